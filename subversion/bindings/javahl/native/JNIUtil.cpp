@@ -202,9 +202,9 @@ bool JNIUtil::JNIGlobalInit(JNIEnv *env)
      explicitly requested. And we don't either, because the caches get
      allocated outside the JVM heap. Duh. */
   {
-    svn_cache_config_t settings = *svn_cache_config_get();
+    svn_cache_config2_t settings = *svn_cache_config_get2();
     settings.single_threaded = FALSE;
-    svn_cache_config_set(&settings);
+    svn_cache_config_set2(&settings);
   }
 
 #ifdef ENABLE_NLS
@@ -36,6 +36,8 @@
 #include "svn_iter.h"
 #include "svn_config.h"
 #include "svn_string.h"
+#include "svn_io.h"
+#include "svn_cache_config.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -169,6 +171,11 @@ typedef struct svn_cache__info_t
    */
   apr_uint64_t used_entries;
 
+  /** Number of entries that have been removed to make room for others.
+   * May be 0 if that information is not available.
+   */
+  apr_uint64_t evictions;
+
   /** Maximum numbers of cache entries.
    * May be 0 if that information is not available.
    */
@@ -179,6 +186,18 @@ typedef struct svn_cache__info_t
    * highest array index.
    */
   apr_uint64_t histogram[32];
+
+  /** Total size of all items passed to the compressor, before and after
+   * compression.  Both are 0 if compression is not being used.
+   */
+  apr_uint64_t compression_input;
+  apr_uint64_t compression_output;
+
+  /** Time spent compressing and decompressing cached items, in
+   * microseconds.
+   */
+  apr_uint64_t compression_time;
+  apr_uint64_t decompression_time;
 } svn_cache__info_t;
 
 /**
@@ -299,6 +318,16 @@ svn_cache__make_memcache_from_config(svn_memcache_t **memcache_p,
  * (no data being written to the cache) if some reader or another writer
  * currently holds the segment lock.
  *
+ * If @a optimistic_reads is set, lookups will first try to access the
+ * @a thread_safe cache without taking the segment lock at all and fall
+ * back to locking only if a concurrent modification has been detected.
+ * Writers only invalidate lookups in the index buckets they actually
+ * modify, so cache hits will rarely block.  This flag is silently ignored
+ * if the platform does not support it.
+ *
+ * @a policy selects the strategy that decides which items to keep when
+ * the cache is full.
+ *
  * Allocations will be made in @a result_pool, in particular the data buffers.
  */
 svn_error_t *
@@ -308,8 +337,70 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
                                   apr_size_t segment_count,
                                   svn_boolean_t thread_safe,
                                   svn_boolean_t allow_blocking_writes,
+                                  svn_boolean_t optimistic_reads,
+                                  svn_cache_policy_t policy,
                                   apr_pool_t *result_pool);
 
+/**
+ * Like svn_cache__membuffer_cache_create() but allocate the cache in an
+ * anonymous shared memory region.  All processes forked from the current
+ * one after this call will share the cache contents with it and with each
+ * other.  They must call svn_cache__membuffer_child_init() first.  The
+ * cache is always safe for concurrent access by multiple threads and
+ * processes.  Since there are no process-shared read-write locks, readers
+ * will lock segments exclusively unless they succeed with
+ * @a optimistic_reads.
+ *
+ * Since cache key prefixes cannot be shared between processes, every
+ * entry will store its full key, i.e. the cache will hold slightly less
+ * data than a private one of the same @a total_size.
+ *
+ * Return #SVN_ERR_UNSUPPORTED_FEATURE if the platform does not provide
+ * anonymous shared memory or suitable process-shared locks.
+ *
+ * @since New in 1.15.
+ */
+svn_error_t *
+svn_cache__membuffer_cache_create_shared(svn_membuffer_t **cache,
+                                         apr_size_t total_size,
+                                         apr_size_t directory_size,
+                                         apr_size_t segment_count,
+                                         svn_boolean_t optimistic_reads,
+                                         svn_cache_policy_t policy,
+                                         apr_pool_t *result_pool);
+
+/**
+ * Prepare the shared membuffer @a cache for use in a process forked from
+ * the one that created it.  This must be called in every such child
+ * before it accesses the cache.  Afterwards, the child will no longer
+ * destroy the process-shared locks when it terminates; they remain owned
+ * by the creating process.  Use @a pool for allocations that must live
+ * as long as the child process accesses the cache.
+ *
+ * This is a no-op if @a cache is @c NULL or has not been created in
+ * shared memory.
+ *
+ * @since New in 1.15.
+ */
+svn_error_t *
+svn_cache__membuffer_child_init(svn_membuffer_t *cache,
+                                apr_pool_t *pool);
+
+/**
+ * Make @a cache store serialized items of @a threshold bytes or more in
+ * LZ4-compressed form, trading CPU time for capacity.  Items that don't
+ * compress well will still be stored as they are.  0 disables compression,
+ * which is the default.
+ *
+ * This must be called before @a cache is being used or any processes
+ * get forked off.
+ *
+ * @since New in 1.15.
+ */
+void
+svn_cache__membuffer_set_compression(svn_membuffer_t *cache,
+                                     apr_size_t threshold);
+
 /**
  * @defgroup Standard priority classes for #svn_cache__create_membuffer_cache.
  * @{
@@ -544,6 +635,46 @@ svn_cache__format_info(const svn_cache__info_t *info,
                        svn_boolean_t access_only,
                        apr_pool_t *result_pool);
 
+/**
+ * Enable or disable (@a enabled) the collection of metrics for caches
+ * that get registered afterwards.  Metrics are disabled by default.
+ *
+ * @since New in 1.15.
+ */
+void
+svn_cache__enable_metrics(svn_boolean_t enabled);
+
+/**
+ * If metrics collection has been enabled, add @a cache to the set of
+ * caches reported by svn_cache__format_metrics() and start recording
+ * its lookup latencies.  The counters of all caches registered with the
+ * same @a kind, e.g. "fsfs:DIR", will be reported as one.  Once @a pool
+ * gets cleaned up, the counters of @a cache will still be included in
+ * the totals reported for @a kind.  Otherwise, this is a no-op.
+ *
+ * Since every distinct @a kind gets reported forever, it must not
+ * contain instance-specific information like repository paths or
+ * transaction IDs.
+ *
+ * @since New in 1.15.
+ */
+svn_error_t *
+svn_cache__register_metrics(svn_cache__t *cache,
+                            const char *kind,
+                            apr_pool_t *pool);
+
+/**
+ * Set @a *metrics to the access counters and lookup latency histograms of
+ * all registered caches, aggregated per cache kind, plus the usage statistics
+ * of the global membuffer cache.  The result will be in the Prometheus text
+ * exposition format and allocated in @a result_pool.
+ *
+ * @since New in 1.15.
+ */
+svn_error_t *
+svn_cache__format_metrics(svn_string_t **metrics,
+                          apr_pool_t *result_pool);
+
 /**
  * Access the process-global (singleton) membuffer cache. The first call
  * will automatically allocate the cache using the current cache config.
@@ -554,6 +685,20 @@ svn_cache__format_info(const svn_cache__info_t *info,
 struct svn_membuffer_t *
 svn_cache__get_global_membuffer_cache(void);
 
+/**
+ * If @a shared is set, allocate the process-global membuffer cache in
+ * shared memory (see svn_cache__membuffer_cache_create_shared()) such
+ * that all processes forked after its creation will use the same cache.
+ * If that is not supported, a private cache will be used instead.
+ *
+ * This must be called before the first call to
+ * svn_cache__get_global_membuffer_cache() to have any effect.
+ *
+ * @since New in 1.15.
+ */
+void
+svn_cache__set_global_membuffer_shared(svn_boolean_t shared);
+
 /**
  * Return total access and size stats over all membuffer caches as they
  * share the underlying data buffer.  The result will be allocated in POOL.
@@ -561,6 +706,60 @@ svn_cache__get_global_membuffer_cache(void);
 svn_cache__info_t *
 svn_cache__membuffer_get_global_info(apr_pool_t *pool);
 
+/**
+ * Callback used by svn_cache__membuffer_dump() and
+ * svn_cache__membuffer_load() to decide whether to write or load
+ * an entry whose cache key starts with @a prefix, i.e. whose front-end
+ * cache has been created with that @a prefix.  Set @a *keep accordingly.
+ * @a baton is the filter baton given to those functions.
+ * Use @a scratch_pool for temporary allocations.
+ *
+ * @since New in 1.15.
+ */
+typedef svn_error_t *(*svn_cache__snapshot_filter_t)(
+  svn_boolean_t *keep,
+  void *baton,
+  const char *prefix,
+  apr_pool_t *scratch_pool);
+
+/**
+ * Write a snapshot of all current contents of @a cache to @a stream.
+ * Segments will be locked only briefly, so concurrent modifications may
+ * or may not be reflected in the snapshot.  If @a filter is not @c NULL,
+ * only write those entries that it accepts.  @a filter_baton will be
+ * passed to @a filter, which will never be called while holding any
+ * cache lock.  The snapshot format is platform-specific.  Use
+ * @a scratch_pool for temporary allocations.
+ *
+ * @since New in 1.15.
+ */
+svn_error_t *
+svn_cache__membuffer_dump(svn_membuffer_t *cache,
+                          svn_stream_t *stream,
+                          svn_cache__snapshot_filter_t filter,
+                          void *filter_baton,
+                          apr_pool_t *scratch_pool);
+
+/**
+ * Read a snapshot written by svn_cache__membuffer_dump() from @a stream
+ * and add its entries to @a cache, as far as it has room for them.  If
+ * @a filter is not @c NULL, only load those entries that it accepts.
+ * @a filter_baton will be passed to @a filter.
+ *
+ * Return #SVN_ERR_CORRUPT_PACKED_DATA if the snapshot is invalid or has
+ * been written on an incompatible platform.  Entries read before that
+ * error was detected will remain in @a cache.  Use @a scratch_pool for
+ * temporary allocations.
+ *
+ * @since New in 1.15.
+ */
+svn_error_t *
+svn_cache__membuffer_load(svn_membuffer_t *cache,
+                          svn_stream_t *stream,
+                          svn_cache__snapshot_filter_t filter,
+                          void *filter_baton,
+                          apr_pool_t *scratch_pool);
+
 /**
  * Remove all current contents from CACHE.
  *
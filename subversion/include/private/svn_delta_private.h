@@ -108,6 +108,69 @@ svn_txdelta__read_raw_window_len(apr_size_t *window_len,
                                  svn_stream_t *stream,
                                  apr_pool_t *pool);
 
+/** Like svn_txdelta_target_push() but instead of matching each target
+ * window only against the source data at the same offset, select the
+ * source view anywhere within @a source that shares the most data with
+ * the respective target window.  This allows for small deltas even if
+ * larger sections have been inserted into, deleted from or moved within
+ * big files.
+ *
+ * The output is a standard svndiff window stream with source views of
+ * at most #SVN_DELTA_WINDOW_SIZE bytes that never slide backwards.
+ *
+ * The selection uses a global index over the source contents that gets
+ * built before this function returns by reading @a index_source to its
+ * end.  @a index_source must have the same contents as @a source and
+ * will not be closed.  Return the writable target stream in @a *stream.
+ * Allocate everything in @a pool; the index takes 12 to 20 bytes per
+ * kByte of source data.
+ */
+svn_error_t *
+svn_txdelta__target_push_large(svn_stream_t **stream,
+                               svn_txdelta_window_handler_t handler,
+                               void *handler_baton,
+                               svn_stream_t *index_source,
+                               svn_stream_t *source,
+                               apr_pool_t *pool);
+
+/** Like svn_txdelta2() but compute the delta windows for consecutive
+ * sections of @a target concurrently on a shared set of worker threads.
+ * Reading from @a source and @a target still happens in the thread that
+ * requests the windows and the windows are returned in the usual order.
+ *
+ * If the result gets passed to svn_txdelta_to_svndiff_stream() before
+ * requesting the first window, the svndiff encoding and compression will
+ * be done on the worker threads as well.  The output is identical to the
+ * one of svn_txdelta2().
+ *
+ * Without APR thread support, this is equivalent to svn_txdelta2().
+ * Allocate everything in @a pool.
+ */
+void
+svn_txdelta__pipelined(svn_txdelta_stream_t **stream,
+                       svn_stream_t *source,
+                       svn_stream_t *target,
+                       svn_boolean_t calculate_checksum,
+                       apr_pool_t *pool);
+
+/** Return in @a *stream a writable stream that produces the same svndiff
+ * data in @a output as svn_txdelta_target_push() would when combined with
+ * svn_txdelta_to_svndiff3() for @a svndiff_version and
+ * @a compression_level.  Delta windows will be computed and encoded
+ * concurrently on a shared set of worker threads, while reading @a source
+ * and writing @a output still happens in the calling thread.
+ *
+ * Closing @a *stream flushes all pending windows and closes @a output.
+ * Allocate everything in @a pool.
+ */
+svn_error_t *
+svn_txdelta__target_push_pipelined(svn_stream_t **stream,
+                                   svn_stream_t *output,
+                                   int svndiff_version,
+                                   int compression_level,
+                                   svn_stream_t *source,
+                                   apr_pool_t *pool);
+
 /* Return a debug editor that wraps @a wrapped_editor.
  *
  * The debug editor simply prints an indication of what callbacks are being
@@ -62,6 +62,18 @@ extern "C" {
 char *
 svn_eol__find_eol_start(char *buf, apr_size_t len);
 
+/* Look for the first occurrence of any of the bytes @a c1, @a c2 and
+ * @a c3 in the array pointed to by @a buf , of length @a len.  To search
+ * for fewer than three distinct values, repeat one of them.
+ * If such a byte is found, return the pointer to it, else return NULL.
+ *
+ * Where supported, this scans 16 or 32 bytes at a time.
+ *
+ * @since New in 1.15
+ */
+char *
+svn_eol__find_chars(char *buf, apr_size_t len, char c1, char c2, char c3);
+
 /* Return the first eol marker found in buffer @a buf as a NUL-terminated
  * string, or NULL if no eol marker is found. Do not examine more than
  * @a len bytes in @a buf.
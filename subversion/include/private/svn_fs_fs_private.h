@@ -157,6 +157,30 @@ typedef struct svn_fs_fs__representation_stats_t
   apr_uint64_t chain_len;
 } svn_fs_fs__representation_stats_t;
 
+/* Statistics on content-chunked file representations and their chunks.
+ */
+typedef struct svn_fs_fs__chunking_stats_t
+{
+  /* number of chunked representations */
+  apr_uint64_t rep_count;
+
+  /* number of chunks referenced by them, counting duplicates */
+  apr_uint64_t chunk_refs;
+
+  /* sum of all referenced chunk sizes after de-deltification,
+   * i.e. total plaintext content of all chunked representations */
+  apr_uint64_t expanded_size;
+
+  /* number of distinct chunks */
+  apr_uint64_t chunk_count;
+
+  /* total plaintext content of all distinct chunks */
+  apr_uint64_t chunk_expanded_size;
+
+  /* total on-disk size of all distinct chunks */
+  apr_uint64_t chunk_size;
+} svn_fs_fs__chunking_stats_t;
+
 /* Basic statistics we collect over a given set of noderevs.
  */
 typedef struct svn_fs_fs__node_stats_t
@@ -200,6 +224,9 @@ typedef struct svn_fs_fs__stats_t
   /* stats on all directory prop representations */
   svn_fs_fs__representation_stats_t dir_prop_rep_stats;
 
+  /* content chunking and deduplication summary */
+  svn_fs_fs__chunking_stats_t chunking_stats;
+
   /* size and count summary over all noderevs */
   svn_fs_fs__node_stats_t total_node_stats;
 
@@ -364,6 +391,76 @@ typedef struct svn_fs_fs__ioctl_build_rep_cache_input_t
 /* See svn_fs_fs__build_rep_cache(). */
 SVN_FS_DECLARE_IOCTL_CODE(SVN_FS_FS__IOCTL_BUILD_REP_CACHE, SVN_FS_TYPE_FSFS, 1004);
 
+typedef struct svn_fs_fs__ioctl_build_path_index_input_t
+{
+  svn_fs_progress_notify_func_t progress_func;
+  void *progress_baton;
+} svn_fs_fs__ioctl_build_path_index_input_t;
+
+/* Create the changed-path index, if it does not exist yet, and add all
+ * revisions to it that it does not cover yet.  Once created, the index
+ * is maintained by every commit. */
+SVN_FS_DECLARE_IOCTL_CODE(SVN_FS_FS__IOCTL_BUILD_PATH_INDEX, SVN_FS_TYPE_FSFS, 1005);
+
+typedef struct svn_fs_fs__ioctl_path_revisions_input_t
+{
+  const char *path;
+  svn_revnum_t start;
+  svn_revnum_t end;
+} svn_fs_fs__ioctl_path_revisions_input_t;
+
+typedef struct svn_fs_fs__ioctl_path_revisions_output_t
+{
+  /* Sorted array of svn_revnum_t or NULL if the index is not available. */
+  apr_array_header_t *revisions;
+} svn_fs_fs__ioctl_path_revisions_output_t;
+
+/* Return the revisions in which PATH, one of its parents or anything
+ * below PATH got changed.  See svn_fs_fs__path_index_get_revisions(). */
+SVN_FS_DECLARE_IOCTL_CODE(SVN_FS_FS__IOCTL_PATH_REVISIONS, SVN_FS_TYPE_FSFS, 1006);
+
+/* Number of entries in svn_fs_fs__chain_stats_t.CHAIN_LENGTHS. */
+#define SVN_FS_FS__CHAIN_LENGTH_BUCKETS 32
+
+/* Delta chain statistics gathered while reading deltified contents
+ * through one svn_fs_t. */
+typedef struct svn_fs_fs__chain_stats_t
+{
+  /* Number of fulltext windows reconstructed from delta windows. */
+  apr_uint64_t windows;
+
+  /* Total number of delta windows read and applied for them. */
+  apr_uint64_t links_walked;
+
+  /* Total number of delta windows that did not need to be read and
+   * applied because a partially composed window had been cached. */
+  apr_uint64_t links_saved;
+
+  /* Number of fulltext windows that could start from a cached partially
+   * composed window. */
+  apr_uint64_t partial_hits;
+
+  /* CHAIN_LENGTHS[i] is the number of fulltext windows that required
+   * I delta windows to be applied.  The last entry also counts all
+   * longer chains. */
+  apr_uint64_t chain_lengths[SVN_FS_FS__CHAIN_LENGTH_BUCKETS];
+} svn_fs_fs__chain_stats_t;
+
+typedef struct svn_fs_fs__ioctl_get_chain_stats_input_t
+{
+  /* Reset the counters after reading them. */
+  svn_boolean_t reset;
+} svn_fs_fs__ioctl_get_chain_stats_input_t;
+
+typedef struct svn_fs_fs__ioctl_get_chain_stats_output_t
+{
+  svn_fs_fs__chain_stats_t stats;
+} svn_fs_fs__ioctl_get_chain_stats_output_t;
+
+/* Return the delta chain statistics of the svn_fs_t the ioctl is sent to.
+ * The input may be NULL, in which case the counters are not reset. */
+SVN_FS_DECLARE_IOCTL_CODE(SVN_FS_FS__IOCTL_GET_CHAIN_STATS, SVN_FS_TYPE_FSFS, 1007);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
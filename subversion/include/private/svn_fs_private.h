@@ -68,6 +68,15 @@ svn_fs__access_get_lock_tokens(svn_fs_access_t *access_ctx);
 svn_error_t *
 svn_fs__path_valid(const char *path, apr_pool_t *pool);
 
+/* Pass the warning ERR to the warning callback of FS, just as FS itself
+ * would do.  ERR will not be cleared.
+ *
+ * This allows code working with private instances of a filesystem, e.g.
+ * in worker threads, to report their warnings through FS.
+ */
+void
+svn_fs__warn(svn_fs_t *fs, svn_error_t *err);
+
 
 
 /** Editors
@@ -157,6 +157,15 @@ svn_stream__from_aprfile(apr_file_t *file,
                          svn_boolean_t truncate_on_seek,
                          apr_pool_t *pool);
 
+/* Tell the OS that the LENGTH bytes of FILE starting at OFFSET will be
+   read soon, so it may start fetching them into its cache in the
+   background.  This is merely a hint: it never blocks on the actual I/O
+   and does nothing on platforms that don't support it. */
+void
+svn_io__file_prefetch(apr_file_t *file,
+                      apr_off_t offset,
+                      apr_off_t length);
+
 #if defined(WIN32)
 
 /* ### Move to something like io.h or subr.h, to avoid making it
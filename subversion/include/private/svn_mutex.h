@@ -104,6 +104,43 @@ do {                                                    \
   SVN_ERR(svn_mutex__unlock(svn_mutex__m, (expr)));     \
 } while (0)
 
+/**
+ * This is a simple wrapper around @c apr_thread_cond_t and will be a
+ * valid identifier even if APR does not support threading.
+ */
+
+/** A condition variable for synchronization between threads.  It is
+ * always used together with a #svn_mutex__t.
+ */
+typedef struct svn_thread_cond__t svn_thread_cond__t;
+
+/** Create the condition variable @a *cond with a lifetime defined by
+ * @a result_pool.
+ *
+ * If threading is not supported by APR, this merely allocates a dummy.
+ */
+svn_error_t *
+svn_thread_cond__create(svn_thread_cond__t **cond,
+                        apr_pool_t *result_pool);
+
+/** Wake up all threads waiting for @a cond.
+ *
+ * If threading is not supported by APR, this function is a no-op.
+ */
+svn_error_t *
+svn_thread_cond__broadcast(svn_thread_cond__t *cond);
+
+/** Release @a mutex, which the current thread must have acquired through
+ * svn_mutex__lock(), wait for @a cond to be signaled and acquire @a mutex
+ * again.  @a mutex must not be @c NULL.  Callers must be prepared for
+ * spurious wake-ups.
+ *
+ * If threading is not supported by APR, this function is a no-op.
+ */
+svn_error_t *
+svn_thread_cond__wait(svn_thread_cond__t *cond,
+                      svn_mutex__t *mutex);
+
 #if APR_HAS_THREADS
 
 /** Return the APR mutex encapsulated in @a mutex.
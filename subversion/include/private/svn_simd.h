@@ -0,0 +1,84 @@
+/**
+ * @copyright
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ * @endcopyright
+ *
+ * @file svn_simd.h
+ * @brief Compile-time and runtime detection of SIMD instruction sets
+ */
+
+#ifndef SVN_SIMD_H
+#define SVN_SIMD_H
+
+#include "svn_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* SSE2 is part of the x86-64 baseline, so whenever the compiler targets
+ * it, it may be used unconditionally.  Users include <emmintrin.h>.
+ */
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) \
+    || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SVN__SSE2 1
+#endif
+
+/* AVX2 code must be compiled for that target explicitly and may only be
+ * called after svn_simd__have_avx2() returned TRUE.  We support that with
+ * compilers providing per-function target attributes and
+ * __builtin_cpu_supports (GCC 4.9+ and clang).  Users include
+ * <immintrin.h> and mark their AVX2 functions with SVN__TARGET_AVX2.
+ */
+#if defined(SVN__SSE2) && (defined(__x86_64__) || defined(__i386__)) \
+    && (defined(__clang__) \
+        || (defined(__GNUC__) \
+            && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#define SVN__AVX2 1
+#define SVN__TARGET_AVX2 __attribute__((target("avx2")))
+
+/* The same applies to the SHA extensions, which also require SSSE3 and
+ * SSE4.1.  Check with svn_simd__have_sha().
+ */
+#define SVN__SHA_NI 1
+#define SVN__TARGET_SHA __attribute__((target("sha,sse4.1,ssse3")))
+#endif
+
+/**
+ * Return TRUE if AVX2 code may be executed on the current CPU.  This is
+ * always FALSE if @c SVN__AVX2 is not defined.  The result is cached,
+ * so this is cheap enough to call for every buffer being processed.
+ */
+svn_boolean_t
+svn_simd__have_avx2(void);
+
+/**
+ * Return TRUE if code using the x86 SHA extensions may be executed on the
+ * current CPU.  This is always FALSE if @c SVN__SHA_NI is not defined.
+ * The result is cached.
+ */
+svn_boolean_t
+svn_simd__have_sha(void);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* SVN_SIMD_H */
@@ -295,6 +295,76 @@ svn_checksum__wrap_write_stream_fnv1a_32x4(apr_uint32_t *digest,
                                            svn_stream_t *inner_stream,
                                            apr_pool_t *pool);
 
+/**
+ * Opaque context computing MD5 and SHA-1 digests over the same data in
+ * a single pass.
+ *
+ * @since New in 1.15
+ */
+typedef struct svn_checksum__multi_ctx_t svn_checksum__multi_ctx_t;
+
+/**
+ * Return a new multi-digest context, allocated in @a pool, that computes
+ * an MD5 digest if @a md5 is set and a SHA-1 digest if @a sha1 is set.
+ *
+ * @since New in 1.15
+ */
+svn_checksum__multi_ctx_t *
+svn_checksum__multi_ctx_create(svn_boolean_t md5,
+                               svn_boolean_t sha1,
+                               apr_pool_t *pool);
+
+/**
+ * Reset @a ctx to its initial state.
+ *
+ * @since New in 1.15
+ */
+svn_error_t *
+svn_checksum__multi_ctx_reset(svn_checksum__multi_ctx_t *ctx);
+
+/**
+ * Feed @a len bytes from @a data into all digests of @a ctx.  The data
+ * is processed in cache-sized chunks such that it is read from memory
+ * only once.
+ *
+ * @since New in 1.15
+ */
+svn_error_t *
+svn_checksum__multi_update(svn_checksum__multi_ctx_t *ctx,
+                           const void *data,
+                           apr_size_t len);
+
+/**
+ * Return the digests of all data fed into @a ctx in @a *md5_checksum
+ * and @a *sha1_checksum, allocated in @a pool.  Either output may be
+ * NULL.  Digests not computed by @a ctx are returned as NULL.
+ *
+ * @since New in 1.15
+ */
+svn_error_t *
+svn_checksum__multi_final(svn_checksum_t **md5_checksum,
+                          svn_checksum_t **sha1_checksum,
+                          const svn_checksum__multi_ctx_t *ctx,
+                          apr_pool_t *pool);
+
+/**
+ * Return a stream that calculates the MD5 checksum, if @a md5_checksum
+ * is not NULL, and the SHA-1 checksum, if @a sha1_checksum is not NULL,
+ * over all data written to the @a inner_stream in a single pass.  When
+ * the returned stream gets closed, write the results to the respective
+ * output parameters.  Allocate the result in @a pool.
+ *
+ * @note The stream returned only supports #svn_stream_write,
+ * #svn_stream_close and, if @a inner_stream does, #svn_stream_reset.
+ *
+ * @since New in 1.15
+ */
+svn_stream_t *
+svn_checksum__wrap_write_stream_multi(svn_checksum_t **md5_checksum,
+                                      svn_checksum_t **sha1_checksum,
+                                      svn_stream_t *inner_stream,
+                                      apr_pool_t *pool);
+
 /**
  * Return a 32 bit FNV-1a checksum for the first @a len bytes in @a input.
  *
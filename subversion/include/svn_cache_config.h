@@ -38,12 +38,69 @@ extern "C" {
  * @{
  * @since New in 1.7. */
 
+/** Strategies that decide which data to keep in the cache.
+
+   @since New in 1.15.
+ */
+typedef enum svn_cache_policy_t
+{
+  /** Evict data based on item priority and hit counts.  Every new item
+     will be admitted to the cache. */
+  svn_cache_policy_default = 0,
+
+  /** Keep track of the access frequency of recently requested items,
+     including those not in the cache.  New items only replace cached
+     data that has been requested less often and data that gets hit
+     repeatedly will be protected from eviction.  This prevents one-time
+     bulk access, e.g. through "svnadmin verify" or a checkout of a large
+     old tag, from evicting the working set.  Uses about 1 byte of extra
+     memory per index entry. */
+  svn_cache_policy_tinylfu
+} svn_cache_policy_t;
+
 /** Cache resource settings. It controls what caches, in what size and
    how they will be created. The settings apply for the whole process.
 
-   @note Do not extend this data structure as this would break binary
-         compatibility.
+   @note Do not extend this data structure once it has been released as
+         this would break binary compatibility.  Until 1.15.0 gets
+         released, no binary depends on its size yet and members may
+         still be appended.
+
+   @since New in 1.15.
+ */
+typedef struct svn_cache_config2_t
+{
+  /** total cache size in bytes. Please note that this is only soft limit
+     to the total application memory usage and will be exceeded due to
+     temporary objects and other program state.
+     May be 0, resulting in default caching code being used. */
+  apr_uint64_t cache_size;
+
+  /** maximum number of files kept open */
+  apr_size_t file_handle_count;
+
+  /** is this application guaranteed to be single-threaded? */
+  svn_boolean_t single_threaded;
+
+  /** admission and eviction strategy to use */
+  svn_cache_policy_t policy;
+
+  /** store cached items of at least this many bytes in compressed form.
+     0 disables compression. */
+  apr_size_t compression_threshold;
+
+  /** let readers access the cache without locking it, retrying if a
+     concurrent writer interfered.  FALSE always locks for reading. */
+  svn_boolean_t optimistic_reads;
+
+  /* DON'T add new members here after 1.15.0 has been released.  Bump
+     struct and API version instead. */
+} svn_cache_config2_t;
+
+/** Similar to #svn_cache_config2_t but without the @c policy,
+   @c compression_threshold and @c optimistic_reads members.
 
+   @deprecated Provided for backward compatibility with the 1.14 API.
    @since New in 1.7.
  */
 typedef struct svn_cache_config_t
@@ -66,8 +123,17 @@ typedef struct svn_cache_config_t
 /** Get the current cache configuration. If it has not been set,
    this function will return the default settings.
 
+   @since New in 1.15.
+ */
+const svn_cache_config2_t *
+svn_cache_config_get2(void);
+
+/** Similar to svn_cache_config_get2() but returns the old struct type.
+
+   @deprecated Provided for backward compatibility with the 1.14 API.
    @since New in 1.7.
  */
+SVN_DEPRECATED
 const svn_cache_config_t *
 svn_cache_config_get(void);
 
@@ -78,8 +144,18 @@ svn_cache_config_get(void);
    This function is not thread-safe. Therefore, it should be called
    from the processes' initialization code only.
 
+   @since New in 1.15.
+ */
+void
+svn_cache_config_set2(const svn_cache_config2_t *settings);
+
+/** Similar to svn_cache_config_set2() but uses the old struct type.
+   The cache policy remains unchanged.
+
+   @deprecated Provided for backward compatibility with the 1.14 API.
    @since New in 1.7.
  */
+SVN_DEPRECATED
 void
 svn_cache_config_set(const svn_cache_config_t *settings);
 
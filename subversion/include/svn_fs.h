@@ -227,6 +227,18 @@ typedef struct svn_fs_t svn_fs_t;
  */
 #define SVN_FS_CONFIG_NO_FLUSH_TO_DISK          "no-flush-to-disk"
 
+/** Enable / disable an in-memory filter of the SHA1 checksums in a FSFS
+ * repository's rep-cache.  With the filter, looking up content that has
+ * not been stored before does not need to query the rep-cache database.
+ *
+ * The filter has to be built by reading the whole rep-cache and becomes
+ * useless as soon as some other process commits to the repository.  It
+ * is meant for bulk operations like loading a dump file.
+ *
+ * @since New in 1.15.
+ */
+#define SVN_FS_CONFIG_FSFS_REP_CACHE_FILTER     "fsfs-rep-cache-filter"
+
 /** @} */
 
 
@@ -553,10 +565,34 @@ typedef void (*svn_fs_hotcopy_notify_t)(void *baton,
  * @a cancel_baton as usual to allow the user to preempt this potentially
  * lengthy operation.
  *
+ * If @a jobs is larger than 1, back-ends may copy up to @a jobs parts of
+ * the filesystem concurrently.  Notifications are still sent in revision
+ * order and only from the calling thread.  Back-ends that don't support
+ * concurrent copying ignore @a jobs.
+ *
  * Use @a scratch_pool for temporary allocations.
  *
+ * @since New in 1.15.
+ */
+svn_error_t *
+svn_fs_hotcopy4(const char *src_path,
+                const char *dest_path,
+                svn_boolean_t clean,
+                svn_boolean_t incremental,
+                int jobs,
+                svn_fs_hotcopy_notify_t notify_func,
+                void *notify_baton,
+                svn_cancel_func_t cancel_func,
+                void *cancel_baton,
+                apr_pool_t *scratch_pool);
+
+/**
+ * Like svn_fs_hotcopy4(), but with @a jobs always being 1.
+ *
  * @since New in 1.9.
+ * @deprecated Provided for backward compatibility with the 1.14 API.
  */
+SVN_DEPRECATED
 svn_error_t *
 svn_fs_hotcopy3(const char *src_path,
                 const char *dest_path,
@@ -3304,8 +3340,33 @@ typedef svn_error_t *(*svn_fs_pack_notify_t)(void *baton,
  * Possibly update the filesystem located in the directory @a path
  * to use disk space more efficiently.
  *
+ * If @a jobs is larger than 1, back-ends may process up to @a jobs
+ * independent parts of the filesystem concurrently.  The visible state
+ * of the filesystem will still advance strictly in order.  Back-ends
+ * that don't support concurrent packing ignore @a jobs.  0 is treated
+ * as 1.
+ *
+ * @a notify_func and @a cancel_func will only be called from the calling
+ * thread, even when packing concurrently.
+ *
+ * @since New in 1.15.
+ */
+svn_error_t *
+svn_fs_pack2(const char *db_path,
+             int jobs,
+             svn_fs_pack_notify_t notify_func,
+             void *notify_baton,
+             svn_cancel_func_t cancel_func,
+             void *cancel_baton,
+             apr_pool_t *pool);
+
+/**
+ * Like svn_fs_pack2(), but with @a jobs always being 1.
+ *
  * @since New in 1.6.
+ * @deprecated Provided for backward compatibility with the 1.14 API.
  */
+SVN_DEPRECATED
 svn_error_t *
 svn_fs_pack(const char *db_path,
             svn_fs_pack_notify_t notify_func,
@@ -3341,8 +3402,15 @@ svn_fs_pack(const char *db_path,
  * The optional @a cancel_func callback will be invoked as usual to allow
  * the user to preempt this potentially lengthy operation.
  *
+ * If @a jobs is larger than 1, back-ends may run up to @a jobs checks
+ * concurrently.  Back-ends that don't support concurrent verification
+ * ignore @a jobs.
+ *
+ * @a notify_func and @a cancel_func will only be called from the calling
+ * thread, even when verifying concurrently.
+ *
  * @note You probably don't want to use this directly.  Take a look at
- * svn_repos_verify_fs2() instead, which does non-backend-specific
+ * svn_repos_verify_fs4() instead, which does non-backend-specific
  * verifications as well.
  *
  * @note To ensure a full verification using all tests and covering all
@@ -3352,11 +3420,30 @@ svn_fs_pack(const char *db_path,
  * a single revision in #svn_fs_verify_root.  This function is meant for
  * global checks or tests that require an expensive context setup.
  *
- * @see svn_repos_verify_fs2()
+ * @see svn_repos_verify_fs4()
  * @see svn_fs_verify_root()
  *
+ * @since New in 1.15.
+ */
+svn_error_t *
+svn_fs_verify2(const char *path,
+               apr_hash_t *fs_config,
+               svn_revnum_t start,
+               svn_revnum_t end,
+               int jobs,
+               svn_fs_progress_notify_func_t notify_func,
+               void *notify_baton,
+               svn_cancel_func_t cancel_func,
+               void *cancel_baton,
+               apr_pool_t *scratch_pool);
+
+/**
+ * Like svn_fs_verify2(), but with @a jobs always being 1.
+ *
  * @since New in 1.8.
+ * @deprecated Provided for backward compatibility with the 1.14 API.
  */
+SVN_DEPRECATED
 svn_error_t *
 svn_fs_verify(const char *path,
               apr_hash_t *fs_config,
@@ -680,10 +680,32 @@ svn_repos_fs_type(svn_repos_t *repos,
  * @a cancel_baton as usual to allow the user to preempt this potentially
  * lengthy operation.
  *
+ * Up to @a jobs parts of the filesystem may be copied concurrently;
+ * see svn_fs_hotcopy4().
+ *
  * Use @a scratch_pool for temporary allocations.
  *
+ * @since New in 1.15.
+ */
+svn_error_t *
+svn_repos_hotcopy4(const char *src_path,
+                   const char *dst_path,
+                   svn_boolean_t clean_logs,
+                   svn_boolean_t incremental,
+                   int jobs,
+                   svn_repos_notify_func_t notify_func,
+                   void *notify_baton,
+                   svn_cancel_func_t cancel_func,
+                   void *cancel_baton,
+                   apr_pool_t *scratch_pool);
+
+/**
+ * Like svn_repos_hotcopy4(), but with @a jobs always being 1.
+ *
  * @since New in 1.9.
+ * @deprecated Provided for backward compatibility with the 1.14 API.
  */
+SVN_DEPRECATED
 svn_error_t *
 svn_repos_hotcopy3(const char *src_path,
                    const char *dst_path,
@@ -728,10 +750,28 @@ svn_repos_hotcopy(const char *src_path,
 
 /**
  * Possibly update the repository, @a repos, to use a more efficient
- * filesystem representation.  Use @a pool for allocations.
+ * filesystem representation.  Up to @a jobs independent parts of the
+ * repository may be processed concurrently; see svn_fs_pack2().
+ * Use @a pool for allocations.
+ *
+ * @since New in 1.15.
+ */
+svn_error_t *
+svn_repos_fs_pack3(svn_repos_t *repos,
+                   int jobs,
+                   svn_repos_notify_func_t notify_func,
+                   void *notify_baton,
+                   svn_cancel_func_t cancel_func,
+                   void *cancel_baton,
+                   apr_pool_t *pool);
+
+/**
+ * Similar to svn_repos_fs_pack3(), but with @a jobs always being 1.
  *
  * @since New in 1.7.
+ * @deprecated Provided for backward compatibility with the 1.14 API.
  */
+SVN_DEPRECATED
 svn_error_t *
 svn_repos_fs_pack2(svn_repos_t *repos,
                    svn_repos_notify_func_t notify_func,
@@ -3224,12 +3264,43 @@ typedef svn_error_t *(*svn_repos_verify_callback_t)(void *baton,
  * cancel_baton as argument to see if the caller wishes to cancel the
  * verification.
  *
+ * If @a jobs is larger than 1, verify up to @a jobs chunks of revisions
+ * concurrently, each using a separate instance of the filesystem, and let
+ * the back-end check its metadata concurrently as well (see
+ * svn_fs_verify2()).  Notifications, calls to @a verify_callback and
+ * warnings of the worker filesystems, which get passed on to the warning
+ * function of the filesystem of @a repos, are still made from the calling
+ * thread and in revision order.  @a cancel_func will only be called from
+ * the calling thread as well.
+ *
  * Use @a scratch_pool for temporary allocation.
  *
  * @see svn_repos_verify_callback_t
  *
+ * @since New in 1.15.
+ */
+svn_error_t *
+svn_repos_verify_fs4(svn_repos_t *repos,
+                     svn_revnum_t start_rev,
+                     svn_revnum_t end_rev,
+                     svn_boolean_t check_normalization,
+                     svn_boolean_t metadata_only,
+                     int jobs,
+                     svn_repos_notify_func_t notify_func,
+                     void *notify_baton,
+                     svn_repos_verify_callback_t verify_callback,
+                     void *verify_baton,
+                     svn_cancel_func_t cancel,
+                     void *cancel_baton,
+                     apr_pool_t *scratch_pool);
+
+/**
+ * Like svn_repos_verify_fs4(), but with @a jobs always being 1.
+ *
  * @since New in 1.9.
+ * @deprecated Provided for backward compatibility with the 1.14 API.
  */
+SVN_DEPRECATED
 svn_error_t *
 svn_repos_verify_fs3(svn_repos_t *repos,
                      svn_revnum_t start_rev,
@@ -47,6 +47,7 @@
 #include "svn_props.h"
 
 #include "client.h"
+#include "private/svn_delta_private.h"
 #include "private/svn_ra_private.h"
 #include "private/svn_sorts_private.h"
 #include "private/svn_subr_private.h"
@@ -97,8 +98,8 @@ open_txdelta_stream(svn_txdelta_stream_t **txdelta_stream_p,
     }
 
   /* Get the delta stream (delta against the empty string). */
-  svn_txdelta2(txdelta_stream_p, svn_stream_empty(result_pool),
-               b->stream, FALSE, result_pool);
+  svn_txdelta__pipelined(txdelta_stream_p, svn_stream_empty(result_pool),
+                         b->stream, FALSE, result_pool);
   b->need_reset = TRUE;
   return SVN_NO_ERROR;
 }
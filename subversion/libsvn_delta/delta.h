@@ -45,6 +45,16 @@ extern "C" {
 #define SVN_DELTA_WINDOW_SIZE 102400
 
 
+/* Text delta stream descriptor. */
+
+struct svn_txdelta_stream_t {
+  /* Copied from parameters to svn_txdelta_stream_create. */
+  void *baton;
+  svn_txdelta_next_window_fn_t next_window;
+  svn_txdelta_md5_digest_fn_t md5_digest;
+};
+
+
 /* Context/baton for building an operation sequence. */
 
 typedef struct svn_txdelta__ops_baton_t {
@@ -88,6 +98,53 @@ void svn_txdelta__xdelta(svn_txdelta__ops_baton_t *build_baton,
                          apr_size_t target_len,
                          apr_pool_t *pool);
 
+/* Compute and return a delta window using the xdelta algorithm on
+   DATA, which contains SOURCE_LEN bytes of source data and TARGET_LEN
+   bytes of target data.  SOURCE_OFFSET gives the offset of the source
+   data, and is simply copied into the window's sview_offset field. */
+svn_txdelta_window_t *
+svn_txdelta__compute_window(const char *data,
+                            apr_size_t source_len,
+                            apr_size_t target_len,
+                            svn_filesize_t source_offset,
+                            apr_pool_t *pool);
+
+/* Return the pseudo-adler32 checksum that svn_txdelta__xdelta() uses for
+   the 64 byte block at DATA.  If SCALAR is set, use the portable code even
+   if a vectorized implementation is available.  For use by the tests. */
+apr_uint32_t
+svn_txdelta__adler32(const char *data,
+                     svn_boolean_t scalar);
+
+/* Encode WINDOW in svndiff format VERSION, using COMPRESSION_LEVEL, and
+   return the resulting bytes in *SVNDIFF.  The output is the same as
+   svn_txdelta_to_svndiff3() would write for WINDOW, excluding the
+   svndiff stream header.  Allocate *SVNDIFF in POOL. */
+svn_error_t *
+svn_txdelta__encode_window(svn_stringbuf_t **svndiff,
+                           const svn_txdelta_window_t *window,
+                           int version,
+                           int compression_level,
+                           apr_pool_t *pool);
+
+/* If STREAM has been created by svn_txdelta__pipelined() and no window
+   has been requested from it yet, make it encode all windows in svndiff
+   format VERSION with COMPRESSION_LEVEL on its worker threads and return
+   TRUE.  Otherwise, return FALSE. */
+svn_boolean_t
+svn_txdelta__pipelined_encode(svn_txdelta_stream_t *stream,
+                              int version,
+                              int compression_level);
+
+/* Set *SVNDIFF to the next window from STREAM, encoded as requested by
+   svn_txdelta__pipelined_encode(), or to NULL at the end of the stream.
+   *SVNDIFF remains valid until the next call; it does not include the
+   svndiff stream header.  Use POOL for temporary allocations. */
+svn_error_t *
+svn_txdelta__pipelined_next_svndiff(svn_stringbuf_t **svndiff,
+                                    svn_txdelta_stream_t *stream,
+                                    apr_pool_t *pool);
+
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,728 @@
+/*
+ * pipeline.c:  compute and encode delta windows concurrently.
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+
+#include <string.h>
+
+#include <apr_thread_pool.h>
+
+#include "svn_delta.h"
+#include "svn_checksum.h"
+#include "svn_pools.h"
+#include "delta.h"
+#include "svn_private_config.h"
+
+#include "private/svn_atomic.h"
+#include "private/svn_delta_private.h"
+#include "private/svn_dep_compat.h"
+#include "private/svn_mutex.h"
+
+/* Computing a delta window and compressing it are purely CPU-bound and
+ * independent of all other windows.  The only sequential parts are
+ * reading the source and target data and writing the svndiff output.
+ *
+ * So, we read the data for up to MAX_JOBS windows ahead, let the worker
+ * threads turn them into delta windows and svndiff data, and hand the
+ * results out in their original order.  The window boundaries are the
+ * same as for the sequential txdelta and target push streams.  Hence,
+ * the output does not depend on whether or how many threads were used.
+ */
+
+/* Maximum number of windows that a single pipeline keeps in flight.
+ * Each of them may take about 3 * SVN_DELTA_WINDOW_SIZE of memory. */
+#define MAX_JOBS 8
+
+#if APR_HAS_THREADS
+
+/* Number of microseconds that an unused thread remains in the pool before
+ * being terminated. */
+#define THREADPOOL_THREAD_IDLE_LIMIT 1000000
+
+/* Maximum number of worker threads, shared by all pipelines within this
+ * process. */
+#define MAX_THREADS 16
+
+/* Thread pool to execute the window jobs. */
+static apr_thread_pool_t *thread_pool = NULL;
+
+#endif
+
+/* Keep track on whether we already created the THREAD_POOL . */
+static svn_atomic_t thread_pool_initialized = FALSE;
+
+#if APR_HAS_THREADS
+
+/* Destructor function that implicitly cleans up any running threads
+   in the THREAD_POOL *once*.
+
+   Must be run as a pre-cleanup hook.
+ */
+static apr_status_t
+thread_pool_pre_cleanup(void *data)
+{
+  apr_thread_pool_t *tp = thread_pool;
+  if (!thread_pool)
+    return APR_SUCCESS;
+
+  thread_pool = NULL;
+  thread_pool_initialized = FALSE;
+
+  return apr_thread_pool_destroy(tp);
+}
+
+#endif
+
+/* Core implementation of pipeline_create.  Create the global THREAD_POOL.
+ * It lives until APR gets terminated. */
+static svn_error_t *
+create_thread_pool(void *baton,
+                   apr_pool_t *scratch_pool)
+{
+#if APR_HAS_THREADS
+  /* The thread-pool must be allocated from a thread-safe pool. */
+  apr_pool_t *pool = svn_pool_create(NULL);
+  apr_status_t status;
+
+  status = apr_thread_pool_create(&thread_pool, 0, MAX_THREADS, pool);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't create delta thread pool"));
+
+  /* Work around an APR bug:  The cleanup must happen in the pre-cleanup
+     hook instead of the normal cleanup hook.  Otherwise, the sub-pools
+     containing the thread objects would already be invalid. */
+  apr_pool_pre_cleanup_register(pool, NULL, thread_pool_pre_cleanup);
+
+  /* let idle threads linger for a while in case more files are
+     coming in */
+  apr_thread_pool_idle_wait_set(thread_pool, THREADPOOL_THREAD_IDLE_LIMIT);
+
+  /* don't queue requests unless we reached the worker thread limit */
+  apr_thread_pool_threshold_set(thread_pool, 0);
+
+#endif
+
+  return SVN_NO_ERROR;
+}
+
+
+/* Forward declaration. */
+typedef struct pipeline_t pipeline_t;
+
+/* The data and results for a single delta window.
+ */
+typedef struct window_job_t
+{
+  /* Source data immediately followed by the target data.
+   * 2 * SVN_DELTA_WINDOW_SIZE bytes, allocated on first use. */
+  char *buf;
+  apr_size_t source_len;
+  apr_size_t target_len;
+  svn_filesize_t source_offset;
+
+  /* The results.  SVNDIFF is NULL if the pipeline does not encode. */
+  svn_txdelta_window_t *window;
+  svn_stringbuf_t *svndiff;
+  svn_error_t *err;
+
+  /* Set once the results are available.  Protected by the pipeline's
+   * MUTEX while the job is in flight. */
+  svn_boolean_t done;
+
+  /* Pool for the results.  Since the job may be processed in a separate
+   * thread, this is a root pool with its own allocator.  Only one thread
+   * uses it at any time, so the allocator needs no mutex.  NULL until the
+   * job gets used for the first time. */
+  apr_pool_t *pool;
+
+  /* The pipeline that this job belongs to. */
+  pipeline_t *pipeline;
+} window_job_t;
+
+/* Ring buffer of window jobs plus the means to wait for them.
+ */
+struct pipeline_t
+{
+  window_job_t jobs[MAX_JOBS];
+
+  /* Index of the oldest job in flight and number of jobs in flight. */
+  int first;
+  int count;
+
+  /* svndiff format to encode the windows in.  -1 means no encoding. */
+  int svndiff_version;
+  int compression_level;
+
+  /* If FALSE, all jobs get processed in the calling thread. */
+  svn_boolean_t threaded;
+
+  /* Signaled whenever a worker completed a job. */
+  svn_mutex__t *mutex;
+  svn_thread_cond__t *cond;
+
+  /* Allocate the job buffers from here. */
+  apr_pool_t *pool;
+};
+
+/* Compute the results for JOB. */
+static svn_error_t *
+process_job(window_job_t *job)
+{
+  pipeline_t *pipeline = job->pipeline;
+
+  job->window = svn_txdelta__compute_window(job->buf, job->source_len,
+                                            job->target_len,
+                                            job->source_offset, job->pool);
+  if (pipeline->svndiff_version >= 0)
+    SVN_ERR(svn_txdelta__encode_window(&job->svndiff, job->window,
+                                       pipeline->svndiff_version,
+                                       pipeline->compression_level,
+                                       job->pool));
+
+  return SVN_NO_ERROR;
+}
+
+#if APR_HAS_THREADS
+
+/* Thread-pool task processing the window_job_t instance given by DATA. */
+static void * APR_THREAD_FUNC
+job_task(apr_thread_t *tid,
+         void *data)
+{
+  window_job_t *job = data;
+  pipeline_t *pipeline = job->pipeline;
+  svn_error_t *err = process_job(job);
+
+  /* As soon as we release the mutex, the main thread may recycle JOB or
+     even destroy the whole PIPELINE.  Errors in the synchronization would
+     leave the main thread waiting forever anyway, so we don't report
+     them. */
+  svn_error_clear(svn_mutex__lock(pipeline->mutex));
+  job->err = err;
+  job->done = TRUE;
+  svn_error_clear(svn_thread_cond__broadcast(pipeline->cond));
+  svn_error_clear(svn_mutex__unlock(pipeline->mutex, SVN_NO_ERROR));
+
+  return NULL;
+}
+
+#endif
+
+/* Wait until JOB in PIPELINE has been processed. */
+static svn_error_t *
+wait_for_job(pipeline_t *pipeline,
+             window_job_t *job)
+{
+  svn_boolean_t done = FALSE;
+
+  /* This loop implicitly handles spurious wake-ups. */
+  do
+    {
+      SVN_ERR(svn_mutex__lock(pipeline->mutex));
+
+      if (job->done)
+        done = TRUE;
+      else
+        SVN_ERR(svn_thread_cond__wait(pipeline->cond, pipeline->mutex));
+
+      SVN_ERR(svn_mutex__unlock(pipeline->mutex, SVN_NO_ERROR));
+    }
+  while (!done);
+
+  return SVN_NO_ERROR;
+}
+
+/* Pool cleanup function for pipeline_t given as DATA.  Wait for all jobs
+ * still in flight, because they reference the pipeline's memory, and
+ * release the job pools. */
+static apr_status_t
+pipeline_cleanup(void *data)
+{
+  pipeline_t *pipeline = data;
+  int i;
+
+  for (i = 0; i < pipeline->count; ++i)
+    {
+      window_job_t *job = &pipeline->jobs[(pipeline->first + i) % MAX_JOBS];
+      svn_error_clear(wait_for_job(pipeline, job));
+      svn_error_clear(job->err);
+    }
+
+  pipeline->count = 0;
+  for (i = 0; i < MAX_JOBS; ++i)
+    if (pipeline->jobs[i].pool)
+      {
+        svn_pool_destroy(pipeline->jobs[i].pool);
+        pipeline->jobs[i].pool = NULL;
+      }
+
+  return APR_SUCCESS;
+}
+
+/* Set *PIPELINE_P to a new, empty pipeline allocated in POOL.  Encode the
+ * windows in SVNDIFF_VERSION format with COMPRESSION_LEVEL unless
+ * SVNDIFF_VERSION is -1. */
+static svn_error_t *
+pipeline_create(pipeline_t **pipeline_p,
+                int svndiff_version,
+                int compression_level,
+                apr_pool_t *pool)
+{
+  pipeline_t *pipeline = apr_pcalloc(pool, sizeof(*pipeline));
+  int i;
+
+  for (i = 0; i < MAX_JOBS; ++i)
+    pipeline->jobs[i].pipeline = pipeline;
+
+  pipeline->svndiff_version = svndiff_version;
+  pipeline->compression_level = compression_level;
+  pipeline->pool = pool;
+
+#if APR_HAS_THREADS
+  SVN_ERR(svn_atomic__init_once(&thread_pool_initialized, create_thread_pool,
+                                NULL, pool));
+  pipeline->threaded = thread_pool != NULL;
+#endif
+
+  SVN_ERR(svn_mutex__init(&pipeline->mutex, pipeline->threaded, pool));
+  SVN_ERR(svn_thread_cond__create(&pipeline->cond, pool));
+
+  /* Registered after the synchronization objects, so it runs before
+     their own cleanups. */
+  apr_pool_cleanup_register(pool, pipeline, pipeline_cleanup,
+                            apr_pool_cleanup_null);
+
+  *pipeline_p = pipeline;
+
+  return SVN_NO_ERROR;
+}
+
+/* Return the job in PIPELINE to fill next.  It must not be used after
+ * the next call to take_job() unless it has been passed to submit_job().
+ * PIPELINE must not be full. */
+static window_job_t *
+next_free_job(pipeline_t *pipeline)
+{
+  window_job_t *job
+    = &pipeline->jobs[(pipeline->first + pipeline->count) % MAX_JOBS];
+
+  if (job->pool)
+    svn_pool_clear(job->pool);
+  else
+    job->pool = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+
+  if (!job->buf)
+    job->buf = apr_palloc(pipeline->pool, 2 * SVN_DELTA_WINDOW_SIZE);
+
+  job->window = NULL;
+  job->svndiff = NULL;
+  job->err = SVN_NO_ERROR;
+  job->done = FALSE;
+
+  return job;
+}
+
+/* Start processing JOB, which has just been returned by next_free_job()
+ * for PIPELINE.  If IS_LAST is set, the caller will not submit more jobs
+ * before taking this one. */
+static void
+submit_job(pipeline_t *pipeline,
+           window_job_t *job,
+           svn_boolean_t is_last)
+{
+  pipeline->count++;
+
+#if APR_HAS_THREADS
+
+  /* A file that fits into a single window does not benefit from a
+     separate thread. */
+  if (pipeline->threaded && (pipeline->count > 1 || !is_last))
+    {
+      /* If we can't push the task, simply do the work ourselves. */
+      if (!apr_thread_pool_push(thread_pool, job_task, job, 0, NULL))
+        return;
+    }
+
+#endif
+
+  job->err = process_job(job);
+  job->done = TRUE;
+}
+
+/* Wait for the oldest job in PIPELINE, remove it from the pipeline and
+ * return it in *JOB_P.  Its results remain valid until the next call to
+ * next_free_job().  PIPELINE must not be empty. */
+static svn_error_t *
+take_job(window_job_t **job_p,
+         pipeline_t *pipeline)
+{
+  window_job_t *job = &pipeline->jobs[pipeline->first];
+  svn_error_t *err;
+
+  SVN_ERR(wait_for_job(pipeline, job));
+
+  pipeline->first = (pipeline->first + 1) % MAX_JOBS;
+  pipeline->count--;
+
+  err = job->err;
+  job->err = SVN_NO_ERROR;
+  *job_p = job;
+
+  return svn_error_trace(err);
+}
+
+
+/* Pipelined txdelta stream baton. */
+typedef struct pipelined_baton_t
+{
+  /* These are copied from parameters passed to svn_txdelta__pipelined. */
+  svn_stream_t *source;
+  svn_stream_t *target;
+
+  /* Private data */
+  svn_boolean_t more_source;    /* FALSE if source stream hit EOF. */
+  svn_boolean_t more_target;    /* FALSE if target stream hit EOF. */
+  svn_boolean_t more;           /* FALSE after the final NULL window. */
+  svn_filesize_t pos;           /* Offset of next read in source file. */
+
+  /* Encoding requested through svn_txdelta__pipelined_encode. */
+  int svndiff_version;
+  int compression_level;
+
+  /* Created upon the first request for a window. */
+  pipeline_t *pipeline;
+
+  svn_checksum_ctx_t *context;  /* If not NULL, the context for computing
+                                   the checksum. */
+  svn_checksum_t *checksum;     /* If non-NULL, the checksum of TARGET. */
+
+  apr_pool_t *pool;
+} pipelined_baton_t;
+
+/* Read ahead as many windows from the streams in B as the pipeline can
+ * take and start processing them. */
+static svn_error_t *
+fill_pipeline(pipelined_baton_t *b)
+{
+  if (!b->pipeline)
+    SVN_ERR(pipeline_create(&b->pipeline, b->svndiff_version,
+                            b->compression_level, b->pool));
+
+  while (b->more_target && b->pipeline->count < MAX_JOBS)
+    {
+      window_job_t *job = next_free_job(b->pipeline);
+      apr_size_t source_len = SVN_DELTA_WINDOW_SIZE;
+      apr_size_t target_len = SVN_DELTA_WINDOW_SIZE;
+
+      /* Read the source stream. */
+      if (b->more_source)
+        {
+          SVN_ERR(svn_stream_read_full(b->source, job->buf, &source_len));
+          b->more_source = (source_len == SVN_DELTA_WINDOW_SIZE);
+        }
+      else
+        source_len = 0;
+
+      /* Read the target stream. */
+      SVN_ERR(svn_stream_read_full(b->target, job->buf + source_len,
+                                   &target_len));
+      b->more_target = (target_len == SVN_DELTA_WINDOW_SIZE);
+      b->pos += source_len;
+
+      if (target_len == 0)
+        break;
+
+      if (b->context != NULL)
+        SVN_ERR(svn_checksum_update(b->context, job->buf + source_len,
+                                    target_len));
+
+      job->source_len = source_len;
+      job->target_len = target_len;
+      job->source_offset = b->pos - source_len;
+      submit_job(b->pipeline, job, !b->more_target);
+    }
+
+  if (!b->more_target && b->context != NULL && b->checksum == NULL)
+    SVN_ERR(svn_checksum_final(&b->checksum, b->context, b->pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Take the next job from the pipeline in B and return it in *JOB_P.
+ * Return NULL at the end of the stream. */
+static svn_error_t *
+next_job(window_job_t **job_p,
+         pipelined_baton_t *b)
+{
+  SVN_ERR(fill_pipeline(b));
+
+  if (b->pipeline->count == 0)
+    {
+      b->more = FALSE;
+      *job_p = NULL;
+      return SVN_NO_ERROR;
+    }
+
+  return svn_error_trace(take_job(job_p, b->pipeline));
+}
+
+/* Implements svn_txdelta_next_window_fn_t. */
+static svn_error_t *
+pipelined_next_window(svn_txdelta_window_t **window,
+                      void *baton,
+                      apr_pool_t *pool)
+{
+  pipelined_baton_t *b = baton;
+  window_job_t *job;
+
+  SVN_ERR(next_job(&job, b));
+  *window = job ? svn_txdelta_window_dup(job->window, pool) : NULL;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_txdelta_md5_digest_fn_t. */
+static const unsigned char *
+pipelined_md5_digest(void *baton)
+{
+  pipelined_baton_t *b = baton;
+
+  /* If there are more windows for this stream, the digest has not yet
+     been calculated.  */
+  if (b->more || b->checksum == NULL)
+    return NULL;
+
+  return b->checksum->digest;
+}
+
+void
+svn_txdelta__pipelined(svn_txdelta_stream_t **stream,
+                       svn_stream_t *source,
+                       svn_stream_t *target,
+                       svn_boolean_t calculate_checksum,
+                       apr_pool_t *pool)
+{
+  pipelined_baton_t *b = apr_pcalloc(pool, sizeof(*b));
+
+  b->source = source;
+  b->target = target;
+  b->more_source = TRUE;
+  b->more_target = TRUE;
+  b->more = TRUE;
+  b->svndiff_version = -1;
+  b->context = calculate_checksum
+             ? svn_checksum_ctx_create(svn_checksum_md5, pool)
+             : NULL;
+  b->pool = pool;
+
+  *stream = svn_txdelta_stream_create(b, pipelined_next_window,
+                                      pipelined_md5_digest, pool);
+}
+
+svn_boolean_t
+svn_txdelta__pipelined_encode(svn_txdelta_stream_t *stream,
+                              int version,
+                              int compression_level)
+{
+  pipelined_baton_t *b = stream->baton;
+
+  if (stream->next_window != pipelined_next_window || b->pipeline)
+    return FALSE;
+
+  b->svndiff_version = version;
+  b->compression_level = compression_level;
+
+  return TRUE;
+}
+
+svn_error_t *
+svn_txdelta__pipelined_next_svndiff(svn_stringbuf_t **svndiff,
+                                    svn_txdelta_stream_t *stream,
+                                    apr_pool_t *pool)
+{
+  pipelined_baton_t *b = stream->baton;
+  window_job_t *job;
+
+  SVN_ERR_ASSERT(stream->next_window == pipelined_next_window
+                 && b->svndiff_version >= 0);
+
+  SVN_ERR(next_job(&job, b));
+  *svndiff = job ? job->svndiff : NULL;
+
+  return SVN_NO_ERROR;
+}
+
+
+/* Pipelined target push stream baton. */
+typedef struct pipelined_push_baton_t
+{
+  /* These are copied from parameters passed to
+     svn_txdelta__target_push_pipelined. */
+  svn_stream_t *source;
+  svn_stream_t *output;
+  int svndiff_version;
+
+  /* Private data */
+  pipeline_t *pipeline;
+  window_job_t *job;            /* Job being filled, NULL if none. */
+  svn_filesize_t source_offset;
+  svn_boolean_t source_done;
+  svn_boolean_t header_done;
+} pipelined_push_baton_t;
+
+/* Write the svndiff data of the oldest job in B's pipeline to B's
+ * output. */
+static svn_error_t *
+write_next_job(pipelined_push_baton_t *b)
+{
+  window_job_t *job;
+  apr_size_t len;
+
+  SVN_ERR(take_job(&job, b->pipeline));
+
+  len = job->svndiff->len;
+  return svn_error_trace(svn_stream_write(b->output, job->svndiff->data,
+                                          &len));
+}
+
+/* Write the svndiff stream header to B's output, if we have not done so
+ * yet. */
+static svn_error_t *
+write_header(pipelined_push_baton_t *b)
+{
+  if (!b->header_done)
+    {
+      const char header[] = { 'S', 'V', 'N', (char)b->svndiff_version };
+      apr_size_t len = sizeof(header);
+
+      SVN_ERR(svn_stream_write(b->output, header, &len));
+      b->header_done = TRUE;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_write_fn_t.  Buffer the target data in window jobs
+ * and start processing them as soon as they are complete. */
+static svn_error_t *
+pipelined_push_write_handler(void *baton,
+                             const char *data,
+                             apr_size_t *len)
+{
+  pipelined_push_baton_t *b = baton;
+  apr_size_t chunk_len, data_len = *len;
+
+  SVN_ERR(write_header(b));
+
+  while (data_len > 0)
+    {
+      window_job_t *job = b->job;
+
+      /* Start a new window with all the source data it may need. */
+      if (job == NULL)
+        {
+          /* Make room in the pipeline. */
+          if (b->pipeline->count == MAX_JOBS)
+            SVN_ERR(write_next_job(b));
+
+          job = next_free_job(b->pipeline);
+          job->source_len = 0;
+          job->target_len = 0;
+          job->source_offset = b->source_offset;
+          if (!b->source_done)
+            {
+              job->source_len = SVN_DELTA_WINDOW_SIZE;
+              SVN_ERR(svn_stream_read_full(b->source, job->buf,
+                                           &job->source_len));
+              if (job->source_len < SVN_DELTA_WINDOW_SIZE)
+                b->source_done = TRUE;
+            }
+
+          b->job = job;
+        }
+
+      /* Copy in the target data, up to SVN_DELTA_WINDOW_SIZE. */
+      chunk_len = SVN_DELTA_WINDOW_SIZE - job->target_len;
+      if (chunk_len > data_len)
+        chunk_len = data_len;
+      memcpy(job->buf + job->source_len + job->target_len, data, chunk_len);
+      data += chunk_len;
+      data_len -= chunk_len;
+      job->target_len += chunk_len;
+
+      /* If the window is full, hand it over to the workers. */
+      if (job->target_len == SVN_DELTA_WINDOW_SIZE)
+        {
+          b->source_offset += job->source_len;
+          b->job = NULL;
+          submit_job(b->pipeline, job, FALSE);
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_close_fn_t.  Process the final window, write all
+ * pending output and close the output stream. */
+static svn_error_t *
+pipelined_push_close_handler(void *baton)
+{
+  pipelined_push_baton_t *b = baton;
+
+  SVN_ERR(write_header(b));
+
+  if (b->job)
+    {
+      window_job_t *job = b->job;
+
+      b->job = NULL;
+      submit_job(b->pipeline, job, TRUE);
+    }
+
+  while (b->pipeline->count)
+    SVN_ERR(write_next_job(b));
+
+  return svn_error_trace(svn_stream_close(b->output));
+}
+
+svn_error_t *
+svn_txdelta__target_push_pipelined(svn_stream_t **stream,
+                                   svn_stream_t *output,
+                                   int svndiff_version,
+                                   int compression_level,
+                                   svn_stream_t *source,
+                                   apr_pool_t *pool)
+{
+  pipelined_push_baton_t *b = apr_pcalloc(pool, sizeof(*b));
+
+  b->source = source;
+  b->output = output;
+  b->svndiff_version = svndiff_version;
+  SVN_ERR(pipeline_create(&b->pipeline, svndiff_version, compression_level,
+                          pool));
+
+  *stream = svn_stream_create(b, pool);
+  svn_stream_set_write(*stream, pipelined_push_write_handler);
+  svn_stream_set_close(*stream, pipelined_push_close_handler);
+
+  return SVN_NO_ERROR;
+}
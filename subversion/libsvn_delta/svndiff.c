@@ -245,6 +245,30 @@ encode_window(svn_stringbuf_t **instructions_p,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_txdelta__encode_window(svn_stringbuf_t **svndiff,
+                           const svn_txdelta_window_t *window,
+                           int version,
+                           int compression_level,
+                           apr_pool_t *pool)
+{
+  svn_txdelta_window_t copy = *window;
+  svn_stringbuf_t *instructions;
+  svn_stringbuf_t *header;
+  const svn_string_t *newdata;
+
+  SVN_ERR(encode_window(&instructions, &header, &newdata, &copy,
+                        version, compression_level, pool));
+
+  *svndiff = svn_stringbuf_create_ensure(header->len + instructions->len
+                                         + newdata->len, pool);
+  svn_stringbuf_appendstr(*svndiff, header);
+  svn_stringbuf_appendstr(*svndiff, instructions);
+  svn_stringbuf_appendbytes(*svndiff, newdata->data, newdata->len);
+
+  return SVN_NO_ERROR;
+}
+
 /* Note: When changing things here, check the related comment in
    the svn_txdelta_to_svndiff_stream() function.  */
 static svn_error_t *
@@ -1004,6 +1028,12 @@ typedef struct svndiff_stream_baton_t
   svn_stringbuf_t *window_buffer;
   apr_size_t read_pos;
   svn_boolean_t hit_eof;
+
+  /* TRUE if TXSTREAM encodes the windows itself.  In that case, we still
+     have to prepend the svndiff header of VERSION. */
+  svn_boolean_t pipelined;
+  svn_boolean_t header_done;
+  int version;
 } svndiff_stream_baton_t;
 
 static svn_error_t *
@@ -1032,17 +1062,41 @@ svndiff_stream_read_fn(void *baton, char *buffer, apr_size_t *len)
 
       if (b->read_pos == b->window_buffer->len && !b->hit_eof)
         {
-          svn_txdelta_window_t *window;
-
           svn_pool_clear(b->scratch_pool);
           svn_stringbuf_setempty(b->window_buffer);
-          SVN_ERR(svn_txdelta_next_window(&window, b->txstream,
-                                          b->scratch_pool));
-          SVN_ERR(b->handler(window, b->handler_baton));
           b->read_pos = 0;
 
-          if (!window)
-            b->hit_eof = TRUE;
+          if (b->pipelined)
+            {
+              svn_stringbuf_t *svndiff;
+
+              if (!b->header_done)
+                {
+                  svn_stringbuf_appendbytes(b->window_buffer,
+                                            get_svndiff_header(b->version),
+                                            SVNDIFF_HEADER_SIZE);
+                  b->header_done = TRUE;
+                }
+
+              SVN_ERR(svn_txdelta__pipelined_next_svndiff(&svndiff,
+                                                          b->txstream,
+                                                          b->scratch_pool));
+              if (svndiff)
+                svn_stringbuf_appendstr(b->window_buffer, svndiff);
+              else
+                b->hit_eof = TRUE;
+            }
+          else
+            {
+              svn_txdelta_window_t *window;
+
+              SVN_ERR(svn_txdelta_next_window(&window, b->txstream,
+                                              b->scratch_pool));
+              SVN_ERR(b->handler(window, b->handler_baton));
+
+              if (!window)
+                b->hit_eof = TRUE;
+            }
         }
 
       if (left > b->window_buffer->len - b->read_pos)
@@ -1081,6 +1135,12 @@ svn_txdelta_to_svndiff_stream(svn_txdelta_stream_t *txstream,
   baton->hit_eof = FALSE;
   baton->read_pos = 0;
 
+  /* Pipelined delta streams compute and encode multiple windows in
+     parallel.  We only need to concatenate their output. */
+  baton->version = svndiff_version;
+  baton->pipelined = svn_txdelta__pipelined_encode(txstream, svndiff_version,
+                                                   compression_level);
+
   push_stream = svn_stream_create(baton, pool);
   svn_stream_set_write(push_stream, svndiff_stream_write_fn);
 
@@ -32,19 +32,15 @@
 #include "svn_io.h"
 #include "svn_pools.h"
 #include "svn_checksum.h"
+#include "svn_sorts.h"
+
+#include "private/svn_delta_private.h"
+#include "private/svn_sorts_private.h"
 
 #include "delta.h"
+#include "svn_private_config.h"
 
 
-/* Text delta stream descriptor. */
-
-struct svn_txdelta_stream_t {
-  /* Copied from parameters to svn_txdelta_stream_create. */
-  void *baton;
-  svn_txdelta_next_window_fn_t next_window;
-  svn_txdelta_md5_digest_fn_t md5_digest;
-};
-
 /* Delta stream baton. */
 struct txdelta_baton {
   /* These are copied from parameters passed to svn_txdelta. */
@@ -83,6 +79,43 @@ struct tpush_baton {
 };
 
 
+/* Large-window target-push stream descriptor. */
+
+struct lwpush_baton {
+  /* These are copied from parameters passed to
+     svn_txdelta__target_push_large. */
+  svn_stream_t *source;
+  svn_txdelta_window_handler_t wh;
+  void *whb;
+  apr_pool_t *pool;
+
+  /* Global index over the source: the hashes of all LW_BLOCKSIZE sized,
+   * aligned source blocks, plus an open hash table mapping those hashes
+   * to the respective block number + 1 (0 marks empty slots). */
+  svn_filesize_t source_size;
+  apr_uint32_t *hashes;
+  apr_size_t block_count;
+  apr_uint32_t *slots;
+  int slot_bits;
+
+  /* LW_HASH_FACTOR ^ (LW_BLOCKSIZE - 1), used to roll the hash. */
+  apr_uint32_t out_factor;
+
+  /* BUF holds the SBUF_LEN bytes of the current source view at the
+   * start and leaves room for the target data to follow it.  SOURCE
+   * has been read up to SBUF_OFFSET + SBUF_LEN. */
+  char *buf;
+  svn_filesize_t sbuf_offset;
+  apr_size_t sbuf_len;
+
+  /* TARGET_LEN bytes of target data not sent yet, starting at offset
+   * TARGET_OFFSET within the target. */
+  char *tbuf;
+  apr_size_t target_len;
+  svn_filesize_t target_offset;
+};
+
+
 /* Text delta applicator.  */
 
 struct apply_baton {
@@ -99,6 +132,7 @@ struct apply_baton {
   apr_size_t sbuf_size;         /* Allocated source buffer space */
   svn_filesize_t sbuf_offset;   /* Offset of SBUF data in source stream */
   apr_size_t sbuf_len;          /* Length of SBUF data */
+  svn_filesize_t source_pos;    /* Amount of data read from SOURCE */
   char *tbuf;                   /* Target buffer */
   apr_size_t tbuf_size;         /* Allocated target buffer space */
 
@@ -139,13 +173,12 @@ svn_txdelta__make_window(const svn_txdelta__ops_baton_t *build_baton,
 }
 
 
-/* Compute and return a delta window using the xdelta algorithm on
-   DATA, which contains SOURCE_LEN bytes of source data and TARGET_LEN
-   bytes of target data.  SOURCE_OFFSET gives the offset of the source
-   data, and is simply copied into the window's sview_offset field. */
-static svn_txdelta_window_t *
-compute_window(const char *data, apr_size_t source_len, apr_size_t target_len,
-               svn_filesize_t source_offset, apr_pool_t *pool)
+svn_txdelta_window_t *
+svn_txdelta__compute_window(const char *data,
+                            apr_size_t source_len,
+                            apr_size_t target_len,
+                            svn_filesize_t source_offset,
+                            apr_pool_t *pool)
 {
   svn_txdelta__ops_baton_t build_baton = { 0 };
   svn_txdelta_window_t *window;
@@ -388,8 +421,8 @@ txdelta_next_window(svn_txdelta_window_t **window,
   else if (b->context != NULL)
     SVN_ERR(svn_checksum_update(b->context, b->buf + source_len, target_len));
 
-  *window = compute_window(b->buf, source_len, target_len,
-                           b->pos - source_len, pool);
+  *window = svn_txdelta__compute_window(b->buf, source_len, target_len,
+                                        b->pos - source_len, pool);
 
   /* That's it. */
   return SVN_NO_ERROR;
@@ -538,8 +571,9 @@ tpush_write_handler(void *baton, const char *data, apr_size_t *len)
       /* If we're full of target data, compute and fire off a window. */
       if (tb->target_len == SVN_DELTA_WINDOW_SIZE)
         {
-          window = compute_window(tb->buf, tb->source_len, tb->target_len,
-                                  tb->source_offset, pool);
+          window = svn_txdelta__compute_window(tb->buf, tb->source_len,
+                                               tb->target_len,
+                                               tb->source_offset, pool);
           SVN_ERR(tb->wh(window, tb->whb));
           tb->source_offset += tb->source_len;
           tb->source_len = 0;
@@ -564,8 +598,9 @@ tpush_close_handler(void *baton)
   /* Send a final window if we have any residual target data. */
   if (tb->target_len > 0)
     {
-      window = compute_window(tb->buf, tb->source_len, tb->target_len,
-                              tb->source_offset, tb->pool);
+      window = svn_txdelta__compute_window(tb->buf, tb->source_len,
+                                           tb->target_len,
+                                           tb->source_offset, tb->pool);
       SVN_ERR(tb->wh(window, tb->whb));
     }
 
@@ -602,6 +637,414 @@ svn_txdelta_target_push(svn_txdelta_window_handler_t handler,
 }
 
 
+/* Functions for implementing a "large-window target push" delta. */
+
+/* Granularity of the global source index.  Target data must contain a
+ * whole, aligned source block of this size for the matcher to find it.
+ * SVN_DELTA_WINDOW_SIZE must be a multiple of it. */
+#define LW_BLOCKSIZE 1024
+
+/* Multiplier of the polynomial rolling hash used by the matcher. */
+#define LW_HASH_FACTOR 0x01000193
+
+/* Limit the index to that many source blocks (256 GB of source data). */
+#define LW_MAX_BLOCKS 0x10000000
+
+/* A source block found in the current target window. */
+typedef struct lw_match_t
+{
+  /* Offset of the block within the source. */
+  svn_filesize_t source_pos;
+
+  /* SOURCE_POS minus the offset of the block within the target window. */
+  svn_filesize_t delta;
+} lw_match_t;
+
+/* Return the hash of the LW_BLOCKSIZE bytes at DATA. */
+static apr_uint32_t
+lw_hash(const char *data)
+{
+  const unsigned char *p = (const unsigned char *)data;
+  const unsigned char *end = p + LW_BLOCKSIZE;
+  apr_uint32_t hash = 0;
+
+  for (; p < end; ++p)
+    hash = hash * LW_HASH_FACTOR + *p;
+
+  return hash;
+}
+
+/* Return the slot in LB's hash table at which the probing for HASH
+ * starts. */
+static APR_INLINE apr_size_t
+lw_first_slot(const struct lwpush_baton *lb, apr_uint32_t hash)
+{
+  return (apr_size_t)((apr_uint32_t)(hash * 0x9E3779B1u)
+                      >> (32 - lb->slot_bits));
+}
+
+/* Look for a source block with hash HASH in LB's index.  If found,
+ * return TRUE and its block number in *BLOCK.  Return FALSE otherwise. */
+static svn_boolean_t
+lw_lookup(apr_size_t *block,
+          const struct lwpush_baton *lb,
+          apr_uint32_t hash)
+{
+  const apr_size_t mask = ((apr_size_t)1 << lb->slot_bits) - 1;
+  apr_size_t slot;
+
+  for (slot = lw_first_slot(lb, hash);
+       lb->slots[slot];
+       slot = (slot + 1) & mask)
+    if (lb->hashes[lb->slots[slot] - 1] == hash)
+      {
+        *block = lb->slots[slot] - 1;
+        return TRUE;
+      }
+
+  return FALSE;
+}
+
+/* Read INDEX_SOURCE to its end and build LB's global source index. */
+static svn_error_t *
+lw_build_index(struct lwpush_baton *lb,
+               svn_stream_t *index_source)
+{
+  apr_array_header_t *hashes
+    = apr_array_make(lb->pool, 1024, sizeof(apr_uint32_t));
+  apr_size_t mask, block;
+  int i;
+
+  /* Hash all complete source blocks.  Use TBUF as read buffer. */
+  while (TRUE)
+    {
+      apr_size_t len = SVN_DELTA_WINDOW_SIZE;
+      apr_size_t pos;
+
+      SVN_ERR(svn_stream_read_full(index_source, lb->tbuf, &len));
+      for (pos = 0;
+           pos + LW_BLOCKSIZE <= len && hashes->nelts < LW_MAX_BLOCKS;
+           pos += LW_BLOCKSIZE)
+        APR_ARRAY_PUSH(hashes, apr_uint32_t) = lw_hash(lb->tbuf + pos);
+
+      lb->source_size += len;
+      if (len < SVN_DELTA_WINDOW_SIZE)
+        break;
+    }
+
+  lb->hashes = (apr_uint32_t *)hashes->elts;
+  lb->block_count = hashes->nelts;
+
+  /* Keep the hash table at most half full.  Where blocks share the same
+   * hash, only the first one gets indexed. */
+  for (lb->slot_bits = 8;
+       ((apr_size_t)1 << lb->slot_bits) < 2 * lb->block_count;
+       ++lb->slot_bits)
+    ;
+
+  mask = ((apr_size_t)1 << lb->slot_bits) - 1;
+  lb->slots = apr_pcalloc(lb->pool, (mask + 1) * sizeof(*lb->slots));
+  for (block = 0; block < lb->block_count; ++block)
+    {
+      apr_size_t slot = lw_first_slot(lb, lb->hashes[block]);
+      while (   lb->slots[slot]
+             && lb->hashes[lb->slots[slot] - 1] != lb->hashes[block])
+        slot = (slot + 1) & mask;
+
+      if (!lb->slots[slot])
+        lb->slots[slot] = (apr_uint32_t)(block + 1);
+    }
+
+  lb->out_factor = 1;
+  for (i = 1; i < LW_BLOCKSIZE; ++i)
+    lb->out_factor *= LW_HASH_FACTOR;
+
+  return SVN_NO_ERROR;
+}
+
+/* Sort lw_match_t elements by source position. */
+static int
+compare_lw_matches(const void *lhs,
+                   const void *rhs)
+{
+  const lw_match_t *lhs_match = lhs;
+  const lw_match_t *rhs_match = rhs;
+
+  if (lhs_match->source_pos < rhs_match->source_pos)
+    return -1;
+
+  return lhs_match->source_pos > rhs_match->source_pos ? 1 : 0;
+}
+
+/* Select the source view for the target data buffered in LB and return
+ * its offset and length in *OFFSET and *LEN.  The view will not slide
+ * backwards relative to the previous one.  Use SCRATCH_POOL for
+ * temporary allocations. */
+static void
+lw_choose_view(svn_filesize_t *offset,
+               apr_size_t *len,
+               struct lwpush_baton *lb,
+               apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *matches
+    = apr_array_make(scratch_pool, 16, sizeof(lw_match_t));
+  const lw_match_t *match;
+  int i, first, best_first = 0, best_last = 0, best_count = 0;
+
+  /* Collect the source blocks contained in the target data.  After each
+   * hit, continue behind it. */
+  if (lb->block_count && lb->target_len >= LW_BLOCKSIZE)
+    {
+      const unsigned char *data = (const unsigned char *)lb->tbuf;
+      apr_uint32_t hash = lw_hash(lb->tbuf);
+      apr_size_t pos = 0;
+
+      while (TRUE)
+        {
+          apr_size_t block;
+          svn_filesize_t source_pos;
+
+          if (   lw_lookup(&block, lb, hash)
+              && (source_pos = (svn_filesize_t)block * LW_BLOCKSIZE)
+                   >= lb->sbuf_offset)
+            {
+              lw_match_t *new_match = apr_array_push(matches);
+              new_match->source_pos = source_pos;
+              new_match->delta = source_pos - (svn_filesize_t)pos;
+
+              pos += LW_BLOCKSIZE;
+              if (pos + LW_BLOCKSIZE > lb->target_len)
+                break;
+
+              hash = lw_hash(lb->tbuf + pos);
+            }
+          else
+            {
+              if (pos + LW_BLOCKSIZE >= lb->target_len)
+                break;
+
+              hash = (hash - data[pos] * lb->out_factor) * LW_HASH_FACTOR
+                   + data[pos + LW_BLOCKSIZE];
+              ++pos;
+            }
+        }
+    }
+
+  /* Without any matches, use the same view as svn_txdelta_target_push()
+   * unless that would slide backwards. */
+  if (matches->nelts == 0)
+    {
+      *offset = MAX(lb->target_offset, lb->sbuf_offset);
+      if (*offset >= lb->source_size)
+        {
+          *offset = lb->sbuf_offset;
+          *len = 0;
+        }
+      else
+        {
+          *len = (apr_size_t)MIN(lb->source_size - *offset,
+                                 SVN_DELTA_WINDOW_SIZE);
+        }
+
+      return;
+    }
+
+  /* Find the view that covers the most distinct source blocks.
+   * Repeated blocks, e.g. runs of zeros, shall count only once. */
+  svn_sort__array(matches, compare_lw_matches);
+  match = (const lw_match_t *)matches->elts;
+
+  for (i = 0, first = 0; i < matches->nelts; ++i)
+    {
+      int count = 0, k;
+
+      while (  match[i].source_pos + LW_BLOCKSIZE - match[first].source_pos
+             > SVN_DELTA_WINDOW_SIZE)
+        ++first;
+
+      for (k = first; k <= i; ++k)
+        if (k == first || match[k].source_pos != match[k - 1].source_pos)
+          ++count;
+
+      if (count > best_count)
+        {
+          best_count = count;
+          best_first = first;
+          best_last = i;
+        }
+    }
+
+  /* Align the view with the target as implied by the first match, but
+   * keep all matches of the range covered and don't slide backwards.
+   * None of these bounds is larger than the first match position. */
+  *offset = match[best_first].delta;
+  *offset = MAX(*offset, match[best_last].source_pos + LW_BLOCKSIZE
+                         - SVN_DELTA_WINDOW_SIZE);
+  *offset = MAX(*offset, lb->sbuf_offset);
+  *offset = MAX(*offset, 0);
+
+  *len = (apr_size_t)MIN(lb->source_size - *offset, SVN_DELTA_WINDOW_SIZE);
+}
+
+/* Skip COUNT bytes in STREAM.  Unlike svn_stream_skip(), accept counts
+ * beyond APR_SIZE_MAX as they may occur on 32 bit systems. */
+static svn_error_t *
+skip_source(svn_stream_t *stream,
+            svn_filesize_t count)
+{
+  while (count > 0)
+    {
+      apr_size_t chunk = (apr_uint64_t)count > APR_SIZE_MAX
+                       ? APR_SIZE_MAX
+                       : (apr_size_t)count;
+
+      SVN_ERR(svn_stream_skip(stream, chunk));
+      count -= chunk;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Make the source view of LEN bytes at OFFSET the current one in LB's
+ * buffer.  The view must not slide backwards. */
+static svn_error_t *
+lw_read_view(struct lwpush_baton *lb,
+             svn_filesize_t offset,
+             apr_size_t len)
+{
+  svn_filesize_t sbuf_end = lb->sbuf_offset + lb->sbuf_len;
+  apr_size_t keep = 0;
+  apr_size_t read_len;
+
+  /* Keep the overlap with the previous view or skip to the new one. */
+  if (offset < sbuf_end)
+    {
+      keep = (apr_size_t)(sbuf_end - offset);
+      memmove(lb->buf, lb->buf + (apr_size_t)(offset - lb->sbuf_offset),
+              keep);
+    }
+  else if (offset > sbuf_end)
+    {
+      SVN_ERR(skip_source(lb->source, offset - sbuf_end));
+    }
+
+  read_len = len - keep;
+  SVN_ERR(svn_stream_read_full(lb->source, lb->buf + keep, &read_len));
+  if (read_len != len - keep)
+    return svn_error_create(SVN_ERR_STREAM_UNEXPECTED_EOF, NULL,
+                            _("Delta source is shorter than indexed"));
+
+  lb->sbuf_offset = offset;
+  lb->sbuf_len = len;
+
+  return SVN_NO_ERROR;
+}
+
+/* Compute the delta window for the target data buffered in LB and
+ * send it to the window handler.  Use SCRATCH_POOL for temporary
+ * allocations. */
+static svn_error_t *
+lw_send_window(struct lwpush_baton *lb,
+               apr_pool_t *scratch_pool)
+{
+  svn_txdelta_window_t *window;
+  svn_filesize_t offset;
+  apr_size_t len;
+
+  lw_choose_view(&offset, &len, lb, scratch_pool);
+  if (len)
+    SVN_ERR(lw_read_view(lb, offset, len));
+
+  memcpy(lb->buf + len, lb->tbuf, lb->target_len);
+  window = svn_txdelta__compute_window(lb->buf, len, lb->target_len,
+                                       offset, scratch_pool);
+  SVN_ERR(lb->wh(window, lb->whb));
+
+  lb->target_offset += lb->target_len;
+  lb->target_len = 0;
+
+  return SVN_NO_ERROR;
+}
+
+/* This is the write handler for a large-window target-push delta
+ * stream.  It buffers target data and fires off delta windows when the
+ * target data buffer is full. */
+static svn_error_t *
+lwpush_write_handler(void *baton, const char *data, apr_size_t *len)
+{
+  struct lwpush_baton *lb = baton;
+  apr_size_t chunk_len, data_len = *len;
+  apr_pool_t *pool = svn_pool_create(lb->pool);
+
+  while (data_len > 0)
+    {
+      /* Copy in the target data, up to SVN_DELTA_WINDOW_SIZE. */
+      chunk_len = SVN_DELTA_WINDOW_SIZE - lb->target_len;
+      if (chunk_len > data_len)
+        chunk_len = data_len;
+      memcpy(lb->tbuf + lb->target_len, data, chunk_len);
+      data += chunk_len;
+      data_len -= chunk_len;
+      lb->target_len += chunk_len;
+
+      /* If we're full of target data, compute and fire off a window. */
+      if (lb->target_len == SVN_DELTA_WINDOW_SIZE)
+        {
+          svn_pool_clear(pool);
+          SVN_ERR(lw_send_window(lb, pool));
+        }
+    }
+
+  svn_pool_destroy(pool);
+  return SVN_NO_ERROR;
+}
+
+/* This is the close handler for a large-window target-push delta stream.
+ * It sends a final window if there is any buffered target data, and then
+ * sends a NULL window signifying the end of the window stream. */
+static svn_error_t *
+lwpush_close_handler(void *baton)
+{
+  struct lwpush_baton *lb = baton;
+
+  /* Send a final window if we have any residual target data. */
+  if (lb->target_len > 0)
+    SVN_ERR(lw_send_window(lb, lb->pool));
+
+  /* Send a final NULL window signifying the end. */
+  return lb->wh(NULL, lb->whb);
+}
+
+svn_error_t *
+svn_txdelta__target_push_large(svn_stream_t **stream,
+                               svn_txdelta_window_handler_t handler,
+                               void *handler_baton,
+                               svn_stream_t *index_source,
+                               svn_stream_t *source,
+                               apr_pool_t *pool)
+{
+  struct lwpush_baton *lb;
+
+  /* Initialize baton. */
+  lb = apr_pcalloc(pool, sizeof(*lb));
+  lb->source = source;
+  lb->wh = handler;
+  lb->whb = handler_baton;
+  lb->pool = pool;
+  lb->buf = apr_palloc(pool, 2 * SVN_DELTA_WINDOW_SIZE);
+  lb->tbuf = apr_palloc(pool, SVN_DELTA_WINDOW_SIZE);
+
+  SVN_ERR(lw_build_index(lb, index_source));
+
+  /* Create and return writable stream. */
+  *stream = svn_stream_create(lb, pool);
+  svn_stream_set_write(*stream, lwpush_write_handler);
+  svn_stream_set_close(*stream, lwpush_close_handler);
+
+  return SVN_NO_ERROR;
+}
+
+
 
 /* Functions for applying deltas.  */
 
@@ -763,8 +1206,7 @@ apply_window(svn_txdelta_window_t *window, void *baton)
 
       /* If the existing view overlaps with the new view, copy the
        * overlap to the beginning of the new buffer.  */
-      if (  (apr_size_t)ab->sbuf_offset + ab->sbuf_len
-          > (apr_size_t)window->sview_offset)
+      if (ab->sbuf_offset + ab->sbuf_len > window->sview_offset)
         {
           apr_size_t start =
             (apr_size_t)(window->sview_offset - ab->sbuf_offset);
@@ -779,11 +1221,22 @@ apply_window(svn_txdelta_window_t *window, void *baton)
   /* Read the remainder of the source view into the buffer.  */
   if (ab->sbuf_len < window->sview_len)
     {
+      /* Source views may skip source data, e.g. those created by
+       * svn_txdelta__target_push_large(). */
+      if (ab->source_pos < ab->sbuf_offset + ab->sbuf_len)
+        {
+          SVN_ERR(skip_source(ab->source,
+                              ab->sbuf_offset + ab->sbuf_len
+                              - ab->source_pos));
+          ab->source_pos = ab->sbuf_offset + ab->sbuf_len;
+        }
+
       len = window->sview_len - ab->sbuf_len;
       SVN_ERR(svn_stream_read_full(ab->source, ab->sbuf + ab->sbuf_len, &len));
       if (len != window->sview_len - ab->sbuf_len)
         return svn_error_create(SVN_ERR_INCOMPLETE_DATA, NULL,
                                 "Delta source ended unexpectedly");
+      ab->source_pos += len;
       ab->sbuf_len = window->sview_len;
     }
 
@@ -823,6 +1276,7 @@ svn_txdelta_apply(svn_stream_t *source,
   ab->sbuf_size = 0;
   ab->sbuf_offset = 0;
   ab->sbuf_len = 0;
+  ab->source_pos = 0;
   ab->tbuf = NULL;
   ab->tbuf_size = 0;
   ab->result_digest = result_digest;
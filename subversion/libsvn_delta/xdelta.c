@@ -30,7 +30,12 @@
 #include "svn_hash.h"
 #include "svn_delta.h"
 #include "private/svn_string_private.h"
+#include "private/svn_simd.h"
 #include "delta.h"
+
+#ifdef SVN__SSE2
+#include <emmintrin.h>
+#endif
 
 /* This is pseudo-adler32. It is adler32 without the prime modulus.
    The idea is borrowed from monotone, and is a translation of the C++
@@ -78,9 +83,8 @@ adler32_replace(apr_uint32_t adler32, const char c_out, const char c_in)
 
 /* Calculate an pseudo-adler32 checksum for MATCH_BLOCKSIZE bytes starting
    at DATA.  Return the checksum value.  */
-
 static APR_INLINE apr_uint32_t
-init_adler32(const char *data)
+init_adler32_scalar(const char *data)
 {
   const unsigned char *input = (const unsigned char *)data;
   const unsigned char *last = input + MATCH_BLOCKSIZE;
@@ -103,6 +107,61 @@ init_adler32(const char *data)
   return s2 * 0x10000 + s1;
 }
 
+#if defined(SVN__SSE2) && MATCH_BLOCKSIZE == 64
+
+/* With S1 being the plain byte sum, S2 is the sum over all bytes weighted
+ * by their distance from the block end.  Compute both for four 16 byte
+ * chunks in parallel. */
+static APR_INLINE apr_uint32_t
+init_adler32(const char *data)
+{
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i offsets = _mm_set_epi16(7, 6, 5, 4, 3, 2, 1, 0);
+  __m128i s1 = zero;
+  __m128i s2 = zero;
+  int i;
+
+  for (i = 0; i < MATCH_BLOCKSIZE; i += sizeof(__m128i))
+    {
+      __m128i chunk = _mm_loadu_si128((const __m128i *)(data + i));
+      __m128i weights_lo = _mm_sub_epi16(
+                             _mm_set1_epi16((short)(MATCH_BLOCKSIZE - i)),
+                             offsets);
+      __m128i weights_hi = _mm_sub_epi16(
+                             _mm_set1_epi16((short)(MATCH_BLOCKSIZE - i - 8)),
+                             offsets);
+
+      s1 = _mm_add_epi64(s1, _mm_sad_epu8(chunk, zero));
+      s2 = _mm_add_epi32(s2,
+                         _mm_madd_epi16(_mm_unpacklo_epi8(chunk, zero),
+                                        weights_lo));
+      s2 = _mm_add_epi32(s2,
+                         _mm_madd_epi16(_mm_unpackhi_epi8(chunk, zero),
+                                        weights_hi));
+    }
+
+  /* Horizontal sums. */
+  s1 = _mm_add_epi64(s1, _mm_srli_si128(s1, 8));
+  s2 = _mm_add_epi32(s2, _mm_srli_si128(s2, 8));
+  s2 = _mm_add_epi32(s2, _mm_srli_si128(s2, 4));
+
+  return (apr_uint32_t)_mm_cvtsi128_si32(s2) * 0x10000
+       + (apr_uint32_t)_mm_cvtsi128_si32(s1);
+}
+
+#else
+
+#define init_adler32 init_adler32_scalar
+
+#endif
+
+apr_uint32_t
+svn_txdelta__adler32(const char *data,
+                     svn_boolean_t scalar)
+{
+  return scalar ? init_adler32_scalar(data) : init_adler32(data);
+}
+
 /* Information for a block of the delta source.  The length of the
    block is the smaller of MATCH_BLOCKSIZE and the difference between
    the size of the source data and the position of this block. */
@@ -278,7 +337,7 @@ find_match(const struct blocks *blocks,
            apr_size_t pending_insert_start)
 {
   apr_size_t apos, bpos = *bposp;
-  apr_size_t delta, max_delta;
+  apr_size_t delta, max_delta, back;
 
   apos = find_block(blocks, rolling, b + bpos);
 
@@ -296,12 +355,13 @@ find_match(const struct blocks *blocks,
 
   /* See if we can extend backwards (max MATCH_BLOCKSIZE-1 steps because A's
      content has been sampled only every MATCH_BLOCKSIZE positions).  */
-  while (apos > 0 && bpos > pending_insert_start && a[apos-1] == b[bpos-1])
-    {
-      --apos;
-      --bpos;
-      ++delta;
-    }
+  max_delta = apos < bpos - pending_insert_start
+            ? apos
+            : bpos - pending_insert_start;
+  back = svn_cstring__reverse_match_length(a + apos, b + bpos, max_delta);
+  apos -= back;
+  bpos -= back;
+  delta += back;
 
   *aposp = apos;
   *bposp = bpos;
@@ -1000,6 +1000,7 @@ static svn_error_t *
 base_verify(svn_fs_t *fs, const char *path,
             svn_revnum_t start,
             svn_revnum_t end,
+            int jobs,
             svn_fs_progress_notify_func_t notify_func,
             void *notify_baton,
             svn_cancel_func_t cancel_func,
@@ -1025,6 +1026,7 @@ base_bdb_recover(svn_fs_t *fs,
 static svn_error_t *
 base_bdb_pack(svn_fs_t *fs,
               const char *path,
+              int jobs,
               svn_fs_pack_notify_t notify_func,
               void *notify_baton,
               svn_cancel_func_t cancel,
@@ -1302,6 +1304,7 @@ base_hotcopy(svn_fs_t *src_fs,
              const char *dest_path,
              svn_boolean_t clean_logs,
              svn_boolean_t incremental,
+             int jobs,
              svn_fs_hotcopy_notify_t notify_func,
              void *notify_baton,
              svn_cancel_func_t cancel_func,
@@ -130,9 +130,11 @@ dbg_log_access(svn_fs_t *fs,
       if (header == NULL)
         description = "  (txdelta window)";
       else if (header->type == svn_fs_fs__rep_plain)
-        description = "  PLAIN";
+        description = header->blocked_dir ? "  BLOCKED" : "  PLAIN";
       else if (header->type == svn_fs_fs__rep_self_delta)
         description = "  DELTA";
+      else if (header->type == svn_fs_fs__rep_chunked)
+        description = "  CHUNKED";
       else
         description = apr_psprintf(scratch_pool,
                                    "  DELTA against %ld/%" APR_UINT64_T_FMT,
@@ -193,21 +195,6 @@ dbg_log_access(svn_fs_t *fs,
   return SVN_NO_ERROR;
 }
 
-/* Convenience wrapper around svn_io_file_aligned_seek, taking filesystem
-   FS instead of a block size. */
-static svn_error_t *
-aligned_seek(svn_fs_t *fs,
-             apr_file_t *file,
-             apr_off_t *buffer_start,
-             apr_off_t offset,
-             apr_pool_t *pool)
-{
-  fs_fs_data_t *ffd = fs->fsap_data;
-  return svn_error_trace(svn_io_file_aligned_seek(file, ffd->block_size,
-                                                  buffer_start, offset,
-                                                  pool));
-}
-
 /* Open the revision file for revision REV in filesystem FS and store
    the newly opened file in FILE.  Seek to location OFFSET before
    returning.  Perform temporary allocations in POOL. */
@@ -227,7 +214,7 @@ open_and_seek_revision(svn_fs_fs__revision_file_t **file,
   SVN_ERR(svn_fs_fs__item_offset(&offset, fs, rev_file, rev, NULL, item,
                                  pool));
 
-  SVN_ERR(aligned_seek(fs, rev_file->file, NULL, offset, pool));
+  SVN_ERR(svn_fs_fs__rev_file_seek(rev_file, NULL, offset));
 
   *file = rev_file;
 
@@ -249,7 +236,7 @@ open_and_seek_transaction(svn_fs_fs__revision_file_t **file,
 
   SVN_ERR(svn_fs_fs__item_offset(&offset, fs, NULL, SVN_INVALID_REVNUM,
                                  &rep->txn_id, rep->item_index, pool));
-  SVN_ERR(aligned_seek(fs, (*file)->file, NULL, offset, pool));
+  SVN_ERR(svn_fs_fs__rev_file_seek(*file, NULL, offset));
 
   return SVN_NO_ERROR;
 }
@@ -547,7 +534,7 @@ get_fs_id_at_offset(svn_fs_id_t **id_p,
 {
   node_revision_t *noderev;
 
-  SVN_ERR(aligned_seek(fs, rev_file->file, NULL, offset, pool));
+  SVN_ERR(svn_fs_fs__rev_file_seek(rev_file, NULL, offset));
   SVN_ERR(svn_fs_fs__read_noderev(&noderev,
                                   rev_file->stream,
                                   pool, pool));
@@ -630,9 +617,8 @@ get_root_changes_offset(apr_off_t *root_offset,
     }
 
   /* Read in this last block, from which we will identify the last line. */
-  SVN_ERR(aligned_seek(fs, rev_file->file, NULL, start, pool));
-  SVN_ERR(svn_io_file_read_full2(rev_file->file, buffer, len, NULL, NULL,
-                                 pool));
+  SVN_ERR(svn_fs_fs__rev_file_seek(rev_file, NULL, start));
+  SVN_ERR(svn_fs_fs__rev_file_read(rev_file, buffer, len, NULL));
 
   /* Parse the last line. */
   trailer = svn_stringbuf_ncreate(buffer, len, pool);
@@ -728,6 +714,8 @@ typedef struct rep_state_t
   svn_cache__t *window_cache;
                     /* Caches un-deltified windows. May be NULL. */
   svn_cache__t *combined_cache;
+                    /* Caches partially composed windows. May be NULL. */
+  svn_cache__t *partial_cache;
                     /* revision containing the representation */
   svn_revnum_t revision;
                     /* representation's item index in REVISION */
@@ -746,29 +734,49 @@ typedef struct rep_state_t
   int chunk_index;  /* number of the window to read */
 } rep_state_t;
 
-/* Simple wrapper around svn_io_file_get_offset to simplify callers. */
+/* Simple wrapper around svn_fs_fs__rev_file_offset to simplify callers. */
 static svn_error_t *
 get_file_offset(apr_off_t *offset,
                 rep_state_t *rs,
                 apr_pool_t *pool)
 {
-  return svn_error_trace(svn_io_file_get_offset(offset,
-                                                rs->sfile->rfile->file,
-                                                pool));
+  return svn_error_trace(svn_fs_fs__rev_file_offset(offset,
+                                                    rs->sfile->rfile));
 }
 
-/* Simple wrapper around svn_io_file_aligned_seek to simplify callers. */
+/* Simple wrapper around svn_fs_fs__rev_file_seek to simplify callers. */
 static svn_error_t *
 rs_aligned_seek(rep_state_t *rs,
                 apr_off_t *buffer_start,
                 apr_off_t offset,
                 apr_pool_t *pool)
 {
-  fs_fs_data_t *ffd = rs->sfile->fs->fsap_data;
-  return svn_error_trace(svn_io_file_aligned_seek(rs->sfile->rfile->file,
-                                                  ffd->block_size,
-                                                  buffer_start, offset,
-                                                  pool));
+  return svn_error_trace(svn_fs_fs__rev_file_seek(rs->sfile->rfile,
+                                                  buffer_start, offset));
+}
+
+/* Skip the svndiff window at the current position in RS->SFILE->RFILE.
+   Use POOL for temporary allocations. */
+static svn_error_t *
+skip_svndiff_window(rep_state_t *rs,
+                    apr_pool_t *pool)
+{
+  svn_fs_fs__revision_file_t *rev_file = rs->sfile->rfile;
+  apr_off_t offset;
+  apr_size_t window_len;
+
+  if (rev_file->mmap == NULL)
+    return svn_error_trace(svn_txdelta_skip_svndiff_window(rev_file->file,
+                                                           rs->ver, pool));
+
+  /* Mapped files have no APR file pointer to advance.  Parse the window
+     header to find where the next window starts. */
+  SVN_ERR(svn_fs_fs__rev_file_offset(&offset, rev_file));
+  SVN_ERR(svn_txdelta__read_raw_window_len(&window_len, rev_file->stream,
+                                           pool));
+
+  return svn_error_trace(svn_fs_fs__rev_file_seek(rev_file, NULL,
+                                                  offset + window_len));
 }
 
 /* Open FILE->FILE and FILE->STREAM if they haven't been opened, yet. */
@@ -809,8 +817,8 @@ auto_read_diff_version(rep_state_t *rs, apr_pool_t *pool)
     {
       char buf[4];
       SVN_ERR(rs_aligned_seek(rs, NULL, rs->start, pool));
-      SVN_ERR(svn_io_file_read_full2(rs->sfile->rfile->file, buf,
-                                     sizeof(buf), NULL, NULL, pool));
+      SVN_ERR(svn_fs_fs__rev_file_read(rs->sfile->rfile, buf, sizeof(buf),
+                                       NULL));
 
       /* ### Layering violation */
       if (! ((buf[0] == 'S') && (buf[1] == 'V') && (buf[2] == 'N')))
@@ -888,6 +896,11 @@ create_rep_state_body(rep_state_t **rep_state,
                                        (apr_size_t)estimated_window_storage)
                      ? ffd->combined_window_cache
                      : NULL;
+  rs->partial_cache =    ffd->partial_window_cache
+                      && svn_cache__is_cachable(ffd->partial_window_cache,
+                                       (apr_size_t)estimated_window_storage)
+                    ? ffd->partial_window_cache
+                    : NULL;
 
   /* cache lookup, i.e. skip reading the rep header if possible */
   if (ffd->rep_header_cache && !svn_fs_fs__id_txn_used(&rep->txn_id))
@@ -964,7 +977,8 @@ create_rep_state_body(rep_state_t **rep_state,
   *rep_state = rs;
   *rep_header = rh;
 
-  if (rh->type == svn_fs_fs__rep_plain)
+  if (   rh->type == svn_fs_fs__rep_plain
+      || rh->type == svn_fs_fs__rep_chunked)
     /* This is a plaintext, so just return the current rep_state. */
     return SVN_NO_ERROR;
 
@@ -1182,6 +1196,15 @@ struct rep_read_baton
   /* The plaintext state, if there is a plaintext. */
   rep_state_t *src_state;
 
+  /* Set if windows got reconstructed from a partially composed window
+     and SRC_STATE has not been advanced for them. */
+  svn_boolean_t src_state_lagging;
+
+  /* The reconstructed fulltext at the end of the delta chain, if that
+     end is a large-window delta or a chunked rep.  SRC_STATE will be NULL
+     in that case. */
+  svn_stream_t *src_stream;
+
   /* The index of the current delta chunk, if we are reading a delta. */
   int chunk_index;
 
@@ -1422,10 +1445,95 @@ set_cached_combined_window(svn_stringbuf_t *window,
   return SVN_NO_ERROR;
 }
 
+/* Read the partially composed window for chunk CHUNK_INDEX of the rep
+ * described by RS from the current FSFS session's cache.  This will be a
+ * no-op and IS_CACHED will be set to FALSE if no cache has been given.
+ * Allocations will be made from POOL.
+ */
+static svn_error_t *
+get_cached_partial_window(svn_stringbuf_t **window_p,
+                          rep_state_t *rs,
+                          int chunk_index,
+                          svn_boolean_t *is_cached,
+                          apr_pool_t *pool)
+{
+  if (! rs->partial_cache || ! SVN_IS_VALID_REVNUM(rs->revision))
+    {
+      /* Not cachable or cache disabled. */
+      *is_cached = FALSE;
+    }
+  else
+    {
+      /* RS may lag behind, i.e. use the chunk we actually want. */
+      window_cache_key_t key = { 0 };
+      get_window_key(&key, rs);
+      key.chunk_index = chunk_index;
+
+      return svn_cache__get((void **)window_p, is_cached,
+                            rs->partial_cache, &key, pool);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Store the fulltext WINDOW of the current chunk of the rep described by
+ * RS as partially composed window in the current FSFS session's cache.
+ * This will be a no-op if no cache has been given.
+ * Temporary allocations will be made from SCRATCH_POOL. */
+static svn_error_t *
+set_cached_partial_window(svn_stringbuf_t *window,
+                          rep_state_t *rs,
+                          apr_pool_t *scratch_pool)
+{
+  if (rs->partial_cache && SVN_IS_VALID_REVNUM(rs->revision))
+    {
+      window_cache_key_t key = { 0 };
+      return svn_cache__set(rs->partial_cache,
+                            get_window_key(&key, rs),
+                            window,
+                            scratch_pool);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Return TRUE if partially composed windows of the rep at position IDX
+ * in RB's RS_LIST shall be cached.  Only every PARTIAL_WINDOW_INTERVAL-th
+ * delta counted from the base of the chain qualifies.  That way, the
+ * reps low in a skip-delta chain, which many reads have in common, get
+ * cached while the cache space needed per read stays a fraction of the
+ * chain length. */
+static svn_boolean_t
+caches_partial_window(struct rep_read_baton *rb,
+                      int idx)
+{
+  fs_fs_data_t *ffd = rb->fs->fsap_data;
+
+  return ffd->partial_window_interval > 0
+      && (rb->rs_list->nelts - idx) % ffd->partial_window_interval == 0;
+}
+
+static svn_error_t *
+read_large_window_rep(svn_stream_t **stream,
+                      rep_state_t *rs,
+                      svn_fs_fs__rep_header_t *rep_header,
+                      svn_fs_t *fs,
+                      apr_pool_t *pool);
+
+static svn_error_t *
+read_chunked_rep(svn_stream_t **stream,
+                 rep_state_t *rs,
+                 const representation_t *rep,
+                 svn_fs_t *fs,
+                 apr_pool_t *pool);
+
 /* Build an array of rep_state structures in *LIST giving the delta
    reps from first_rep to a plain-text or self-compressed rep.  Set
    *SRC_STATE to the plain-text rep we find at the end of the chain,
    or to NULL if the final delta representation is self-compressed.
+   If the chain ends at a large-window delta or a chunked rep, set
+   *SRC_STATE to NULL and *SRC_STREAM to that rep's fulltext.  Otherwise,
+   set *SRC_STREAM to NULL.
    The representation to start from is designated by filesystem FS, id
    ID, and representation REP.
    Also, set *WINDOW_P to the base window content for *LIST, if it
@@ -1435,6 +1543,7 @@ static svn_error_t *
 build_rep_list(apr_array_header_t **list,
                svn_stringbuf_t **window_p,
                rep_state_t **src_state,
+               svn_stream_t **src_stream,
                svn_fs_t *fs,
                representation_t *first_rep,
                apr_pool_t *pool)
@@ -1447,6 +1556,7 @@ build_rep_list(apr_array_header_t **list,
   apr_pool_t *iterpool = svn_pool_create(pool);
 
   *list = apr_array_make(pool, 1, sizeof(rep_state_t *));
+  *src_stream = NULL;
   rep = *first_rep;
 
   /* for the top-level rep, we need the rep_args */
@@ -1484,6 +1594,26 @@ build_rep_list(apr_array_header_t **list,
           break;
         }
 
+      if (rep_header->large_window)
+        {
+          /* The source views of this delta don't follow the window
+             structure of its base, i.e. we can't combine windows across
+             it.  Reconstruct its fulltext instead and use that like a
+             plaintext base for the deltas on top of it. */
+          SVN_ERR(read_large_window_rep(src_stream, rs, rep_header, fs,
+                                        pool));
+          *src_state = NULL;
+          break;
+        }
+
+      if (rep_header->type == svn_fs_fs__rep_chunked)
+        {
+          /* Same for the concatenated chunks. */
+          SVN_ERR(read_chunked_rep(src_stream, rs, &rep, fs, pool));
+          *src_state = NULL;
+          break;
+        }
+
       /* Push this rep onto the list.  If it's self-compressed, we're done. */
       APR_ARRAY_PUSH(*list, rep_state_t *) = rs;
       if (rep_header->type == svn_fs_fs__rep_self_delta)
@@ -1602,8 +1732,7 @@ read_delta_window(svn_txdelta_window_t **nwin, int this_chunk,
   while (rs->chunk_index < this_chunk)
     {
       svn_pool_clear(iterpool);
-      SVN_ERR(svn_txdelta_skip_svndiff_window(rs->sfile->rfile->file,
-                                              rs->ver, iterpool));
+      SVN_ERR(skip_svndiff_window(rs, iterpool));
       rs->chunk_index++;
       SVN_ERR(get_file_offset(&start_offset, rs, iterpool));
       rs->current = start_offset - rs->start;
@@ -1651,8 +1780,8 @@ read_plain_window(svn_stringbuf_t **nwin, rep_state_t *rs,
 
   /* Read the plain data. */
   *nwin = svn_stringbuf_create_ensure(size, result_pool);
-  SVN_ERR(svn_io_file_read_full2(rs->sfile->rfile->file, (*nwin)->data, size,
-                                 NULL, NULL, result_pool));
+  SVN_ERR(svn_fs_fs__rev_file_read(rs->sfile->rfile, (*nwin)->data, size,
+                                   NULL));
   (*nwin)->data[size] = 0;
 
   /* Update RS. */
@@ -1672,15 +1801,61 @@ skip_plain_window(rep_state_t *rs,
   return SVN_NO_ERROR;
 }
 
+/* Read SIZE bytes from the fulltext STREAM and return it in *NWIN. */
+static svn_error_t *
+read_stream_window(svn_stringbuf_t **nwin,
+                   svn_stream_t *stream,
+                   apr_size_t size,
+                   apr_pool_t *result_pool)
+{
+  apr_size_t len = size;
+
+  *nwin = svn_stringbuf_create_ensure(size, result_pool);
+  SVN_ERR(svn_stream_read_full(stream, (*nwin)->data, &len));
+  if (len != size)
+    return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                            _("Delta base ended unexpectedly"));
+
+  (*nwin)->len = len;
+  (*nwin)->data[len] = 0;
+
+  return SVN_NO_ERROR;
+}
+
+/* Update the delta chain statistics in FS for a fulltext window that
+   required WALKED delta windows to be applied and that could skip
+   another SAVED windows due to a cached partially composed window. */
+static void
+count_chain_length(svn_fs_t *fs,
+                   int walked,
+                   int saved)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_fs_fs__chain_stats_t *stats = &ffd->chain_stats;
+
+  stats->windows++;
+  stats->links_walked += walked;
+  stats->links_saved += saved;
+  if (saved)
+    stats->partial_hits++;
+
+  stats->chain_lengths[MIN(walked, SVN_FS_FS__CHAIN_LENGTH_BUCKETS - 1)]++;
+}
+
 /* Get the undeltified window that is a result of combining all deltas
    from the current desired representation identified in *RB with its
-   base representation.  Store the window in *RESULT. */
+   base representation.  Store the window in *RESULT.
+
+   If some lower part of the delta chain has already been composed for
+   the same chunk while reading another representation sharing it, start
+   from that partially composed window instead of walking the chain down
+   to its base. */
 static svn_error_t *
 get_combined_window(svn_stringbuf_t **result,
                     struct rep_read_baton *rb)
 {
   apr_pool_t *pool, *new_pool, *window_pool;
-  int i;
+  int i, saved = 0;
   apr_array_header_t *windows;
   svn_stringbuf_t *source, *buf = rb->base_window;
   rep_state_t *rs;
@@ -1689,10 +1864,12 @@ get_combined_window(svn_stringbuf_t **result,
   /* Read all windows that we need to combine. This is fine because
      the size of each window is relatively small (100kB) and skip-
      delta limits the number of deltas in a chain to well under 100.
-     Stop early if one of them does not depend on its predecessors. */
+     Stop early if one of them does not depend on its predecessors
+     or if the remainder of the chain has already been composed. */
   window_pool = svn_pool_create(rb->pool);
   windows = apr_array_make(window_pool, 0, sizeof(svn_txdelta_window_t *));
   iterpool = svn_pool_create(rb->pool);
+  pool = svn_pool_create(rb->pool);
   for (i = 0; i < rb->rs_list->nelts; ++i)
     {
       svn_txdelta_window_t *window;
@@ -1709,10 +1886,35 @@ get_combined_window(svn_stringbuf_t **result,
           ++i;
           break;
         }
+
+      /* We can't reposition a reconstructed large-window base, so only
+         look for partially composed windows with plain and delta bases.
+         The reps further down will catch up once we need them again. */
+      if (   rb->src_stream == NULL && i + 1 < rb->rs_list->nelts
+          && caches_partial_window(rb, i + 1))
+        {
+          svn_stringbuf_t *partial;
+          svn_boolean_t is_cached;
+
+          SVN_ERR(get_cached_partial_window(&partial,
+                                            APR_ARRAY_IDX(rb->rs_list, i + 1,
+                                                          rep_state_t *),
+                                            rb->chunk_index, &is_cached,
+                                            pool));
+          if (is_cached)
+            {
+              buf = partial;
+              ++i;
+              saved = rb->rs_list->nelts - i;
+              rb->src_state_lagging = rb->src_state != NULL;
+              break;
+            }
+        }
     }
 
+  count_chain_length(rb->fs, i, saved);
+
   /* Combine in the windows from the other delta reps. */
-  pool = svn_pool_create(rb->pool);
   for (--i; i >= 0; --i)
     {
       svn_txdelta_window_t *window;
@@ -1729,8 +1931,26 @@ get_combined_window(svn_stringbuf_t **result,
          Also note that we may have short-cut reading the delta chain --
          in which case SRC_OPS is 0 and it might not be a PLAIN rep. */
       source = buf;
-      if (source == NULL && rb->src_state != NULL)
+      if (source == NULL && rb->src_stream != NULL)
+        {
+          /* Same as below but for a reconstructed large-window delta. */
+          if (window->src_ops)
+            SVN_ERR(read_stream_window(&source, rb->src_stream,
+                                       window->sview_len, pool));
+          else
+            SVN_ERR(svn_stream_skip(rb->src_stream, window->sview_len));
+        }
+      else if (source == NULL && rb->src_state != NULL)
         {
+          /* After starting from partially composed windows, the source
+           * rep has not been advanced for the chunks in between.  The
+           * source view tells us where to continue. */
+          if (window->src_ops && rb->src_state_lagging)
+            {
+              rb->src_state->current = window->sview_offset;
+              rb->src_state_lagging = FALSE;
+            }
+
           /* Even if we don't need the source rep now, we still must keep
            * its read offset in sync with what we might need for the next
            * window. */
@@ -1761,6 +1981,11 @@ get_combined_window(svn_stringbuf_t **result,
           && SVN_IS_VALID_REVNUM(rs->revision))
         SVN_ERR(set_cached_combined_window(buf, rs, new_pool));
 
+      /* Reads of other reps whose delta chains lead through RS may
+         start from here. */
+      if (window->src_ops && caches_partial_window(rb, i))
+        SVN_ERR(set_cached_partial_window(buf, rs, new_pool));
+
       rs->chunk_index++;
 
       /* Cycle pools so that we only need to hold three windows at a time. */
@@ -1809,6 +2034,11 @@ get_contents_from_windows(struct rep_read_baton *rb,
   char *cur = buf;
   rep_state_t *rs;
 
+  /* Special case for when there are no delta reps on top of a
+     large-window delta or chunked rep. */
+  if (rb->rs_list->nelts == 0 && rb->src_stream)
+    return svn_error_trace(svn_stream_read_full(rb->src_stream, buf, len));
+
   /* Special case for when there are no delta reps, only a plain
      text. */
   if (rb->rs_list->nelts == 0)
@@ -1840,8 +2070,8 @@ get_contents_from_windows(struct rep_read_baton *rb,
 
           offset = rs->start + rs->current;
           SVN_ERR(rs_aligned_seek(rs, NULL, offset, rb->pool));
-          SVN_ERR(svn_io_file_read_full2(rs->sfile->rfile->file, cur,
-                                         copy_len, NULL, NULL, rb->pool));
+          SVN_ERR(svn_fs_fs__rev_file_read(rs->sfile->rfile, cur, copy_len,
+                                           NULL));
         }
 
       rs->current += copy_len;
@@ -1896,6 +2126,248 @@ get_contents_from_windows(struct rep_read_baton *rb,
   return SVN_NO_ERROR;
 }
 
+/* Baton type for the fulltext stream of a large-window delta rep. */
+typedef struct large_window_baton_t
+{
+  /* State of the large-window delta rep.  Its windows are read in order. */
+  rep_state_t *rs;
+
+  /* Applies those windows to the base fulltext. */
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+
+  /* Reconstructed fulltext of the last window, delivered up to
+     BUFFER_POS. */
+  svn_stringbuf_t *buffer;
+  apr_size_t buffer_pos;
+
+  /* For the current window. */
+  apr_pool_t *iterpool;
+} large_window_baton_t;
+
+/* Implement svn_read_fn_t for the base fulltext of a large-window delta.
+ * BATON is the rep_read_baton for that base. */
+static svn_error_t *
+read_large_window_base(void *baton,
+                       char *buffer,
+                       apr_size_t *len)
+{
+  struct rep_read_baton *rb = baton;
+  return svn_error_trace(get_contents_from_windows(rb, buffer, len));
+}
+
+/* Implement svn_read_fn_t for the fulltext of a large-window delta rep.
+ * BATON is a large_window_baton_t. */
+static svn_error_t *
+read_large_window_contents(void *baton,
+                           char *buffer,
+                           apr_size_t *len)
+{
+  large_window_baton_t *lwb = baton;
+  apr_size_t remaining = *len;
+
+  while (remaining > 0)
+    {
+      if (lwb->buffer_pos < lwb->buffer->len)
+        {
+          apr_size_t copy_len = MIN(remaining,
+                                    lwb->buffer->len - lwb->buffer_pos);
+          memcpy(buffer, lwb->buffer->data + lwb->buffer_pos, copy_len);
+
+          buffer += copy_len;
+          remaining -= copy_len;
+          lwb->buffer_pos += copy_len;
+        }
+      else if (lwb->rs->current < lwb->rs->size)
+        {
+          svn_txdelta_window_t *window;
+
+          /* Reconstruct the next window. */
+          svn_pool_clear(lwb->iterpool);
+          svn_stringbuf_setempty(lwb->buffer);
+          lwb->buffer_pos = 0;
+
+          SVN_ERR(read_delta_window(&window, lwb->rs->chunk_index, lwb->rs,
+                                    lwb->iterpool, lwb->iterpool));
+          SVN_ERR(lwb->handler(window, lwb->handler_baton));
+          lwb->rs->chunk_index++;
+        }
+      else
+        {
+          break;
+        }
+    }
+
+  *len -= remaining;
+  return SVN_NO_ERROR;
+}
+
+/* Set *STREAM to the fulltext of the large-window delta representation
+ * with state RS and header REP_HEADER in FS.  Windows of such deltas may
+ * refer to any part of the base fulltext, so we apply them to a stream
+ * of it like any other svndiff.  Allocate *STREAM in POOL.
+ *
+ * Note that neither the base nor the result will be verified here.  The
+ * MD5 checksum of the rep being read covers them anyway. */
+static svn_error_t *
+read_large_window_rep(svn_stream_t **stream,
+                      rep_state_t *rs,
+                      svn_fs_fs__rep_header_t *rep_header,
+                      svn_fs_t *fs,
+                      apr_pool_t *pool)
+{
+  large_window_baton_t *lwb = apr_pcalloc(pool, sizeof(*lwb));
+  struct rep_read_baton *base_rb = apr_pcalloc(pool, sizeof(*base_rb));
+  representation_t base_rep = { 0 };
+  svn_stream_t *base_stream;
+
+  /* Read the base like any other rep but without the checksumming. */
+  base_rep.revision = rep_header->base_revision;
+  base_rep.item_index = rep_header->base_item_index;
+  base_rep.size = rep_header->base_length;
+  svn_fs_fs__id_txn_reset(&base_rep.txn_id);
+
+  base_rb->fs = fs;
+  base_rb->rep = base_rep;
+  base_rb->pool = svn_pool_create(pool);
+  base_rb->filehandle_pool = pool;
+  SVN_ERR(build_rep_list(&base_rb->rs_list, &base_rb->base_window,
+                         &base_rb->src_state, &base_rb->src_stream, fs,
+                         &base_rep, pool));
+
+  base_stream = svn_stream_create(base_rb, pool);
+  svn_stream_set_read2(base_stream, NULL /* only full read support */,
+                       read_large_window_base);
+
+  /* Apply our windows to it. */
+  lwb->rs = rs;
+  lwb->buffer = svn_stringbuf_create_empty(pool);
+  lwb->iterpool = svn_pool_create(pool);
+  svn_txdelta_apply(base_stream,
+                    svn_stream_from_stringbuf(lwb->buffer, pool),
+                    NULL, NULL, pool, &lwb->handler, &lwb->handler_baton);
+
+  *stream = svn_stream_create(lwb, pool);
+  svn_stream_set_read2(*stream, NULL /* only full read support */,
+                       read_large_window_contents);
+
+  return SVN_NO_ERROR;
+}
+
+/* Baton type for the fulltext stream of a chunked rep. */
+typedef struct chunked_rep_baton_t
+{
+  svn_fs_t *fs;
+
+  /* The representation_t * of all chunks, in order. */
+  apr_array_header_t *chunks;
+
+  /* Index of the chunk to open after CURRENT. */
+  int next;
+
+  /* Contents of the current chunk, NULL between chunks. */
+  svn_stream_t *current;
+
+  /* For CURRENT. */
+  apr_pool_t *chunk_pool;
+} chunked_rep_baton_t;
+
+/* Implement svn_read_fn_t for the fulltext of a chunked rep.
+ * BATON is a chunked_rep_baton_t. */
+static svn_error_t *
+read_chunked_contents(void *baton,
+                      char *buffer,
+                      apr_size_t *len)
+{
+  chunked_rep_baton_t *crb = baton;
+  apr_size_t remaining = *len;
+
+  while (remaining > 0)
+    {
+      apr_size_t read_len = remaining;
+
+      if (crb->current == NULL)
+        {
+          if (crb->next == crb->chunks->nelts)
+            break;
+
+          svn_pool_clear(crb->chunk_pool);
+          SVN_ERR(svn_fs_fs__get_contents(&crb->current, crb->fs,
+                                          APR_ARRAY_IDX(crb->chunks,
+                                                        crb->next,
+                                                        representation_t *),
+                                          TRUE, crb->chunk_pool));
+          crb->next++;
+        }
+
+      /* Continue with the next chunk upon short reads. */
+      SVN_ERR(svn_stream_read_full(crb->current, buffer, &read_len));
+      if (read_len < remaining)
+        {
+          SVN_ERR(svn_stream_close(crb->current));
+          crb->current = NULL;
+        }
+
+      buffer += read_len;
+      remaining -= read_len;
+    }
+
+  *len -= remaining;
+  return SVN_NO_ERROR;
+}
+
+/* Set *STREAM to the fulltext of the chunked representation REP in FS,
+ * i.e. the concatenation of the chunks listed in the rep body that RS
+ * points to.  Allocate *STREAM in POOL.
+ *
+ * Each chunk is a rep of its own and gets verified when being read. */
+static svn_error_t *
+read_chunked_rep(svn_stream_t **stream,
+                 rep_state_t *rs,
+                 const representation_t *rep,
+                 svn_fs_t *fs,
+                 apr_pool_t *pool)
+{
+  chunked_rep_baton_t *crb = apr_pcalloc(pool, sizeof(*crb));
+  apr_size_t size = (apr_size_t)rs->size;
+  svn_stringbuf_t *list;
+  int i;
+
+  /* Read the chunk list. */
+  SVN_ERR(auto_open_shared_file(rs->sfile));
+  SVN_ERR(auto_set_start_offset(rs, pool));
+  SVN_ERR(rs_aligned_seek(rs, NULL, rs->start, pool));
+
+  list = svn_stringbuf_create_ensure(size, pool);
+  SVN_ERR(svn_fs_fs__rev_file_read(rs->sfile->rfile, list->data, size,
+                                   NULL));
+  list->data[size] = 0;
+  list->len = size;
+
+  SVN_ERR(svn_fs_fs__parse_chunk_list(&crb->chunks, list, pool, pool));
+
+  /* Chunks without a revision live next to REP. */
+  for (i = 0; i < crb->chunks->nelts; ++i)
+    {
+      representation_t *chunk = APR_ARRAY_IDX(crb->chunks, i,
+                                              representation_t *);
+      if (!SVN_IS_VALID_REVNUM(chunk->revision))
+        {
+          chunk->revision = rep->revision;
+          chunk->txn_id = rep->txn_id;
+        }
+    }
+
+  crb->fs = fs;
+  crb->chunk_pool = svn_pool_create(pool);
+
+  *stream = svn_stream_create(crb, pool);
+  svn_stream_set_read2(*stream, NULL /* only full read support */,
+                       read_chunked_contents);
+
+  return SVN_NO_ERROR;
+}
+
 /* Baton type for get_fulltext_partial. */
 typedef struct fulltext_baton_t
 {
@@ -2131,8 +2603,8 @@ rep_read_contents(void *baton,
       /* Window stream not initialized, yet.  Do it now. */
       rb->len = rb->rep.expanded_size;
       SVN_ERR(build_rep_list(&rb->rs_list, &rb->base_window,
-                             &rb->src_state, rb->fs, &rb->rep,
-                             rb->filehandle_pool));
+                             &rb->src_state, &rb->src_stream, rb->fs,
+                             &rb->rep, rb->filehandle_pool));
 
       /* In case we did read from the fulltext cache before, make the
        * window stream catch up.  Also, initialize the fulltext buffer
@@ -2267,6 +2739,7 @@ svn_fs_fs__get_contents_from_file(svn_stream_t **contents_p,
                                   apr_off_t offset,
                                   apr_pool_t *pool)
 {
+  fs_fs_data_t *ffd = fs->fsap_data;
   struct rep_read_baton *rb;
   pair_cache_key_t fulltext_cache_key = { SVN_INVALID_REVNUM, 0 };
   rep_state_t *rs = apr_pcalloc(pool, sizeof(*rs));
@@ -2294,9 +2767,11 @@ svn_fs_fs__get_contents_from_file(svn_stream_t **contents_p,
   rs->sfile->rfile->start_revision = SVN_INVALID_REVNUM;
   rs->sfile->rfile->file = file;
   rs->sfile->rfile->stream = svn_stream_from_aprfile2(file, TRUE, pool);
+  rs->sfile->rfile->block_size = ffd->block_size;
+  rs->sfile->rfile->pool = pool;
 
   /* Read the rep header. */
-  SVN_ERR(aligned_seek(fs, file, NULL, offset, pool));
+  SVN_ERR(svn_fs_fs__rev_file_seek(rs->sfile->rfile, NULL, offset));
   SVN_ERR(svn_fs_fs__read_rep_header(&rh, rs->sfile->rfile->stream,
                                      pool, pool));
   SVN_ERR(get_file_offset(&rs->start, rs, pool));
@@ -2318,6 +2793,21 @@ svn_fs_fs__get_contents_from_file(svn_stream_t **contents_p,
       APR_ARRAY_PUSH(rb->rs_list, rep_state_t *) = rs;
       rb->src_state = NULL;
     }
+  else if (rh->type == svn_fs_fs__rep_chunked)
+    {
+      rb->rs_list = apr_array_make(pool, 0, sizeof(rep_state_t *));
+      rb->src_state = NULL;
+      SVN_ERR(read_chunked_rep(&rb->src_stream, rs, rep, fs, pool));
+    }
+  else if (rh->large_window)
+    {
+      /* skip "SVNx" diff marker */
+      rs->current = 4;
+
+      rb->rs_list = apr_array_make(pool, 0, sizeof(rep_state_t *));
+      rb->src_state = NULL;
+      SVN_ERR(read_large_window_rep(&rb->src_stream, rs, rh, fs, pool));
+    }
   else
     {
       representation_t next_rep = { 0 };
@@ -2333,8 +2823,8 @@ svn_fs_fs__get_contents_from_file(svn_stream_t **contents_p,
       svn_fs_fs__id_txn_reset(&next_rep.txn_id);
 
       SVN_ERR(build_rep_list(&rb->rs_list, &rb->base_window,
-                             &rb->src_state, rb->fs, &next_rep,
-                             rb->filehandle_pool));
+                             &rb->src_state, &rb->src_stream, rb->fs,
+                             &next_rep, rb->filehandle_pool));
 
       /* Insert the access to REP as the first element of the delta chain. */
       SVN_ERR(svn_sort__array_insert2(rb->rs_list, &rs, 0));
@@ -2497,8 +2987,10 @@ svn_fs_fs__get_file_delta_stream(svn_txdelta_stream_t **stream_p,
         {
           /* If that matches source, then use this delta as is.
              Note that we want an actual delta here.  E.g. a self-delta would
-             not be good enough. */
+             not be good enough.  Large-window deltas may skip parts of their
+             source, which older clients can't handle. */
           if (rep_header->type == svn_fs_fs__rep_delta
+              && !rep_header->large_window
               && rep_header->base_revision == source->data_rep->revision
               && rep_header->base_item_index == source->data_rep->item_index)
             {
@@ -2728,6 +3220,229 @@ get_txn_dir_info(svn_filesize_t *filesize,
   return SVN_NO_ERROR;
 }
 
+/* Read the committed directory representation REP in FS and return its
+ * entries in *ENTRIES_P.  ID is provided for nicer error messages.
+ * Allocate *ENTRIES_P in RESULT_POOL and use SCRATCH_POOL for temporaries.
+ */
+static svn_error_t *
+read_dir_rep(apr_array_header_t **entries_p,
+             svn_fs_t *fs,
+             representation_t *rep,
+             const svn_fs_id_t *id,
+             apr_pool_t *result_pool,
+             apr_pool_t *scratch_pool)
+{
+  /* Undeltify content before parsing it. Otherwise, we could only
+   * parse it byte-by-byte.
+   */
+  apr_size_t len = rep->expanded_size;
+  svn_stringbuf_t *text;
+  svn_stream_t *contents;
+
+  SVN_ERR(svn_fs_fs__get_contents(&contents, fs, rep, FALSE, scratch_pool));
+  SVN_ERR(svn_stringbuf_from_stream(&text, contents, len, scratch_pool));
+  SVN_ERR(svn_stream_close(contents));
+
+  /* de-serialize hash */
+  contents = svn_stream_from_stringbuf(text, scratch_pool);
+  SVN_ERR(read_dir_entries(entries_p, contents, FALSE, id, result_pool,
+                           scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* If the committed directory representation REP in FS is a BLOCKED rep,
+ * set *BLOCKS to its block index, i.e. an array of svn_fs_fs__dir_block_t.
+ * Otherwise, set *BLOCKS to NULL.  Use and update the directory index
+ * cache.  Allocate *BLOCKS in RESULT_POOL and use SCRATCH_POOL for
+ * temporaries.
+ */
+static svn_error_t *
+get_dir_index(apr_array_header_t **blocks,
+              svn_fs_t *fs,
+              representation_t *rep,
+              apr_pool_t *result_pool,
+              apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  pair_cache_key_t key;
+  svn_boolean_t found = FALSE;
+  rep_state_t *rs;
+  svn_fs_fs__rep_header_t *rep_header;
+  svn_stream_t *contents;
+
+  *blocks = NULL;
+  if (   ffd->format < SVN_FS_FS__MIN_BLOCKED_DIRS_FORMAT
+      || svn_fs_fs__id_txn_used(&rep->txn_id))
+    return SVN_NO_ERROR;
+
+  key.revision = rep->revision;
+  key.second = rep->item_index;
+  if (ffd->dir_index_cache)
+    {
+      SVN_ERR(svn_cache__get((void **)blocks, &found, ffd->dir_index_cache,
+                             &key, result_pool));
+      if (found)
+        return SVN_NO_ERROR;
+    }
+
+  /* Only BLOCKED reps have an index.  Their header tells us. */
+  SVN_ERR(create_rep_state(&rs, &rep_header, NULL, rep, fs, scratch_pool,
+                           scratch_pool));
+  if (!rep_header->blocked_dir)
+    {
+      *blocks = NULL;
+      return SVN_NO_ERROR;
+    }
+
+  SVN_ERR(svn_fs_fs__get_contents(&contents, fs, rep, FALSE, scratch_pool));
+  SVN_ERR(svn_fs_fs__parse_dir_index(blocks, contents, result_pool,
+                                     scratch_pool));
+  SVN_ERR(svn_stream_close(contents));
+
+  if (ffd->dir_index_cache)
+    SVN_ERR(svn_cache__set(ffd->dir_index_cache, &key, *blocks,
+                           scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Return the rep of the block in BLOCKS (an array of svn_fs_fs__dir_block_t)
+ * that may contain the entry NAME, or NULL if NAME sorts before all blocks.
+ */
+static representation_t *
+find_dir_block(apr_array_header_t *blocks,
+               const char *name)
+{
+  int lower = 0;
+  int upper = blocks->nelts;
+
+  /* The block containing NAME is the last one starting at or before it. */
+  while (lower < upper)
+    {
+      int middle = lower + (upper - lower) / 2;
+      if (strcmp(APR_ARRAY_IDX(blocks, middle,
+                               svn_fs_fs__dir_block_t).first_name,
+                 name) <= 0)
+        lower = middle + 1;
+      else
+        upper = middle;
+    }
+
+  return lower > 0
+       ? &APR_ARRAY_IDX(blocks, lower - 1, svn_fs_fs__dir_block_t).rep
+       : NULL;
+}
+
+/* Set *ENTRIES_P to the entries of the directory block REP in FS.  Use and
+ * update the directory cache.  ID is provided for nicer error messages.
+ * Allocate *ENTRIES_P in RESULT_POOL and use SCRATCH_POOL for temporaries.
+ */
+static svn_error_t *
+get_dir_block(apr_array_header_t **entries_p,
+              svn_fs_t *fs,
+              representation_t *rep,
+              const svn_fs_id_t *id,
+              apr_pool_t *result_pool,
+              apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  pair_cache_key_t key;
+  svn_fs_fs__dir_data_t *dir;
+  svn_boolean_t found = FALSE;
+
+  key.revision = rep->revision;
+  key.second = rep->item_index;
+  if (ffd->dir_cache)
+    {
+      SVN_ERR(svn_cache__get((void **)&dir, &found, ffd->dir_cache, &key,
+                             result_pool));
+      if (found)
+        {
+          *entries_p = dir->entries;
+          return SVN_NO_ERROR;
+        }
+    }
+
+  dir = apr_pcalloc(scratch_pool, sizeof(*dir));
+  dir->txn_filesize = SVN_INVALID_FILESIZE;
+  SVN_ERR(read_dir_rep(&dir->entries, fs, rep, id, result_pool,
+                       scratch_pool));
+
+  if (ffd->dir_cache)
+    SVN_ERR(svn_cache__set(ffd->dir_cache, &key, dir, scratch_pool));
+
+  *entries_p = dir->entries;
+  return SVN_NO_ERROR;
+}
+
+/* Set *ENTRIES_P to the concatenated entries of all BLOCKS (an array of
+ * svn_fs_fs__dir_block_t) of a BLOCKED directory in FS.  ID is provided
+ * for nicer error messages.  Allocate *ENTRIES_P in RESULT_POOL and use
+ * SCRATCH_POOL for temporaries.
+ */
+static svn_error_t *
+read_blocked_dir(apr_array_header_t **entries_p,
+                 svn_fs_t *fs,
+                 apr_array_header_t *blocks,
+                 const svn_fs_id_t *id,
+                 apr_pool_t *result_pool,
+                 apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  apr_array_header_t *entries
+    = apr_array_make(result_pool, 16, sizeof(svn_fs_dirent_t *));
+  int i;
+
+  for (i = 0; i < blocks->nelts; ++i)
+    {
+      svn_fs_fs__dir_block_t *block
+        = &APR_ARRAY_IDX(blocks, i, svn_fs_fs__dir_block_t);
+      apr_array_header_t *block_entries;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(get_dir_block(&block_entries, fs, &block->rep, id,
+                            result_pool, iterpool));
+
+      /* Each block must start with the name that the index lists for it.
+       * Since the index is sorted, so will be the concatenated blocks. */
+      if (   block_entries->nelts == 0
+          || strcmp(APR_ARRAY_IDX(block_entries, 0,
+                                  svn_fs_dirent_t *)->name,
+                    block->first_name) != 0
+          || (   i + 1 < blocks->nelts
+              && strcmp(APR_ARRAY_IDX(block_entries,
+                                      block_entries->nelts - 1,
+                                      svn_fs_dirent_t *)->name,
+                        APR_ARRAY_IDX(blocks, i + 1,
+                                      svn_fs_fs__dir_block_t).first_name)
+                 >= 0))
+        return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                           _("Directory block corrupt in '%s'"),
+                           svn_fs_fs__id_unparse(id, scratch_pool)->data);
+
+      apr_array_cat(entries, block_entries);
+    }
+
+  svn_pool_destroy(iterpool);
+
+  *entries_p = entries;
+  return SVN_NO_ERROR;
+}
+
+/* Return a deep copy of the directory ENTRY, allocated in RESULT_POOL. */
+static svn_fs_dirent_t *
+dir_entry_dup(const svn_fs_dirent_t *entry,
+              apr_pool_t *result_pool)
+{
+  svn_fs_dirent_t *copy = apr_palloc(result_pool, sizeof(*copy));
+  copy->name = apr_pstrdup(result_pool, entry->name);
+  copy->id = svn_fs_fs__id_copy(entry->id, result_pool);
+  copy->kind = entry->kind;
+
+  return copy;
+}
+
 /* Fetch the contents of a directory into DIR.  Values are stored
    as filename to string mappings; further conversion is necessary to
    convert them into svn_fs_dirent_t values. */
@@ -2769,22 +3484,18 @@ get_dir_contents(svn_fs_fs__dir_data_t *dir,
     }
   else if (noderev->data_rep)
     {
-      /* Undeltify content before parsing it. Otherwise, we could only
-       * parse it byte-by-byte.
-       */
-      apr_size_t len = noderev->data_rep->expanded_size;
-      svn_stringbuf_t *text;
-
-      /* The representation is immutable.  Read it normally. */
-      SVN_ERR(svn_fs_fs__get_contents(&contents, fs, noderev->data_rep,
-                                      FALSE, scratch_pool));
-      SVN_ERR(svn_stringbuf_from_stream(&text, contents, len, scratch_pool));
-      SVN_ERR(svn_stream_close(contents));
-
-      /* de-serialize hash */
-      contents = svn_stream_from_stringbuf(text, scratch_pool);
-      SVN_ERR(read_dir_entries(&dir->entries, contents, FALSE, noderev->id,
-                               result_pool, scratch_pool));
+      apr_array_header_t *blocks;
+
+      /* The representation is immutable.  Very large directories may
+       * have been split into blocks. */
+      SVN_ERR(get_dir_index(&blocks, fs, noderev->data_rep, scratch_pool,
+                            scratch_pool));
+      if (blocks)
+        SVN_ERR(read_blocked_dir(&dir->entries, fs, blocks, noderev->id,
+                                 result_pool, scratch_pool));
+      else
+        SVN_ERR(read_dir_rep(&dir->entries, fs, noderev->data_rep,
+                             noderev->id, result_pool, scratch_pool));
     }
   else
     {
@@ -2834,6 +3545,89 @@ locate_dir_cache(svn_fs_t *fs,
     }
 }
 
+/* Look up the entry NAME in the committed directory NODEREV in FS, if it
+ * has been stored as a BLOCKED rep.  In that case, set *FOUND and return
+ * the entry in *DIRENT or NULL if the directory does not contain NAME.
+ * Otherwise, set *FOUND to FALSE.  Only the block index and a single block
+ * will be read.  Allocate *DIRENT in RESULT_POOL and use SCRATCH_POOL for
+ * temporaries.
+ */
+static svn_error_t *
+find_dir_entry_in_blocks(svn_fs_dirent_t **dirent,
+                         svn_boolean_t *found,
+                         svn_fs_t *fs,
+                         node_revision_t *noderev,
+                         const char *name,
+                         apr_pool_t *result_pool,
+                         apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  representation_t *block_rep = NULL;
+  pair_cache_key_t key;
+  apr_array_header_t *entries;
+  svn_fs_dirent_t *entry;
+
+  *found = FALSE;
+  if (   ffd->format < SVN_FS_FS__MIN_BLOCKED_DIRS_FORMAT
+      || !noderev->data_rep
+      || svn_fs_fs__id_txn_used(&noderev->data_rep->txn_id))
+    return SVN_NO_ERROR;
+
+  /* Which block would contain NAME? */
+  key.revision = noderev->data_rep->revision;
+  key.second = noderev->data_rep->item_index;
+  if (ffd->dir_index_cache)
+    SVN_ERR(svn_cache__get_partial((void **)&block_rep, found,
+                                   ffd->dir_index_cache, &key,
+                                   svn_fs_fs__extract_dir_block,
+                                   (void *)name, scratch_pool));
+  if (!*found)
+    {
+      apr_array_header_t *blocks;
+
+      SVN_ERR(get_dir_index(&blocks, fs, noderev->data_rep, scratch_pool,
+                            scratch_pool));
+      if (!blocks)
+        return SVN_NO_ERROR;
+
+      block_rep = find_dir_block(blocks, name);
+      *found = TRUE;
+    }
+
+  /* Sorts before the first entry? */
+  if (!block_rep)
+    {
+      *dirent = NULL;
+      return SVN_NO_ERROR;
+    }
+
+  /* Look for NAME in the cached block. */
+  key.revision = block_rep->revision;
+  key.second = block_rep->item_index;
+  if (ffd->dir_cache)
+    {
+      extract_dir_entry_baton_t baton;
+      svn_boolean_t is_cached;
+
+      baton.name = name;
+      baton.txn_filesize = SVN_INVALID_FILESIZE;
+      SVN_ERR(svn_cache__get_partial((void **)dirent, &is_cached,
+                                     ffd->dir_cache, &key,
+                                     svn_fs_fs__extract_dir_entry,
+                                     &baton, result_pool));
+      if (is_cached && !baton.out_of_date)
+        return SVN_NO_ERROR;
+    }
+
+  /* Read and cache the block. */
+  SVN_ERR(get_dir_block(&entries, fs, block_rep, noderev->id, scratch_pool,
+                        scratch_pool));
+  entry = svn_fs_fs__find_dir_entry(entries, name, NULL);
+  *dirent = entry ? dir_entry_dup(entry, result_pool) : NULL;
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_fs_fs__rep_contents_dir(apr_array_header_t **entries_p,
                             svn_fs_t *fs,
@@ -2886,6 +3680,21 @@ svn_fs_fs__rep_contents_dir(apr_array_header_t **entries_p,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_fs_fs__get_dir_block_index(apr_array_header_t **blocks,
+                               svn_fs_t *fs,
+                               node_revision_t *noderev,
+                               apr_pool_t *result_pool,
+                               apr_pool_t *scratch_pool)
+{
+  *blocks = NULL;
+  if (noderev->data_rep)
+    SVN_ERR(get_dir_index(blocks, fs, noderev->data_rep, result_pool,
+                          scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
 svn_fs_dirent_t *
 svn_fs_fs__find_dir_entry(apr_array_header_t *entries,
                           const char *name,
@@ -2929,11 +3738,18 @@ svn_fs_fs__rep_contents_dir_entry(svn_fs_dirent_t **dirent,
                                      result_pool));
     }
 
+  /* Very large directories may have been stored in blocks. */
+  if (! found || baton.out_of_date)
+    {
+      SVN_ERR(find_dir_entry_in_blocks(dirent, &found, fs, noderev, name,
+                                       result_pool, scratch_pool));
+      baton.out_of_date = FALSE;
+    }
+
   /* fetch data from disk if we did not find it in the cache */
   if (! found || baton.out_of_date)
     {
       svn_fs_dirent_t *entry;
-      svn_fs_dirent_t *entry_copy = NULL;
       svn_fs_fs__dir_data_t dir;
 
       /* Read in the directory contents. */
@@ -2950,15 +3766,7 @@ svn_fs_fs__rep_contents_dir_entry(svn_fs_dirent_t **dirent,
 
       /* find desired entry and return a copy in POOL, if found */
       entry = svn_fs_fs__find_dir_entry(dir.entries, name, NULL);
-      if (entry)
-        {
-          entry_copy = apr_palloc(result_pool, sizeof(*entry_copy));
-          entry_copy->name = apr_pstrdup(result_pool, entry->name);
-          entry_copy->id = svn_fs_fs__id_copy(entry->id, result_pool);
-          entry_copy->kind = entry->kind;
-        }
-
-      *dirent = entry_copy;
+      *dirent = entry ? dir_entry_dup(entry, result_pool) : NULL;
     }
 
   return SVN_NO_ERROR;
@@ -3142,9 +3950,9 @@ svn_fs_fs__get_changes(apr_array_header_t **changes,
             }
 
           /* Actual reading and parsing are the same, though. */
-          SVN_ERR(aligned_seek(context->fs, context->revision_file->file,
-                               NULL, changes_offset + context->next_offset,
-                               scratch_pool));
+          SVN_ERR(svn_fs_fs__rev_file_seek(context->revision_file, NULL,
+                                           changes_offset
+                                             + context->next_offset));
 
           SVN_ERR(svn_fs_fs__read_changes(changes,
                                           context->revision_file->stream,
@@ -3153,9 +3961,8 @@ svn_fs_fs__get_changes(apr_array_header_t **changes,
 
           /* Construct the info object for the entries block we just read. */
           changes_list = apr_pcalloc(scratch_pool, sizeof(*changes_list));
-          SVN_ERR(svn_io_file_get_offset(&changes_list->end_offset,
-                                         context->revision_file->file,
-                                         scratch_pool));
+          SVN_ERR(svn_fs_fs__rev_file_offset(&changes_list->end_offset,
+                                             context->revision_file));
           changes_list->end_offset -= changes_offset;
           changes_list->start_offset = context->next_offset;
           changes_list->count = (*changes)->nelts;
@@ -3226,13 +4033,15 @@ init_rep_state(rep_state_t *rs,
   rs->item_index = entry->item.number;
   rs->header_size = rep_header->header_size;
   rs->start = entry->offset + rs->header_size;
-  rs->current = rep_header->type == svn_fs_fs__rep_plain ? 0 : 4;
+  rs->current = (   rep_header->type == svn_fs_fs__rep_plain
+                 || rep_header->type == svn_fs_fs__rep_chunked) ? 0 : 4;
   rs->size = entry->size - rep_header->header_size - 7;
   rs->ver = -1;
   rs->chunk_index = 0;
   rs->raw_window_cache = ffd->raw_window_cache;
   rs->window_cache = ffd->txdelta_window_cache;
   rs->combined_cache = ffd->combined_window_cache;
+  rs->partial_cache = ffd->partial_window_cache;
 
   return SVN_NO_ERROR;
 }
@@ -3338,8 +4147,8 @@ cache_windows(svn_fs_t *fs,
           /* Read the raw window. */
           buf = apr_palloc(iterpool, window_len + 1);
           SVN_ERR(rs_aligned_seek(rs, NULL, start_offset, iterpool));
-          SVN_ERR(svn_io_file_read_full2(rs->sfile->rfile->file, buf,
-                                         window_len, NULL, NULL, iterpool));
+          SVN_ERR(svn_fs_fs__rev_file_read(rs->sfile->rfile, buf,
+                                           window_len, NULL));
           buf[window_len] = 0;
 
           /* update relative offset in representation */
@@ -3388,6 +4197,10 @@ block_read_windows(svn_fs_fs__rep_header_t *rep_header,
   apr_off_t offset;
   window_cache_key_t key = { 0 };
 
+  /* The chunk list of chunked reps is not worth caching. */
+  if (rep_header->type == svn_fs_fs__rep_chunked)
+    return SVN_NO_ERROR;
+
   if (   (rep_header->type != svn_fs_fs__rep_plain
           && (!ffd->txdelta_window_cache || !ffd->raw_window_cache))
       || (rep_header->type == svn_fs_fs__rep_plain
@@ -3415,12 +4228,11 @@ block_read_windows(svn_fs_fs__rep_header_t *rep_header,
       /* for larger reps, the header may have crossed a block boundary.
        * make sure we still read blocks properly aligned, i.e. don't use
        * plain seek here. */
-      SVN_ERR(aligned_seek(fs, rev_file->file, NULL, offset, scratch_pool));
+      SVN_ERR(svn_fs_fs__rev_file_seek(rev_file, NULL, offset));
 
       plaintext = svn_stringbuf_create_ensure(rs.size, result_pool);
-      SVN_ERR(svn_io_file_read_full2(rev_file->file, plaintext->data,
-                                     rs.size, &plaintext->len, NULL,
-                                     result_pool));
+      SVN_ERR(svn_fs_fs__rev_file_read(rev_file, plaintext->data, rs.size,
+                                       &plaintext->len));
       plaintext->data[plaintext->len] = 0;
       rs.current += rs.size;
 
@@ -3510,17 +4322,32 @@ read_item(svn_stream_t **stream,
   apr_uint32_t digest;
   svn_checksum_t *expected, *actual;
   apr_uint32_t plain_digest;
+  const char *mapped;
 
-  /* Read item into string buffer. */
-  svn_stringbuf_t *text = svn_stringbuf_create_ensure(entry->size, pool);
-  text->len = entry->size;
-  text->data[text->len] = 0;
-  SVN_ERR(svn_io_file_read_full2(rev_file->file, text->data, text->len,
-                                 NULL, NULL, pool));
+  /* Mapped files allow us to parse the item in-place.  Otherwise,
+   * read it into a string buffer. */
+  SVN_ERR(svn_fs_fs__rev_file_get_mapped(&mapped, rev_file,
+                                         (apr_size_t)entry->size));
+  if (mapped)
+    {
+      svn_string_t *text = apr_palloc(pool, sizeof(*text));
+      text->data = mapped;
+      text->len = (apr_size_t)entry->size;
 
-  /* Return (construct, calculate) stream and checksum. */
-  *stream = svn_stream_from_stringbuf(text, pool);
-  digest = svn__fnv1a_32x4(text->data, text->len);
+      *stream = svn_stream_from_string(text, pool);
+      digest = svn__fnv1a_32x4(text->data, text->len);
+    }
+  else
+    {
+      svn_stringbuf_t *text = svn_stringbuf_create_ensure(entry->size, pool);
+      text->len = entry->size;
+      text->data[text->len] = 0;
+      SVN_ERR(svn_fs_fs__rev_file_read(rev_file, text->data, text->len,
+                                       NULL));
+
+      *stream = svn_stream_from_stringbuf(text, pool);
+      digest = svn__fnv1a_32x4(text->data, text->len);
+    }
 
   /* Checksums will match most of the time. */
   if (entry->fnv1_checksum == digest)
@@ -3658,6 +4485,90 @@ block_read_noderev(node_revision_t **noderev_p,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_fs_fs__get_prefetch_range(apr_off_t *start,
+                              apr_off_t *end,
+                              svn_fs_t *fs,
+                              svn_fs_fs__revision_file_t *revision_file,
+                              svn_revnum_t revision,
+                              apr_off_t block_start,
+                              apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  apr_off_t window_start = block_start + ffd->block_size;
+  apr_off_t window_end;
+  apr_array_header_t *entries;
+  svn_boolean_t found = FALSE;
+  int i;
+
+  *start = window_start;
+  *end = window_start;
+
+  /* There is nothing to prefetch behind the revision contents. */
+  SVN_ERR(svn_fs_fs__auto_read_footer(revision_file));
+  window_end = MIN(window_start + ffd->prefetch_blocks * ffd->block_size,
+                   revision_file->l2p_offset);
+  if (window_start >= window_end)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_fs_fs__p2l_index_lookup(&entries, fs, revision_file, revision,
+                                      window_start,
+                                      window_end - window_start,
+                                      scratch_pool, scratch_pool));
+
+  for (i = 0; i < entries->nelts; ++i)
+    {
+      svn_fs_fs__p2l_entry_t *entry
+        = &APR_ARRAY_IDX(entries, i, svn_fs_fs__p2l_entry_t);
+
+      /* Items starting in the current block have just been read and
+       * unused sections will never be. */
+      if (   entry->offset < window_start
+          || entry->type == SVN_FS_FS__ITEM_TYPE_UNUSED)
+        continue;
+
+      /* Items that exceed the window will be read sequentially later on
+       * and profit from the OS' own read-ahead. */
+      if (entry->offset + entry->size > window_end)
+        break;
+
+      if (!found)
+        *start = entry->offset;
+
+      *end = entry->offset + entry->size;
+      found = TRUE;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Ask the OS to read the items following the block at BLOCK_START in
+ * REVISION_FILE of FS in the background.  REVISION_FILE is the rev / pack
+ * file containing REVISION.  Use SCRATCH_POOL for temporary allocations.
+ *
+ * The P2L index orders items by their expected access pattern, so a
+ * checkout or export that just needed this block will very likely need
+ * the next items as well.
+ */
+static svn_error_t *
+prefetch_following_items(svn_fs_t *fs,
+                         svn_fs_fs__revision_file_t *revision_file,
+                         svn_revnum_t revision,
+                         apr_off_t block_start,
+                         apr_pool_t *scratch_pool)
+{
+  apr_off_t start, end;
+
+  SVN_ERR(svn_fs_fs__get_prefetch_range(&start, &end, fs, revision_file,
+                                        revision, block_start,
+                                        scratch_pool));
+  if (start < end)
+    SVN_ERR(svn_fs_fs__rev_file_prefetch(revision_file, start,
+                                         end - start));
+
+  return SVN_NO_ERROR;
+}
+
 /* Read the whole (e.g. 64kB) block containing ITEM_INDEX of REVISION in FS
  * and put all data into cache.  If necessary and depending on heuristics,
  * neighboring blocks may also get read.  The data is being read from
@@ -3718,8 +4629,7 @@ block_read(void **result,
                                           ffd->block_size, scratch_pool,
                                           scratch_pool));
 
-      SVN_ERR(aligned_seek(fs, revision_file->file, &block_start, offset,
-                           iterpool));
+      SVN_ERR(svn_fs_fs__rev_file_seek(revision_file, &block_start, offset));
 
       /* read all items from the block */
       for (i = 0; i < entries->nelts; ++i)
@@ -3751,8 +4661,8 @@ block_read(void **result,
                             && entry->size < ffd->block_size))
             {
               void *item = NULL;
-              SVN_ERR(svn_io_file_seek(revision_file->file, APR_SET,
-                                       &entry->offset, iterpool));
+              SVN_ERR(svn_fs_fs__rev_file_seek(revision_file, NULL,
+                                               entry->offset));
               switch (entry->type)
                 {
                   case SVN_FS_FS__ITEM_TYPE_FILE_REP:
@@ -3798,6 +4708,11 @@ block_read(void **result,
   while(run_count++ == 1); /* can only be true once and only if a block
                             * boundary got crossed */
 
+  /* Make the OS fetch the data that we will probably read next. */
+  if (ffd->prefetch_blocks > 0)
+    SVN_ERR(prefetch_following_items(fs, revision_file, revision,
+                                     block_start, iterpool));
+
   /* if the caller requested a result, we must have provided one by now */
   assert(!result || *result);
   svn_pool_destroy(iterpool);
@@ -140,6 +140,17 @@ svn_fs_fs__rep_contents_dir(apr_array_header_t **entries_p,
                             apr_pool_t *result_pool,
                             apr_pool_t *scratch_pool);
 
+/* If the committed directory NODEREV in FS has been stored as a BLOCKED
+   rep, set *BLOCKS to its block index, i.e. an array of
+   svn_fs_fs__dir_block_t sorted by name.  Otherwise, set *BLOCKS to NULL.
+   Allocate *BLOCKS in RESULT_POOL and use SCRATCH_POOL for temporaries. */
+svn_error_t *
+svn_fs_fs__get_dir_block_index(apr_array_header_t **blocks,
+                               svn_fs_t *fs,
+                               node_revision_t *noderev,
+                               apr_pool_t *result_pool,
+                               apr_pool_t *scratch_pool);
+
 /* Return the directory entry from ENTRIES that matches NAME.  If no such
    entry exists, return NULL.  If HINT is not NULL, set *HINT to the array
    index of the entry returned.  Successive calls in a linear scan scenario
@@ -188,4 +199,22 @@ svn_fs_fs__get_changes(apr_array_header_t **changes,
                        apr_pool_t *result_pool,
                        apr_pool_t *scratch_pool);
 
+/* Set *START and *END to the range of REVISION_FILE in FS that block-read
+ * asks the OS to prefetch after reading the block at BLOCK_START.
+ * REVISION_FILE must be the rev / pack file containing REVISION.
+ *
+ * The range covers the used items that start within the prefetch window
+ * following that block, up to the first item that does not end within
+ * the window.  *START will be equal to *END if there is nothing to
+ * prefetch.  Use SCRATCH_POOL for temporary allocations.
+ */
+svn_error_t *
+svn_fs_fs__get_prefetch_range(apr_off_t *start,
+                              apr_off_t *end,
+                              svn_fs_t *fs,
+                              svn_fs_fs__revision_file_t *revision_file,
+                              svn_revnum_t revision,
+                              apr_off_t block_start,
+                              apr_pool_t *scratch_pool);
+
 #endif
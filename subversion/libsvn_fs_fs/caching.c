@@ -234,16 +234,31 @@ dump_global_cache_statistics(void *baton_void)
 
 #endif /* SVN_DEBUG_CACHE_DUMP_STATS */
 
+/* Return the kind of cache that uses the key PREFIX for reporting it to
+ * monitoring, e.g. "fsfs:DIR".  Allocate the result in RESULT_POOL.
+ */
+static const char *
+get_metrics_kind(const char *prefix,
+                 apr_pool_t *result_pool)
+{
+  /* The last part of the prefix identifies the type of data. */
+  const char *kind = strrchr(prefix, ':');
+  return apr_pstrcat(result_pool, "fsfs:", kind ? kind + 1 : prefix,
+                     SVN_VA_NULL);
+}
+
 /* This function sets / registers the required callbacks for a given
  * not transaction-specific CACHE object in FS, if CACHE is not NULL.
  *
  * All these svn_cache__t instances shall be handled uniformly. Unless
- * ERROR_HANDLER is NULL, register it for the given CACHE in FS.
+ * ERROR_HANDLER is NULL, register it for the given CACHE in FS.  Unless
+ * METRICS_KIND is NULL, report CACHE's statistics under that name.
  */
 static svn_error_t *
 init_callbacks(svn_cache__t *cache,
                svn_fs_t *fs,
                svn_cache__error_handler_t error_handler,
+               const char *metrics_kind,
                apr_pool_t *pool)
 {
   if (cache != NULL)
@@ -271,6 +286,9 @@ init_callbacks(svn_cache__t *cache,
                                              fs,
                                              pool));
 
+      /* Report access statistics to monitoring, if enabled. */
+      if (metrics_kind)
+        SVN_ERR(svn_cache__register_metrics(cache, metrics_kind, pool));
     }
 
   return SVN_NO_ERROR;
@@ -285,7 +303,8 @@ init_callbacks(svn_cache__t *cache,
  * whether we prefixed this cache instance with a namespace.
  *
  * Unless NO_HANDLER is true, register an error handler that reports errors
- * as warnings to the FS warning callback.
+ * as warnings to the FS warning callback.  HAS_TXN_SCOPE indicates that
+ * the cache is specific to a transaction.
  *
  * Cache is allocated in RESULT_POOL, temporaries in SCRATCH_POOL.
  * */
@@ -303,6 +322,7 @@ create_cache(svn_cache__t **cache_p,
              svn_boolean_t has_namespace,
              svn_fs_t *fs,
              svn_boolean_t no_handler,
+             svn_boolean_t has_txn_scope,
              apr_pool_t *result_pool,
              apr_pool_t *scratch_pool)
 {
@@ -341,7 +361,12 @@ create_cache(svn_cache__t **cache_p,
       *cache_p = NULL;
     }
 
-  SVN_ERR(init_callbacks(*cache_p, fs, error_handler, result_pool));
+  /* Transaction-specific caches come and go with every transaction.
+   * Don't report them, so the set of reported metrics stays bounded. */
+  SVN_ERR(init_callbacks(*cache_p, fs, error_handler,
+                         has_txn_scope ? NULL
+                                       : get_metrics_kind(prefix, result_pool),
+                         result_pool));
 
   return SVN_NO_ERROR;
 }
@@ -417,6 +442,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
                        has_namespace,
                        fs,
                        no_handler,
+                       FALSE,
                        fs->pool, pool));
 
   /* Rough estimate: revision DAG nodes have size around 1kBytes, so
@@ -433,6 +459,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
                        has_namespace,
                        fs,
                        no_handler,
+                       FALSE,
                        fs->pool, pool));
 
   /* 1st level DAG node cache */
@@ -451,6 +478,24 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
                        has_namespace,
                        fs,
                        no_handler,
+                       FALSE,
+                       fs->pool, pool));
+
+  /* Only used for very large directories, so don't bother with an
+     in-process fallback. */
+  SVN_ERR(create_cache(&(ffd->dir_index_cache),
+                       NULL,
+                       membuffer,
+                       0, 0, /* Do not use the inprocess cache */
+                       svn_fs_fs__serialize_dir_index,
+                       svn_fs_fs__deserialize_dir_index,
+                       sizeof(pair_cache_key_t),
+                       apr_pstrcat(pool, prefix, "DIRINDEX", SVN_VA_NULL),
+                       SVN_CACHE__MEMBUFFER_HIGH_PRIORITY,
+                       has_namespace,
+                       fs,
+                       no_handler,
+                       FALSE,
                        fs->pool, pool));
 
   /* 8 kBytes per entry (1000 revs / shared, one file offset per rev).
@@ -468,6 +513,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
                        has_namespace,
                        fs,
                        no_handler,
+                       FALSE,
                        fs->pool, pool));
 
   /* initialize node revision cache, if caching has been enabled */
@@ -483,6 +529,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
                        has_namespace,
                        fs,
                        no_handler,
+                       FALSE,
                        fs->pool, pool));
 
   /* initialize representation header cache, if caching has been enabled */
@@ -498,6 +545,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
                        has_namespace,
                        fs,
                        no_handler,
+                       FALSE,
                        fs->pool, pool));
 
   /* initialize node change list cache, if caching has been enabled */
@@ -513,6 +561,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
                        has_namespace,
                        fs,
                        no_handler,
+                       FALSE,
                        fs->pool, pool));
 
   /* if enabled, cache revprops */
@@ -528,6 +577,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
                        TRUE, /* contents is short-lived */
                        fs,
                        no_handler,
+                       FALSE,
                        fs->pool, pool));
 
   /* if enabled, cache fulltext and other derived information */
@@ -545,6 +595,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
                            has_namespace,
                            fs,
                            no_handler,
+                           FALSE,
                            fs->pool, pool));
 
       SVN_ERR(create_cache(&(ffd->mergeinfo_cache),
@@ -560,6 +611,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
                            has_namespace,
                            fs,
                            no_handler,
+                           FALSE,
                            fs->pool, pool));
 
       SVN_ERR(create_cache(&(ffd->mergeinfo_existence_cache),
@@ -575,6 +627,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
                            has_namespace,
                            fs,
                            no_handler,
+                           FALSE,
                            fs->pool, pool));
     }
   else
@@ -600,6 +653,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
                            has_namespace,
                            fs,
                            no_handler,
+                           FALSE,
                            fs->pool, pool));
     }
   else
@@ -623,6 +677,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
                            has_namespace,
                            fs,
                            no_handler,
+                           FALSE,
                            fs->pool, pool));
 
       SVN_ERR(create_cache(&(ffd->txdelta_window_cache),
@@ -638,6 +693,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
                            has_namespace,
                            fs,
                            no_handler,
+                           FALSE,
                            fs->pool, pool));
 
       SVN_ERR(create_cache(&(ffd->combined_window_cache),
@@ -653,12 +709,33 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
                            has_namespace,
                            fs,
                            no_handler,
+                           FALSE,
                            fs->pool, pool));
+
+      if (ffd->partial_window_interval > 0)
+        SVN_ERR(create_cache(&(ffd->partial_window_cache),
+                             NULL,
+                             membuffer,
+                             0, 0, /* Do not use the inprocess cache */
+                             /* Values are svn_stringbuf_t */
+                             NULL, NULL,
+                             sizeof(window_cache_key_t),
+                             apr_pstrcat(pool, prefix, "PARTIAL_WINDOW",
+                                         SVN_VA_NULL),
+                             SVN_CACHE__MEMBUFFER_LOW_PRIORITY,
+                             has_namespace,
+                             fs,
+                             no_handler,
+                             FALSE,
+                             fs->pool, pool));
+      else
+        ffd->partial_window_cache = NULL;
     }
   else
     {
       ffd->txdelta_window_cache = NULL;
       ffd->combined_window_cache = NULL;
+      ffd->partial_window_cache = NULL;
     }
 
   SVN_ERR(create_cache(&(ffd->l2p_header_cache),
@@ -677,6 +754,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
                        has_namespace,
                        fs,
                        no_handler,
+                       FALSE,
                        fs->pool, pool));
   SVN_ERR(create_cache(&(ffd->l2p_page_cache),
                        NULL,
@@ -694,6 +772,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
                        has_namespace,
                        fs,
                        no_handler,
+                       FALSE,
                        fs->pool, pool));
   SVN_ERR(create_cache(&(ffd->p2l_header_cache),
                        NULL,
@@ -708,6 +787,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
                        has_namespace,
                        fs,
                        no_handler,
+                       FALSE,
                        fs->pool, pool));
   SVN_ERR(create_cache(&(ffd->p2l_page_cache),
                        NULL,
@@ -722,6 +802,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
                        has_namespace,
                        fs,
                        no_handler,
+                       FALSE,
                        fs->pool, pool));
 
   return SVN_NO_ERROR;
@@ -880,6 +961,7 @@ svn_fs_fs__initialize_txn_caches(svn_fs_t *fs,
                        TRUE, /* The TXN-ID is our namespace. */
                        fs,
                        TRUE,
+                       TRUE,
                        pool, pool));
 
   /* reset the transaction-specific cache if the pool gets cleaned up. */
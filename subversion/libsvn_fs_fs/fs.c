@@ -39,6 +39,7 @@
 #include "hotcopy.h"
 #include "id.h"
 #include "pack.h"
+#include "path-index.h"
 #include "recovery.h"
 #include "rep-cache.h"
 #include "revprops.h"
@@ -328,6 +329,49 @@ fs_ioctl(svn_fs_t *fs, svn_fs_ioctl_code_t ctlcode,
           *output_p = NULL;
           return SVN_NO_ERROR;
         }
+      else if (ctlcode.code == SVN_FS_FS__IOCTL_BUILD_PATH_INDEX.code)
+        {
+          svn_fs_fs__ioctl_build_path_index_input_t *input = input_void;
+
+          SVN_ERR(svn_fs_fs__update_path_index(fs, SVN_INVALID_REVNUM,
+                                               input->progress_func,
+                                               input->progress_baton,
+                                               cancel_func,
+                                               cancel_baton,
+                                               scratch_pool));
+
+          *output_p = NULL;
+          return SVN_NO_ERROR;
+        }
+      else if (ctlcode.code == SVN_FS_FS__IOCTL_PATH_REVISIONS.code)
+        {
+          svn_fs_fs__ioctl_path_revisions_input_t *input = input_void;
+          svn_fs_fs__ioctl_path_revisions_output_t *output
+            = apr_pcalloc(result_pool, sizeof(*output));
+
+          SVN_ERR(svn_fs_fs__path_index_get_revisions(&output->revisions,
+                                                      fs, input->path,
+                                                      input->start,
+                                                      input->end,
+                                                      result_pool,
+                                                      scratch_pool));
+          *output_p = output;
+          return SVN_NO_ERROR;
+        }
+      else if (ctlcode.code == SVN_FS_FS__IOCTL_GET_CHAIN_STATS.code)
+        {
+          svn_fs_fs__ioctl_get_chain_stats_input_t *input = input_void;
+          svn_fs_fs__ioctl_get_chain_stats_output_t *output
+            = apr_pcalloc(result_pool, sizeof(*output));
+          fs_fs_data_t *ffd = fs->fsap_data;
+
+          output->stats = ffd->chain_stats;
+          if (input && input->reset)
+            memset(&ffd->chain_stats, 0, sizeof(ffd->chain_stats));
+
+          *output_p = output;
+          return SVN_NO_ERROR;
+        }
     }
 
   return svn_error_create(SVN_ERR_FS_UNRECOGNIZED_IOCTL_CODE, NULL, NULL);
@@ -525,10 +569,47 @@ fs_upgrade(svn_fs_t *fs,
                             cancel_func, cancel_baton, pool);
 }
 
+/* Baton type for open_fs_instance(). */
+typedef struct open_fs_instance_baton_t
+{
+  /* The FS instance to clone. */
+  svn_fs_t *fs;
+
+  /* As passed to fs_open(). */
+  svn_mutex__t *common_pool_lock;
+  apr_pool_t *common_pool;
+} open_fs_instance_baton_t;
+
+/* Implements svn_fs_fs__open_fs_func_t.  Open another instance of the
+ * filesystem given by the open_fs_instance_baton_t BATON.  The new
+ * instance shares nothing with the original one but the FS-global data
+ * and may therefore be used from a different thread. */
+static svn_error_t *
+open_fs_instance(svn_fs_t **fs_p,
+                 void *baton,
+                 apr_pool_t *result_pool,
+                 apr_pool_t *scratch_pool)
+{
+  open_fs_instance_baton_t *b = baton;
+  svn_fs_t *fs = apr_pcalloc(result_pool, sizeof(*fs));
+
+  fs->pool = result_pool;
+  fs->warning = b->fs->warning;
+  fs->warning_baton = b->fs->warning_baton;
+  fs->config = b->fs->config;
+
+  SVN_ERR(fs_open(fs, b->fs->path, b->common_pool_lock, scratch_pool,
+                  b->common_pool));
+  *fs_p = fs;
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *
 fs_verify(svn_fs_t *fs, const char *path,
           svn_revnum_t start,
           svn_revnum_t end,
+          int jobs,
           svn_fs_progress_notify_func_t notify_func,
           void *notify_baton,
           svn_cancel_func_t cancel_func,
@@ -537,14 +618,24 @@ fs_verify(svn_fs_t *fs, const char *path,
           apr_pool_t *pool,
           apr_pool_t *common_pool)
 {
+  open_fs_instance_baton_t open_baton;
+
   SVN_ERR(fs_open(fs, path, common_pool_lock, pool, common_pool));
-  return svn_fs_fs__verify(fs, start, end, notify_func, notify_baton,
+
+  open_baton.fs = fs;
+  open_baton.common_pool_lock = common_pool_lock;
+  open_baton.common_pool = common_pool;
+
+  return svn_fs_fs__verify(fs, start, end, jobs,
+                           open_fs_instance, &open_baton,
+                           notify_func, notify_baton,
                            cancel_func, cancel_baton, pool);
 }
 
 static svn_error_t *
 fs_pack(svn_fs_t *fs,
         const char *path,
+        int jobs,
         svn_fs_pack_notify_t notify_func,
         void *notify_baton,
         svn_cancel_func_t cancel_func,
@@ -553,8 +644,16 @@ fs_pack(svn_fs_t *fs,
         apr_pool_t *pool,
         apr_pool_t *common_pool)
 {
+  open_fs_instance_baton_t open_baton;
+
   SVN_ERR(fs_open(fs, path, common_pool_lock, pool, common_pool));
-  return svn_fs_fs__pack(fs, 0, notify_func, notify_baton,
+
+  open_baton.fs = fs;
+  open_baton.common_pool_lock = common_pool_lock;
+  open_baton.common_pool = common_pool;
+
+  return svn_fs_fs__pack(fs, 0, jobs, open_fs_instance, &open_baton,
+                         notify_func, notify_baton,
                          cancel_func, cancel_baton, pool);
 }
 
@@ -566,8 +665,9 @@ fs_pack(svn_fs_t *fs,
    DST_FS at DEST_PATH. If INCREMENTAL is TRUE, make an effort not to
    re-copy data which already exists in DST_FS.
    The CLEAN_LOGS argument is ignored and included for Subversion
-   1.0.x compatibility.  Indicate progress via the optional NOTIFY_FUNC
-   callback using NOTIFY_BATON.  Perform all temporary allocations in POOL. */
+   1.0.x compatibility.  Copy up to JOBS shards concurrently.  Indicate
+   progress via the optional NOTIFY_FUNC callback using NOTIFY_BATON.
+   Perform all temporary allocations in POOL. */
 static svn_error_t *
 fs_hotcopy(svn_fs_t *src_fs,
            svn_fs_t *dst_fs,
@@ -575,6 +675,7 @@ fs_hotcopy(svn_fs_t *src_fs,
            const char *dst_path,
            svn_boolean_t clean_logs,
            svn_boolean_t incremental,
+           int jobs,
            svn_fs_hotcopy_notify_t notify_func,
            void *notify_baton,
            svn_cancel_func_t cancel_func,
@@ -593,7 +694,7 @@ fs_hotcopy(svn_fs_t *src_fs,
      can't be opened.
    */
   return svn_fs_fs__hotcopy(src_fs, dst_fs, src_path, dst_path,
-                            incremental, notify_func, notify_baton,
+                            incremental, jobs, notify_func, notify_baton,
                             cancel_func, cancel_baton, common_pool_lock,
                             pool, common_pool);
 }
@@ -705,6 +806,8 @@ svn_fs_fs__init(const svn_version_t *loader_version,
                              loader_version->major);
   SVN_ERR(svn_ver_check_list2(fs_version(), checklist, svn_ver_equal));
 
+  SVN_ERR(svn_fs__batch_fsync_init(common_pool));
+
   *vtable = &library_vtable;
   return SVN_NO_ERROR;
 }
@@ -92,6 +92,8 @@ extern "C" {
 #define PATH_TXN_ITEM_INDEX "itemidx"      /* File containing the current item
                                               index number */
 #define PATH_INDEX          "index"        /* name of index files w/o ext */
+#define PATH_TXN_CHUNKS     "chunks"       /* Content chunks to add to the
+                                              rep-cache upon commit */
 
 /* Names of files in legacy FS formats */
 #define PATH_REV           "rev"           /* Proto rev file */
@@ -100,13 +102,16 @@ extern "C" {
 /* Names of sections and options in fsfs.conf. */
 #define CONFIG_SECTION_CACHES            "caches"
 #define CONFIG_OPTION_FAIL_STOP          "fail-stop"
+#define CONFIG_OPTION_PARTIAL_WINDOW_INTERVAL "partial-window-interval"
 #define CONFIG_SECTION_REP_SHARING       "rep-sharing"
 #define CONFIG_OPTION_ENABLE_REP_SHARING "enable-rep-sharing"
+#define CONFIG_OPTION_CONTENT_CHUNKING_THRESHOLD "content-chunking-threshold"
 #define CONFIG_SECTION_DELTIFICATION     "deltification"
 #define CONFIG_OPTION_ENABLE_DIR_DELTIFICATION   "enable-dir-deltification"
 #define CONFIG_OPTION_ENABLE_PROPS_DELTIFICATION "enable-props-deltification"
 #define CONFIG_OPTION_MAX_DELTIFICATION_WALK     "max-deltification-walk"
 #define CONFIG_OPTION_MAX_LINEAR_DELTIFICATION   "max-linear-deltification"
+#define CONFIG_OPTION_LARGE_WINDOW_THRESHOLD     "large-window-threshold"
 #define CONFIG_OPTION_COMPRESSION_LEVEL  "compression-level"
 #define CONFIG_SECTION_PACKED_REVPROPS   "packed-revprops"
 #define CONFIG_OPTION_REVPROP_PACK_SIZE  "revprop-pack-size"
@@ -115,6 +120,8 @@ extern "C" {
 #define CONFIG_OPTION_BLOCK_SIZE         "block-size"
 #define CONFIG_OPTION_L2P_PAGE_SIZE      "l2p-page-size"
 #define CONFIG_OPTION_P2L_PAGE_SIZE      "p2l-page-size"
+#define CONFIG_OPTION_USE_MMAP           "use-mmap"
+#define CONFIG_OPTION_PREFETCH_BLOCKS    "prefetch-blocks"
 #define CONFIG_SECTION_DEBUG             "debug"
 #define CONFIG_OPTION_PACK_AFTER_COMMIT  "pack-after-commit"
 #define CONFIG_OPTION_VERIFY_BEFORE_COMMIT "verify-before-commit"
@@ -127,7 +134,7 @@ extern "C" {
    Note: If you bump this, please update the switch statement in
          svn_fs_fs__create() as well.
  */
-#define SVN_FS_FS__FORMAT_NUMBER   8
+#define SVN_FS_FS__FORMAT_NUMBER   9
 
 /* The minimum format number that supports svndiff version 1.  */
 #define SVN_FS_FS__MIN_SVNDIFF1_FORMAT 2
@@ -200,6 +207,18 @@ extern "C" {
     database. */
 #define SVN_FS_FS__MIN_REP_CACHE_SCHEMA_V2_FORMAT 8
 
+/* The minimum format number that stores very large directories as an
+   index of separately stored blocks of entries ("BLOCKED" reps). */
+#define SVN_FS_FS__MIN_BLOCKED_DIRS_FORMAT 9
+
+/* The minimum format number that supports deltas created by the
+   large-window matcher ("LWDELTA" reps). */
+#define SVN_FS_FS__MIN_LARGE_WINDOW_FORMAT 9
+
+/* The minimum format number that supports file contents stored as
+   content-defined chunks ("CHUNKED" reps). */
+#define SVN_FS_FS__MIN_CONTENT_CHUNKING_FORMAT 9
+
 /* On most operating systems apr implements file locks per process, not
    per file.  On Windows apr implements the locking as per file handle
    locks, so we don't have to add our own mutex for just in-process
@@ -318,6 +337,35 @@ typedef enum compression_type_t
   compression_type_lz4
 } compression_type_t;
 
+/* A Bloom filter of the SHA1 checksums found in a rep-cache database.
+   Looking up a checksum not in the database will usually not match.
+   It only lives in memory; see "structure" for why it is not stored. */
+typedef struct rep_cache_filter_t
+{
+  /* Pool containing this structure and BITS. */
+  apr_pool_t *pool;
+
+  /* The filter bits.  Their number is a power of two. */
+  unsigned char *bits;
+
+  /* Number of filter bits - 1. */
+  apr_uint64_t mask;
+
+  /* Number of checksums that may be added before false positives become
+     too frequent and number of distinct checksums added so far. */
+  apr_uint64_t capacity;
+  apr_uint64_t entries;
+
+  /* All representations added to the rep-cache by revisions up to and
+     including this one have been added to the filter. */
+  svn_revnum_t revision;
+
+  /* Statistics: number of lookups and how many of them were found to
+     not be in the rep-cache without querying it. */
+  apr_uint64_t lookups;
+  apr_uint64_t negatives;
+} rep_cache_filter_t;
+
 /* Private (non-shared) FSFS-specific data for each svn_fs_t object.
    Any caches in here may be NULL. */
 typedef struct fs_fs_data_t
@@ -347,6 +395,14 @@ typedef struct fs_fs_data_t
    * (not just the one bit that we need, atm). */
   svn_boolean_t use_block_read;
 
+  /* If set, map rev / pack files into memory when opening them for
+   * reading and access their contents without read() calls. */
+  svn_boolean_t use_mmap;
+
+  /* Number of blocks following the current one that block-read asks the
+   * OS to read ahead.  0 disables prefetching. */
+  apr_int64_t prefetch_blocks;
+
   /* The revision that was youngest, last time we checked. */
   svn_revnum_t youngest_rev_cache;
 
@@ -360,6 +416,10 @@ typedef struct fs_fs_data_t
      e.g. memcached may be ignored as caching is an optional feature. */
   svn_boolean_t fail_stop;
 
+  /* Cache the partially composed windows of every N-th delta in a chain,
+     counted from its base.  0 disables the PARTIAL_WINDOW_CACHE. */
+  apr_int64_t partial_window_interval;
+
   /* A cache of revision root IDs, mapping from (svn_revnum_t *) to
      (svn_fs_id_t *).  (Not threadsafe.) */
   svn_cache__t *rev_root_id_cache;
@@ -376,6 +436,11 @@ typedef struct fs_fs_data_t
      names to (svn_fs_dirent_t *). */
   svn_cache__t *dir_cache;
 
+  /* A cache of the block indexes of "BLOCKED" directory reps; maps from
+     pair_cache_key_t to an array of svn_fs_fs__dir_block_t.  The blocks
+     themselves go into DIR_CACHE under their own rep keys. */
+  svn_cache__t *dir_index_cache;
+
   /* Fulltext cache; currently only used with memcached.  Maps from
      rep key (revision/offset) to svn_stringbuf_t. */
   svn_cache__t *fulltext_cache;
@@ -409,6 +474,13 @@ typedef struct fs_fs_data_t
      the key is window_cache_key_t */
   svn_cache__t *combined_window_cache;
 
+  /* Cache for partially composed windows as svn_stringbuf_t objects.
+     An entry is the fulltext of the given chunk of a deltified rep that
+     got reconstructed while reading some rep further up its delta chain.
+     Only every PARTIAL_WINDOW_INTERVAL-th rep of a chain gets cached;
+     the key is window_cache_key_t */
+  svn_cache__t *partial_window_cache;
+
   /* Cache for node_revision_t objects; the key is (revision, item_index) */
   svn_cache__t *node_revision_cache;
 
@@ -465,6 +537,20 @@ typedef struct fs_fs_data_t
   /* Thread-safe boolean */
   svn_atomic_t rep_cache_db_opened;
 
+  /* Whether to use REP_CACHE_FILTER.  Reset to FALSE when the filter
+     becomes outdated.  */
+  svn_boolean_t rep_cache_filter_enabled;
+
+  /* Filter of the checksums in the rep-cache.  Created upon first use.
+     May be NULL. */
+  rep_cache_filter_t *rep_cache_filter;
+
+  /* The sqlite database indexing changed paths, if any. */
+  svn_sqlite__db_t *path_index_db;
+
+  /* Thread-safe boolean */
+  svn_atomic_t path_index_db_opened;
+
   /* The oldest revision not in a pack file.  It also applies to revprops
    * if revprop packing has been enabled by the FSFS format version. */
   svn_revnum_t min_unpacked_rev;
@@ -473,6 +559,10 @@ typedef struct fs_fs_data_t
    * and allowed by the configuration. */
   svn_boolean_t rep_sharing_allowed;
 
+  /* Minimum fulltext size in bytes of a file for its contents to be split
+   * into individually shared chunks.  0 disables content chunking. */
+  apr_int64_t content_chunking_threshold;
+
   /* File size limit in bytes up to which multiple revprops shall be packed
    * into a single file. */
   apr_int64_t revprop_pack_size;
@@ -493,6 +583,10 @@ typedef struct fs_fs_data_t
    * deltification history after which skip deltas will be used. */
   apr_int64_t max_linear_deltification;
 
+  /* Minimum size in bytes of the delta base of a file for its delta to be
+   * computed by the large-window matcher.  0 disables that matcher. */
+  apr_int64_t large_window_threshold;
+
   /* Compression type to use with txdelta storage format in new revs. */
   compression_type_t delta_compression_type;
 
@@ -514,6 +608,9 @@ typedef struct fs_fs_data_t
   /* Ensure that all filesystem changes are written to disk. */
   svn_boolean_t flush_to_disk;
 
+  /* Delta chain statistics of all reads through this FS object. */
+  svn_fs_fs__chain_stats_t chain_stats;
+
   /* Pointer to svn_fs_open. */
   svn_error_t *(*svn_fs_open_)(svn_fs_t **, const char *, apr_hash_t *,
                                apr_pool_t *, apr_pool_t *);
@@ -697,6 +794,31 @@ typedef struct svn_fs_fs__dir_data_t
   svn_filesize_t txn_filesize;
 } svn_fs_fs__dir_data_t;
 
+/*** Block of a "BLOCKED" directory (only used at the cache interface) ***/
+typedef struct svn_fs_fs__dir_block_t
+{
+  /* Name of the first entry in that block.  All entries in this block
+   * sort before the FIRST_NAME of the next block. */
+  const char *first_name;
+
+  /* Where to find the block, i.e. a directory rep containing only the
+   * entries of this block. */
+  representation_t rep;
+} svn_fs_fs__dir_block_t;
+
+/*** Opening independent FS instances ***/
+
+/* Callback type used by operations that process parts of a filesystem
+   concurrently, to open further, independent instances of the filesystem
+   for their worker threads.  BATON is the respective OPEN_BATON.
+   Allocate *FS in RESULT_POOL and use SCRATCH_POOL for temporary
+   allocations. */
+typedef svn_error_t *
+(*svn_fs_fs__open_fs_func_t)(svn_fs_t **fs,
+                             void *baton,
+                             apr_pool_t *result_pool,
+                             apr_pool_t *scratch_pool);
+
 
 #ifdef __cplusplus
 }
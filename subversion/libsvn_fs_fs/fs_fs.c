@@ -761,6 +761,25 @@ read_config(fs_fs_data_t *ffd,
   else
     ffd->rep_sharing_allowed = FALSE;
 
+  /* Content chunks are shared through the rep-cache and need the item
+   * index of logical addressing to be stored individually.  Older formats
+   * can't read "CHUNKED" reps. */
+  if (   ffd->rep_sharing_allowed
+      && ffd->format >= SVN_FS_FS__MIN_CONTENT_CHUNKING_FORMAT
+      && ffd->use_log_addressing)
+    {
+      SVN_ERR(svn_config_get_int64(config, &ffd->content_chunking_threshold,
+                                   CONFIG_SECTION_REP_SHARING,
+                                   CONFIG_OPTION_CONTENT_CHUNKING_THRESHOLD,
+                                   0));
+      ffd->content_chunking_threshold
+        = MAX(ffd->content_chunking_threshold, 0) * 0x400;
+    }
+  else
+    {
+      ffd->content_chunking_threshold = 0;
+    }
+
   /* Initialize deltification settings in ffd. */
   if (ffd->format >= SVN_FS_FS__MIN_DELTIFICATION_FORMAT)
     {
@@ -780,6 +799,21 @@ read_config(fs_fs_data_t *ffd,
                                    CONFIG_SECTION_DELTIFICATION,
                                    CONFIG_OPTION_MAX_LINEAR_DELTIFICATION,
                                    SVN_FS_FS_MAX_LINEAR_DELTIFICATION));
+
+      /* Older formats can't read "LWDELTA" reps. */
+      if (ffd->format >= SVN_FS_FS__MIN_LARGE_WINDOW_FORMAT)
+        {
+          SVN_ERR(svn_config_get_int64(config, &ffd->large_window_threshold,
+                                       CONFIG_SECTION_DELTIFICATION,
+                                       CONFIG_OPTION_LARGE_WINDOW_THRESHOLD,
+                                       0));
+          ffd->large_window_threshold = MAX(ffd->large_window_threshold, 0)
+                                      * 0x400;
+        }
+      else
+        {
+          ffd->large_window_threshold = 0;
+        }
     }
   else
     {
@@ -787,6 +821,7 @@ read_config(fs_fs_data_t *ffd,
       ffd->deltify_properties = FALSE;
       ffd->max_deltification_walk = SVN_FS_FS_MAX_DELTIFICATION_WALK;
       ffd->max_linear_deltification = SVN_FS_FS_MAX_LINEAR_DELTIFICATION;
+      ffd->large_window_threshold = 0;
     }
 
   /* Initialize revprop packing settings in ffd. */
@@ -825,6 +860,10 @@ read_config(fs_fs_data_t *ffd,
                                    CONFIG_SECTION_IO,
                                    CONFIG_OPTION_P2L_PAGE_SIZE,
                                    0x400));
+      SVN_ERR(svn_config_get_int64(config, &ffd->prefetch_blocks,
+                                   CONFIG_SECTION_IO,
+                                   CONFIG_OPTION_PREFETCH_BLOCKS,
+                                   4));
 
       /* Don't accept unreasonable or illegal values.
        * Block size and P2L page size are in kbytes;
@@ -835,6 +874,14 @@ read_config(fs_fs_data_t *ffd,
                                 CONFIG_OPTION_P2L_PAGE_SIZE, scratch_pool));
       SVN_ERR(verify_block_size(ffd->l2p_page_size, sizeof(apr_off_t),
                                 CONFIG_OPTION_L2P_PAGE_SIZE, scratch_pool));
+      if (ffd->prefetch_blocks < 0 || ffd->prefetch_blocks > 0x400)
+        return svn_error_createf(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                                 _("%s is %s but must be between 0 and "
+                                   "1024"),
+                                 CONFIG_OPTION_PREFETCH_BLOCKS,
+                                 apr_psprintf(scratch_pool,
+                                              "%" APR_INT64_T_FMT,
+                                              ffd->prefetch_blocks));
 
       /* convert kBytes to bytes */
       ffd->block_size *= 0x400;
@@ -847,8 +894,14 @@ read_config(fs_fs_data_t *ffd,
       ffd->block_size = 0x1000; /* Matches default APR file buffer size. */
       ffd->l2p_page_size = 0x2000;    /* Matches above default. */
       ffd->p2l_page_size = 0x100000;  /* Matches above default in bytes. */
+      ffd->prefetch_blocks = 0;       /* No block-read, no prefetch. */
     }
 
+  SVN_ERR(svn_config_get_bool(config, &ffd->use_mmap,
+                              CONFIG_SECTION_IO,
+                              CONFIG_OPTION_USE_MMAP,
+                              FALSE));
+
   if (ffd->format >= SVN_FS_FS__MIN_PACKED_FORMAT)
     {
       SVN_ERR(svn_config_get_bool(config, &ffd->pack_after_commit,
@@ -946,6 +999,17 @@ read_config(fs_fs_data_t *ffd,
                               CONFIG_SECTION_CACHES, CONFIG_OPTION_FAIL_STOP,
                               FALSE));
 
+  SVN_ERR(svn_config_get_int64(config, &ffd->partial_window_interval,
+                               CONFIG_SECTION_CACHES,
+                               CONFIG_OPTION_PARTIAL_WINDOW_INTERVAL, 4));
+  if (ffd->partial_window_interval < 0)
+    return svn_error_createf(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                             _("%s is %s but must not be negative"),
+                             CONFIG_OPTION_PARTIAL_WINDOW_INTERVAL,
+                             apr_psprintf(scratch_pool,
+                                          "%" APR_INT64_T_FMT,
+                                          ffd->partial_window_interval));
+
   return SVN_NO_ERROR;
 }
 
@@ -978,6 +1042,16 @@ write_config(svn_fs_t *fs,
 "### configured (and ignoring it with file:// access).  To make"             NL
 "### Subversion never ignore cache errors, uncomment this line."             NL
 "# " CONFIG_OPTION_FAIL_STOP " = true"                                       NL
+"###"                                                                        NL
+"### Reading a file that is stored as a chain of deltas composes the"       NL
+"### windows of all deltas along the chain.  Files in neighbouring"         NL
+"### revisions share most of their chains, so the intermediate results may" NL
+"### be cached and used as a short cut by later reads.  Caching them for"   NL
+"### every delta uses a lot of cache space, so only every N-th delta of"    NL
+"### a chain (counted from its base) gets its results cached.  The lower"   NL
+"### the value, the shorter the walks but the more cache space is used."    NL
+"### 0 disables that cache.  The default is 4."                             NL
+"# " CONFIG_OPTION_PARTIAL_WINDOW_INTERVAL " = 4"                           NL
 ""                                                                           NL
 "[" CONFIG_SECTION_REP_SHARING "]"                                           NL
 "### To conserve space, the filesystem can optionally avoid storing"         NL
@@ -994,6 +1068,17 @@ write_config(svn_fs_t *fs,
 "### 'svnadmin verify' will check the rep-cache regardless of this setting." NL
 "### rep-sharing is enabled by default."                                     NL
 "# " CONFIG_OPTION_ENABLE_REP_SHARING " = true"                              NL
+"###"                                                                        NL
+"### Rep-sharing only finds files with identical contents.  Large files that" NL
+"### differ only in parts, e.g. growing logs or rebuilt binaries on several" NL
+"### branches, can be split into chunks at content-defined boundaries such"  NL
+"### that each distinct chunk gets stored only once.  The following"         NL
+"### parameter sets the minimum file size (in kBytes) for that to happen."   NL
+"### It requires rep-sharing to be enabled and logical addressing."         NL
+"### This option is only supported for FSFS format 9 and newer, i.e."        NL
+"### repositories that can't be read by Subversion versions prior to 1.15."  NL
+"### Content chunking is disabled (value 0) by default."                     NL
+"# " CONFIG_OPTION_CONTENT_CHUNKING_THRESHOLD " = 0"                         NL
 ""                                                                           NL
 "[" CONFIG_SECTION_DELTIFICATION "]"                                         NL
 "### To conserve space, the filesystem stores data as differences against"   NL
@@ -1056,6 +1141,19 @@ write_config(svn_fs_t *fs,
 "### For 1.8, the default value is 16; earlier versions use 1."              NL
 "# " CONFIG_OPTION_MAX_LINEAR_DELTIFICATION " = 16"                          NL
 "###"                                                                        NL
+"### Normally, each 100 kByte window of a file is only compared to the data" NL
+"### at the same offset in the previous version.  Inserting or removing a"   NL
+"### larger section near the start of big binary files like VM images or"    NL
+"### archives will therefore result in almost full-size deltas.  Files"      NL
+"### whose delta base is at least as large as the threshold given here (in"  NL
+"### kBytes) will be compared against the whole previous version instead."   NL
+"### This costs an extra pass over the delta base during commit and about"   NL
+"### 20 bytes of memory per kByte of delta base."                            NL
+"### This option is only supported for FSFS format 9 and newer, i.e."        NL
+"### repositories that can't be read by Subversion versions prior to 1.15."  NL
+"### The matcher is disabled (value 0) by default."                          NL
+"# " CONFIG_OPTION_LARGE_WINDOW_THRESHOLD " = 0"                             NL
+"###"                                                                        NL
 "### After deltification, we compress the data to minimize on-disk size."    NL
 "### This setting controls the compression algorithm, which will be used in" NL
 "### future revisions.  It can be used to either disable compression or to"  NL
@@ -1148,6 +1246,25 @@ write_config(svn_fs_t *fs,
 "### Must be a power of 2."                                                  NL
 "### p2l-page-size is given in kBytes and with a default of 1024 kBytes."    NL
 "# " CONFIG_OPTION_P2L_PAGE_SIZE " = 1024"                                   NL
+"###"                                                                        NL
+"### Revision and pack files may be mapped into memory for reading instead"  NL
+"### of accessing them through read() calls.  This eliminates most of the"   NL
+"### system call overhead when the data is already in the OS file cache or"  NL
+"### on fast local storage such as NVMe drives.  Do not enable this if the"  NL
+"### repository lives on a network file system or if revision files may"     NL
+"### get truncated while being read (e.g. by 'svnfsfs load-index')."         NL
+"### Very large pack files may not be mapped on 32 bit systems."             NL
+"### This is disabled by default."                                           NL
+"# " CONFIG_OPTION_USE_MMAP " = false"                                       NL
+"###"                                                                        NL
+"### With block-read enabled, reading a block asks the OS to fetch the"     NL
+"### items that the phys-to-log index lists within the following blocks"    NL
+"### of the same rev or pack file in the background.  Sequential"          NL
+"### traversals such as checkouts will then find that data in the OS file"  NL
+"### cache.  Set this to 0 to disable the prefetch, e.g. when the disks"    NL
+"### are saturated by random accesses anyway."                              NL
+"### prefetch-blocks is given in blocks and with a default of 4 blocks."    NL
+"# " CONFIG_OPTION_PREFETCH_BLOCKS " = 4"                                    NL
 ""                                                                           NL
 "[" CONFIG_SECTION_DEBUG "]"                                                 NL
 "###"                                                                        NL
@@ -1174,6 +1291,9 @@ read_global_config(svn_fs_t *fs)
   ffd->flush_to_disk = !svn_hash__get_bool(fs->config,
                                            SVN_FS_CONFIG_NO_FLUSH_TO_DISK,
                                            FALSE);
+  ffd->rep_cache_filter_enabled
+    = svn_hash__get_bool(fs->config, SVN_FS_CONFIG_FSFS_REP_CACHE_FILTER,
+                         FALSE);
 
   /* Ignore the user-specified larger block size if we don't use block-read.
      Defaulting to 4k gives us the same access granularity in format 7 as in
@@ -1373,6 +1493,9 @@ upgrade_body(void *baton, apr_pool_t *pool)
                                                pool));
     }
 
+  /* Very large directories will be stored as blocks once they get
+     modified.  Existing directory reps don't need to be converted. */
+
   /* We will need the UUID info shortly ...
      Read it before the format bump as the UUID file still uses the old
      format. */
@@ -1952,6 +2075,13 @@ svn_fs_fs__create(svn_fs_t *fs,
           case 9: format = 7;
                   break;
 
+          case 10:
+          case 11:
+          case 12:
+          case 13:
+          case 14: format = 8;
+                  break;
+
           default:format = SVN_FS_FS__FORMAT_NUMBER;
         }
 
@@ -2323,8 +2453,11 @@ svn_fs_fs__info_format(int *fs_format,
     case 8:
       (*supports_version)->minor = 10;
       break;
+    case 9:
+      (*supports_version)->minor = 15;
+      break;
 #ifdef SVN_DEBUG
-# if SVN_FS_FS__FORMAT_NUMBER != 8
+# if SVN_FS_FS__FORMAT_NUMBER != 9
 #  error "Need to add a 'case' statement here"
 # endif
 #endif
@@ -2398,7 +2531,7 @@ reindex_node(svn_fs_t *fs,
   SVN_ERR(svn_fs_fs__item_offset(&offset, fs, rev_file, rev, NULL,
                                  svn_fs_fs__id_item(id), pool));
 
-  SVN_ERR(svn_io_file_seek(rev_file->file, APR_SET, &offset, pool));
+  SVN_ERR(svn_fs_fs__rev_file_seek(rev_file, NULL, offset));
   SVN_ERR(svn_fs_fs__read_noderev(&noderev, rev_file->stream,
                                   pool, pool));
 
@@ -19,38 +19,46 @@
  *    under the License.
  * ====================================================================
  */
+#include <apr_thread_proc.h>
+
 #include "svn_pools.h"
 #include "svn_path.h"
 #include "svn_dirent_uri.h"
+#include "svn_sorts.h"
 
 #include "fs_fs.h"
 #include "hotcopy.h"
 #include "util.h"
 #include "recovery.h"
 #include "revprops.h"
+#include "path-index.h"
 #include "rep-cache.h"
 
 #include "../libsvn_fs/fs-loader.h"
 
 #include "svn_private_config.h"
 
-/* Like svn_io_dir_file_copy(), but doesn't copy files that exist at
- * the destination and do not differ in terms of kind, size, and mtime.
- * Set *SKIPPED_P to FALSE only if the file was copied, do not change
- * the value in *SKIPPED_P otherwise. SKIPPED_P may be NULL if not
- * required. */
+/* Number of consecutive non-packed revisions copied by a single job in
+ * hotcopy_revisions(). */
+#define HOTCOPY_CHUNK_SIZE 64
+
+/* Set *UNCHANGED_P to TRUE if FILE exists in DST_PATH and does not differ
+ * from FILE in SRC_PATH in terms of kind, size, and mtime.  Otherwise,
+ * set it to FALSE.  Use SCRATCH_POOL for temporary allocations. */
 static svn_error_t *
-hotcopy_io_dir_file_copy(svn_boolean_t *skipped_p,
-                         const char *src_path,
-                         const char *dst_path,
-                         const char *file,
-                         apr_pool_t *scratch_pool)
+hotcopy_file_unchanged(svn_boolean_t *unchanged_p,
+                       const char *src_path,
+                       const char *dst_path,
+                       const char *file,
+                       apr_pool_t *scratch_pool)
 {
   const svn_io_dirent2_t *src_dirent;
   const svn_io_dirent2_t *dst_dirent;
   const char *src_target;
   const char *dst_target;
 
+  *unchanged_p = FALSE;
+
   /* Does the destination already exist? If not, we must copy it. */
   dst_target = svn_dirent_join(dst_path, file, scratch_pool);
   SVN_ERR(svn_io_stat_dirent2(&dst_dirent, dst_target, FALSE, TRUE,
@@ -66,9 +74,31 @@ hotcopy_io_dir_file_copy(svn_boolean_t *skipped_p,
           src_dirent->special == dst_dirent->special &&
           src_dirent->filesize == dst_dirent->filesize &&
           src_dirent->mtime <= dst_dirent->mtime)
-        return SVN_NO_ERROR;
+        *unchanged_p = TRUE;
     }
 
+  return SVN_NO_ERROR;
+}
+
+/* Like svn_io_dir_file_copy(), but doesn't copy files that exist at
+ * the destination and do not differ in terms of kind, size, and mtime.
+ * Set *SKIPPED_P to FALSE only if the file was copied, do not change
+ * the value in *SKIPPED_P otherwise. SKIPPED_P may be NULL if not
+ * required. */
+static svn_error_t *
+hotcopy_io_dir_file_copy(svn_boolean_t *skipped_p,
+                         const char *src_path,
+                         const char *dst_path,
+                         const char *file,
+                         apr_pool_t *scratch_pool)
+{
+  svn_boolean_t unchanged;
+
+  SVN_ERR(hotcopy_file_unchanged(&unchanged, src_path, dst_path, file,
+                                 scratch_pool));
+  if (unchanged)
+    return SVN_NO_ERROR;
+
   if (skipped_p)
     *skipped_p = FALSE;
 
@@ -277,17 +307,46 @@ hotcopy_copy_shard_file(svn_boolean_t *skipped_p,
 }
 
 
+/* Set *UNCHANGED_P to TRUE if the packed rev shard directory PACKED_SHARD
+ * in DST_SUBDIR is a complete copy of the one in SRC_SUBDIR, i.e. its pack
+ * file and, unless USE_LOG_ADDRESSING is set, its manifest file do not
+ * differ in terms of kind, size, and mtime.  Packed rev shards are never
+ * modified, so the whole directory can be skipped in that case.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+hotcopy_packed_rev_shard_unchanged(svn_boolean_t *unchanged_p,
+                                   const char *src_subdir,
+                                   const char *dst_subdir,
+                                   const char *packed_shard,
+                                   svn_boolean_t use_log_addressing,
+                                   apr_pool_t *scratch_pool)
+{
+  const char *src_path = svn_dirent_join(src_subdir, packed_shard,
+                                         scratch_pool);
+  const char *dst_path = svn_dirent_join(dst_subdir, packed_shard,
+                                         scratch_pool);
+
+  SVN_ERR(hotcopy_file_unchanged(unchanged_p, src_path, dst_path,
+                                 PATH_PACKED, scratch_pool));
+  if (*unchanged_p && !use_log_addressing)
+    SVN_ERR(hotcopy_file_unchanged(unchanged_p, src_path, dst_path,
+                                   PATH_MANIFEST, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
 /* Copy a packed shard containing revision REV, and which contains
  * MAX_FILES_PER_DIR revisions, from SRC_FS to DST_FS.
- * Update *DST_MIN_UNPACKED_REV in case the shard is new in DST_FS.
  * Do not re-copy data which already exists in DST_FS.
  * Set *SKIPPED_P to FALSE only if at least one part of the shard
  * was copied, do not change the value in *SKIPPED_P otherwise.
  * SKIPPED_P may be NULL if not required.
+ *
+ * This only reads and writes files and may therefore be called from
+ * multiple threads concurrently, as long as they process different shards.
  * Use SCRATCH_POOL for temporary allocations. */
 static svn_error_t *
 hotcopy_copy_packed_shard(svn_boolean_t *skipped_p,
-                          svn_revnum_t *dst_min_unpacked_rev,
                           svn_fs_t *src_fs,
                           svn_fs_t *dst_fs,
                           svn_revnum_t rev,
@@ -299,21 +358,31 @@ hotcopy_copy_packed_shard(svn_boolean_t *skipped_p,
   const char *packed_shard;
   const char *src_subdir_packed_shard;
   svn_revnum_t revprop_rev;
+  svn_boolean_t unchanged;
   apr_pool_t *iterpool;
   fs_fs_data_t *src_ffd = src_fs->fsap_data;
 
-  /* Copy the packed shard. */
+  /* Copy the packed shard, unless the destination has it already. */
   src_subdir = svn_dirent_join(src_fs->path, PATH_REVS_DIR, scratch_pool);
   dst_subdir = svn_dirent_join(dst_fs->path, PATH_REVS_DIR, scratch_pool);
   packed_shard = apr_psprintf(scratch_pool, "%ld" PATH_EXT_PACKED_SHARD,
                               rev / max_files_per_dir);
-  src_subdir_packed_shard = svn_dirent_join(src_subdir, packed_shard,
-                                            scratch_pool);
-  SVN_ERR(hotcopy_io_copy_dir_recursively(skipped_p, src_subdir_packed_shard,
-                                          dst_subdir, packed_shard,
-                                          TRUE /* copy_perms */,
-                                          NULL /* cancel_func */, NULL,
-                                          scratch_pool));
+  SVN_ERR(hotcopy_packed_rev_shard_unchanged(&unchanged,
+                                             src_subdir, dst_subdir,
+                                             packed_shard,
+                                             src_ffd->use_log_addressing,
+                                             scratch_pool));
+  if (!unchanged)
+    {
+      src_subdir_packed_shard = svn_dirent_join(src_subdir, packed_shard,
+                                                scratch_pool);
+      SVN_ERR(hotcopy_io_copy_dir_recursively(skipped_p,
+                                              src_subdir_packed_shard,
+                                              dst_subdir, packed_shard,
+                                              TRUE /* copy_perms */,
+                                              NULL /* cancel_func */, NULL,
+                                              scratch_pool));
+    }
 
   /* Copy revprops belonging to revisions in this pack. */
   src_subdir = svn_dirent_join(src_fs->path, PATH_REVPROPS_DIR, scratch_pool);
@@ -357,17 +426,180 @@ hotcopy_copy_packed_shard(svn_boolean_t *skipped_p,
                                               scratch_pool));
     }
 
-  /* If necessary, update the min-unpacked rev file in the hotcopy. */
-  if (*dst_min_unpacked_rev < rev + max_files_per_dir)
+  return SVN_NO_ERROR;
+}
+
+/* Copy the rev file and the revprop file of the non-packed revision REV
+ * from SRC_REVS_DIR and SRC_REVPROPS_DIR to DST_REVS_DIR and
+ * DST_REVPROPS_DIR, respectively.  Assume a sharding layout based on
+ * MAX_FILES_PER_DIR.  Set *SKIPPED_P to FALSE only if a file was copied,
+ * do not change the value in *SKIPPED_P otherwise.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+hotcopy_copy_revision(svn_boolean_t *skipped_p,
+                      const char *src_revs_dir,
+                      const char *dst_revs_dir,
+                      const char *src_revprops_dir,
+                      const char *dst_revprops_dir,
+                      svn_revnum_t rev,
+                      int max_files_per_dir,
+                      apr_pool_t *scratch_pool)
+{
+  /* Copy the rev file. */
+  SVN_ERR(hotcopy_copy_shard_file(skipped_p,
+                                  src_revs_dir, dst_revs_dir, rev,
+                                  max_files_per_dir,
+                                  scratch_pool));
+  /* Copy the revprop file. */
+  SVN_ERR(hotcopy_copy_shard_file(skipped_p,
+                                  src_revprops_dir, dst_revprops_dir,
+                                  rev, max_files_per_dir,
+                                  scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+#if APR_HAS_THREADS
+/* Work item for hotcopy_thread(). */
+typedef struct hotcopy_job_t
+{
+  /* Source and destination.  Only their paths and the format information
+   * in SRC_FS are being accessed. */
+  svn_fs_t *src_fs;
+  svn_fs_t *dst_fs;
+  const char *src_revs_dir;
+  const char *dst_revs_dir;
+  const char *src_revprops_dir;
+  const char *dst_revprops_dir;
+  int max_files_per_dir;
+
+  /* If set, copy the packed shard starting at FIRST.  Otherwise, copy
+   * the non-packed revisions FIRST to FIRST + COUNT - 1. */
+  svn_boolean_t packed;
+  svn_revnum_t first;
+  int count;
+
+  /* COUNT "skipped" flags, one per shard or revision. */
+  svn_boolean_t *skipped;
+
+  /* The outcome of this job. */
+  svn_error_t *err;
+
+  /* The thread executing this job. */
+  apr_thread_t *thread;
+} hotcopy_job_t;
+
+/* Thread function executing the hotcopy_job_t in DATA. */
+static void * APR_THREAD_FUNC
+hotcopy_thread(apr_thread_t *thread,
+               void *data)
+{
+  hotcopy_job_t *job = data;
+
+  /* Pools are not thread-safe.  Use a separate root pool. */
+  apr_pool_t *pool
+    = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i;
+
+  if (job->packed)
+    job->err = hotcopy_copy_packed_shard(&job->skipped[0],
+                                         job->src_fs, job->dst_fs,
+                                         job->first, job->max_files_per_dir,
+                                         iterpool);
+  else
+    for (i = 0; i < job->count && !job->err; ++i)
+      {
+        svn_pool_clear(iterpool);
+        job->err = hotcopy_copy_revision(&job->skipped[i],
+                                         job->src_revs_dir,
+                                         job->dst_revs_dir,
+                                         job->src_revprops_dir,
+                                         job->dst_revprops_dir,
+                                         job->first + i,
+                                         job->max_files_per_dir,
+                                         iterpool);
+      }
+
+  svn_pool_destroy(pool);
+  apr_thread_exit(thread, APR_SUCCESS);
+
+  return NULL;
+}
+
+/* Execute the COUNT hotcopy jobs in BATCH, each one in a separate thread,
+ * and wait for all of them to finish.  Return their errors in job order.
+ * Use POOL for allocations. */
+static svn_error_t *
+hotcopy_run_jobs(hotcopy_job_t *batch,
+                 int count,
+                 apr_pool_t *pool)
+{
+  svn_error_t *err = SVN_NO_ERROR;
+  int started, i;
+
+  for (started = 0; started < count; ++started)
     {
-      *dst_min_unpacked_rev = rev + max_files_per_dir;
-      SVN_ERR(svn_fs_fs__write_min_unpacked_rev(dst_fs,
-                                                *dst_min_unpacked_rev,
-                                                scratch_pool));
+      apr_status_t status = apr_thread_create(&batch[started].thread, NULL,
+                                              hotcopy_thread,
+                                              &batch[started], pool);
+      if (status)
+        {
+          err = svn_error_wrap_apr(status, _("Can't create hotcopy thread"));
+          break;
+        }
+    }
+
+  /* Wait for all jobs.  We must not leave running threads behind. */
+  for (i = 0; i < started; ++i)
+    {
+      apr_status_t retval;
+      apr_status_t status = apr_thread_join(&retval, batch[i].thread);
+
+      if (status)
+        batch[i].err = svn_error_compose_create(batch[i].err,
+                          svn_error_wrap_apr(status,
+                                             _("Can't join hotcopy thread")));
     }
 
+  for (i = started - 1; i >= 0; --i)
+    err = svn_error_compose_create(batch[i].err, err);
+
+  return svn_error_trace(err);
+}
+
+/* Create the shard directories for revisions START_REV to END_REV
+ * (inclusive) in DST_SUBDIR, which uses a sharding layout based on
+ * MAX_FILES_PER_DIR.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+hotcopy_make_shard_dirs(const char *dst_subdir,
+                        svn_revnum_t start_rev,
+                        svn_revnum_t end_rev,
+                        int max_files_per_dir,
+                        apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  svn_revnum_t shard;
+
+  for (shard = start_rev / max_files_per_dir;
+       shard <= end_rev / max_files_per_dir;
+       ++shard)
+    {
+      const char *dst_subdir_shard;
+
+      svn_pool_clear(iterpool);
+      dst_subdir_shard = svn_dirent_join(dst_subdir,
+                                         apr_psprintf(iterpool, "%ld", shard),
+                                         iterpool);
+      SVN_ERR(svn_io_make_dir_recursively(dst_subdir_shard, iterpool));
+      SVN_ERR(svn_io_copy_perms(dst_subdir, dst_subdir_shard, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
   return SVN_NO_ERROR;
 }
+#endif
 
 /* Remove file PATH, if it exists - even if it is read-only.
  * Use POOL for temporary allocations. */
@@ -532,13 +764,93 @@ remove_folder(const char *path,
   return svn_error_trace(err);
 }
 
+/* Make the packed shard starting at REV, which has just been copied
+ * from SRC_FS to DST_FS, visible in DST_FS.  That includes updating
+ * *DST_MIN_UNPACKED_REV and 'current', if necessary, as well as removing
+ * the now obsolete non-packed files of the shard from DST_FS.
+ * DST_YOUNGEST is the youngest revision in DST_FS before the hotcopy
+ * and SKIPPED tells whether anything had to be copied for this shard.
+ * All other parameters are as for hotcopy_revisions().
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+hotcopy_publish_packed_shard(svn_revnum_t *dst_min_unpacked_rev,
+                             svn_fs_t *dst_fs,
+                             svn_revnum_t dst_youngest,
+                             svn_revnum_t rev,
+                             int max_files_per_dir,
+                             svn_boolean_t skipped,
+                             svn_boolean_t incremental,
+                             svn_fs_hotcopy_notify_t notify_func,
+                             void* notify_baton,
+                             svn_cancel_func_t cancel_func,
+                             void* cancel_baton,
+                             apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *dst_ffd = dst_fs->fsap_data;
+  svn_revnum_t pack_end_rev = rev + max_files_per_dir - 1;
+
+  /* If necessary, update the min-unpacked rev file in the hotcopy. */
+  if (*dst_min_unpacked_rev < rev + max_files_per_dir)
+    {
+      *dst_min_unpacked_rev = rev + max_files_per_dir;
+      SVN_ERR(svn_fs_fs__write_min_unpacked_rev(dst_fs,
+                                                *dst_min_unpacked_rev,
+                                                scratch_pool));
+    }
+
+  /* Whenever this pack did not previously exist in the destination,
+   * update 'current' to the most recent packed rev (so readers can see
+   * new revisions which arrived in this pack). */
+  if (pack_end_rev > dst_youngest)
+    {
+      SVN_ERR(svn_fs_fs__write_current(dst_fs, pack_end_rev, 0, 0,
+                                       scratch_pool));
+    }
+
+  /* When notifying about packed shards, make things simpler by either
+   * reporting a full revision range, i.e [pack start, pack end] or
+   * reporting nothing. There is one case when this approach might not
+   * be exact (incremental hotcopy with a pack replacing last unpacked
+   * revisions), but generally this is good enough. */
+  if (notify_func && !skipped)
+    notify_func(notify_baton, rev, pack_end_rev, scratch_pool);
+
+  /* Remove revision files which are now packed. */
+  if (incremental)
+    {
+      SVN_ERR(hotcopy_remove_rev_files(dst_fs, rev,
+                                       rev + max_files_per_dir,
+                                       max_files_per_dir, scratch_pool));
+      if (dst_ffd->format >= SVN_FS_FS__MIN_PACKED_REVPROP_FORMAT)
+        SVN_ERR(hotcopy_remove_revprop_files(dst_fs, rev,
+                                             rev + max_files_per_dir,
+                                             max_files_per_dir,
+                                             scratch_pool));
+    }
+
+  /* Now that all revisions have moved into the pack, the original
+   * rev dir can be removed. */
+  SVN_ERR(remove_folder(svn_fs_fs__path_rev_shard(dst_fs, rev, scratch_pool),
+                        cancel_func, cancel_baton, scratch_pool));
+  if (rev > 0 && dst_ffd->format >= SVN_FS_FS__MIN_PACKED_REVPROP_FORMAT)
+    SVN_ERR(remove_folder(svn_fs_fs__path_revprops_shard(dst_fs, rev,
+                                                         scratch_pool),
+                          cancel_func, cancel_baton, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
 /* Copy the revision and revprop files (possibly sharded / packed) from
  * SRC_FS to DST_FS.  Do not re-copy data which already exists in DST_FS.
  * When copying packed or unpacked shards, checkpoint the result in DST_FS
  * for every shard by updating the 'current' file if necessary.  Assume
  * the >= SVN_FS_FS__MIN_NO_GLOBAL_IDS_FORMAT filesystem format without
  * global next-ID counters.  Indicate progress via the optional NOTIFY_FUNC
- * callback using NOTIFY_BATON.  Use POOL for temporary allocations.
+ * callback using NOTIFY_BATON.
+ *
+ * If JOBS is larger than 1, copy up to JOBS packed shards or chunks of
+ * non-packed revisions concurrently.  The results still get checkpointed
+ * and notified in revision order.  Use POOL for temporary allocations.
  */
 static svn_error_t *
 hotcopy_revisions(svn_fs_t *src_fs,
@@ -546,6 +858,7 @@ hotcopy_revisions(svn_fs_t *src_fs,
                   svn_revnum_t src_youngest,
                   svn_revnum_t dst_youngest,
                   svn_boolean_t incremental,
+                  int jobs,
                   const char *src_revs_dir,
                   const char *dst_revs_dir,
                   const char *src_revprops_dir,
@@ -557,12 +870,40 @@ hotcopy_revisions(svn_fs_t *src_fs,
                   apr_pool_t *pool)
 {
   fs_fs_data_t *src_ffd = src_fs->fsap_data;
-  fs_fs_data_t *dst_ffd = dst_fs->fsap_data;
   int max_files_per_dir = src_ffd->max_files_per_dir;
   svn_revnum_t src_min_unpacked_rev;
   svn_revnum_t dst_min_unpacked_rev;
   svn_revnum_t rev;
   apr_pool_t *iterpool;
+  svn_boolean_t *skipped;
+  int count, i;
+
+#if APR_HAS_THREADS
+  hotcopy_job_t *batch = NULL;
+
+  /* Concurrent copying requires a sharded layout. */
+  if (jobs > 1 && max_files_per_dir)
+    {
+      batch = apr_pcalloc(pool, jobs * sizeof(*batch));
+      for (i = 0; i < jobs; ++i)
+        {
+          batch[i].src_fs = src_fs;
+          batch[i].dst_fs = dst_fs;
+          batch[i].src_revs_dir = src_revs_dir;
+          batch[i].dst_revs_dir = dst_revs_dir;
+          batch[i].src_revprops_dir = src_revprops_dir;
+          batch[i].dst_revprops_dir = dst_revprops_dir;
+          batch[i].max_files_per_dir = max_files_per_dir;
+        }
+    }
+  else
+    jobs = 1;
+#else
+  jobs = 1;
+#endif
+
+  /* One "skipped" flag per shard or revision being copied in one go. */
+  skipped = apr_palloc(pool, jobs * HOTCOPY_CHUNK_SIZE * sizeof(*skipped));
 
   /* Copy the min unpacked rev, and read its value. */
   if (src_ffd->format >= SVN_FS_FS__MIN_PACKED_FORMAT)
@@ -602,62 +943,54 @@ hotcopy_revisions(svn_fs_t *src_fs,
 
   iterpool = svn_pool_create(pool);
   /* First, copy packed shards. */
-  for (rev = 0; rev < src_min_unpacked_rev; rev += max_files_per_dir)
+  rev = 0;
+  while (rev < src_min_unpacked_rev)
     {
-      svn_boolean_t skipped = TRUE;
-      svn_revnum_t pack_end_rev;
-
       svn_pool_clear(iterpool);
 
       if (cancel_func)
         SVN_ERR(cancel_func(cancel_baton));
 
-      /* Copy the packed shard. */
-      SVN_ERR(hotcopy_copy_packed_shard(&skipped, &dst_min_unpacked_rev,
-                                        src_fs, dst_fs,
-                                        rev, max_files_per_dir,
-                                        iterpool));
+      count = (int)MIN(jobs,
+                       (src_min_unpacked_rev - rev) / max_files_per_dir);
+      for (i = 0; i < count; ++i)
+        skipped[i] = TRUE;
 
-      pack_end_rev = rev + max_files_per_dir - 1;
+#if APR_HAS_THREADS
+      if (batch)
+        {
+          for (i = 0; i < count; ++i)
+            {
+              batch[i].packed = TRUE;
+              batch[i].first = rev + i * max_files_per_dir;
+              batch[i].count = 1;
+              batch[i].skipped = &skipped[i];
+              batch[i].err = SVN_NO_ERROR;
+            }
 
-      /* Whenever this pack did not previously exist in the destination,
-       * update 'current' to the most recent packed rev (so readers can see
-       * new revisions which arrived in this pack). */
-      if (pack_end_rev > dst_youngest)
+          SVN_ERR(hotcopy_run_jobs(batch, count, iterpool));
+        }
+      else
+#endif
         {
-          SVN_ERR(svn_fs_fs__write_current(dst_fs, pack_end_rev, 0, 0,
-                                           iterpool));
+          /* Copy the packed shard. */
+          SVN_ERR(hotcopy_copy_packed_shard(&skipped[0], src_fs, dst_fs,
+                                            rev, max_files_per_dir,
+                                            iterpool));
         }
 
-      /* When notifying about packed shards, make things simpler by either
-       * reporting a full revision range, i.e [pack start, pack end] or
-       * reporting nothing. There is one case when this approach might not
-       * be exact (incremental hotcopy with a pack replacing last unpacked
-       * revisions), but generally this is good enough. */
-      if (notify_func && !skipped)
-        notify_func(notify_baton, rev, pack_end_rev, iterpool);
-
-      /* Remove revision files which are now packed. */
-      if (incremental)
+      /* Publish the copied shards in order. */
+      for (i = 0; i < count; ++i)
         {
-          SVN_ERR(hotcopy_remove_rev_files(dst_fs, rev,
-                                           rev + max_files_per_dir,
-                                           max_files_per_dir, iterpool));
-          if (dst_ffd->format >= SVN_FS_FS__MIN_PACKED_REVPROP_FORMAT)
-            SVN_ERR(hotcopy_remove_revprop_files(dst_fs, rev,
-                                                 rev + max_files_per_dir,
-                                                 max_files_per_dir,
-                                                 iterpool));
+          SVN_ERR(hotcopy_publish_packed_shard(&dst_min_unpacked_rev, dst_fs,
+                                               dst_youngest, rev,
+                                               max_files_per_dir, skipped[i],
+                                               incremental,
+                                               notify_func, notify_baton,
+                                               cancel_func, cancel_baton,
+                                               iterpool));
+          rev += max_files_per_dir;
         }
-
-      /* Now that all revisions have moved into the pack, the original
-       * rev dir can be removed. */
-      SVN_ERR(remove_folder(svn_fs_fs__path_rev_shard(dst_fs, rev, iterpool),
-                            cancel_func, cancel_baton, iterpool));
-      if (rev > 0 && dst_ffd->format >= SVN_FS_FS__MIN_PACKED_REVPROP_FORMAT)
-        SVN_ERR(remove_folder(svn_fs_fs__path_revprops_shard(dst_fs, rev,
-                                                             iterpool),
-                              cancel_func, cancel_baton, iterpool));
     }
 
   if (cancel_func)
@@ -668,10 +1001,8 @@ hotcopy_revisions(svn_fs_t *src_fs,
 
   /* Now, copy pairs of non-packed revisions and revprop files.
    * If necessary, update 'current' after copying all files from a shard. */
-  for (; rev <= src_youngest; rev++)
+  while (rev <= src_youngest)
     {
-      svn_boolean_t skipped = TRUE;
-
       svn_pool_clear(iterpool);
 
       if (cancel_func)
@@ -690,31 +1021,64 @@ hotcopy_revisions(svn_fs_t *src_fs,
        * hotcopy with an ENOENT (revision file moved to a pack, so it is no
        * longer where we expect it to be). */
 
-      /* Copy the rev file. */
-      SVN_ERR(hotcopy_copy_shard_file(&skipped,
-                                      src_revs_dir, dst_revs_dir, rev,
-                                      max_files_per_dir,
-                                      iterpool));
-      /* Copy the revprop file. */
-      SVN_ERR(hotcopy_copy_shard_file(&skipped,
-                                      src_revprops_dir, dst_revprops_dir,
-                                      rev, max_files_per_dir,
-                                      iterpool));
-
-      /* Whenever this revision did not previously exist in the destination,
-       * checkpoint the progress via 'current' (do that once per full shard
-       * in order not to slow things down). */
-      if (rev > dst_youngest)
+#if APR_HAS_THREADS
+      if (batch)
         {
-          if (max_files_per_dir && (rev % max_files_per_dir == 0))
+          int used;
+
+          count = (int)MIN(jobs * HOTCOPY_CHUNK_SIZE, src_youngest - rev + 1);
+          for (i = 0; i < count; ++i)
+            skipped[i] = TRUE;
+
+          /* The workers must not race for creating the shard folders. */
+          SVN_ERR(hotcopy_make_shard_dirs(dst_revs_dir, rev, rev + count - 1,
+                                          max_files_per_dir, iterpool));
+          SVN_ERR(hotcopy_make_shard_dirs(dst_revprops_dir,
+                                          rev, rev + count - 1,
+                                          max_files_per_dir, iterpool));
+
+          for (used = 0; used * HOTCOPY_CHUNK_SIZE < count; ++used)
             {
-              SVN_ERR(svn_fs_fs__write_current(dst_fs, rev, 0, 0,
-                                               iterpool));
+              hotcopy_job_t *job = &batch[used];
+
+              job->packed = FALSE;
+              job->first = rev + used * HOTCOPY_CHUNK_SIZE;
+              job->count = MIN(HOTCOPY_CHUNK_SIZE,
+                               count - used * HOTCOPY_CHUNK_SIZE);
+              job->skipped = &skipped[used * HOTCOPY_CHUNK_SIZE];
+              job->err = SVN_NO_ERROR;
             }
+
+          SVN_ERR(hotcopy_run_jobs(batch, used, iterpool));
+        }
+      else
+#endif
+        {
+          count = 1;
+          skipped[0] = TRUE;
+          SVN_ERR(hotcopy_copy_revision(&skipped[0],
+                                        src_revs_dir, dst_revs_dir,
+                                        src_revprops_dir, dst_revprops_dir,
+                                        rev, max_files_per_dir, iterpool));
         }
 
-      if (notify_func && !skipped)
-        notify_func(notify_baton, rev, rev, iterpool);
+      for (i = 0; i < count; ++i, ++rev)
+        {
+          /* Whenever this revision did not previously exist in the
+           * destination, checkpoint the progress via 'current' (do that
+           * once per full shard in order not to slow things down). */
+          if (rev > dst_youngest)
+            {
+              if (max_files_per_dir && (rev % max_files_per_dir == 0))
+                {
+                  SVN_ERR(svn_fs_fs__write_current(dst_fs, rev, 0, 0,
+                                                   iterpool));
+                }
+            }
+
+          if (notify_func && !skipped[i])
+            notify_func(notify_baton, rev, rev, iterpool);
+        }
     }
   svn_pool_destroy(iterpool);
 
@@ -780,6 +1144,7 @@ struct hotcopy_body_baton {
   svn_fs_t *src_fs;
   svn_fs_t *dst_fs;
   svn_boolean_t incremental;
+  int jobs;
   svn_fs_hotcopy_notify_t notify_func;
   void *notify_baton;
   svn_cancel_func_t cancel_func;
@@ -928,7 +1293,8 @@ hotcopy_body(void *baton, apr_pool_t *pool)
   if (src_ffd->format >= SVN_FS_FS__MIN_NO_GLOBAL_IDS_FORMAT)
     {
       SVN_ERR(hotcopy_revisions(src_fs, dst_fs, src_youngest, dst_youngest,
-                                incremental, src_revs_dir, dst_revs_dir,
+                                incremental, hbb->jobs,
+                                src_revs_dir, dst_revs_dir,
                                 src_revprops_dir, dst_revprops_dir,
                                 notify_func, notify_baton,
                                 cancel_func, cancel_baton, pool));
@@ -990,6 +1356,17 @@ hotcopy_body(void *baton, apr_pool_t *pool)
         }
     }
 
+  /* Likewise for the optional changed-path index. */
+  src_subdir = svn_dirent_join(src_fs->path, PATH_INDEX_DB_NAME, pool);
+  dst_subdir = svn_dirent_join(dst_fs->path, PATH_INDEX_DB_NAME, pool);
+  SVN_ERR(svn_io_check_path(src_subdir, &kind, pool));
+  if (kind == svn_node_file)
+    {
+      SVN_ERR(svn_sqlite__hotcopy(src_subdir, dst_subdir, pool));
+      SVN_ERR(svn_io_set_file_read_write(dst_subdir, FALSE, pool));
+      SVN_ERR(svn_fs_fs__path_index_truncate(dst_fs, src_youngest, pool));
+    }
+
   /* Copy the txn-current file. */
   if (dst_ffd->format >= SVN_FS_FS__MIN_TXN_CURRENT_FORMAT)
     SVN_ERR(svn_io_dir_file_copy(src_fs->path, dst_fs->path,
@@ -1007,6 +1384,7 @@ svn_fs_fs__hotcopy(svn_fs_t *src_fs,
                    const char *src_path,
                    const char *dst_path,
                    svn_boolean_t incremental,
+                   int jobs,
                    svn_fs_hotcopy_notify_t notify_func,
                    void *notify_baton,
                    svn_cancel_func_t cancel_func,
@@ -1082,6 +1460,7 @@ svn_fs_fs__hotcopy(svn_fs_t *src_fs,
   hbb.src_fs = src_fs;
   hbb.dst_fs = dst_fs;
   hbb.incremental = incremental;
+  hbb.jobs = jobs;
   hbb.notify_func = notify_func;
   hbb.notify_baton = notify_baton;
   hbb.cancel_func = cancel_func;
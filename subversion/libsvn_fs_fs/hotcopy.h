@@ -27,7 +27,8 @@
 
 /* Copy the fsfs filesystem SRC_FS at SRC_PATH into a new copy DST_FS at
  * DST_PATH.  If INCREMENTAL is TRUE, do not re-copy data which already
- * exists in DST_FS.  Indicate progress via the optional NOTIFY_FUNC
+ * exists in DST_FS.  Copy up to JOBS packed shards or chunks of non-packed
+ * revisions concurrently.  Indicate progress via the optional NOTIFY_FUNC
  * callback using NOTIFY_BATON.  Use COMMON_POOL for process-wide and
  * POOL for temporary allocations.  Use COMMON_POOL_LOCK to ensure
  * that the initialization of the shared data is serialized. */
@@ -36,6 +37,7 @@ svn_error_t * svn_fs_fs__hotcopy(svn_fs_t *src_fs,
                                  const char *src_path,
                                  const char *dst_path,
                                  svn_boolean_t incremental,
+                                 int jobs,
                                  svn_fs_hotcopy_notify_t notify_func,
                                  void *notify_baton,
                                  svn_cancel_func_t cancel_func,
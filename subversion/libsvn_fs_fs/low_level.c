@@ -61,6 +61,9 @@
 /* Kinds of representation. */
 #define REP_PLAIN          "PLAIN"
 #define REP_DELTA          "DELTA"
+#define REP_LARGE_WINDOW_DELTA "LWDELTA"
+#define REP_CHUNKED        "CHUNKED"
+#define REP_BLOCKED        "BLOCKED"
 
 /* An arbitrary maximum path length, so clients can't run us out of memory
  * by giving us arbitrarily large paths. */
@@ -1266,6 +1269,14 @@ svn_fs_fs__read_rep_header(svn_fs_fs__rep_header_t **header,
       return SVN_NO_ERROR;
     }
 
+  if (strcmp(buffer->data, REP_BLOCKED) == 0)
+    {
+      /* The plain contents are the block index of a directory. */
+      (*header)->type = svn_fs_fs__rep_plain;
+      (*header)->blocked_dir = TRUE;
+      return SVN_NO_ERROR;
+    }
+
   if (strcmp(buffer->data, REP_DELTA) == 0)
     {
       /* This is a delta against the empty stream. */
@@ -1273,12 +1284,20 @@ svn_fs_fs__read_rep_header(svn_fs_fs__rep_header_t **header,
       return SVN_NO_ERROR;
     }
 
+  if (strcmp(buffer->data, REP_CHUNKED) == 0)
+    {
+      (*header)->type = svn_fs_fs__rep_chunked;
+      return SVN_NO_ERROR;
+    }
+
   (*header)->type = svn_fs_fs__rep_delta;
 
   /* We have hopefully a DELTA vs. a non-empty base revision. */
   last_str = buffer->data;
   str = svn_cstring_tokenize(" ", &last_str);
-  if (! str || (strcmp(str, REP_DELTA) != 0))
+  if (str && (strcmp(str, REP_LARGE_WINDOW_DELTA) == 0))
+    (*header)->large_window = TRUE;
+  else if (! str || (strcmp(str, REP_DELTA) != 0))
     goto error;
 
   SVN_ERR(parse_revnum(&(*header)->base_revision, (const char **)&last_str));
@@ -1312,19 +1331,160 @@ svn_fs_fs__write_rep_header(svn_fs_fs__rep_header_t *header,
   switch (header->type)
     {
       case svn_fs_fs__rep_plain:
-        text = REP_PLAIN "\n";
+        text = header->blocked_dir ? REP_BLOCKED "\n" : REP_PLAIN "\n";
         break;
 
       case svn_fs_fs__rep_self_delta:
         text = REP_DELTA "\n";
         break;
 
+      case svn_fs_fs__rep_chunked:
+        text = REP_CHUNKED "\n";
+        break;
+
       default:
-        text = apr_psprintf(scratch_pool, REP_DELTA " %ld %" APR_OFF_T_FMT
+        text = apr_psprintf(scratch_pool, "%s %ld %" APR_OFF_T_FMT
                                           " %" SVN_FILESIZE_T_FMT "\n",
+                            header->large_window ? REP_LARGE_WINDOW_DELTA
+                                                 : REP_DELTA,
                             header->base_revision, header->base_item_index,
                             header->base_length);
     }
 
   return svn_error_trace(svn_stream_puts(stream, text));
 }
+
+svn_error_t *
+svn_fs_fs__parse_chunk_list(apr_array_header_t **chunks,
+                            svn_stringbuf_t *text,
+                            apr_pool_t *result_pool,
+                            apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *lines = svn_cstring_split(text->data, "\n", TRUE,
+                                                scratch_pool);
+  int i;
+
+  /* One rep string per line. */
+  *chunks = apr_array_make(result_pool, lines->nelts,
+                           sizeof(representation_t *));
+  for (i = 0; i < lines->nelts; ++i)
+    {
+      representation_t *rep;
+      const char *line = APR_ARRAY_IDX(lines, i, const char *);
+
+      SVN_ERR(svn_fs_fs__parse_representation(&rep,
+                                    svn_stringbuf_create(line, scratch_pool),
+                                    result_pool, scratch_pool));
+      if (!rep->has_sha1)
+        return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                                _("Malformed chunk list"));
+
+      APR_ARRAY_PUSH(*chunks, representation_t *) = rep;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__write_chunk_list(apr_array_header_t *chunks,
+                            int format,
+                            svn_stream_t *stream,
+                            apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  int i;
+
+  for (i = 0; i < chunks->nelts; ++i)
+    {
+      representation_t *rep = APR_ARRAY_IDX(chunks, i, representation_t *);
+      svn_stringbuf_t *str;
+
+      svn_pool_clear(iterpool);
+      str = svn_fs_fs__unparse_representation(rep, format, FALSE,
+                                              iterpool, iterpool);
+      svn_stringbuf_appendbyte(str, '\n');
+      SVN_ERR(svn_stream_write(stream, str->data, &str->len));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__parse_dir_index(apr_array_header_t **blocks,
+                           svn_stream_t *stream,
+                           apr_pool_t *result_pool,
+                           apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+
+  /* One first entry name -> rep string pair per block, sorted by name. */
+  *blocks = apr_array_make(result_pool, 16, sizeof(svn_fs_fs__dir_block_t));
+  while (1)
+    {
+      svn_hash__entry_t entry;
+      svn_fs_fs__dir_block_t *block;
+      representation_t *rep;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_hash__read_entry(&entry, stream, SVN_HASH_TERMINATOR,
+                                   FALSE, iterpool));
+      if (entry.key == NULL)
+        break;
+
+      SVN_ERR(svn_fs_fs__parse_representation(&rep,
+                            svn_stringbuf_ncreate(entry.val, entry.vallen,
+                                                  iterpool),
+                            iterpool, iterpool));
+
+      /* Keys must be strictly ascending. */
+      if (   (*blocks)->nelts
+          && strcmp(APR_ARRAY_IDX(*blocks, (*blocks)->nelts - 1,
+                                  svn_fs_fs__dir_block_t).first_name,
+                    entry.key) >= 0)
+        return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                                _("Malformed directory block index"));
+
+      block = apr_array_push(*blocks);
+      block->first_name = apr_pstrmemdup(result_pool, entry.key,
+                                         entry.keylen);
+      block->rep = *rep;
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__write_dir_index(apr_array_header_t *blocks,
+                           int format,
+                           svn_stream_t *stream,
+                           apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  int i;
+
+  for (i = 0; i < blocks->nelts; ++i)
+    {
+      svn_fs_fs__dir_block_t *block = &APR_ARRAY_IDX(blocks, i,
+                                                     svn_fs_fs__dir_block_t);
+      svn_stringbuf_t *str;
+
+      svn_pool_clear(iterpool);
+      str = svn_fs_fs__unparse_representation(&block->rep, format, FALSE,
+                                              iterpool, iterpool);
+      SVN_ERR(svn_stream_printf(stream, iterpool, "K %" APR_SIZE_T_FMT "\n"
+                                                  "%s\nV %" APR_SIZE_T_FMT
+                                                  "\n%s\n",
+                                strlen(block->first_name), block->first_name,
+                                str->len, str->data));
+    }
+
+  SVN_ERR(svn_stream_puts(stream, SVN_HASH_TERMINATOR "\n"));
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
@@ -189,7 +189,11 @@ typedef enum svn_fs_fs__rep_type_t
   svn_fs_fs__rep_self_delta,
 
   /* this is a DELTA representation against some base representation */
-  svn_fs_fs__rep_delta
+  svn_fs_fs__rep_delta,
+
+  /* this is a list of other representations whose contents, concatenated,
+   * form the contents of this one.  See svn_fs_fs__parse_chunk_list(). */
+  svn_fs_fs__rep_chunked
 } svn_fs_fs__rep_type_t;
 
 /* This structure is used to hold the information stored in a representation
@@ -212,6 +216,16 @@ typedef struct svn_fs_fs__rep_header_t
    * size of that base rep.  Should be 0 if there is no base rep. */
   svn_filesize_t base_length;
 
+  /* if this rep is a delta against some other rep, the source views of
+   * its windows may be anywhere within that base rep's fulltext instead
+   * of being aligned with the respective target window. */
+  svn_boolean_t large_window;
+
+  /* if this is a PLAIN rep, its contents are not the directory itself
+   * but an index of the blocks that the directory entries have been
+   * split into.  See svn_fs_fs__parse_dir_index(). */
+  svn_boolean_t blocked_dir;
+
   /* length of the textual representation of the header in the rep or pack
    * file, including EOL.  Only valid after reading it from disk.
    * Should be 0 otherwise. */
@@ -233,3 +247,51 @@ svn_error_t *
 svn_fs_fs__write_rep_header(svn_fs_fs__rep_header_t *header,
                             svn_stream_t *stream,
                             apr_pool_t *scratch_pool);
+
+/* Parse the contents TEXT of a CHUNKED representation, i.e. everything
+ * between its header and the "ENDREP" marker, and return the chunks
+ * in *CHUNKS as an array of representation_t *, allocated in RESULT_POOL.
+ * Chunks stored in the same revision (or transaction) as the CHUNKED rep
+ * itself will have an invalid REVISION.  Use SCRATCH_POOL for temporary
+ * allocations.
+ */
+svn_error_t *
+svn_fs_fs__parse_chunk_list(apr_array_header_t **chunks,
+                            svn_stringbuf_t *text,
+                            apr_pool_t *result_pool,
+                            apr_pool_t *scratch_pool);
+
+/* Write the CHUNKS (an array of representation_t *) of a CHUNKED
+ * representation to STREAM in a form that svn_fs_fs__parse_chunk_list()
+ * will read, using the rep string syntax of FORMAT.  Chunks within the
+ * current transaction must have an invalid REVISION.  Use SCRATCH_POOL for
+ * temporary allocations.
+ */
+svn_error_t *
+svn_fs_fs__write_chunk_list(apr_array_header_t *chunks,
+                            int format,
+                            svn_stream_t *stream,
+                            apr_pool_t *scratch_pool);
+
+/* Read the contents of a BLOCKED directory representation from STREAM,
+ * i.e. everything between its header and the "ENDREP" marker, and return
+ * the blocks in *BLOCKS as an array of svn_fs_fs__dir_block_t, sorted by
+ * their FIRST_NAME and allocated in RESULT_POOL.  Use SCRATCH_POOL for
+ * temporary allocations.
+ */
+svn_error_t *
+svn_fs_fs__parse_dir_index(apr_array_header_t **blocks,
+                           svn_stream_t *stream,
+                           apr_pool_t *result_pool,
+                           apr_pool_t *scratch_pool);
+
+/* Write the BLOCKS (an array of svn_fs_fs__dir_block_t, sorted by their
+ * FIRST_NAME) of a BLOCKED directory representation to STREAM in a form
+ * that svn_fs_fs__parse_dir_index() will read, using the rep string syntax
+ * of FORMAT.  Use SCRATCH_POOL for temporary allocations.
+ */
+svn_error_t *
+svn_fs_fs__write_dir_index(apr_array_header_t *blocks,
+                           int format,
+                           svn_stream_t *stream,
+                           apr_pool_t *scratch_pool);
@@ -22,14 +22,18 @@
 #include <assert.h>
 #include <string.h>
 
+#include <apr_thread_proc.h>
+
 #include "svn_pools.h"
 #include "svn_dirent_uri.h"
 #include "svn_sorts.h"
+#include "private/svn_atomic.h"
 #include "private/svn_temp_serializer.h"
 #include "private/svn_sorts_private.h"
 #include "private/svn_subr_private.h"
 #include "private/svn_string_private.h"
 #include "private/svn_io_private.h"
+#include "private/svn_fs_util.h"
 
 #include "fs_fs.h"
 #include "pack.h"
@@ -216,13 +220,20 @@ typedef struct pack_context_t
    * It will be sorted by the FROM members (for rep->base rep lookup). */
   apr_array_header_t *references;
 
+  /* array of reference_t* linking CHUNKED reps and BLOCKED directory
+   * indexes to the chunks and blocks they consist of.  No noderev refers
+   * to the latter directly.  Will be filled in phase 2 and be cleared
+   * after each revision range.  It will be sorted by the FROM members. */
+  apr_array_header_t *parts;
+
   /* array of svn_fs_fs__p2l_entry_t*.  Will be filled in phase 2 and be
    * cleared after each revision range.  During phase 3, we will set items
    * to NULL that we already processed. */
   apr_array_header_t *reps;
 
   /* array of int, marking for each revision, at which offset their items
-   * begin in REPS.  Will be filled in phase 2 and be cleared after
+   * begin in REPS.  The last element marks the end of the items of the
+   * last revision.  Will be filled in phase 2 and be cleared after
    * each revision range. */
   apr_array_header_t *rev_offsets;
 
@@ -329,6 +340,7 @@ initialize_pack_context(pack_context_t *context,
                                        sizeof(path_order_t *));
   context->references = apr_array_make(pool, max_items,
                                        sizeof(reference_t *));
+  context->parts = apr_array_make(pool, max_items, sizeof(reference_t *));
   context->reps = apr_array_make(pool, max_items,
                                  sizeof(svn_fs_fs__p2l_entry_t *));
   SVN_ERR(svn_io_open_unique_file3(&context->reps_file, NULL, temp_dir,
@@ -356,6 +368,7 @@ reset_pack_context(pack_context_t *context,
   apr_array_clear(context->rev_offsets);
   apr_array_clear(context->path_order);
   apr_array_clear(context->references);
+  apr_array_clear(context->parts);
   apr_array_clear(context->reps);
   SVN_ERR(svn_io_file_close(context->reps_file, pool));
 
@@ -580,6 +593,92 @@ get_item(pack_context_t *context,
   return result;
 }
 
+/* Link the CHUNKED rep or BLOCKED directory index described by ENTRY and
+ * REP_HEADER to all of its parts in CONTEXT.  Read the list of parts from
+ * STREAM, which is positioned directly behind REP_HEADER.  Use POOL for
+ * temporary allocations.
+ */
+static svn_error_t *
+add_part_references(pack_context_t *context,
+                    svn_stream_t *stream,
+                    svn_fs_fs__p2l_entry_t *entry,
+                    svn_fs_fs__rep_header_t *rep_header,
+                    apr_pool_t *pool)
+{
+  apr_array_header_t *parts
+    = apr_array_make(pool, 16, sizeof(svn_fs_fs__id_part_t));
+  int i;
+
+  if (rep_header->type == svn_fs_fs__rep_chunked)
+    {
+      apr_off_t size = entry->size - (apr_off_t)rep_header->header_size
+                     - (apr_off_t)(sizeof("ENDREP\n") - 1);
+      apr_array_header_t *chunks;
+      svn_stringbuf_t *list;
+      apr_size_t len;
+
+      if (size < 0)
+        return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                                 _("Chunked representation r%ld:%s is "
+                                   "truncated"),
+                                 entry->item.revision,
+                                 apr_psprintf(pool, "%" APR_UINT64_T_FMT,
+                                              entry->item.number));
+
+      len = (apr_size_t)size;
+      list = svn_stringbuf_create_ensure(len, pool);
+      SVN_ERR(svn_stream_read_full(stream, list->data, &len));
+      list->data[len] = 0;
+      list->len = len;
+
+      /* Chunks without a revision live next to the CHUNKED rep. */
+      SVN_ERR(svn_fs_fs__parse_chunk_list(&chunks, list, pool, pool));
+      for (i = 0; i < chunks->nelts; ++i)
+        {
+          representation_t *chunk = APR_ARRAY_IDX(chunks, i,
+                                                  representation_t *);
+          svn_fs_fs__id_part_t *part = apr_array_push(parts);
+
+          part->revision = SVN_IS_VALID_REVNUM(chunk->revision)
+                         ? chunk->revision
+                         : entry->item.revision;
+          part->number = chunk->item_index;
+        }
+    }
+  else
+    {
+      apr_array_header_t *blocks;
+
+      SVN_ERR(svn_fs_fs__parse_dir_index(&blocks, stream, pool, pool));
+      for (i = 0; i < blocks->nelts; ++i)
+        {
+          svn_fs_fs__dir_block_t *block
+            = &APR_ARRAY_IDX(blocks, i, svn_fs_fs__dir_block_t);
+          svn_fs_fs__id_part_t *part = apr_array_push(parts);
+
+          part->revision = block->rep.revision;
+          part->number = block->rep.item_index;
+        }
+    }
+
+  /* Parts in older pack files or revisions stay where they are. */
+  for (i = 0; i < parts->nelts; ++i)
+    {
+      svn_fs_fs__id_part_t *part = &APR_ARRAY_IDX(parts, i,
+                                                  svn_fs_fs__id_part_t);
+      if (part->revision >= context->start_rev)
+        {
+          reference_t *reference = apr_pcalloc(context->info_pool,
+                                               sizeof(*reference));
+          reference->from = entry->item;
+          reference->to = *part;
+          APR_ARRAY_PUSH(context->parts, reference_t *) = reference;
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /* Copy representation item identified by ENTRY from the current position
  * in REV_FILE into CONTEXT->REPS_FILE.  Add all tracking into needed by
  * our placement algorithm to CONTEXT.  Use POOL for temporary allocations.
@@ -603,6 +702,12 @@ copy_rep_to_temp(pack_context_t *context,
   /* read & parse the representation header */
   stream = svn_stream_from_aprfile2(rev_file, TRUE, pool);
   SVN_ERR(svn_fs_fs__read_rep_header(&rep_header, stream, pool, pool));
+
+  /* the chunks and blocks of a rep must be kept and placed next to it */
+  if (   rep_header->type == svn_fs_fs__rep_chunked
+      || rep_header->blocked_dir)
+    SVN_ERR(add_part_references(context, stream, entry, rep_header, pool));
+
   SVN_ERR(svn_stream_close(stream));
 
   /* if the representation is a delta against some other rep, link the two */
@@ -740,6 +845,7 @@ copy_node_to_temp(pack_context_t *context,
   apr_off_t source_offset = entry->offset;
 
   /* read & parse noderev */
+  SVN_ERR(svn_fs_fs__rev_file_seek(rev_file, NULL, source_offset));
   SVN_ERR(svn_fs_fs__read_noderev(&noderev, rev_file->stream, pool, pool));
 
   /* create a copy of ENTRY, make it point to the copy destination and
@@ -1028,6 +1134,8 @@ sort_reps(pack_context_t *context)
                   (int (*)(const void *, const void *))compare_path_order);
   svn_sort__array(context->references,
                   (int (*)(const void *, const void *))compare_references);
+  svn_sort__array(context->parts,
+                  (int (*)(const void *, const void *))compare_references);
 
   /* Directories are already in front; sort directories section and files
    * section separately but use the same heuristics (see sub-function).
@@ -1195,6 +1303,36 @@ store_items(pack_context_t *context,
   return SVN_NO_ERROR;
 }
 
+/* Read the chunks or blocks of the rep ITEM from TEMP_FILE and write
+ * them to CONTEXT->PACK_FILE, unless that already happened.  Use POOL for
+ * allocations.
+ */
+static svn_error_t *
+store_parts(pack_context_t *context,
+            apr_file_t *temp_file,
+            const svn_fs_fs__id_part_t *item,
+            apr_pool_t *pool)
+{
+  int i = svn_sort__bsearch_lower_bound(context->parts, item,
+              (int (*)(const void *, const void *))compare_ref_to_item);
+
+  for (; i < context->parts->nelts; ++i)
+    {
+      reference_t *reference = APR_ARRAY_IDX(context->parts, i,
+                                             reference_t *);
+      svn_fs_fs__p2l_entry_t *part;
+
+      if (!svn_fs_fs__id_part_eq(&reference->from, item))
+        break;
+
+      part = get_item(context, &reference->to, TRUE);
+      if (part)
+        SVN_ERR(store_item(context, temp_file, part, pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /* Copy (append) the items identified by svn_fs_fs__p2l_entry_t * elements
  * in ENTRIES strictly in order from TEMP_FILE into CONTEXT->PACK_FILE.
  * Use POOL for temporary allocations.
@@ -1227,7 +1365,11 @@ copy_reps_from_temp(pack_context_t *context,
 
       rep_part = get_item(context, &current_path->rep_id, TRUE);
       if (rep_part)
-        SVN_ERR(store_item(context, temp_file, rep_part, iterpool));
+        {
+          SVN_ERR(store_item(context, temp_file, rep_part, iterpool));
+          SVN_ERR(store_parts(context, temp_file, &current_path->rep_id,
+                              iterpool));
+        }
     }
 
   /* copy the remaining non-head noderevs. */
@@ -1244,6 +1386,22 @@ copy_reps_from_temp(pack_context_t *context,
         SVN_ERR(store_item(context, temp_file, node_part, iterpool));
     }
 
+  /* copy the chunks and blocks of reps that no noderev refers to, e.g.
+     because they got replaced within their transaction.  The commit has
+     added those chunks to the rep-cache, so other reps may share them.
+     Keep them in the order of their revisions. */
+  for (i = 0; i < context->parts->nelts; ++i)
+    {
+      reference_t *reference = APR_ARRAY_IDX(context->parts, i,
+                                             reference_t *);
+      svn_fs_fs__p2l_entry_t *part;
+
+      svn_pool_clear(iterpool);
+      part = get_item(context, &reference->to, TRUE);
+      if (part)
+        SVN_ERR(store_item(context, temp_file, part, iterpool));
+    }
+
   svn_pool_destroy(iterpool);
 
   return SVN_NO_ERROR;
@@ -1427,6 +1585,9 @@ pack_range(pack_context_t *context,
   svn_pool_destroy(iterpool2);
   svn_pool_destroy(iterpool);
 
+  /* mark the end of the item range of the last revision */
+  APR_ARRAY_PUSH(context->rev_offsets, int) = context->reps->nelts;
+
   /* phase 3: placement.
    * Use "newest first" placement for simple items. */
   sort_items(context->changes);
@@ -1781,20 +1942,28 @@ pack_phys_addressed(const char *pack_file_dir,
 
   /* Close stream over APR file. */
   SVN_ERR(svn_stream_close(manifest_stream));
+  SVN_ERR(svn_io_file_close(manifest_file, pool));
+  SVN_ERR(svn_io_file_close(pack_file, pool));
 
-  /* Ensure that pack file is written to disk. */
+  /* Ensure that manifest and pack file are written to disk.  Flush them
+     concurrently. */
   if (flush_to_disk)
-    SVN_ERR(svn_io_file_flush_to_disk(manifest_file, pool));
-  SVN_ERR(svn_io_file_close(manifest_file, pool));
+    {
+      svn_fs__batch_fsync_t *batch;
+      apr_file_t *file;
+
+      SVN_ERR(svn_fs__batch_fsync_create(&batch, TRUE, pool));
+      SVN_ERR(svn_fs__batch_fsync_open_file(&file, batch,
+                                            manifest_file_path, pool));
+      SVN_ERR(svn_fs__batch_fsync_open_file(&file, batch, pack_file_path,
+                                            pool));
+      SVN_ERR(svn_fs__batch_fsync_new_path(batch, pack_file_path, pool));
+      SVN_ERR(svn_fs__batch_fsync_run(batch, pool));
+    }
 
   /* disallow write access to the manifest file */
   SVN_ERR(svn_io_set_file_read_only(manifest_file_path, FALSE, iterpool));
 
-  /* Ensure that pack file is written to disk. */
-  if (flush_to_disk)
-    SVN_ERR(svn_io_file_flush_to_disk(pack_file, pool));
-  SVN_ERR(svn_io_file_close(pack_file, pool));
-
   svn_pool_destroy(iterpool);
 
   return SVN_NO_ERROR;
@@ -1866,6 +2035,12 @@ struct pack_baton
   void *cancel_baton;
   size_t max_mem;
 
+  /* Number of rev shards to pack concurrently and the callback to open
+     the FS instances needed for that.  Valid when entering pack_body(). */
+  int jobs;
+  svn_fs_fs__open_fs_func_t open_func;
+  void *open_baton;
+
   /* Additional entries valid when entering pack_shard(). */
   const char *revs_dir;
   const char *revsprops_dir;
@@ -1957,6 +2132,53 @@ synced_pack_shard(void *baton,
   return SVN_NO_ERROR;
 }
 
+/* Return the path of the packed rev shard directory for SHARD in REVS_DIR.
+ * Allocate the result in POOL. */
+static const char *
+rev_pack_file_dir_path(const char *revs_dir,
+                       apr_int64_t shard,
+                       apr_pool_t *pool)
+{
+  return svn_dirent_join(revs_dir,
+                         apr_psprintf(pool,
+                                      "%" APR_INT64_T_FMT PATH_EXT_PACKED_SHARD,
+                                      shard),
+                         pool);
+}
+
+/* Return the path of the non-packed rev shard directory for SHARD in
+ * REVS_DIR.  Allocate the result in POOL. */
+static const char *
+rev_shard_dir_path(const char *revs_dir,
+                   apr_int64_t shard,
+                   apr_pool_t *pool)
+{
+  return svn_dirent_join(revs_dir,
+                         apr_psprintf(pool, "%" APR_INT64_T_FMT, shard),
+                         pool);
+}
+
+/* Make the rev shard described by BATON, which has already been packed
+ * into its pack directory, visible to readers and pack its revprops.
+ */
+static svn_error_t *
+publish_shard(struct pack_baton *baton,
+              apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = baton->fs->fsap_data;
+
+  /* For newer repo formats, we only acquired the pack lock so far.
+     Before modifying the repo state by switching over to the packed
+     data, we need to acquire the global (write) lock. */
+  if (ffd->format >= SVN_FS_FS__MIN_PACK_LOCK_FORMAT)
+    SVN_ERR(svn_fs_fs__with_write_lock(baton->fs, synced_pack_shard, baton,
+                                       pool));
+  else
+    SVN_ERR(synced_pack_shard(baton, pool));
+
+  return SVN_NO_ERROR;
+}
+
 /* Pack the shard described by BATON.
  *
  * If for some reason we detect a partial packing already performed,
@@ -1975,16 +2197,10 @@ pack_shard(struct pack_baton *baton,
                                svn_fs_pack_notify_start, pool));
 
   /* Some useful paths. */
-  rev_pack_file_dir = svn_dirent_join(baton->revs_dir,
-                  apr_psprintf(pool,
-                               "%" APR_INT64_T_FMT PATH_EXT_PACKED_SHARD,
-                               baton->shard),
-                  pool);
-  baton->rev_shard_path = svn_dirent_join(baton->revs_dir,
-                                          apr_psprintf(pool,
-                                                       "%" APR_INT64_T_FMT,
-                                                       baton->shard),
-                                          pool);
+  rev_pack_file_dir = rev_pack_file_dir_path(baton->revs_dir, baton->shard,
+                                             pool);
+  baton->rev_shard_path = rev_shard_dir_path(baton->revs_dir, baton->shard,
+                                             pool);
 
   /* pack the revision content */
   SVN_ERR(pack_rev_shard(baton->fs, rev_pack_file_dir, baton->rev_shard_path,
@@ -1992,14 +2208,8 @@ pack_shard(struct pack_baton *baton,
                          baton->max_mem, ffd->flush_to_disk,
                          baton->cancel_func, baton->cancel_baton, pool));
 
-  /* For newer repo formats, we only acquired the pack lock so far.
-     Before modifying the repo state by switching over to the packed
-     data, we need to acquire the global (write) lock. */
-  if (ffd->format >= SVN_FS_FS__MIN_PACK_LOCK_FORMAT)
-    SVN_ERR(svn_fs_fs__with_write_lock(baton->fs, synced_pack_shard, baton,
-                                       pool));
-  else
-    SVN_ERR(synced_pack_shard(baton, pool));
+  /* Switch over to the packed data. */
+  SVN_ERR(publish_shard(baton, pool));
 
   /* Notify caller we're starting to pack this shard. */
   if (baton->notify_func)
@@ -2009,6 +2219,198 @@ pack_shard(struct pack_baton *baton,
   return SVN_NO_ERROR;
 }
 
+#if APR_HAS_THREADS
+/* Interval in microseconds, in which pack_shards_concurrently() checks
+ * for cancellation while waiting for a pack thread. */
+#define PACK_JOB_POLL_INTERVAL (APR_USEC_PER_SEC / 20)
+
+/* Work item for pack_rev_shard_thread(). */
+typedef struct pack_job_t
+{
+  /* Shared, read-only pack parameters. */
+  struct pack_baton *baton;
+
+  /* The rev shard to pack and its source and target directories. */
+  apr_int64_t shard;
+  const char *rev_shard_path;
+  const char *rev_pack_file_dir;
+
+  /* Set by the calling thread to make all jobs of a batch stop early.
+   * Shared between those jobs. */
+  volatile svn_atomic_t *cancelled;
+
+  /* Set by the pack thread once it has finished. */
+  volatile svn_atomic_t done;
+
+  /* The thread executing this job. */
+  apr_thread_t *thread;
+
+  /* The outcome of this job. */
+  svn_error_t *err;
+} pack_job_t;
+
+/* Implements svn_cancel_func_t for the pack_job_t in BATON.
+ *
+ * The caller's cancel function may not be thread-safe, so only the calling
+ * thread invokes it.  The pack threads simply poll the shared flag.
+ */
+static svn_error_t *
+pack_job_cancel(void *baton)
+{
+  pack_job_t *job = baton;
+
+  if (svn_atomic_read(job->cancelled))
+    return svn_error_create(SVN_ERR_CANCELLED, NULL, NULL);
+
+  return SVN_NO_ERROR;
+}
+
+/* Thread function packing the rev shard described by the pack_job_t in
+ * DATA, using a private FS instance and pool.
+ */
+static void * APR_THREAD_FUNC
+pack_rev_shard_thread(apr_thread_t *thread,
+                      void *data)
+{
+  pack_job_t *job = data;
+  struct pack_baton *baton = job->baton;
+
+  /* Pools are not thread-safe.  Use a separate root pool. */
+  apr_pool_t *pool
+    = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+  svn_fs_t *fs;
+
+  job->err = baton->open_func(&fs, baton->open_baton, pool, pool);
+  if (!job->err)
+    {
+      fs_fs_data_t *ffd = fs->fsap_data;
+      job->err = pack_rev_shard(fs, job->rev_pack_file_dir,
+                                job->rev_shard_path, job->shard,
+                                ffd->max_files_per_dir, baton->max_mem,
+                                ffd->flush_to_disk, pack_job_cancel, job,
+                                pool);
+    }
+
+  svn_pool_destroy(pool);
+  svn_atomic_set(&job->done, TRUE);
+  apr_thread_exit(thread, APR_SUCCESS);
+
+  return NULL;
+}
+
+/* Wait for the pack thread of JOB to finish and return its outcome.
+ * While waiting, check BATON->CANCEL_FUNC and set *JOB->CANCELLED if
+ * the operation got cancelled.  Always join the thread.
+ */
+static svn_error_t *
+wait_for_pack_job(pack_job_t *job,
+                  struct pack_baton *baton)
+{
+  svn_error_t *err = SVN_NO_ERROR;
+  apr_status_t retval;
+  apr_status_t status;
+
+  while (!svn_atomic_read(&job->done))
+    {
+      if (!err && baton->cancel_func)
+        {
+          err = baton->cancel_func(baton->cancel_baton);
+          if (err)
+            svn_atomic_set(job->cancelled, TRUE);
+        }
+
+      apr_sleep(PACK_JOB_POLL_INTERVAL);
+    }
+
+  status = apr_thread_join(&retval, job->thread);
+  if (status)
+    err = svn_error_compose_create(err,
+             svn_error_wrap_apr(status, _("Can't join pack thread")));
+
+  /* Report the cancellation only once, not for each pack thread. */
+  if (err && svn_error_find_cause(job->err, SVN_ERR_CANCELLED))
+    svn_error_clear(job->err);
+  else
+    err = svn_error_compose_create(err, job->err);
+
+  job->err = SVN_NO_ERROR;
+  return err;
+}
+
+/* Pack the COUNT rev shards starting at BATON->SHARD concurrently, one
+ * thread per shard.  As each of them completes, publish it and pack its
+ * revprops, strictly in shard order.  Use POOL for allocations.
+ */
+static svn_error_t *
+pack_shards_concurrently(struct pack_baton *baton,
+                         int count,
+                         apr_pool_t *pool)
+{
+  apr_int64_t first_shard = baton->shard;
+  pack_job_t *jobs = apr_pcalloc(pool, count * sizeof(*jobs));
+  volatile svn_atomic_t cancelled = FALSE;
+  svn_error_t *err = SVN_NO_ERROR;
+  int started, i;
+
+  for (started = 0; started < count; ++started)
+    {
+      pack_job_t *job = &jobs[started];
+      apr_status_t status;
+
+      job->baton = baton;
+      job->shard = first_shard + started;
+      job->rev_shard_path = rev_shard_dir_path(baton->revs_dir, job->shard,
+                                               pool);
+      job->rev_pack_file_dir = rev_pack_file_dir_path(baton->revs_dir,
+                                                      job->shard, pool);
+      job->cancelled = &cancelled;
+
+      status = apr_thread_create(&job->thread, NULL, pack_rev_shard_thread,
+                                 job, pool);
+      if (status)
+        {
+          err = svn_error_wrap_apr(status, _("Can't create pack thread"));
+          break;
+        }
+    }
+
+  /* Publish the results strictly in shard order, so readers never see
+   * a gap in the packed range.  After a failure, stop the remaining jobs
+   * but still wait for them.  We must not leave running threads behind. */
+  for (i = 0; i < started; ++i)
+    {
+      svn_error_t *job_err;
+
+      if (err)
+        svn_atomic_set(&cancelled, TRUE);
+
+      baton->shard = jobs[i].shard;
+      baton->rev_shard_path = jobs[i].rev_shard_path;
+
+      if (!err && baton->notify_func)
+        err = baton->notify_func(baton->notify_baton, baton->shard,
+                                 svn_fs_pack_notify_start, pool);
+
+      job_err = wait_for_pack_job(&jobs[i], baton);
+
+      /* Jobs stopped because of an earlier error add no information. */
+      if (err && svn_error_find_cause(job_err, SVN_ERR_CANCELLED))
+        svn_error_clear(job_err);
+      else
+        err = svn_error_compose_create(err, job_err);
+
+      if (!err)
+        err = publish_shard(baton, pool);
+
+      if (!err && baton->notify_func)
+        err = baton->notify_func(baton->notify_baton, baton->shard,
+                                 svn_fs_pack_notify_end, pool);
+    }
+
+  return svn_error_trace(err);
+}
+#endif
+
 /* Read the youngest rev and the first non-packed rev info for FS from disk.
    Set *FULLY_PACKED when there is no completed unpacked shard.
    Use SCRATCH_POOL for temporary allocations.
@@ -2081,16 +2483,28 @@ pack_body(void *baton,
                                         pool);
 
   iterpool = svn_pool_create(pool);
-  for (pb->shard = ffd->min_unpacked_rev / ffd->max_files_per_dir;
-       pb->shard < completed_shards;
-       pb->shard++)
+  pb->shard = ffd->min_unpacked_rev / ffd->max_files_per_dir;
+  while (pb->shard < completed_shards)
     {
       svn_pool_clear(iterpool);
 
       if (pb->cancel_func)
         SVN_ERR(pb->cancel_func(pb->cancel_baton));
 
+#if APR_HAS_THREADS
+      if (pb->jobs > 1 && pb->open_func)
+        {
+          int count = (int)MIN(pb->jobs, completed_shards - pb->shard);
+
+          /* This leaves PB->SHARD at the last shard being packed. */
+          SVN_ERR(pack_shards_concurrently(pb, count, iterpool));
+          pb->shard++;
+          continue;
+        }
+#endif
+
       SVN_ERR(pack_shard(pb, iterpool));
+      pb->shard++;
     }
 
   svn_pool_destroy(iterpool);
@@ -2100,6 +2514,9 @@ pack_body(void *baton,
 svn_error_t *
 svn_fs_fs__pack(svn_fs_t *fs,
                 apr_size_t max_mem,
+                int jobs,
+                svn_fs_fs__open_fs_func_t open_func,
+                void *open_baton,
                 svn_fs_pack_notify_t notify_func,
                 void *notify_baton,
                 svn_cancel_func_t cancel_func,
@@ -2146,6 +2563,9 @@ svn_fs_fs__pack(svn_fs_t *fs,
   pb.cancel_func = cancel_func;
   pb.cancel_baton = cancel_baton;
   pb.max_mem = max_mem ? max_mem : DEFAULT_MAX_MEM;
+  pb.jobs = jobs;
+  pb.open_func = open_func;
+  pb.open_baton = open_baton;
 
   if (ffd->format >= SVN_FS_FS__MIN_PACK_LOCK_FORMAT)
     {
@@ -32,13 +32,24 @@
    MAX_MEM limits the size of in-memory data structures needed for reordering
    items in format 7 repositories.  0 means use the built-in default.
 
+   If JOBS is larger than 1 and OPEN_FUNC is not NULL, up to JOBS rev
+   shards will be packed concurrently, each one in a separate thread and
+   with its own FS instance provided by OPEN_FUNC with OPEN_BATON.  Packed
+   shards still get published strictly in order.  Note that every job may
+   use up to MAX_MEM.
+
    If given, NOTIFY_FUNC will be called with NOTIFY_BATON to report progress.
-   Use optional CANCEL_FUNC/CANCEL_BATON for cancellation support.
+   Use optional CANCEL_FUNC/CANCEL_BATON for cancellation support.  Both
+   will only be called from the calling thread, so they need not be
+   thread-safe.  The pack threads get stopped through a shared flag.
 
    Existing filesystem references need not change.  */
 svn_error_t *
 svn_fs_fs__pack(svn_fs_t *fs,
                 apr_size_t max_mem,
+                int jobs,
+                svn_fs_fs__open_fs_func_t open_func,
+                void *open_baton,
                 svn_fs_pack_notify_t notify_func,
                 void *notify_baton,
                 svn_cancel_func_t cancel_func,
@@ -0,0 +1,76 @@
+/* path-index-db.sql -- schema of the changed-path index
+ *   This is intended for use with SQLite 3
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+-- STMT_CREATE_SCHEMA
+/* One row per path that got changed in a revision.  Paths are relpaths,
+   i.e. the repository root is ''. */
+CREATE TABLE path_changes (
+  path TEXT NOT NULL,
+  revision INTEGER NOT NULL,
+  PRIMARY KEY (path, revision)
+  ) WITHOUT ROWID;
+
+/* The youngest revision up to which PATH_CHANGES is complete.  Contains
+   at most one row. */
+CREATE TABLE path_index_state (
+  id INTEGER NOT NULL PRIMARY KEY CHECK (id = 0),
+  youngest INTEGER NOT NULL
+  );
+
+INSERT INTO path_index_state (id, youngest) VALUES (0, -1);
+
+PRAGMA USER_VERSION = 1;
+
+-- STMT_GET_YOUNGEST
+SELECT youngest
+FROM path_index_state
+WHERE id = 0
+
+-- STMT_SET_YOUNGEST
+UPDATE path_index_state
+SET youngest = ?1
+WHERE id = 0
+
+-- STMT_ADD_PATH_CHANGE
+INSERT OR IGNORE INTO path_changes (path, revision)
+VALUES (?1, ?2)
+
+-- STMT_GET_PATH_REVISIONS
+SELECT revision
+FROM path_changes
+WHERE path = ?1 AND revision >= ?2 AND revision <= ?3
+
+-- STMT_GET_DESCENDANT_REVISIONS
+SELECT DISTINCT revision
+FROM path_changes
+WHERE IS_STRICT_DESCENDANT_OF(path, ?1)
+  AND revision >= ?2 AND revision <= ?3
+
+-- STMT_DEL_REVISIONS_YOUNGER_THAN
+DELETE FROM path_changes
+WHERE revision > ?1
+
+-- STMT_LIMIT_YOUNGEST
+UPDATE path_index_state
+SET youngest = ?1
+WHERE id = 0 AND youngest > ?1
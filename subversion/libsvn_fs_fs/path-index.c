@@ -0,0 +1,434 @@
+/* path-index.c --- the changed-path index for fsfs
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+
+#include "svn_pools.h"
+#include "svn_sorts.h"
+
+#include "svn_private_config.h"
+
+#include "cached_data.h"
+#include "fs_fs.h"
+#include "fs.h"
+#include "path-index.h"
+#include "util.h"
+#include "../libsvn_fs/fs-loader.h"
+
+#include "svn_dirent_uri.h"
+#include "svn_path.h"
+
+#include "private/svn_fspath.h"
+#include "private/svn_sorts_private.h"
+#include "private/svn_sqlite.h"
+
+#include "path-index-db.h"
+
+PATH_INDEX_DB_SQL_DECLARE_STATEMENTS(statements);
+
+
+
+/** Helper functions. **/
+static APR_INLINE const char *
+path_path_index_db(const char *fs_path,
+                   apr_pool_t *result_pool)
+{
+  return svn_dirent_join(fs_path, PATH_INDEX_DB_NAME, result_pool);
+}
+
+/* Set *YOUNGEST to the youngest revision covered by the path index in DB.
+ */
+static svn_error_t *
+get_indexed_youngest(svn_revnum_t *youngest,
+                     svn_sqlite__db_t *db)
+{
+  svn_sqlite__stmt_t *stmt;
+  svn_boolean_t have_row;
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, db, STMT_GET_YOUNGEST));
+  SVN_ERR(svn_sqlite__step(&have_row, stmt));
+  *youngest = have_row ? svn_sqlite__column_revnum(stmt, 0)
+                       : SVN_INVALID_REVNUM;
+
+  return svn_error_trace(svn_sqlite__reset(stmt));
+}
+
+
+/** Library-private API's. **/
+
+/* Body of svn_fs_fs__open_path_index().
+   Implements svn_atomic__init_once().init_func.
+ */
+static svn_error_t *
+open_path_index(void *baton,
+                apr_pool_t *pool)
+{
+  svn_fs_t *fs = baton;
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_sqlite__db_t *sdb;
+  const char *db_path;
+  int version;
+
+  /* Open (or create) the sqlite database.  It will be automatically
+     closed when fs->pool is destroyed. */
+  db_path = path_path_index_db(fs->path, pool);
+#ifndef WIN32
+  {
+    /* Like the rep-cache, the index should be accessible to everybody
+       who may access the repository. */
+    svn_boolean_t exists;
+
+    SVN_ERR(svn_fs_fs__exists_path_index(&exists, fs, pool));
+    if (!exists)
+      {
+        const char *current = svn_fs_fs__path_current(fs, pool);
+        svn_error_t *err = svn_io_file_create_empty(db_path, pool);
+
+        if (err && !APR_STATUS_IS_EEXIST(err->apr_err))
+          /* A real error. */
+          return svn_error_trace(err);
+        else if (err)
+          /* Some other thread/process created the file. */
+          svn_error_clear(err);
+        else
+          /* We created the file. */
+          SVN_ERR(svn_io_copy_perms(current, db_path, pool));
+      }
+  }
+#endif
+  SVN_ERR(svn_sqlite__open(&sdb, db_path,
+                           svn_sqlite__mode_rwcreate, statements,
+                           0, NULL, 0,
+                           fs->pool, pool));
+
+  SVN_SQLITE__ERR_CLOSE(svn_sqlite__read_schema_version(&version, sdb, pool),
+                        sdb);
+  /* If we have an uninitialized database, go ahead and create the schema. */
+  if (version <= 0)
+    SVN_SQLITE__ERR_CLOSE(svn_sqlite__exec_statements(sdb,
+                                                      STMT_CREATE_SCHEMA),
+                          sdb);
+
+  /* This is used as a flag that the database is available so don't
+     set it earlier. */
+  ffd->path_index_db = sdb;
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__open_path_index(svn_fs_t *fs,
+                           apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_error_t *err = svn_atomic__init_once(&ffd->path_index_db_opened,
+                                           open_path_index, fs, pool);
+  return svn_error_quick_wrapf(err,
+                               _("Couldn't open path index database '%s'"),
+                               svn_dirent_local_style(
+                                 path_path_index_db(fs->path, pool), pool));
+}
+
+svn_error_t *
+svn_fs_fs__close_path_index(svn_fs_t *fs)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+
+  if (ffd->path_index_db)
+    {
+      SVN_ERR(svn_sqlite__close(ffd->path_index_db));
+      ffd->path_index_db = NULL;
+      ffd->path_index_db_opened = 0;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__exists_path_index(svn_boolean_t *exists,
+                             svn_fs_t *fs,
+                             apr_pool_t *pool)
+{
+  svn_node_kind_t kind;
+
+  SVN_ERR(svn_io_check_path(path_path_index_db(fs->path, pool),
+                            &kind, pool));
+
+  *exists = (kind != svn_node_none);
+  return SVN_NO_ERROR;
+}
+
+/* Baton type for index_next_revision(). */
+typedef struct index_revision_baton_t
+{
+  /* The filesystem being indexed. */
+  svn_fs_t *fs;
+
+  /* Index no revisions after this one. */
+  svn_revnum_t end_rev;
+
+  /* Set by index_next_revision: the revision just added or
+     SVN_INVALID_REVNUM if END_REV had already been covered. */
+  svn_revnum_t revision;
+} index_revision_baton_t;
+
+/* Add the revision following the youngest one in the path index DB to
+ * that index, unless the index already covers BATON->END_REV.  Implements
+ * svn_sqlite__transaction_callback_t for an index_revision_baton_t BATON.
+ *
+ * Because we determine the revision to add within the same transaction,
+ * concurrent updates will neither add a revision twice nor leave gaps.
+ */
+static svn_error_t *
+index_next_revision(void *baton,
+                    svn_sqlite__db_t *db,
+                    apr_pool_t *scratch_pool)
+{
+  index_revision_baton_t *b = baton;
+  svn_fs_fs__changes_context_t *context;
+  svn_sqlite__stmt_t *stmt;
+  svn_revnum_t youngest;
+  apr_pool_t *iterpool;
+
+  SVN_ERR(get_indexed_youngest(&youngest, db));
+  if (youngest >= b->end_rev)
+    {
+      b->revision = SVN_INVALID_REVNUM;
+      return SVN_NO_ERROR;
+    }
+
+  b->revision = youngest + 1;
+  SVN_ERR(svn_fs_fs__create_changes_context(&context, b->fs, b->revision,
+                                            scratch_pool));
+
+  iterpool = svn_pool_create(scratch_pool);
+  while (!context->eol)
+    {
+      apr_array_header_t *changes;
+      int i;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_fs__get_changes(&changes, context, iterpool,
+                                     iterpool));
+
+      for (i = 0; i < changes->nelts; ++i)
+        {
+          change_t *change = APR_ARRAY_IDX(changes, i, change_t *);
+          const char *relpath = svn_fspath__skip_ancestor("/",
+                                                          change->path.data);
+
+          SVN_ERR(svn_sqlite__get_statement(&stmt, db,
+                                            STMT_ADD_PATH_CHANGE));
+          SVN_ERR(svn_sqlite__bindf(stmt, "sr", relpath, b->revision));
+          SVN_ERR(svn_sqlite__insert(NULL, stmt));
+        }
+    }
+  svn_pool_destroy(iterpool);
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, db, STMT_SET_YOUNGEST));
+  SVN_ERR(svn_sqlite__bindf(stmt, "r", b->revision));
+  SVN_ERR(svn_sqlite__step_done(stmt));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__update_path_index(svn_fs_t *fs,
+                             svn_revnum_t end_rev,
+                             svn_fs_progress_notify_func_t progress_func,
+                             void *progress_baton,
+                             svn_cancel_func_t cancel_func,
+                             void *cancel_baton,
+                             apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  index_revision_baton_t baton;
+  apr_pool_t *iterpool;
+
+  if (!SVN_IS_VALID_REVNUM(end_rev))
+    SVN_ERR(svn_fs_fs__youngest_rev(&end_rev, fs, pool));
+
+  if (! ffd->path_index_db)
+    SVN_ERR(svn_fs_fs__open_path_index(fs, pool));
+
+  baton.fs = fs;
+  baton.end_rev = end_rev;
+
+  iterpool = svn_pool_create(pool);
+  do
+    {
+      svn_pool_clear(iterpool);
+
+      if (cancel_func)
+        SVN_ERR(cancel_func(cancel_baton));
+
+      SVN_ERR(svn_sqlite__with_immediate_transaction(ffd->path_index_db,
+                                                     index_next_revision,
+                                                     &baton, iterpool));
+
+      if (progress_func && SVN_IS_VALID_REVNUM(baton.revision))
+        progress_func(baton.revision, progress_baton, iterpool);
+    }
+  while (SVN_IS_VALID_REVNUM(baton.revision));
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Append to REVISIONS all revisions between START and END that STMT_ID
+ * returns from DB for PATH. */
+static svn_error_t *
+add_revisions(apr_array_header_t *revisions,
+              svn_sqlite__db_t *db,
+              int stmt_id,
+              const char *path,
+              svn_revnum_t start,
+              svn_revnum_t end)
+{
+  svn_sqlite__stmt_t *stmt;
+  svn_boolean_t have_row;
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, db, stmt_id));
+  SVN_ERR(svn_sqlite__bindf(stmt, "srr", path, start, end));
+  SVN_ERR(svn_sqlite__step(&have_row, stmt));
+  while (have_row)
+    {
+      APR_ARRAY_PUSH(revisions, svn_revnum_t)
+        = svn_sqlite__column_revnum(stmt, 0);
+      SVN_ERR(svn_sqlite__step(&have_row, stmt));
+    }
+
+  return svn_error_trace(svn_sqlite__reset(stmt));
+}
+
+/* Comparison function for svn_revnum_t array elements. */
+static int
+compare_revnums(const void *a, const void *b)
+{
+  svn_revnum_t lhs = *(const svn_revnum_t *)a;
+  svn_revnum_t rhs = *(const svn_revnum_t *)b;
+
+  return lhs < rhs ? -1 : (lhs > rhs ? 1 : 0);
+}
+
+svn_error_t *
+svn_fs_fs__path_index_get_revisions(apr_array_header_t **revisions,
+                                    svn_fs_t *fs,
+                                    const char *path,
+                                    svn_revnum_t start,
+                                    svn_revnum_t end,
+                                    apr_pool_t *result_pool,
+                                    apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  apr_array_header_t *result;
+  svn_revnum_t youngest;
+  const char *relpath;
+  int i, k;
+
+  *revisions = NULL;
+
+  /* Don't create the index when we only want to read from it. */
+  if (! ffd->path_index_db)
+    {
+      svn_boolean_t exists;
+      SVN_ERR(svn_fs_fs__exists_path_index(&exists, fs, scratch_pool));
+      if (!exists)
+        return SVN_NO_ERROR;
+
+      SVN_ERR(svn_fs_fs__open_path_index(fs, scratch_pool));
+    }
+
+  SVN_ERR(get_indexed_youngest(&youngest, ffd->path_index_db));
+  if (youngest < end)
+    return SVN_NO_ERROR;
+
+  /* Changes to PATH itself and to all of its parents ... */
+  result = apr_array_make(result_pool, 16, sizeof(svn_revnum_t));
+  relpath = svn_fspath__skip_ancestor("/", svn_fspath__canonicalize(path,
+                                                               scratch_pool));
+  while (TRUE)
+    {
+      SVN_ERR(add_revisions(result, ffd->path_index_db,
+                            STMT_GET_PATH_REVISIONS, relpath, start, end));
+      if (*relpath == '\0')
+        break;
+
+      relpath = svn_relpath_dirname(relpath, scratch_pool);
+    }
+
+  /* ... plus those to anything below it. */
+  relpath = svn_fspath__skip_ancestor("/", svn_fspath__canonicalize(path,
+                                                               scratch_pool));
+  SVN_ERR(add_revisions(result, ffd->path_index_db,
+                        STMT_GET_DESCENDANT_REVISIONS, relpath, start, end));
+
+  /* Sort and remove duplicates. */
+  svn_sort__array(result, compare_revnums);
+  for (i = 0, k = 0; i < result->nelts; ++i)
+    if (k == 0 || APR_ARRAY_IDX(result, i, svn_revnum_t)
+                  != APR_ARRAY_IDX(result, k - 1, svn_revnum_t))
+      APR_ARRAY_IDX(result, k++, svn_revnum_t)
+        = APR_ARRAY_IDX(result, i, svn_revnum_t);
+  result->nelts = k;
+
+  *revisions = result;
+  return SVN_NO_ERROR;
+}
+
+/* Remove all revisions younger than *BATON, an svn_revnum_t, from the
+ * path index DB.  Implements svn_sqlite__transaction_callback_t. */
+static svn_error_t *
+truncate_index(void *baton,
+               svn_sqlite__db_t *db,
+               apr_pool_t *scratch_pool)
+{
+  svn_revnum_t youngest = *(svn_revnum_t *)baton;
+  svn_sqlite__stmt_t *stmt;
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, db,
+                                    STMT_DEL_REVISIONS_YOUNGER_THAN));
+  SVN_ERR(svn_sqlite__bindf(stmt, "r", youngest));
+  SVN_ERR(svn_sqlite__step_done(stmt));
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, db, STMT_LIMIT_YOUNGEST));
+  SVN_ERR(svn_sqlite__bindf(stmt, "r", youngest));
+  SVN_ERR(svn_sqlite__step_done(stmt));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__path_index_truncate(svn_fs_t *fs,
+                               svn_revnum_t youngest,
+                               apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+
+  if (! ffd->path_index_db)
+    SVN_ERR(svn_fs_fs__open_path_index(fs, pool));
+
+  return svn_error_trace(
+           svn_sqlite__with_immediate_transaction(ffd->path_index_db,
+                                                  truncate_index, &youngest,
+                                                  pool));
+}
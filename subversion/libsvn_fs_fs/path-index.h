@@ -0,0 +1,108 @@
+/* path-index.h : interface to the changed-path index
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#ifndef SVN_LIBSVN_FS_FS_PATH_INDEX_H
+#define SVN_LIBSVN_FS_FS_PATH_INDEX_H
+
+#include "svn_error.h"
+#include "svn_fs.h"
+
+#include "fs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* The changed-path index is an optional SQLite database listing, for each
+ * revision, the paths changed in it.  It allows for finding the revisions
+ * that touched a given path without walking the repository history.
+ *
+ * The index only exists if it has been created explicitly, e.g. through
+ * 'svnadmin build-path-index'.  From then on, it is being extended upon
+ * every commit.  Revisions are always added in sequence, so the index is
+ * complete up to some youngest revision.
+ */
+
+#define PATH_INDEX_DB_NAME       "path-index.db"
+
+/* Set *EXISTS to TRUE iff the path index DB file exists in FS. */
+svn_error_t *
+svn_fs_fs__exists_path_index(svn_boolean_t *exists,
+                             svn_fs_t *fs,
+                             apr_pool_t *pool);
+
+/* Open and create, if needed, the path index database associated with FS.
+   Use POOL for temporary allocations. */
+svn_error_t *
+svn_fs_fs__open_path_index(svn_fs_t *fs,
+                           apr_pool_t *pool);
+
+/* Close the path index database associated with FS. */
+svn_error_t *
+svn_fs_fs__close_path_index(svn_fs_t *fs);
+
+/* Add all revisions up to and including END_REV to the path index of FS
+ * that are not in it, yet.  If END_REV is SVN_INVALID_REVNUM, index up to
+ * the youngest revision.  Create the index if it does not exist.
+ *
+ * Each revision is being added in its own SQLite transaction, so this may
+ * run concurrently with other processes updating the same index.  Call
+ * the optional PROGRESS_FUNC with PROGRESS_BATON for each revision being
+ * added.  Use POOL for temporary allocations.
+ */
+svn_error_t *
+svn_fs_fs__update_path_index(svn_fs_t *fs,
+                             svn_revnum_t end_rev,
+                             svn_fs_progress_notify_func_t progress_func,
+                             void *progress_baton,
+                             svn_cancel_func_t cancel_func,
+                             void *cancel_baton,
+                             apr_pool_t *pool);
+
+/* Set *REVISIONS to the ascending list of svn_revnum_t of all revisions
+ * between START and END (inclusive) in FS that changed the node at PATH,
+ * any of its parent directories or any node below PATH.
+ *
+ * If FS has no path index or the index does not cover END yet, set
+ * *REVISIONS to NULL.  Allocate the result in RESULT_POOL and use
+ * SCRATCH_POOL for temporaries.
+ */
+svn_error_t *
+svn_fs_fs__path_index_get_revisions(apr_array_header_t **revisions,
+                                    svn_fs_t *fs,
+                                    const char *path,
+                                    svn_revnum_t start,
+                                    svn_revnum_t end,
+                                    apr_pool_t *result_pool,
+                                    apr_pool_t *scratch_pool);
+
+/* Remove all revisions younger than YOUNGEST from the path index of FS. */
+svn_error_t *
+svn_fs_fs__path_index_truncate(svn_fs_t *fs,
+                               svn_revnum_t youngest,
+                               apr_pool_t *pool);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* SVN_LIBSVN_FS_FS_PATH_INDEX_H */
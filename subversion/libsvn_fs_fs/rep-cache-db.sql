@@ -75,6 +75,16 @@ WHERE revision >= ?1 AND revision <= ?2
 SELECT MAX(revision)
 FROM rep_cache
 
+-- STMT_COUNT_REPS
+/* Works for both V1 and V2 schemas. */
+SELECT COUNT(*)
+FROM rep_cache
+
+-- STMT_GET_ALL_HASHES
+/* Works for both V1 and V2 schemas. */
+SELECT hash
+FROM rep_cache
+
 -- STMT_DEL_REPS_YOUNGER_THAN_REV
 /* Works for both V1 and V2 schemas. */
 DELETE FROM rep_cache
@@ -21,6 +21,7 @@
  */
 
 #include "svn_pools.h"
+#include "svn_sorts.h"
 
 #include "svn_private_config.h"
 
@@ -48,7 +49,225 @@ path_rep_cache_db(const char *fs_path,
   return svn_dirent_join(fs_path, REP_CACHE_DB_NAME, result_pool);
 }
 
+/* Filter bits per checksum and number of bits set per checksum.  These
+   give about 1% false positives when the filter is at its capacity. */
+#define FILTER_BITS_PER_ENTRY 10
+#define FILTER_HASHES 7
+
+/* Make room for at least that many checksums in a new filter. */
+#define FILTER_MIN_CAPACITY 0x10000
+
+/* Call ACTION for each filter bit position selected by the SHA1 DIGEST
+   in FILTER, with I being the bit position.  SHA1 is evenly distributed,
+   so we can use parts of it directly to derive the positions. */
+#define FOR_FILTER_BITS(filter, digest, i, action)                        \
+  do {                                                                     \
+    apr_uint64_t h1_, h2_;                                                 \
+    int k_;                                                                \
+    memcpy(&h1_, (digest), sizeof(h1_));                                   \
+    memcpy(&h2_, (digest) + sizeof(h1_), sizeof(h2_));                     \
+    h2_ |= 1;                                                              \
+    for (k_ = 0; k_ < FILTER_HASHES; ++k_)                                 \
+      {                                                                    \
+        apr_uint64_t i = (h1_ + k_ * h2_) & (filter)->mask;                \
+        action;                                                            \
+      }                                                                    \
+  } while (0)
+
+/* Add the SHA1 DIGEST to FILTER.  Count it as a new entry only if that
+   changed any bit, i.e. don't count duplicates.  False positives won't be
+   counted either but they don't fill the filter any further. */
+static void
+filter_add(rep_cache_filter_t *filter,
+           const unsigned char *digest)
+{
+  svn_boolean_t added = FALSE;
+  FOR_FILTER_BITS(filter, digest, bit,
+                  if ((filter->bits[bit / 8] & (1 << (bit % 8))) == 0)
+                    {
+                      filter->bits[bit / 8] |= (unsigned char)(1 << (bit % 8));
+                      added = TRUE;
+                    });
+  if (added)
+    filter->entries++;
+}
+
+/* Return TRUE if SHA1 DIGEST may have been added to FILTER. */
+static svn_boolean_t
+filter_may_contain(const rep_cache_filter_t *filter,
+                   const unsigned char *digest)
+{
+  FOR_FILTER_BITS(filter, digest, bit,
+                  if ((filter->bits[bit / 8] & (1 << (bit % 8))) == 0)
+                    return FALSE);
+  return TRUE;
+}
+
 
+/* Baton type for fill_filter(). */
+typedef struct fill_filter_baton_t
+{
+  /* The filter being built.  Its BITS have not been allocated yet. */
+  rep_cache_filter_t *filter;
+
+  /* Cancellation support. */
+  svn_cancel_func_t cancel_func;
+  void *cancel_baton;
+} fill_filter_baton_t;
+
+/* Size the filter in BATON, a fill_filter_baton_t, for the contents of
+   rep-cache DB and add all checksums in DB to it.  Running this as a
+   single transaction gives us a consistent view of DB.  Implements
+   svn_sqlite__transaction_callback_t. */
+static svn_error_t *
+fill_filter(void *baton,
+            svn_sqlite__db_t *db,
+            apr_pool_t *scratch_pool)
+{
+  fill_filter_baton_t *b = baton;
+  rep_cache_filter_t *filter = b->filter;
+  svn_sqlite__stmt_t *stmt;
+  svn_boolean_t have_row;
+  apr_uint64_t count, bit_count;
+  int iterations = 0;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, db, STMT_COUNT_REPS));
+  SVN_ERR(svn_sqlite__step_row(stmt));
+  count = (apr_uint64_t)svn_sqlite__column_int64(stmt, 0);
+  SVN_ERR(svn_sqlite__reset(stmt));
+
+  /* Leave room for the cache to double in size before we need to
+     rebuild the filter. */
+  count = MAX(2 * count, FILTER_MIN_CAPACITY);
+  for (bit_count = 8; bit_count < count * FILTER_BITS_PER_ENTRY; )
+    bit_count *= 2;
+
+  filter->bits = apr_pcalloc(filter->pool, (apr_size_t)(bit_count / 8));
+  filter->mask = bit_count - 1;
+  filter->capacity = bit_count / FILTER_BITS_PER_ENTRY;
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, db, STMT_GET_ALL_HASHES));
+  SVN_ERR(svn_sqlite__step(&have_row, stmt));
+  while (have_row)
+    {
+      svn_checksum_t *checksum;
+      svn_error_t *err;
+
+      if (iterations++ % 1024 == 0)
+        {
+          svn_pool_clear(iterpool);
+          if (b->cancel_func)
+            {
+              err = b->cancel_func(b->cancel_baton);
+              if (err)
+                return svn_error_compose_create(err,
+                                                svn_sqlite__reset(stmt));
+            }
+        }
+
+      err = svn_checksum_parse_hex(&checksum, svn_checksum_sha1,
+                                   svn_sqlite__column_text(stmt, 0, NULL),
+                                   iterpool);
+      if (err)
+        return svn_error_compose_create(err, svn_sqlite__reset(stmt));
+
+      /* Ignore any invalid entries.  They will never match. */
+      if (checksum)
+        filter_add(filter, checksum->digest);
+
+      SVN_ERR(svn_sqlite__step(&have_row, stmt));
+    }
+
+  svn_pool_destroy(iterpool);
+  return svn_error_trace(svn_sqlite__reset(stmt));
+}
+
+/* Replace the rep-cache filter of FS with a new one built from the
+   current contents of the rep-cache.  Use SCRATCH_POOL for temporaries. */
+static svn_error_t *
+build_filter(svn_fs_t *fs,
+             apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  rep_cache_filter_t *old_filter = ffd->rep_cache_filter;
+  apr_pool_t *pool = svn_pool_create(fs->pool);
+  fill_filter_baton_t baton;
+  svn_error_t *err;
+
+  baton.filter = apr_pcalloc(pool, sizeof(*baton.filter));
+  baton.filter->pool = pool;
+  baton.cancel_func = NULL;
+  baton.cancel_baton = NULL;
+
+  /* Any revision committed before we read the rep-cache should be
+     covered.  Should some other process still be adding the reps of
+     those revisions, we will merely fail to share them. */
+  err = svn_fs_fs__youngest_rev(&baton.filter->revision, fs, scratch_pool);
+  if (!err)
+    err = svn_sqlite__with_transaction(ffd->rep_cache_db, fill_filter,
+                                       &baton, scratch_pool);
+  if (err)
+    {
+      svn_pool_destroy(pool);
+      return svn_error_trace(err);
+    }
+
+  if (old_filter)
+    {
+      baton.filter->lookups = old_filter->lookups;
+      baton.filter->negatives = old_filter->negatives;
+      svn_pool_destroy(old_filter->pool);
+    }
+
+  ffd->rep_cache_filter = baton.filter;
+  return SVN_NO_ERROR;
+}
+
+/* Set *MAY_EXIST to FALSE if the rep-cache filter of FS shows that
+   the SHA1 DIGEST is not in the rep-cache.  Set it to TRUE if it might
+   be or the filter cannot be used.  Use SCRATCH_POOL for temporaries. */
+static svn_error_t *
+check_filter(svn_boolean_t *may_exist,
+             svn_fs_t *fs,
+             const unsigned char *digest,
+             apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  rep_cache_filter_t *filter = ffd->rep_cache_filter;
+
+  *may_exist = TRUE;
+
+  /* Someone else committed in the meantime and may have added reps
+     to the cache that the filter does not know about.  Re-reading the
+     whole rep-cache after each such commit would be more expensive than
+     querying it directly, so stop using the filter. */
+  if (filter && ffd->youngest_rev_cache > filter->revision)
+    {
+      svn_pool_destroy(filter->pool);
+      ffd->rep_cache_filter = NULL;
+      ffd->rep_cache_filter_enabled = FALSE;
+
+      return SVN_NO_ERROR;
+    }
+
+  if (!filter || filter->entries > filter->capacity)
+    {
+      SVN_ERR(build_filter(fs, scratch_pool));
+      filter = ffd->rep_cache_filter;
+    }
+
+  filter->lookups++;
+  if (!filter_may_contain(filter, digest))
+    {
+      filter->negatives++;
+      *may_exist = FALSE;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+
 /** Library-private API's. **/
 
 /* Body of svn_fs_fs__open_rep_cache().
@@ -281,6 +500,20 @@ svn_fs_fs__get_rep_reference(representation_t **rep_p,
                             _("Only SHA1 checksums can be used as keys in the "
                               "rep_cache table.\n"));
 
+  /* Most new content has never been seen before.  Try to find that out
+     without querying the database. */
+  if (ffd->rep_cache_filter_enabled)
+    {
+      svn_boolean_t may_exist;
+
+      SVN_ERR(check_filter(&may_exist, fs, checksum->digest, pool));
+      if (!may_exist)
+        {
+          *rep_p = NULL;
+          return SVN_NO_ERROR;
+        }
+    }
+
   SVN_ERR(svn_sqlite__get_statement(&stmt, ffd->rep_cache_db, STMT_GET_REP));
   SVN_ERR(svn_sqlite__bindf(stmt, "s",
                             svn_checksum_to_cstring(checksum, pool)));
@@ -352,6 +585,9 @@ svn_fs_fs__set_rep_reference(svn_fs_t *fs,
 
   SVN_ERR(svn_sqlite__insert(NULL, stmt));
 
+  if (ffd->rep_cache_filter)
+    filter_add(ffd->rep_cache_filter, rep->sha1_digest);
+
   return SVN_NO_ERROR;
 }
 
@@ -376,6 +612,17 @@ svn_fs_fs__del_rep_reference(svn_fs_t *fs,
   return SVN_NO_ERROR;
 }
 
+void
+svn_fs_fs__rep_cache_filter_bump(svn_fs_t *fs,
+                                 svn_revnum_t revision)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  rep_cache_filter_t *filter = ffd->rep_cache_filter;
+
+  if (filter && filter->revision + 1 == revision)
+    filter->revision = revision;
+}
+
 /* Start a transaction to take an SQLite reserved lock that prevents
    other writes.
 
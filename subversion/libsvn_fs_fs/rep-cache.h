@@ -83,6 +83,12 @@ svn_fs_fs__set_rep_reference(svn_fs_t *fs,
                              representation_t *rep,
                              apr_pool_t *pool);
 
+/* Tell the rep-cache filter of FS, if there is one, that all reps of
+   REVISION have been added to the rep cache. */
+void
+svn_fs_fs__rep_cache_filter_bump(svn_fs_t *fs,
+                                 svn_revnum_t revision);
+
 /* Delete from the cache all reps corresponding to revisions younger
    than YOUNGEST. */
 svn_error_t *
@@ -20,6 +20,8 @@
  * ====================================================================
  */
 
+#include <string.h>
+
 #include "rev_file.h"
 #include "fs_fs.h"
 #include "index.h"
@@ -46,6 +48,8 @@ init_revision_file(svn_fs_fs__revision_file_t *file,
 
   file->file = NULL;
   file->stream = NULL;
+  file->mmap = NULL;
+  file->mapped_pos = 0;
   file->p2l_stream = NULL;
   file->l2p_stream = NULL;
   file->block_size = ffd->block_size;
@@ -54,6 +58,8 @@ init_revision_file(svn_fs_fs__revision_file_t *file,
   file->p2l_offset = -1;
   file->p2l_checksum = NULL;
   file->footer_offset = -1;
+  file->prefetched_start = 0;
+  file->prefetched_end = 0;
   file->pool = pool;
 }
 
@@ -120,6 +126,139 @@ auto_make_writable(const char *path,
   return SVN_NO_ERROR;
 }
 
+/* Don't map files larger than this into memory.  On 32 bit systems,
+ * this prevents us from exhausting the address space. */
+#define MAX_MAPPED_SIZE (APR_SIZE_MAX / 4)
+
+/* Implements svn_read_fn_t, reading from the mapped revision file BATON. */
+static svn_error_t *
+mapped_read(void *baton,
+            char *buffer,
+            apr_size_t *len)
+{
+  svn_fs_fs__revision_file_t *file = baton;
+  apr_off_t size = (apr_off_t)file->mmap->size;
+  apr_off_t remaining = file->mapped_pos < size
+                      ? size - file->mapped_pos
+                      : 0;
+
+  if (*len > remaining)
+    *len = (apr_size_t)remaining;
+
+  memcpy(buffer, (const char *)file->mmap->mm + file->mapped_pos, *len);
+  file->mapped_pos += *len;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_stream_skip_fn_t for mapped revision files. */
+static svn_error_t *
+mapped_skip(void *baton,
+            apr_size_t len)
+{
+  svn_fs_fs__revision_file_t *file = baton;
+  file->mapped_pos += len;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_stream_data_available_fn_t for mapped revision files. */
+static svn_error_t *
+mapped_data_available(void *baton,
+                      svn_boolean_t *data_available)
+{
+  svn_fs_fs__revision_file_t *file = baton;
+  *data_available = file->mapped_pos < (apr_off_t)file->mmap->size;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_stream_readline_fn_t for mapped revision files.
+ * Other than the default implementation, this scans the mapped data
+ * directly instead of reading it byte-by-byte. */
+static svn_error_t *
+mapped_readline(void *baton,
+                svn_stringbuf_t **stringbuf,
+                const char *eol,
+                svn_boolean_t *eof,
+                apr_pool_t *pool)
+{
+  svn_fs_fs__revision_file_t *file = baton;
+  apr_size_t eol_len = strlen(eol);
+  const char *start, *end, *p;
+
+  if (file->mapped_pos >= (apr_off_t)file->mmap->size)
+    {
+      *eof = TRUE;
+      *stringbuf = svn_stringbuf_create_empty(pool);
+      return SVN_NO_ERROR;
+    }
+
+  start = (const char *)file->mmap->mm + file->mapped_pos;
+  end = (const char *)file->mmap->mm + file->mmap->size;
+  p = start;
+
+  while ((p = memchr(p, eol[0], end - p)) != NULL)
+    {
+      if ((apr_size_t)(end - p) >= eol_len && !memcmp(p, eol, eol_len))
+        {
+          *eof = FALSE;
+          *stringbuf = svn_stringbuf_ncreate(start, p - start, pool);
+          file->mapped_pos += (p - start) + eol_len;
+
+          return SVN_NO_ERROR;
+        }
+
+      ++p;
+    }
+
+  /* No EOL found.  Return the remainder of the file. */
+  *eof = TRUE;
+  *stringbuf = svn_stringbuf_ncreate(start, end - start, pool);
+  file->mapped_pos = file->mmap->size;
+
+  return SVN_NO_ERROR;
+}
+
+/* If FILE->FILE is suitable for being memory-mapped, map it and replace
+ * FILE->STREAM with a stream reading from that mapping.  Otherwise, leave
+ * FILE unchanged.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+auto_map_file(svn_fs_fs__revision_file_t *file,
+              apr_pool_t *scratch_pool)
+{
+#if APR_HAS_MMAP
+  apr_off_t size;
+  apr_status_t status;
+
+  SVN_ERR(svn_io_file_size_get(&size, file->file, scratch_pool));
+
+  /* Empty files can't be mapped and very large ones should not. */
+  if (size == 0 || size > MAX_MAPPED_SIZE)
+    return SVN_NO_ERROR;
+
+  status = apr_mmap_create(&file->mmap, file->file, 0, (apr_size_t)size,
+                           APR_MMAP_READ, file->pool);
+
+  /* Not being able to map the file is not fatal.  We can still read it
+   * the traditional way. */
+  if (status)
+    {
+      file->mmap = NULL;
+      return SVN_NO_ERROR;
+    }
+
+  file->mapped_pos = 0;
+  file->stream = svn_stream_create(file, file->pool);
+  svn_stream_set_read2(file->stream, mapped_read, mapped_read);
+  svn_stream_set_skip(file->stream, mapped_skip);
+  svn_stream_set_data_available(file->stream, mapped_data_available);
+  svn_stream_set_readline(file->stream, mapped_readline);
+#endif
+
+  return SVN_NO_ERROR;
+}
+
 /* Core implementation of svn_fs_fs__open_pack_or_rev_file working on an
  * existing, initialized FILE structure.  If WRITABLE is TRUE, give write
  * access to the file - temporarily resetting the r/o state if necessary.
@@ -160,6 +299,11 @@ open_pack_or_rev_file(svn_fs_fs__revision_file_t *file,
                                                   result_pool);
           file->is_packed = svn_fs_fs__is_packed_rev(fs, rev);
 
+          /* Mapping files that we are going to modify may cause
+           * access violations when they shrink. */
+          if (ffd->use_mmap && !writable)
+            SVN_ERR(auto_map_file(file, scratch_pool));
+
           return SVN_NO_ERROR;
         }
 
@@ -237,22 +381,23 @@ svn_fs_fs__auto_read_footer(svn_fs_fs__revision_file_t *file)
       svn_stringbuf_t *footer;
 
       /* Determine file size. */
-      SVN_ERR(svn_io_file_seek(file->file, APR_END, &filesize, file->pool));
+      if (file->mmap)
+        filesize = (apr_off_t)file->mmap->size;
+      else
+        SVN_ERR(svn_io_file_seek(file->file, APR_END, &filesize,
+                                 file->pool));
 
       /* Read last byte (containing the length of the footer). */
-      SVN_ERR(svn_io_file_aligned_seek(file->file, file->block_size, NULL,
-                                       filesize - 1, file->pool));
-      SVN_ERR(svn_io_file_read_full2(file->file, &footer_length,
-                                     sizeof(footer_length), NULL, NULL,
-                                     file->pool));
+      SVN_ERR(svn_fs_fs__rev_file_seek(file, NULL, filesize - 1));
+      SVN_ERR(svn_fs_fs__rev_file_read(file, &footer_length,
+                                       sizeof(footer_length), NULL));
 
       /* Read footer. */
       footer = svn_stringbuf_create_ensure(footer_length, file->pool);
-      SVN_ERR(svn_io_file_aligned_seek(file->file, file->block_size, NULL,
-                                       filesize - 1 - footer_length,
-                                       file->pool));
-      SVN_ERR(svn_io_file_read_full2(file->file, footer->data, footer_length,
-                                     &footer->len, NULL, file->pool));
+      SVN_ERR(svn_fs_fs__rev_file_seek(file, NULL,
+                                       filesize - 1 - footer_length));
+      SVN_ERR(svn_fs_fs__rev_file_read(file, footer->data, footer_length,
+                                       &footer->len));
       footer->data[footer->len] = '\0';
 
       /* Extract index locations. */
@@ -267,6 +412,111 @@ svn_fs_fs__auto_read_footer(svn_fs_fs__revision_file_t *file)
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_fs_fs__rev_file_seek(svn_fs_fs__revision_file_t *file,
+                         apr_off_t *buffer_start,
+                         apr_off_t offset)
+{
+  if (file->mmap)
+    {
+      file->mapped_pos = offset;
+      if (buffer_start)
+        *buffer_start = offset - (offset % file->block_size);
+
+      return SVN_NO_ERROR;
+    }
+
+  return svn_error_trace(svn_io_file_aligned_seek(file->file,
+                                                  file->block_size,
+                                                  buffer_start, offset,
+                                                  file->pool));
+}
+
+svn_error_t *
+svn_fs_fs__rev_file_prefetch(svn_fs_fs__revision_file_t *file,
+                             apr_off_t offset,
+                             apr_off_t length)
+{
+  apr_off_t end = offset + length;
+
+  /* Sequential traversals will request overlapping ranges over and over.
+   * Only hint those parts that are new.  Any other range, e.g. after a
+   * backward seek, starts a new prefetched section. */
+  if (offset >= file->prefetched_start && offset < file->prefetched_end)
+    offset = file->prefetched_end;
+  else
+    file->prefetched_start = offset;
+
+  if (offset < end)
+    {
+      svn_io__file_prefetch(file->file, offset, end - offset);
+      file->prefetched_end = end;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__rev_file_offset(apr_off_t *offset,
+                           svn_fs_fs__revision_file_t *file)
+{
+  if (file->mmap)
+    {
+      *offset = file->mapped_pos;
+      return SVN_NO_ERROR;
+    }
+
+  return svn_error_trace(svn_io_file_get_offset(offset, file->file,
+                                                file->pool));
+}
+
+svn_error_t *
+svn_fs_fs__rev_file_read(svn_fs_fs__revision_file_t *file,
+                         void *buf,
+                         apr_size_t nbytes,
+                         apr_size_t *bytes_read)
+{
+  if (file->mmap)
+    {
+      apr_size_t len = nbytes;
+      SVN_ERR(mapped_read(file, buf, &len));
+
+      if (bytes_read)
+        *bytes_read = len;
+      else if (len < nbytes)
+        return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                                _("Unexpected end of revision file"));
+
+      return SVN_NO_ERROR;
+    }
+
+  return svn_error_trace(svn_io_file_read_full2(file->file, buf, nbytes,
+                                                bytes_read, NULL,
+                                                file->pool));
+}
+
+svn_error_t *
+svn_fs_fs__rev_file_get_mapped(const char **data,
+                               svn_fs_fs__revision_file_t *file,
+                               apr_size_t nbytes)
+{
+  if (file->mmap == NULL)
+    {
+      *data = NULL;
+      return SVN_NO_ERROR;
+    }
+
+  if (   file->mapped_pos > (apr_off_t)file->mmap->size
+      || nbytes > file->mmap->size - (apr_size_t)file->mapped_pos)
+    return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                            _("Unexpected end of revision file"));
+
+  *data = (const char *)file->mmap->mm + file->mapped_pos;
+  file->mapped_pos += nbytes;
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_fs_fs__open_proto_rev_file(svn_fs_fs__revision_file_t **file,
                                svn_fs_t *fs,
@@ -274,6 +524,7 @@ svn_fs_fs__open_proto_rev_file(svn_fs_fs__revision_file_t **file,
                                apr_pool_t* result_pool,
                                apr_pool_t *scratch_pool)
 {
+  fs_fs_data_t *ffd = fs->fsap_data;
   apr_file_t *apr_file;
   SVN_ERR(svn_io_file_open(&apr_file,
                            svn_fs_fs__path_txn_proto_rev(fs, txn_id,
@@ -286,6 +537,8 @@ svn_fs_fs__open_proto_rev_file(svn_fs_fs__revision_file_t **file,
   (*file)->is_packed = FALSE;
   (*file)->start_revision = SVN_INVALID_REVNUM;
   (*file)->stream = svn_stream_from_aprfile2(apr_file, TRUE, result_pool);
+  (*file)->block_size = ffd->block_size;
+  (*file)->pool = result_pool;
 
   return SVN_NO_ERROR;
 }
@@ -295,11 +548,20 @@ svn_fs_fs__close_revision_file(svn_fs_fs__revision_file_t *file)
 {
   if (file->stream)
     SVN_ERR(svn_stream_close(file->stream));
+#if APR_HAS_MMAP
+  if (file->mmap)
+    {
+      apr_status_t status = apr_mmap_delete(file->mmap);
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't unmap revision file"));
+    }
+#endif
   if (file->file)
     SVN_ERR(svn_io_file_close(file->file, file->pool));
 
   file->file = NULL;
   file->stream = NULL;
+  file->mmap = NULL;
   file->l2p_stream = NULL;
   file->p2l_stream = NULL;
 
@@ -23,6 +23,8 @@
 #ifndef SVN_LIBSVN_FS__REV_FILE_H
 #define SVN_LIBSVN_FS__REV_FILE_H
 
+#include <apr_mmap.h>
+
 #include "svn_fs.h"
 #include "id.h"
 
@@ -54,9 +56,18 @@ typedef struct svn_fs_fs__revision_file_t
   /* rev / pack file */
   apr_file_t *file;
 
-  /* stream based on FILE and not NULL exactly when FILE is not NULL */
+  /* stream based on FILE and not NULL exactly when FILE is not NULL.
+   * If MMAP is not NULL, this reads from the mapped data instead and
+   * callers must position it using svn_fs_fs__rev_file_seek. */
   svn_stream_t *stream;
 
+  /* read-only mapping of the whole FILE or NULL if FILE has not been
+   * mapped into memory. */
+  apr_mmap_t *mmap;
+
+  /* current read position within MMAP.  Only used if MMAP is not NULL. */
+  apr_off_t mapped_pos;
+
   /* the opened P2L index stream or NULL.  Always NULL for txns. */
   svn_fs_fs__packed_number_stream_t *p2l_stream;
 
@@ -90,6 +101,11 @@ typedef struct svn_fs_fs__revision_file_t
    * been called, yet. */
   apr_off_t footer_offset;
 
+  /* Data range that svn_fs_fs__rev_file_prefetch has most recently asked
+   * the OS to read ahead.  Both are 0 if nothing has been prefetched yet. */
+  apr_off_t prefetched_start;
+  apr_off_t prefetched_end;
+
   /* pool containing this object */
   apr_pool_t *pool;
 } svn_fs_fs__revision_file_t;
@@ -128,6 +144,52 @@ svn_fs_fs__open_pack_or_rev_file_writable(svn_fs_fs__revision_file_t **file,
 svn_error_t *
 svn_fs_fs__auto_read_footer(svn_fs_fs__revision_file_t *file);
 
+/* Set the read position in FILE to OFFSET, using aligned block reads for
+ * non-mapped files.  If BUFFER_START is not NULL, return the start of the
+ * block containing OFFSET in *BUFFER_START.
+ */
+svn_error_t *
+svn_fs_fs__rev_file_seek(svn_fs_fs__revision_file_t *file,
+                         apr_off_t *buffer_start,
+                         apr_off_t offset);
+
+/* Set *OFFSET to the current read position in FILE.
+ */
+svn_error_t *
+svn_fs_fs__rev_file_offset(apr_off_t *offset,
+                           svn_fs_fs__revision_file_t *file);
+
+/* Read up to NBYTES from the current position in FILE into BUF.  Set
+ * *BYTES_READ to the number of bytes actually read.  If BYTES_READ is
+ * NULL, reading less than NBYTES is an error, just like with
+ * svn_io_file_read_full2.
+ */
+svn_error_t *
+svn_fs_fs__rev_file_read(svn_fs_fs__revision_file_t *file,
+                         void *buf,
+                         apr_size_t nbytes,
+                         apr_size_t *bytes_read);
+
+/* If FILE has been mapped into memory, set *DATA to the NBYTES starting
+ * at the current read position and advance that position, without copying
+ * the data.  *DATA remains valid until FILE gets closed.  Otherwise, set
+ * *DATA to NULL and leave the read position untouched.  Reading beyond the
+ * end of FILE is an error.
+ */
+svn_error_t *
+svn_fs_fs__rev_file_get_mapped(const char **data,
+                               svn_fs_fs__revision_file_t *file,
+                               apr_size_t nbytes);
+
+/* Hint the OS to read the LENGTH bytes of FILE starting at OFFSET in the
+ * background.  Parts of that range that continue the most recently
+ * prefetched one and have already been hinted will be skipped.
+ */
+svn_error_t *
+svn_fs_fs__rev_file_prefetch(svn_fs_fs__revision_file_t *file,
+                             apr_off_t offset,
+                             apr_off_t length);
+
 /* Open the proto-rev file of transaction TXN_ID in FS and return it in *FILE.
  * Allocate *FILE in RESULT_POOL use and SCRATCH_POOL for temporaries.. */
 svn_error_t *
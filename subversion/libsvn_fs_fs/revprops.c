@@ -32,6 +32,7 @@
 #include "temp_serializer.h"
 #include "util.h"
 
+#include "private/svn_fs_util.h"
 #include "private/svn_subr_private.h"
 #include "private/svn_string_private.h"
 #include "../libsvn_fs/fs-loader.h"
@@ -1437,6 +1438,7 @@ svn_fs_fs__pack_revprops_shard(const char *pack_file_dir,
   apr_size_t total_size;
   apr_pool_t *iterpool = svn_pool_create(scratch_pool);
   apr_array_header_t *sizes;
+  apr_array_header_t *pack_filenames;
 
   /* Sanitize config file values. */
   apr_size_t max_size = (apr_size_t)MIN(MAX(max_pack_size, 1),
@@ -1472,6 +1474,9 @@ svn_fs_fs__pack_revprops_shard(const char *pack_file_dir,
   sizes = apr_array_make(scratch_pool, max_files_per_dir, sizeof(apr_size_t));
   total_size = 2 * SVN_INT64_BUFFER_SIZE;
 
+  /* The pack files written so far.  We flush them to disk in one go. */
+  pack_filenames = apr_array_make(scratch_pool, 4, sizeof(const char *));
+
   /* Iterate over the revisions in this shard, determine their size and
    * squashing them together into pack files. */
   for (rev = start_rev; rev <= end_rev; rev++)
@@ -1497,7 +1502,7 @@ svn_fs_fs__pack_revprops_shard(const char *pack_file_dir,
           SVN_ERR(svn_fs_fs__copy_revprops(pack_file_dir, pack_filename,
                                            shard_path, start_rev, rev-1,
                                            sizes, total_size,
-                                           compression_level, flush_to_disk,
+                                           compression_level, FALSE,
                                            cancel_func, cancel_baton,
                                            iterpool));
 
@@ -1510,7 +1515,10 @@ svn_fs_fs__pack_revprops_shard(const char *pack_file_dir,
       /* Update the manifest. Allocate a file name for the current pack
        * file if it is a new one */
       if (sizes->nelts == 0)
-        pack_filename = apr_psprintf(scratch_pool, "%ld.0", rev);
+        {
+          pack_filename = apr_psprintf(scratch_pool, "%ld.0", rev);
+          APR_ARRAY_PUSH(pack_filenames, const char *) = pack_filename;
+        }
 
       SVN_ERR(svn_stream_printf(manifest_stream, iterpool, "%s\n",
                                 pack_filename));
@@ -1525,14 +1533,37 @@ svn_fs_fs__pack_revprops_shard(const char *pack_file_dir,
     SVN_ERR(svn_fs_fs__copy_revprops(pack_file_dir, pack_filename,
                                      shard_path, start_rev, rev-1,
                                      sizes, (apr_size_t)total_size,
-                                     compression_level, flush_to_disk,
+                                     compression_level, FALSE,
                                      cancel_func, cancel_baton, iterpool));
 
-  /* flush the manifest file to disk and update permissions */
+  /* flush the manifest and all pack files to disk and update permissions */
   SVN_ERR(svn_stream_close(manifest_stream));
-  if (flush_to_disk)
-    SVN_ERR(svn_io_file_flush_to_disk(manifest_file, iterpool));
   SVN_ERR(svn_io_file_close(manifest_file, iterpool));
+
+  if (flush_to_disk)
+    {
+      svn_fs__batch_fsync_t *batch;
+      apr_file_t *file;
+      int i;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs__batch_fsync_create(&batch, TRUE, iterpool));
+      SVN_ERR(svn_fs__batch_fsync_open_file(&file, batch,
+                                            manifest_file_path,
+                                            iterpool));
+      SVN_ERR(svn_fs__batch_fsync_new_path(batch, manifest_file_path,
+                                           iterpool));
+
+      for (i = 0; i < pack_filenames->nelts; ++i)
+        SVN_ERR(svn_fs__batch_fsync_open_file(&file, batch,
+                       svn_dirent_join(pack_file_dir,
+                                       APR_ARRAY_IDX(pack_filenames, i,
+                                                     const char *),
+                                       iterpool),
+                       iterpool));
+
+      SVN_ERR(svn_fs__batch_fsync_run(batch, iterpool));
+    }
   SVN_ERR(svn_io_copy_perms(shard_path, pack_file_dir, iterpool));
 
   svn_pool_destroy(iterpool);
@@ -189,6 +189,10 @@ typedef struct query_t
    * Used as a dummy base for DELTA reps without base. */
   rep_stats_t *null_base;
 
+  /* svn_fs_fs__id_part_t of all chunks seen so far -> query_t.
+   * Used to tell new chunks from shared ones. */
+  apr_hash_t *chunks;
+
   /* collected statistics */
   svn_fs_fs__stats_t *stats;
 
@@ -462,8 +466,8 @@ parse_representation(rep_stats_t **representation,
                            + (apr_off_t)rep->item_index;
 
           SVN_ERR_ASSERT(revision_info->rev_file);
-          SVN_ERR(svn_io_file_seek(revision_info->rev_file->file, APR_SET,
-                                   &offset, scratch_pool));
+          SVN_ERR(svn_fs_fs__rev_file_seek(revision_info->rev_file, NULL,
+                                           offset));
           SVN_ERR(svn_fs_fs__read_rep_header(&header,
                                              revision_info->rev_file->stream,
                                              scratch_pool, scratch_pool));
@@ -530,8 +534,7 @@ read_phsy_noderev(svn_stringbuf_t **noderev,
   SVN_ERR_ASSERT(revision_info->rev_file);
 
   offset += revision_info->offset;
-  SVN_ERR(svn_io_file_seek(revision_info->rev_file->file, APR_SET,
-                           &offset, scratch_pool));
+  SVN_ERR(svn_fs_fs__rev_file_seek(revision_info->rev_file, NULL, offset));
 
   /* Read it (terminated by an empty line) */
   do
@@ -924,6 +927,66 @@ read_item(svn_stringbuf_t **contents,
   return SVN_NO_ERROR;
 }
 
+/* Update the content chunking statistics in QUERY with the chunked
+ * representation that has been read from REV_FILE, described by ENTRY and
+ * starting with HEADER.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+read_chunked_rep(query_t *query,
+                 svn_fs_fs__revision_file_t *rev_file,
+                 svn_fs_fs__p2l_entry_t *entry,
+                 svn_fs_fs__rep_header_t *header,
+                 apr_pool_t *scratch_pool)
+{
+  svn_fs_fs__chunking_stats_t *stats = &query->stats->chunking_stats;
+  apr_pool_t *hash_pool = apr_hash_pool_get(query->chunks);
+  apr_size_t footer_size = sizeof("ENDREP\n") - 1;
+  svn_stringbuf_t *item;
+  apr_array_header_t *chunks;
+  int i;
+
+  /* Extract the chunk list between header and "ENDREP". */
+  SVN_ERR(read_item(&item, rev_file, entry, scratch_pool, scratch_pool));
+  if (item->len < header->header_size + footer_size)
+    return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                             _("Malformed chunked representation in r%ld"),
+                             entry->item.revision);
+
+  svn_stringbuf_remove(item, 0, header->header_size);
+  svn_stringbuf_chop(item, footer_size);
+  SVN_ERR(svn_fs_fs__parse_chunk_list(&chunks, item, scratch_pool,
+                                      scratch_pool));
+
+  stats->rep_count++;
+  for (i = 0; i < chunks->nelts; ++i)
+    {
+      representation_t *chunk = APR_ARRAY_IDX(chunks, i, representation_t *);
+      svn_fs_fs__id_part_t key;
+
+      memset(&key, 0, sizeof(key));
+      key.revision = SVN_IS_VALID_REVNUM(chunk->revision)
+                   ? chunk->revision
+                   : entry->item.revision;
+      key.number = chunk->item_index;
+
+      stats->chunk_refs++;
+      stats->expanded_size += chunk->expanded_size;
+
+      if (apr_hash_get(query->chunks, &key, sizeof(key)) == NULL)
+        {
+          apr_hash_set(query->chunks,
+                       apr_pmemdup(hash_pool, &key, sizeof(key)),
+                       sizeof(key), query);
+
+          stats->chunk_count++;
+          stats->chunk_expanded_size += chunk->expanded_size;
+          stats->chunk_size += chunk->size;
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /* Predicate comparing the two rep_ref_t** LHS and RHS by the respective
  * representation's revision.
  */
@@ -1094,10 +1157,8 @@ read_log_rev_or_packfile(query_t *query,
               svn_fs_fs__rep_header_t *header;
               rep_ref_t *ref = apr_pcalloc(scratch_pool, sizeof(*ref));
 
-              SVN_ERR(svn_io_file_aligned_seek(rev_file->file,
-                                               rev_file->block_size,
-                                               NULL, entry->offset,
-                                               iterpool));
+              SVN_ERR(svn_fs_fs__rev_file_seek(rev_file, NULL,
+                                               entry->offset));
               SVN_ERR(svn_fs_fs__read_rep_header(&header,
                                                  rev_file->stream,
                                                  iterpool, iterpool));
@@ -1106,6 +1167,10 @@ read_log_rev_or_packfile(query_t *query,
               ref->revision = entry->item.revision;
               ref->item_index = entry->item.number;
 
+              if (header->type == svn_fs_fs__rep_chunked)
+                SVN_ERR(read_chunked_rep(query, rev_file, entry, header,
+                                         iterpool));
+
               if (header->type == svn_fs_fs__rep_delta)
                 {
                   ref->base_item_index = header->base_item_index;
@@ -1364,6 +1429,7 @@ create_query(query_t **query,
                                        sizeof(revision_info_t *));
   (*query)->null_base = apr_pcalloc(result_pool,
                                     sizeof(*(*query)->null_base));
+  (*query)->chunks = apr_hash_make(result_pool);
 
   /* Store other parameters */
   (*query)->fs = fs;
@@ -787,6 +787,85 @@ svn_fs_fs__deserialize_node_revision(void **item,
   return SVN_NO_ERROR;
 }
 
+/* Auxiliary structure representing the block index of a "BLOCKED"
+   directory, i.e. the contents of an array of svn_fs_fs__dir_block_t.
+ */
+typedef struct dir_index_data_t
+{
+  /* number of blocks */
+  int count;
+
+  /* COUNT blocks, sorted by their FIRST_NAME */
+  svn_fs_fs__dir_block_t *blocks;
+} dir_index_data_t;
+
+svn_error_t *
+svn_fs_fs__serialize_dir_index(void **data,
+                               apr_size_t *data_len,
+                               void *in,
+                               apr_pool_t *pool)
+{
+  apr_array_header_t *blocks = in;
+  dir_index_data_t index_data;
+  svn_temp_serializer__context_t *context;
+  svn_stringbuf_t *serialized;
+  int i;
+
+  index_data.count = blocks->nelts;
+  index_data.blocks = (svn_fs_fs__dir_block_t *)blocks->elts;
+
+  /* serialize it and all its elements */
+  context = svn_temp_serializer__init(&index_data,
+                                      sizeof(index_data),
+                                      blocks->nelts * 100 + 50,
+                                      pool);
+
+  svn_temp_serializer__push(context,
+                            (const void * const *)&index_data.blocks,
+                            index_data.count * sizeof(*index_data.blocks));
+
+  for (i = 0; i < index_data.count; ++i)
+    svn_temp_serializer__add_string(context,
+                                    &index_data.blocks[i].first_name);
+
+  svn_temp_serializer__pop(context);
+
+  /* return the serialized result */
+  serialized = svn_temp_serializer__get(context);
+
+  *data = serialized->data;
+  *data_len = serialized->len;
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__deserialize_dir_index(void **out,
+                                 void *data,
+                                 apr_size_t data_len,
+                                 apr_pool_t *pool)
+{
+  dir_index_data_t *index_data = (dir_index_data_t *)data;
+  apr_array_header_t *blocks
+    = apr_array_make(pool, 1, sizeof(svn_fs_fs__dir_block_t));
+  int i;
+
+  /* de-serialize our auxiliary data structure */
+  svn_temp_deserializer__resolve(index_data, (void**)&index_data->blocks);
+  for (i = 0; i < index_data->count; ++i)
+    svn_temp_deserializer__resolve(index_data->blocks,
+                            (void**)&index_data->blocks[i].first_name);
+
+  /* wrap it into an array without copying */
+  blocks->nelts = index_data->count;
+  blocks->nalloc = index_data->count;
+  blocks->elts = (char*)index_data->blocks;
+
+  *out = blocks;
+
+  return SVN_NO_ERROR;
+}
+
 /* Utility function that returns the directory serialized inside CONTEXT
  * to DATA and DATA_LEN.  If OVERPROVISION is set, allocate some extra
  * room for future in-place changes by svn_fs_fs__replace_dir_entry. */
@@ -981,6 +1060,45 @@ svn_fs_fs__extract_dir_entry(void **out,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_fs_fs__extract_dir_block(void **out,
+                             const void *data,
+                             apr_size_t data_len,
+                             void *baton,
+                             apr_pool_t *pool)
+{
+  const dir_index_data_t *index_data = data;
+  const char *name = baton;
+  int lower = 0;
+  int upper = index_data->count;
+
+  /* resolve the reference to the blocks array */
+  const svn_fs_fs__dir_block_t *blocks =
+    svn_temp_deserializer__ptr(data,
+                               (const void *const *)&index_data->blocks);
+
+  /* binary search for the last block starting at or before NAME */
+  while (lower < upper)
+    {
+      int middle = lower + (upper - lower) / 2;
+      const char *first_name =
+        svn_temp_deserializer__ptr(blocks,
+                     (const void *const *)&blocks[middle].first_name);
+
+      if (strcmp(first_name, name) <= 0)
+        lower = middle + 1;
+      else
+        upper = middle;
+    }
+
+  /* NAME sorting before the first block cannot be in the directory. */
+  *out = lower > 0 ? apr_pmemdup(pool, &blocks[lower - 1].rep,
+                                 sizeof(blocks[lower - 1].rep))
+                   : NULL;
+
+  return SVN_NO_ERROR;
+}
+
 /* Utility function for svn_fs_fs__replace_dir_entry that implements the
  * modification as a simply deserialize / modify / serialize sequence.
  */
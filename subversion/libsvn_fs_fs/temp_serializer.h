@@ -300,6 +300,21 @@ svn_fs_fs__extract_dir_entry(void **out,
                              void *baton,
                              apr_pool_t *pool);
 
+/**
+ * Implements #svn_cache__partial_getter_func_t for the block index of a
+ * "BLOCKED" directory, i.e. an array of #svn_fs_fs__dir_block_t.  Set
+ * (representation_t *) @a *out to a copy, allocated in @a pool, of the
+ * rep of the block that may contain the entry whose name is the
+ * (const char *) @a baton, or to NULL if that name sorts before the
+ * first block.
+ */
+svn_error_t *
+svn_fs_fs__extract_dir_block(void **out,
+                             const void *data,
+                             apr_size_t data_len,
+                             void *baton,
+                             apr_pool_t *pool);
+
 /**
  * Describes the change to be done to a directory: Set the entry
  * identify by @a name to the value @a new_entry. If the latter is
@@ -344,6 +359,26 @@ svn_fs_fs__reset_txn_filesize(void **data,
                               void *baton,
                               apr_pool_t *pool);
 
+/**
+ * Implements #svn_cache__serialize_func_t for the block index of a
+ * "BLOCKED" directory, i.e. an array of #svn_fs_fs__dir_block_t.
+ */
+svn_error_t *
+svn_fs_fs__serialize_dir_index(void **data,
+                               apr_size_t *data_len,
+                               void *in,
+                               apr_pool_t *pool);
+
+/**
+ * Implements #svn_cache__deserialize_func_t for the block index of a
+ * "BLOCKED" directory, i.e. an array of #svn_fs_fs__dir_block_t.
+ */
+svn_error_t *
+svn_fs_fs__deserialize_dir_index(void **out,
+                                 void *data,
+                                 apr_size_t data_len,
+                                 apr_pool_t *pool);
+
 /**
  * Implements #svn_cache__serialize_func_t for a #svn_fs_fs__rep_header_t.
  */
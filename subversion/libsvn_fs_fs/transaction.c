@@ -41,8 +41,10 @@
 #include "temp_serializer.h"
 #include "cached_data.h"
 #include "lock.h"
+#include "path-index.h"
 #include "rep-cache.h"
 
+#include "private/svn_delta_private.h"
 #include "private/svn_fs_util.h"
 #include "private/svn_fspath.h"
 #include "private/svn_sorts_private.h"
@@ -97,6 +99,15 @@ path_txn_next_ids(svn_fs_t *fs,
                          PATH_NEXT_IDS, pool);
 }
 
+static APR_INLINE const char *
+path_txn_chunks(svn_fs_t *fs,
+                const svn_fs_fs__id_part_t *txn_id,
+                apr_pool_t *pool)
+{
+  return svn_dirent_join(svn_fs_fs__path_txn_dir(fs, txn_id, pool),
+                         PATH_TXN_CHUNKS, pool);
+}
+
 
 /* The vtable associated with an open transaction object. */
 static txn_vtable_t txn_vtable = {
@@ -531,32 +542,30 @@ svn_fs_fs__put_node_revision(svn_fs_t *fs,
   return SVN_NO_ERROR;
 }
 
-/* For the in-transaction NODEREV within FS, write the sha1->rep mapping
- * file in the respective transaction, if rep sharing has been enabled etc.
+/* For the in-transaction representation REP within FS, write the
+ * sha1->rep mapping file in the respective transaction, if rep sharing
+ * has been enabled etc.  MUTABLE_REP_TRUNCATED is passed through to
+ * svn_fs_fs__unparse_representation().
  * Use SCATCH_POOL for temporary allocations.
  */
 static svn_error_t *
-store_sha1_rep_mapping(svn_fs_t *fs,
-                       node_revision_t *noderev,
-                       apr_pool_t *scratch_pool)
+store_sha1_mapping(svn_fs_t *fs,
+                   representation_t *rep,
+                   svn_boolean_t mutable_rep_truncated,
+                   apr_pool_t *scratch_pool)
 {
   fs_fs_data_t *ffd = fs->fsap_data;
 
-  /* if rep sharing has been enabled and the noderev has a data rep and
-   * its SHA-1 is known, store the rep struct under its SHA1. */
-  if (   ffd->rep_sharing_allowed
-      && noderev->data_rep
-      && noderev->data_rep->has_sha1)
+  /* if rep sharing has been enabled and the SHA-1 of the rep is known,
+   * store the rep struct under its SHA1. */
+  if (ffd->rep_sharing_allowed && rep->has_sha1)
     {
       apr_file_t *rep_file;
-      const char *file_name = path_txn_sha1(fs,
-                                            &noderev->data_rep->txn_id,
-                                            noderev->data_rep->sha1_digest,
-                                            scratch_pool);
+      const char *file_name = path_txn_sha1(fs, &rep->txn_id,
+                                            rep->sha1_digest, scratch_pool);
       svn_stringbuf_t *rep_string
-        = svn_fs_fs__unparse_representation(noderev->data_rep,
-                                            ffd->format,
-                                            (noderev->kind == svn_node_dir),
+        = svn_fs_fs__unparse_representation(rep, ffd->format,
+                                            mutable_rep_truncated,
                                             scratch_pool, scratch_pool);
       SVN_ERR(svn_io_file_open(&rep_file, file_name,
                                APR_WRITE | APR_CREATE | APR_TRUNCATE
@@ -571,6 +580,23 @@ store_sha1_rep_mapping(svn_fs_t *fs,
   return SVN_NO_ERROR;
 }
 
+/* For the in-transaction NODEREV within FS, write the sha1->rep mapping
+ * file in the respective transaction, if rep sharing has been enabled etc.
+ * Use SCATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+store_sha1_rep_mapping(svn_fs_t *fs,
+                       node_revision_t *noderev,
+                       apr_pool_t *scratch_pool)
+{
+  if (noderev->data_rep)
+    SVN_ERR(store_sha1_mapping(fs, noderev->data_rep,
+                               (noderev->kind == svn_node_dir),
+                               scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *
 unparse_dir_entry(svn_fs_dirent_t *dirent,
                   svn_stream_t *stream,
@@ -1935,12 +1961,33 @@ struct rep_write_baton
      writing to it. */
   void *lockcookie;
 
-  svn_checksum_ctx_t *md5_checksum_ctx;
-  svn_checksum_ctx_t *sha1_checksum_ctx;
+  /* MD5 and SHA1 of the contents, calculated in a single pass. */
+  svn_checksum__multi_ctx_t *checksum_ctx;
 
   /* calculate a modified FNV-1a checksum of the on-disk representation */
   svn_checksum_ctx_t *fnv1a_checksum_ctx;
 
+  /* If not NULL, neither the rep header nor DELTA_STREAM have been written
+     or created, yet, and the contents are being collected here until we
+     know whether they are large enough for content chunking. */
+  svn_spillbuf_t *pending;
+
+  /* If not NULL, the contents get split into chunks and this collects
+     the data of the current one.  See chunk_contents(). */
+  svn_stringbuf_t *chunk;
+
+  /* Rolling hash over the last 32 bytes of CHUNK. */
+  apr_uint32_t chunk_hash;
+
+  /* Random values per byte value used to calculate CHUNK_HASH. */
+  apr_uint32_t *chunk_gear;
+
+  /* The representation_t * of all chunks written so far. */
+  apr_array_header_t *chunks;
+
+  /* Cleared for every chunk written. */
+  apr_pool_t *chunk_pool;
+
   /* Local / scratch pool, available for temporary allocations. */
   apr_pool_t *scratch_pool;
 
@@ -1948,6 +1995,26 @@ struct rep_write_baton
   apr_pool_t *result_pool;
 };
 
+/* Chunks of content-chunked representations shall be at least that large,
+   except for the last one. */
+#define CHUNK_MIN_SIZE 0x4000
+
+/* Chunks of content-chunked representations must not be larger than this. */
+#define CHUNK_MAX_SIZE 0x40000
+
+/* Cut a chunk after the first byte at which the rolling hash has all these
+   bits cleared.  That gives an average chunk size of CHUNK_MIN_SIZE + 64k. */
+#define CHUNK_HASH_MASK 0xffff0000
+
+/* Contents of up to that size are buffered in memory while we decide
+   whether to chunk them.  Anything beyond will spill to a temp. file. */
+#define CHUNK_PENDING_MEMORY 0x100000
+
+static svn_error_t *
+chunk_contents(struct rep_write_baton *b,
+               const char *data,
+               apr_size_t len);
+
 /* Handler for the write method of the representation writable stream.
    BATON is a rep_write_baton, DATA is the data to write, and *LEN is
    the length of this data. */
@@ -1958,10 +2025,44 @@ rep_write_contents(void *baton,
 {
   struct rep_write_baton *b = baton;
 
-  SVN_ERR(svn_checksum_update(b->md5_checksum_ctx, data, *len));
-  SVN_ERR(svn_checksum_update(b->sha1_checksum_ctx, data, *len));
+  SVN_ERR(svn_checksum__multi_update(b->checksum_ctx, data, *len));
   b->rep_size += *len;
 
+  /* Large contents may be stored in chunks. */
+  if (b->chunk)
+    return svn_error_trace(chunk_contents(b, data, *len));
+
+  if (b->pending)
+    {
+      fs_fs_data_t *ffd = b->fs->fsap_data;
+
+      SVN_ERR(svn_spillbuf__write(b->pending, data, *len, b->scratch_pool));
+      if (b->rep_size < ffd->content_chunking_threshold)
+        return SVN_NO_ERROR;
+
+      /* Large enough.  Chunk everything received so far. */
+      b->chunk = svn_stringbuf_create_ensure(CHUNK_MAX_SIZE, b->result_pool);
+      b->chunks = apr_array_make(b->result_pool, 16,
+                                 sizeof(representation_t *));
+      b->chunk_pool = svn_pool_create(b->scratch_pool);
+
+      while (TRUE)
+        {
+          const char *pending_data;
+          apr_size_t pending_len;
+
+          SVN_ERR(svn_spillbuf__read(&pending_data, &pending_len, b->pending,
+                                     b->scratch_pool));
+          if (pending_data == NULL)
+            break;
+
+          SVN_ERR(chunk_contents(b, pending_data, pending_len));
+        }
+
+      b->pending = NULL;
+      return SVN_NO_ERROR;
+    }
+
   /* If we are writing a delta, use that stream. */
   if (b->delta_stream)
     return svn_stream_write(b->delta_stream, data, len);
@@ -2159,6 +2260,26 @@ rep_write_cleanup(void *data)
   return APR_SUCCESS;
 }
 
+/* Return the svndiff version to use for new representations in FS. */
+static int
+get_svndiff_version(svn_fs_t *fs)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+
+  if (ffd->delta_compression_type == compression_type_lz4)
+    {
+      SVN_ERR_ASSERT_NO_RETURN(ffd->format >= SVN_FS_FS__MIN_SVNDIFF2_FORMAT);
+      return 2;
+    }
+  else if (ffd->delta_compression_type == compression_type_zlib)
+    {
+      SVN_ERR_ASSERT_NO_RETURN(ffd->format >= SVN_FS_FS__MIN_SVNDIFF1_FORMAT);
+      return 1;
+    }
+
+  return 0;
+}
+
 static void
 txdelta_to_svndiff(svn_txdelta_window_handler_t *handler,
                    void **handler_baton,
@@ -2167,25 +2288,81 @@ txdelta_to_svndiff(svn_txdelta_window_handler_t *handler,
                    apr_pool_t *pool)
 {
   fs_fs_data_t *ffd = fs->fsap_data;
-  int svndiff_version;
 
-  if (ffd->delta_compression_type == compression_type_lz4)
+  svn_txdelta_to_svndiff3(handler, handler_baton, output,
+                          get_svndiff_version(fs),
+                          ffd->delta_compression_level, pool);
+}
+
+/* Choose the delta base for the representation being written by B, write
+   the rep header and set up B->DELTA_STREAM. */
+static svn_error_t *
+rep_write_start(struct rep_write_baton *b)
+{
+  svn_fs_t *fs = b->fs;
+  fs_fs_data_t *ffd = fs->fsap_data;
+  representation_t *base_rep;
+  svn_stream_t *source;
+  svn_fs_fs__rep_header_t header = { 0 };
+
+  /* Get the base for this delta. */
+  SVN_ERR(choose_delta_base(&base_rep, fs, b->noderev, FALSE,
+                            b->scratch_pool));
+  SVN_ERR(svn_fs_fs__get_contents(&source, fs, base_rep, TRUE,
+                                  b->scratch_pool));
+
+  /* Write out the rep header. */
+  if (base_rep)
     {
-      SVN_ERR_ASSERT_NO_RETURN(ffd->format >= SVN_FS_FS__MIN_SVNDIFF2_FORMAT);
-      svndiff_version = 2;
+      header.base_revision = base_rep->revision;
+      header.base_item_index = base_rep->item_index;
+      header.base_length = base_rep->size;
+      header.type = svn_fs_fs__rep_delta;
+
+      /* Big files shall be matched against the whole delta base. */
+      header.large_window
+        =    ffd->large_window_threshold
+          && (base_rep->expanded_size ? base_rep->expanded_size
+                                      : base_rep->size)
+             >= ffd->large_window_threshold;
     }
-  else if (ffd->delta_compression_type == compression_type_zlib)
+  else
     {
-      SVN_ERR_ASSERT_NO_RETURN(ffd->format >= SVN_FS_FS__MIN_SVNDIFF1_FORMAT);
-      svndiff_version = 1;
+      header.type = svn_fs_fs__rep_self_delta;
+    }
+  SVN_ERR(svn_fs_fs__write_rep_header(&header, b->rep_stream,
+                                      b->scratch_pool));
+
+  /* Now determine the offset of the actual svndiff data. */
+  SVN_ERR(svn_io_file_get_offset(&b->delta_start, b->file,
+                                 b->scratch_pool));
+
+  /* Prepare to write the svndiff data. */
+  if (header.large_window)
+    {
+      svn_stream_t *index_source;
+      svn_txdelta_window_handler_t wh;
+      void *whb;
+
+      txdelta_to_svndiff(&wh, &whb, b->rep_stream, fs, b->result_pool);
+      SVN_ERR(svn_fs_fs__get_contents(&index_source, fs, base_rep, TRUE,
+                                      b->scratch_pool));
+      SVN_ERR(svn_txdelta__target_push_large(&b->delta_stream, wh, whb,
+                                             index_source, source,
+                                             b->scratch_pool));
+      SVN_ERR(svn_stream_close(index_source));
     }
   else
     {
-      svndiff_version = 0;
+      /* Compute and compress consecutive windows in parallel. */
+      SVN_ERR(svn_txdelta__target_push_pipelined(&b->delta_stream,
+                                                 b->rep_stream,
+                                                 get_svndiff_version(fs),
+                                                 ffd->delta_compression_level,
+                                                 source, b->scratch_pool));
     }
 
-  svn_txdelta_to_svndiff3(handler, handler_baton, output, svndiff_version,
-                          ffd->delta_compression_level, pool);
+  return SVN_NO_ERROR;
 }
 
 /* Get a rep_write_baton and store it in *WB_P for the representation
@@ -2198,18 +2375,13 @@ rep_write_get_baton(struct rep_write_baton **wb_p,
                     node_revision_t *noderev,
                     apr_pool_t *pool)
 {
+  fs_fs_data_t *ffd = fs->fsap_data;
   struct rep_write_baton *b;
   apr_file_t *file;
-  representation_t *base_rep;
-  svn_stream_t *source;
-  svn_txdelta_window_handler_t wh;
-  void *whb;
-  svn_fs_fs__rep_header_t header = { 0 };
 
   b = apr_pcalloc(pool, sizeof(*b));
 
-  b->sha1_checksum_ctx = svn_checksum_ctx_create(svn_checksum_sha1, pool);
-  b->md5_checksum_ctx = svn_checksum_ctx_create(svn_checksum_md5, pool);
+  b->checksum_ctx = svn_checksum__multi_ctx_create(TRUE, TRUE, pool);
 
   b->fs = fs;
   b->result_pool = pool;
@@ -2230,39 +2402,18 @@ rep_write_get_baton(struct rep_write_baton **wb_p,
 
   SVN_ERR(svn_io_file_get_offset(&b->rep_offset, file, b->scratch_pool));
 
-  /* Get the base for this delta. */
-  SVN_ERR(choose_delta_base(&base_rep, fs, noderev, FALSE, b->scratch_pool));
-  SVN_ERR(svn_fs_fs__get_contents(&source, fs, base_rep, TRUE,
-                                  b->scratch_pool));
-
-  /* Write out the rep header. */
-  if (base_rep)
-    {
-      header.base_revision = base_rep->revision;
-      header.base_item_index = base_rep->item_index;
-      header.base_length = base_rep->size;
-      header.type = svn_fs_fs__rep_delta;
-    }
-  else
-    {
-      header.type = svn_fs_fs__rep_self_delta;
-    }
-  SVN_ERR(svn_fs_fs__write_rep_header(&header, b->rep_stream,
-                                      b->scratch_pool));
-
-  /* Now determine the offset of the actual svndiff data. */
-  SVN_ERR(svn_io_file_get_offset(&b->delta_start, file,
-                                 b->scratch_pool));
-
   /* Cleanup in case something goes wrong. */
   apr_pool_cleanup_register(b->scratch_pool, b, rep_write_cleanup,
                             apr_pool_cleanup_null);
 
-  /* Prepare to write the svndiff data. */
-  txdelta_to_svndiff(&wh, &whb, b->rep_stream, fs, pool);
-
-  b->delta_stream = svn_txdelta_target_push(wh, whb, source,
-                                            b->scratch_pool);
+  /* With content chunking, we can only tell what kind of representation
+     to write once we know how large the contents are. */
+  if (ffd->content_chunking_threshold)
+    b->pending = svn_spillbuf__create(SVN__STREAM_CHUNK_SIZE,
+                                      CHUNK_PENDING_MEMORY,
+                                      b->scratch_pool);
+  else
+    SVN_ERR(rep_write_start(b));
 
   *wb_p = b;
 
@@ -2483,30 +2634,266 @@ get_shared_rep(representation_t **old_rep,
   return SVN_NO_ERROR;
 }
 
-/* Copy the hash sum calculation results from MD5_CTX, SHA1_CTX into REP.
- * SHA1 results are only be set if SHA1_CTX is not NULL.
+/* Copy the hash sum calculation results from CTX into REP.
+ * SHA1 results are only be set if CTX calculated them.
  * Use POOL for allocations.
  */
 static svn_error_t *
 digests_final(representation_t *rep,
-              const svn_checksum_ctx_t *md5_ctx,
-              const svn_checksum_ctx_t *sha1_ctx,
+              const svn_checksum__multi_ctx_t *ctx,
               apr_pool_t *pool)
 {
-  svn_checksum_t *checksum;
-
-  SVN_ERR(svn_checksum_final(&checksum, md5_ctx, pool));
-  memcpy(rep->md5_digest, checksum->digest, svn_checksum_size(checksum));
-  rep->has_sha1 = sha1_ctx != NULL;
+  svn_checksum_t *md5_checksum;
+  svn_checksum_t *sha1_checksum;
+
+  SVN_ERR(svn_checksum__multi_final(&md5_checksum, &sha1_checksum, ctx,
+                                    pool));
+  memcpy(rep->md5_digest, md5_checksum->digest,
+         svn_checksum_size(md5_checksum));
+  rep->has_sha1 = sha1_checksum != NULL;
   if (rep->has_sha1)
+    memcpy(rep->sha1_digest, sha1_checksum->digest,
+           svn_checksum_size(sha1_checksum));
+
+  return SVN_NO_ERROR;
+}
+
+/* Append the in-transaction elements of CHUNKS, i.e. the content chunks
+ * of a CHUNKED representation written to transaction TXN_ID in FS, to
+ * the list of reps that will be added to the rep-cache when the
+ * transaction gets committed.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+store_chunk_references(svn_fs_t *fs,
+                       const svn_fs_fs__id_part_t *txn_id,
+                       const apr_array_header_t *chunks,
+                       apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  apr_file_t *file;
+  svn_stringbuf_t *reps_string = svn_stringbuf_create_empty(scratch_pool);
+  int i;
+
+  for (i = 0; i < chunks->nelts; ++i)
     {
-      SVN_ERR(svn_checksum_final(&checksum, sha1_ctx, pool));
-      memcpy(rep->sha1_digest, checksum->digest, svn_checksum_size(checksum));
+      representation_t *rep = APR_ARRAY_IDX(chunks, i, representation_t *);
+      if (SVN_IS_VALID_REVNUM(rep->revision))
+        continue;
+
+      svn_stringbuf_appendstr(reps_string,
+          svn_fs_fs__unparse_representation(rep, ffd->format, FALSE,
+                                            scratch_pool, scratch_pool));
+      svn_stringbuf_appendbyte(reps_string, '\n');
     }
 
+  if (svn_stringbuf_isempty(reps_string))
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_io_file_open(&file, path_txn_chunks(fs, txn_id, scratch_pool),
+                           APR_WRITE | APR_CREATE | APR_APPEND
+                           | APR_BUFFERED, APR_OS_DEFAULT, scratch_pool));
+  SVN_ERR(svn_io_file_write_full(file, reps_string->data, reps_string->len,
+                                 NULL, scratch_pool));
+
+  return svn_error_trace(svn_io_file_close(file, scratch_pool));
+}
+
+/* Store the contents of B->CHUNK as a separate, self-deltified
+ * representation at the end of B->FILE, unless an identical one already
+ * exists in the repository or the current transaction.  Add the rep to
+ * B->CHUNKS and reset the chunk.
+ */
+static svn_error_t *
+write_chunk(struct rep_write_baton *b)
+{
+  svn_fs_t *fs = b->fs;
+  apr_pool_t *scratch_pool = b->chunk_pool;
+  representation_t *rep;
+  representation_t *old_rep;
+  svn_checksum__multi_ctx_t *checksum_ctx;
+  svn_checksum_ctx_t *fnv1a_checksum_ctx;
+  svn_fs_fs__rep_header_t header = { 0 };
+  svn_txdelta_window_handler_t wh;
+  void *whb;
+  svn_stream_t *stream;
+  svn_stream_t *delta_stream;
+  apr_off_t offset;
+  apr_off_t delta_start;
+  apr_off_t end;
+  apr_size_t len = b->chunk->len;
+
+  svn_pool_clear(scratch_pool);
+  rep = apr_pcalloc(b->result_pool, sizeof(*rep));
+
+  /* Write the chunk like any other fulltext. */
+  SVN_ERR(svn_io_file_get_offset(&offset, b->file, scratch_pool));
+  stream = fnv1a_wrap_stream(&fnv1a_checksum_ctx,
+                             svn_stream_from_aprfile2(b->file, TRUE,
+                                                      scratch_pool),
+                             scratch_pool);
+
+  header.type = svn_fs_fs__rep_self_delta;
+  SVN_ERR(svn_fs_fs__write_rep_header(&header, stream, scratch_pool));
+  SVN_ERR(svn_io_file_get_offset(&delta_start, b->file, scratch_pool));
+
+  txdelta_to_svndiff(&wh, &whb, stream, fs, scratch_pool);
+  delta_stream = svn_txdelta_target_push(wh, whb,
+                                         svn_stream_empty(scratch_pool),
+                                         scratch_pool);
+  SVN_ERR(svn_stream_write(delta_stream, b->chunk->data, &len));
+  SVN_ERR(svn_stream_close(delta_stream));
+
+  SVN_ERR(svn_io_file_get_offset(&end, b->file, scratch_pool));
+  rep->size = end - delta_start;
+  rep->expanded_size = b->chunk->len;
+  rep->txn_id = *svn_fs_fs__id_txn_id(b->noderev->id);
+  SVN_ERR(set_uniquifier(fs, rep, b->result_pool));
+  rep->revision = SVN_INVALID_REVNUM;
+
+  checksum_ctx = svn_checksum__multi_ctx_create(TRUE, TRUE, scratch_pool);
+  SVN_ERR(svn_checksum__multi_update(checksum_ctx, b->chunk->data,
+                                     b->chunk->len));
+  SVN_ERR(digests_final(rep, checksum_ctx, scratch_pool));
+
+  /* The rep-cache serves as our chunk index. */
+  SVN_ERR(get_shared_rep(&old_rep, fs, rep, b->file, offset, NULL,
+                         b->result_pool, scratch_pool));
+
+  if (old_rep)
+    {
+      /* We need to erase from the protorev the data we just wrote. */
+      SVN_ERR(svn_io_file_trunc(b->file, offset, scratch_pool));
+      rep = old_rep;
+    }
+  else
+    {
+      svn_fs_fs__p2l_entry_t entry;
+
+      SVN_ERR(svn_stream_puts(stream, "ENDREP\n"));
+      SVN_ERR(allocate_item_index(&rep->item_index, fs, &rep->txn_id,
+                                  offset, scratch_pool));
+
+      entry.offset = offset;
+      SVN_ERR(svn_io_file_get_offset(&end, b->file, scratch_pool));
+      entry.size = end - offset;
+      entry.type = SVN_FS_FS__ITEM_TYPE_FILE_REP;
+      entry.item.revision = SVN_INVALID_REVNUM;
+      entry.item.number = rep->item_index;
+      SVN_ERR(fnv1a_checksum_finalize(&entry.fnv1_checksum,
+                                      fnv1a_checksum_ctx, scratch_pool));
+      SVN_ERR(store_p2l_index_entry(fs, &rep->txn_id, &entry,
+                                    scratch_pool));
+
+      SVN_ERR(store_sha1_mapping(fs, rep, FALSE, scratch_pool));
+
+      /* The chunk is indexed now and must survive any later failure.
+         Later chunks may also share it and will read it through a
+         different file handle.  It only goes into the rep-cache once
+         some CHUNKED rep that lists it got committed, though. */
+      b->rep_offset = end;
+      SVN_ERR(svn_io_file_flush(b->file, scratch_pool));
+    }
+
+  APR_ARRAY_PUSH(b->chunks, representation_t *) = rep;
+  svn_stringbuf_setempty(b->chunk);
+  b->chunk_hash = 0;
+
   return SVN_NO_ERROR;
 }
 
+/* Add LEN bytes of DATA to the chunked representation written by B and
+ * write out all chunks that got completed by it.  Chunk boundaries are
+ * defined by a rolling hash over the contents, i.e. they will move along
+ * with the data when some other part of the file changes.
+ */
+static svn_error_t *
+chunk_contents(struct rep_write_baton *b,
+               const char *data,
+               apr_size_t len)
+{
+  if (b->chunk_gear == NULL)
+    {
+      apr_uint32_t i;
+
+      /* The values need to be fixed but should look random. */
+      b->chunk_gear = apr_palloc(b->result_pool, 256 * sizeof(apr_uint32_t));
+      for (i = 0; i < 256; ++i)
+        {
+          apr_uint32_t h = (i + 1) * 0x9e3779b9;
+          h ^= h >> 16;
+          h *= 0x85ebca6b;
+          h ^= h >> 13;
+          h *= 0xc2b2ae35;
+          h ^= h >> 16;
+          b->chunk_gear[i] = h;
+        }
+    }
+
+  while (len)
+    {
+      const unsigned char *bytes = (const unsigned char *)data;
+      apr_uint32_t hash = b->chunk_hash;
+      apr_size_t filled = b->chunk->len;
+      apr_size_t to_scan = MIN(len, CHUNK_MAX_SIZE - filled);
+      svn_boolean_t cut = FALSE;
+      apr_size_t i;
+
+      for (i = 0; i < to_scan; ++i)
+        {
+          hash = (hash << 1) + b->chunk_gear[bytes[i]];
+          if (   (hash & CHUNK_HASH_MASK) == 0
+              && filled + i + 1 >= CHUNK_MIN_SIZE)
+            {
+              cut = TRUE;
+              ++i;
+              break;
+            }
+        }
+
+      svn_stringbuf_appendbytes(b->chunk, data, i);
+      b->chunk_hash = hash;
+      data += i;
+      len -= i;
+
+      if (cut || b->chunk->len == CHUNK_MAX_SIZE)
+        SVN_ERR(write_chunk(b));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Write out the last chunk of the content-chunked representation being
+ * written by B, followed by the CHUNKED rep header and the chunk list.
+ * Update B's rep offset, checksum and stream members accordingly.
+ */
+static svn_error_t *
+finish_chunking(struct rep_write_baton *b)
+{
+  fs_fs_data_t *ffd = b->fs->fsap_data;
+  svn_fs_fs__rep_header_t header = { 0 };
+
+  if (b->chunk->len)
+    SVN_ERR(write_chunk(b));
+  svn_pool_destroy(b->chunk_pool);
+
+  /* The actual rep follows all of its new chunks. */
+  SVN_ERR(svn_io_file_get_offset(&b->rep_offset, b->file, b->scratch_pool));
+  b->rep_stream = fnv1a_wrap_stream(&b->fnv1a_checksum_ctx,
+                                    svn_stream_from_aprfile2(b->file, TRUE,
+                                                             b->scratch_pool),
+                                    b->scratch_pool);
+
+  header.type = svn_fs_fs__rep_chunked;
+  SVN_ERR(svn_fs_fs__write_rep_header(&header, b->rep_stream,
+                                      b->scratch_pool));
+  SVN_ERR(svn_io_file_get_offset(&b->delta_start, b->file,
+                                 b->scratch_pool));
+
+  return svn_error_trace(svn_fs_fs__write_chunk_list(b->chunks, ffd->format,
+                                                     b->rep_stream,
+                                                     b->scratch_pool));
+}
+
 /* Close handler for the representation write stream.  BATON is a
    rep_write_baton.  Writes out a new node-rev that correctly
    references the representation we just finished writing. */
@@ -2520,6 +2907,30 @@ rep_write_contents_close(void *baton)
 
   rep = apr_pcalloc(b->result_pool, sizeof(*rep));
 
+  if (b->chunk)
+    {
+      SVN_ERR(finish_chunking(b));
+    }
+  else if (b->pending)
+    {
+      /* Too small to be chunked.  Write it as usual. */
+      SVN_ERR(rep_write_start(b));
+      while (TRUE)
+        {
+          const char *data;
+          apr_size_t len;
+
+          SVN_ERR(svn_spillbuf__read(&data, &len, b->pending,
+                                     b->scratch_pool));
+          if (data == NULL)
+            break;
+
+          SVN_ERR(svn_stream_write(b->delta_stream, data, &len));
+        }
+
+      b->pending = NULL;
+    }
+
   /* Close our delta stream so the last bits of svndiff are written
      out. */
   if (b->delta_stream)
@@ -2536,8 +2947,7 @@ rep_write_contents_close(void *baton)
   rep->revision = SVN_INVALID_REVNUM;
 
   /* Finalize the checksum. */
-  SVN_ERR(digests_final(rep, b->md5_checksum_ctx, b->sha1_checksum_ctx,
-                        b->result_pool));
+  SVN_ERR(digests_final(rep, b->checksum_ctx, b->result_pool));
 
   /* Check and see if we already have a representation somewhere that's
      identical to the one we just wrote out. */
@@ -2593,6 +3003,13 @@ rep_write_contents_close(void *baton)
   if (!old_rep)
     SVN_ERR(store_sha1_rep_mapping(b->fs, b->noderev, b->scratch_pool));
 
+  /* Pack only keeps chunks that some CHUNKED rep in the revision lists.
+   * So, chunks of failed writes or of contents that turned out to exist
+   * already must not get into the rep-cache. */
+  if (!old_rep && b->chunks)
+    SVN_ERR(store_chunk_references(b->fs, &rep->txn_id, b->chunks,
+                                   b->scratch_pool));
+
   SVN_ERR(unlock_proto_rev(b->fs, &rep->txn_id, b->lockcookie,
                            b->scratch_pool));
   svn_pool_destroy(b->scratch_pool);
@@ -2713,10 +3130,8 @@ struct write_container_baton
 
   apr_size_t size;
 
-  svn_checksum_ctx_t *md5_ctx;
-
-  /* SHA1 calculation is optional. If not needed, this will be NULL. */
-  svn_checksum_ctx_t *sha1_ctx;
+  /* MD5 and, optionally, SHA1 of the data written. */
+  svn_checksum__multi_ctx_t *checksum_ctx;
 };
 
 /* The handler for the write_container_rep stream.  BATON is a
@@ -2729,9 +3144,7 @@ write_container_handler(void *baton,
 {
   struct write_container_baton *whb = baton;
 
-  SVN_ERR(svn_checksum_update(whb->md5_ctx, data, *len));
-  if (whb->sha1_ctx)
-    SVN_ERR(svn_checksum_update(whb->sha1_ctx, data, *len));
+  SVN_ERR(svn_checksum__multi_update(whb->checksum_ctx, data, *len));
 
   SVN_ERR(svn_stream_write(whb->stream, data, len));
   whb->size += *len;
@@ -2781,6 +3194,9 @@ write_directory_to_stream(svn_stream_t *stream,
    existing reps can be found, we will truncate the one just written from
    the file and return the existing rep.
 
+   If BLOCKED_DIR is TRUE, the COLLECTION is the block index of a directory
+   and the rep will get a BLOCKED header instead of a PLAIN one.
+
    Perform temporary allocations in SCRATCH_POOL. */
 static svn_error_t *
 write_container_rep(representation_t *rep,
@@ -2791,11 +3207,13 @@ write_container_rep(representation_t *rep,
                     apr_hash_t *reps_hash,
                     svn_boolean_t allow_rep_sharing,
                     apr_uint32_t item_type,
+                    svn_boolean_t blocked_dir,
                     apr_pool_t *scratch_pool)
 {
   svn_stream_t *stream;
   struct write_container_baton *whb;
   svn_checksum_ctx_t *fnv1a_checksum_ctx;
+  svn_fs_fs__rep_header_t header = { 0 };
   apr_off_t offset = 0;
 
   SVN_ERR(svn_io_file_get_offset(&offset, file, scratch_pool));
@@ -2809,19 +3227,22 @@ write_container_rep(representation_t *rep,
   else
     fnv1a_checksum_ctx = NULL;
   whb->size = 0;
-  whb->md5_ctx = svn_checksum_ctx_create(svn_checksum_md5, scratch_pool);
-  if (item_type != SVN_FS_FS__ITEM_TYPE_DIR_REP)
-    whb->sha1_ctx = svn_checksum_ctx_create(svn_checksum_sha1, scratch_pool);
+  whb->checksum_ctx
+    = svn_checksum__multi_ctx_create(TRUE,
+                                     item_type != SVN_FS_FS__ITEM_TYPE_DIR_REP,
+                                     scratch_pool);
 
   stream = svn_stream_create(whb, scratch_pool);
   svn_stream_set_write(stream, write_container_handler);
 
-  SVN_ERR(svn_stream_puts(whb->stream, "PLAIN\n"));
+  header.type = svn_fs_fs__rep_plain;
+  header.blocked_dir = blocked_dir;
+  SVN_ERR(svn_fs_fs__write_rep_header(&header, whb->stream, scratch_pool));
 
   SVN_ERR(writer(stream, collection, scratch_pool));
 
   /* Store the results. */
-  SVN_ERR(digests_final(rep, whb->md5_ctx, whb->sha1_ctx, scratch_pool));
+  SVN_ERR(digests_final(rep, whb->checksum_ctx, scratch_pool));
 
   /* Update size info. */
   rep->expanded_size = whb->size;
@@ -2886,6 +3307,7 @@ write_container_rep(representation_t *rep,
 
    If ITEM_TYPE is IS_PROPS equals SVN_FS_FS__ITEM_TYPE_*_PROPS, assume
    that we want to a props representation as the base for our delta.
+   If NODEREV is NULL, write a self-delta.
    Perform temporary allocations in SCRATCH_POOL.
  */
 static svn_error_t *
@@ -2919,7 +3341,11 @@ write_container_delta_rep(representation_t *rep,
                         || (item_type == SVN_FS_FS__ITEM_TYPE_DIR_PROPS);
 
   /* Get the base for this delta. */
-  SVN_ERR(choose_delta_base(&base_rep, fs, noderev, is_props, scratch_pool));
+  if (noderev)
+    SVN_ERR(choose_delta_base(&base_rep, fs, noderev, is_props,
+                              scratch_pool));
+  else
+    base_rep = NULL;
   SVN_ERR(svn_fs_fs__get_contents(&source, fs, base_rep, FALSE, scratch_pool));
 
   SVN_ERR(svn_io_file_get_offset(&offset, file, scratch_pool));
@@ -2953,9 +3379,10 @@ write_container_delta_rep(representation_t *rep,
   whb->stream = svn_txdelta_target_push(diff_wh, diff_whb, source,
                                         scratch_pool);
   whb->size = 0;
-  whb->md5_ctx = svn_checksum_ctx_create(svn_checksum_md5, scratch_pool);
-  if (item_type != SVN_FS_FS__ITEM_TYPE_DIR_REP)
-    whb->sha1_ctx = svn_checksum_ctx_create(svn_checksum_sha1, scratch_pool);
+  whb->checksum_ctx
+    = svn_checksum__multi_ctx_create(TRUE,
+                                     item_type != SVN_FS_FS__ITEM_TYPE_DIR_REP,
+                                     scratch_pool);
 
   /* serialize the hash */
   stream = svn_stream_create(whb, scratch_pool);
@@ -2965,7 +3392,7 @@ write_container_delta_rep(representation_t *rep,
   SVN_ERR(svn_stream_close(whb->stream));
 
   /* Store the results. */
-  SVN_ERR(digests_final(rep, whb->md5_ctx, whb->sha1_ctx, scratch_pool));
+  SVN_ERR(digests_final(rep, whb->checksum_ctx, scratch_pool));
 
   /* Update size info. */
   SVN_ERR(svn_io_file_get_offset(&rep_end, file, scratch_pool));
@@ -3017,6 +3444,244 @@ write_container_delta_rep(representation_t *rep,
   return SVN_NO_ERROR;
 }
 
+/* Directories with at least that many entries get stored as BLOCKED reps. */
+#define DIR_BLOCK_THRESHOLD 0x800
+
+/* Number of entries per block of a BLOCKED directory rep.  Blocks that
+   need to be rewritten may grow up to twice that size before they get
+   split.  With about 50 bytes per entry on disk, blocks are small enough
+   to be read quickly and the index of a directory with 1M entries is
+   about 60kB. */
+#define DIR_BLOCK_SIZE 0x400
+
+/* Baton type for write_dir_index_to_stream. */
+typedef struct dir_index_baton_t
+{
+  /* The svn_fs_fs__dir_block_t to write. */
+  apr_array_header_t *blocks;
+
+  /* FS format to use for the rep strings. */
+  int format;
+} dir_index_baton_t;
+
+/* Implement collection_writer_t writing the block index given as
+   dir_index_baton_t BATON. */
+static svn_error_t *
+write_dir_index_to_stream(svn_stream_t *stream,
+                          void *baton,
+                          apr_pool_t *pool)
+{
+  dir_index_baton_t *index_baton = baton;
+  SVN_ERR(svn_fs_fs__write_dir_index(index_baton->blocks,
+                                     index_baton->format, stream, pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Return the index of the block in the non-empty block index BLOCKS that
+   covers the entry NAME.  Names sorting before the first block belong to
+   the first block. */
+static int
+find_dir_block(apr_array_header_t *blocks,
+               const char *name)
+{
+  int lower = 1;
+  int upper = blocks->nelts;
+
+  while (lower < upper)
+    {
+      int middle = lower + (upper - lower) / 2;
+      if (strcmp(APR_ARRAY_IDX(blocks, middle,
+                               svn_fs_fs__dir_block_t).first_name,
+                 name) <= 0)
+        lower = middle + 1;
+      else
+        upper = middle;
+    }
+
+  return lower - 1;
+}
+
+/* Write the entries FIRST up to but not including END of the directory
+   ENTRIES to FILE as new blocks of the directory NODEREV in FS and append
+   those to BLOCKS.  REV is the revision being committed.  Don't write
+   empty blocks.  Perform temporary allocations in SCRATCH_POOL. */
+static svn_error_t *
+write_dir_blocks(apr_array_header_t *blocks,
+                 apr_file_t *file,
+                 apr_array_header_t *entries,
+                 int first,
+                 int end,
+                 node_revision_t *noderev,
+                 svn_revnum_t rev,
+                 svn_fs_t *fs,
+                 apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+
+  while (first < end)
+    {
+      int count = end - first >= 2 * DIR_BLOCK_SIZE ? DIR_BLOCK_SIZE
+                                                    : end - first;
+      svn_fs_fs__dir_block_t *block = apr_array_push(blocks);
+      apr_array_header_t *slice;
+
+      svn_pool_clear(iterpool);
+
+      slice = apr_array_make(iterpool, count, sizeof(svn_fs_dirent_t *));
+      memcpy(slice->elts, &APR_ARRAY_IDX(entries, first, svn_fs_dirent_t *),
+             count * sizeof(svn_fs_dirent_t *));
+      slice->nelts = count;
+
+      block->first_name = APR_ARRAY_IDX(entries, first,
+                                        svn_fs_dirent_t *)->name;
+      memset(&block->rep, 0, sizeof(block->rep));
+      block->rep.revision = rev;
+      block->rep.txn_id = noderev->data_rep->txn_id;
+
+      if (ffd->deltify_directories)
+        SVN_ERR(write_container_delta_rep(&block->rep, file, slice,
+                                          write_directory_to_stream, fs,
+                                          NULL, NULL, FALSE,
+                                          SVN_FS_FS__ITEM_TYPE_DIR_REP,
+                                          iterpool));
+      else
+        SVN_ERR(write_container_rep(&block->rep, file, slice,
+                                    write_directory_to_stream, fs, NULL,
+                                    FALSE, SVN_FS_FS__ITEM_TYPE_DIR_REP,
+                                    FALSE, iterpool));
+
+      reset_txn_in_rep(&block->rep);
+      first += count;
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Write the sorted ENTRIES of the directory NODEREV in FS to FILE as a
+   BLOCKED rep, i.e. as blocks of entries that are reps of their own plus
+   an index of these blocks.  Update NODEREV->DATA_REP to that index.
+
+   REV is the revision being committed and CHANGED_PATHS its folded list
+   of changes.  Blocks of the predecessor that contain no changed entries
+   are being referenced instead of being written again.  Perform
+   temporary allocations in SCRATCH_POOL. */
+static svn_error_t *
+write_blocked_dir_rep(node_revision_t *noderev,
+                      apr_file_t *file,
+                      apr_array_header_t *entries,
+                      apr_hash_t *changed_paths,
+                      svn_revnum_t rev,
+                      svn_fs_t *fs,
+                      apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  apr_array_header_t *old_blocks = NULL;
+  dir_index_baton_t index_baton;
+  int first, i;
+
+  index_baton.blocks = apr_array_make(scratch_pool,
+                                      entries->nelts / DIR_BLOCK_SIZE + 1,
+                                      sizeof(svn_fs_fs__dir_block_t));
+  index_baton.format = ffd->format;
+
+  if (noderev->predecessor_id)
+    {
+      node_revision_t *pred;
+      SVN_ERR(svn_fs_fs__get_node_revision(&pred, fs, noderev->predecessor_id,
+                                           scratch_pool, scratch_pool));
+      SVN_ERR(svn_fs_fs__get_dir_block_index(&old_blocks, fs, pred,
+                                             scratch_pool, scratch_pool));
+    }
+
+  if (old_blocks && old_blocks->nelts)
+    {
+      svn_boolean_t *modified = apr_pcalloc(scratch_pool,
+                                            old_blocks->nelts
+                                              * sizeof(*modified));
+      apr_hash_index_t *hi;
+
+      /* Entries that have been added, replaced or deleted in this
+         revision or that contain such changes. */
+      for (hi = apr_hash_first(scratch_pool, changed_paths);
+           hi;
+           hi = apr_hash_next(hi))
+        {
+          const char *name
+            = svn_fspath__skip_ancestor(noderev->created_path,
+                                        apr_hash_this_key(hi));
+          if (name && *name)
+            {
+              const char *slash = strchr(name, '/');
+              if (slash)
+                name = apr_pstrmemdup(scratch_pool, name, slash - name);
+
+              modified[find_dir_block(old_blocks, name)] = TRUE;
+            }
+        }
+
+      /* Sub-trees get new node IDs also without any recorded change, e.g.
+         when a change got reverted in the same txn. */
+      for (i = 0; i < entries->nelts; ++i)
+        {
+          svn_fs_dirent_t *dirent = APR_ARRAY_IDX(entries, i,
+                                                  svn_fs_dirent_t *);
+          if (svn_fs_fs__id_rev(dirent->id) == rev)
+            modified[find_dir_block(old_blocks, dirent->name)] = TRUE;
+        }
+
+      /* Keep the unmodified blocks, rewrite the others. */
+      first = 0;
+      for (i = 0; i < old_blocks->nelts; ++i)
+        {
+          svn_fs_fs__dir_block_t *old_block
+            = &APR_ARRAY_IDX(old_blocks, i, svn_fs_fs__dir_block_t);
+          int end = first;
+
+          if (i + 1 == old_blocks->nelts)
+            end = entries->nelts;
+          else
+            while (   end < entries->nelts
+                   && strcmp(APR_ARRAY_IDX(entries, end,
+                                           svn_fs_dirent_t *)->name,
+                             APR_ARRAY_IDX(old_blocks, i + 1,
+                                   svn_fs_fs__dir_block_t).first_name) < 0)
+              ++end;
+
+          if (   !modified[i]
+              && end > first
+              && strcmp(APR_ARRAY_IDX(entries, first,
+                                      svn_fs_dirent_t *)->name,
+                        old_block->first_name) == 0)
+            APR_ARRAY_PUSH(index_baton.blocks, svn_fs_fs__dir_block_t)
+              = *old_block;
+          else
+            SVN_ERR(write_dir_blocks(index_baton.blocks, file, entries,
+                                     first, end, noderev, rev, fs,
+                                     scratch_pool));
+
+          first = end;
+        }
+    }
+  else
+    {
+      SVN_ERR(write_dir_blocks(index_baton.blocks, file, entries,
+                               0, entries->nelts, noderev, rev, fs,
+                               scratch_pool));
+    }
+
+  /* The index becomes the directory rep. */
+  SVN_ERR(write_container_rep(noderev->data_rep, file, &index_baton,
+                              write_dir_index_to_stream, fs, NULL, FALSE,
+                              SVN_FS_FS__ITEM_TYPE_DIR_REP, TRUE,
+                              scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
 /* Sanity check ROOT_NODEREV, a candidate for being the root node-revision
    of (not yet committed) revision REV in FS.  Use POOL for temporary
    allocations.
@@ -3117,6 +3782,9 @@ get_final_id(svn_fs_fs__id_part_t *part,
    Collect the pair_cache_key_t of all directories written to the
    committed cache in DIRECTORY_IDS.
 
+   CHANGED_PATHS is the folded list of changes in this revision.  It is
+   used to find the unchanged parts of very large directories.
+
    If REPS_TO_CACHE is not NULL, append to it a copy (allocated in
    REPS_POOL) of each data rep that is new in this revision.
 
@@ -3139,6 +3807,7 @@ write_final_rev(const svn_fs_id_t **new_id_p,
                 apr_uint64_t start_copy_id,
                 apr_off_t initial_offset,
                 apr_array_header_t *directory_ids,
+                apr_hash_t *changed_paths,
                 apr_array_header_t *reps_to_cache,
                 apr_hash_t *reps_hash,
                 apr_pool_t *reps_pool,
@@ -3181,8 +3850,8 @@ write_final_rev(const svn_fs_id_t **new_id_p,
           svn_pool_clear(subpool);
           SVN_ERR(write_final_rev(&new_id, file, rev, fs, dirent->id,
                                   start_node_id, start_copy_id, initial_offset,
-                                  directory_ids, reps_to_cache, reps_hash,
-                                  reps_pool, FALSE, subpool));
+                                  directory_ids, changed_paths, reps_to_cache,
+                                  reps_hash, reps_pool, FALSE, subpool));
           if (new_id && (svn_fs_fs__id_rev(new_id) == rev))
             dirent->id = svn_fs_fs__id_copy(new_id, pool);
         }
@@ -3192,9 +3861,14 @@ write_final_rev(const svn_fs_id_t **new_id_p,
           pair_cache_key_t *key;
           svn_fs_fs__dir_data_t dir_data;
 
-          /* Write out the contents of this directory as a text rep. */
+          /* Write out the contents of this directory as a text rep.
+             Very large directories get split into blocks. */
           noderev->data_rep->revision = rev;
-          if (ffd->deltify_directories)
+          if (   ffd->format >= SVN_FS_FS__MIN_BLOCKED_DIRS_FORMAT
+              && entries->nelts >= DIR_BLOCK_THRESHOLD)
+            SVN_ERR(write_blocked_dir_rep(noderev, file, entries,
+                                          changed_paths, rev, fs, pool));
+          else if (ffd->deltify_directories)
             SVN_ERR(write_container_delta_rep(noderev->data_rep, file,
                                               entries,
                                               write_directory_to_stream,
@@ -3205,7 +3879,7 @@ write_final_rev(const svn_fs_id_t **new_id_p,
             SVN_ERR(write_container_rep(noderev->data_rep, file, entries,
                                         write_directory_to_stream, fs, NULL,
                                         FALSE, SVN_FS_FS__ITEM_TYPE_DIR_REP,
-                                        pool));
+                                        FALSE, pool));
 
           reset_txn_in_rep(noderev->data_rep);
 
@@ -3272,7 +3946,7 @@ write_final_rev(const svn_fs_id_t **new_id_p,
       else
         SVN_ERR(write_container_rep(noderev->prop_rep, file, proplist,
                                     write_hash_to_stream, fs, reps_hash,
-                                    TRUE, item_type, pool));
+                                    TRUE, item_type, FALSE, pool));
 
       reset_txn_in_rep(noderev->prop_rep);
     }
@@ -3594,12 +4268,13 @@ verify_locks(svn_fs_t *fs,
 
 /* Writes final revision properties to file PATH applying permissions
    from file PERMS_REFERENCE. This involves setting svn:date and
-   removing any temporary properties associated with the commit flags. */
+   removing any temporary properties associated with the commit flags.
+   Schedule the necessary fsyncs in BATCH. */
 static svn_error_t *
 write_final_revprop(const char *path,
                     const char *perms_reference,
                     svn_fs_txn_t *txn,
-                    svn_boolean_t flush_to_disk,
+                    svn_fs__batch_fsync_t *batch,
                     apr_pool_t *pool)
 {
   apr_hash_t *txnprops;
@@ -3629,20 +4304,18 @@ write_final_revprop(const char *path,
       svn_hash_sets(txnprops, SVN_PROP_REVISION_DATE, &date);
     }
 
-  /* Create new revprops file. Tell OS to truncate existing file,
-     since  file may already exists from failed transaction. */
-  SVN_ERR(svn_io_file_open(&revprop_file, path,
-                           APR_WRITE | APR_CREATE | APR_TRUNCATE
-                           | APR_BUFFERED, APR_OS_DEFAULT, pool));
+  /* Create new revprops file. Truncate any existing file, since the
+     file may already exists from failed transaction.  BATCH owns the
+     file handle. */
+  SVN_ERR(svn_fs__batch_fsync_open_file(&revprop_file, batch, path,
+                                        pool));
+  SVN_ERR(svn_io_file_trunc(revprop_file, 0, pool));
+  SVN_ERR(svn_fs__batch_fsync_new_path(batch, path, pool));
 
   stream = svn_stream_from_aprfile2(revprop_file, TRUE, pool);
   SVN_ERR(svn_hash_write2(txnprops, stream, SVN_HASH_TERMINATOR, pool));
   SVN_ERR(svn_stream_close(stream));
 
-  if (flush_to_disk)
-    SVN_ERR(svn_io_file_flush_to_disk(revprop_file, pool));
-  SVN_ERR(svn_io_file_close(revprop_file, pool));
-
   SVN_ERR(svn_io_copy_perms(perms_reference, path, pool));
 
   return SVN_NO_ERROR;
@@ -3724,6 +4397,41 @@ promote_cached_directories(svn_fs_t *fs,
   return SVN_NO_ERROR;
 }
 
+/* Append the content chunks that have been written to transaction TXN_ID
+ * in FS to REPS_TO_CACHE, assigning them to revision REV.  Allocate the
+ * new array elements in REPS_POOL and use SCRATCH_POOL for temporaries.
+ */
+static svn_error_t *
+add_chunks_to_cache(apr_array_header_t *reps_to_cache,
+                    svn_fs_t *fs,
+                    const svn_fs_fs__id_part_t *txn_id,
+                    svn_revnum_t rev,
+                    apr_pool_t *reps_pool,
+                    apr_pool_t *scratch_pool)
+{
+  const char *path = path_txn_chunks(fs, txn_id, scratch_pool);
+  svn_node_kind_t kind;
+  svn_stringbuf_t *contents;
+  apr_array_header_t *chunks;
+  int i;
+
+  SVN_ERR(svn_io_check_path(path, &kind, scratch_pool));
+  if (kind != svn_node_file)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_stringbuf_from_file2(&contents, path, scratch_pool));
+  SVN_ERR(svn_fs_fs__parse_chunk_list(&chunks, contents, reps_pool,
+                                      scratch_pool));
+  for (i = 0; i < chunks->nelts; ++i)
+    {
+      representation_t *rep = APR_ARRAY_IDX(chunks, i, representation_t *);
+      rep->revision = rev;
+      APR_ARRAY_PUSH(reps_to_cache, representation_t *) = rep;
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /* Baton used for commit_body below. */
 struct commit_baton {
   svn_revnum_t *new_rev_p;
@@ -3755,6 +4463,7 @@ commit_body(void *baton, apr_pool_t *pool)
   apr_hash_t *changed_paths;
   apr_array_header_t *directory_ids = apr_array_make(pool, 4,
                                                      sizeof(pair_cache_key_t));
+  svn_fs__batch_fsync_t *batch;
 
   /* Re-Read the current repository format.  All our repo upgrade and
      config evaluation strategies are such that existing information in
@@ -3808,8 +4517,11 @@ commit_body(void *baton, apr_pool_t *pool)
   root_id = svn_fs_fs__id_txn_create_root(txn_id, pool);
   SVN_ERR(write_final_rev(&new_root_id, proto_file, new_rev, cb->fs, root_id,
                           start_node_id, start_copy_id, initial_offset,
-                          directory_ids, cb->reps_to_cache, cb->reps_hash,
-                          cb->reps_pool, TRUE, pool));
+                          directory_ids, changed_paths, cb->reps_to_cache,
+                          cb->reps_hash, cb->reps_pool, TRUE, pool));
+  if (cb->reps_to_cache)
+    SVN_ERR(add_chunks_to_cache(cb->reps_to_cache, cb->fs, txn_id, new_rev,
+                                cb->reps_pool, pool));
 
   /* Write the changed-path information. */
   SVN_ERR(write_final_changed_path_info(&changed_path_offset, proto_file,
@@ -3837,10 +4549,13 @@ commit_body(void *baton, apr_pool_t *pool)
                                      NULL, pool));
     }
 
-  if (ffd->flush_to_disk)
-    SVN_ERR(svn_io_file_flush_to_disk(proto_file, pool));
   SVN_ERR(svn_io_file_close(proto_file, pool));
 
+  /* Rather than flushing each new file and directory entry to disk as
+     soon as we have written it, collect them and flush them all at once
+     just before we bump 'current'. */
+  SVN_ERR(svn_fs__batch_fsync_create(&batch, ffd->flush_to_disk, pool));
+
   /* We don't unlock the prototype revision file immediately to avoid a
      race with another caller writing to the prototype revision file
      before we commit it. */
@@ -3863,6 +4578,7 @@ commit_body(void *baton, apr_pool_t *pool)
                                                     PATH_REVS_DIR,
                                                     pool),
                                     new_dir, pool));
+          SVN_ERR(svn_fs__batch_fsync_new_path(batch, new_dir, pool));
         }
 
       /* Create the revprops shard. */
@@ -3879,6 +4595,7 @@ commit_body(void *baton, apr_pool_t *pool)
                                                     PATH_REVPROPS_DIR,
                                                     pool),
                                     new_dir, pool));
+          SVN_ERR(svn_fs__batch_fsync_new_path(batch, new_dir, pool));
         }
     }
 
@@ -3891,8 +4608,10 @@ commit_body(void *baton, apr_pool_t *pool)
   rev_filename = svn_fs_fs__path_rev(cb->fs, new_rev, pool);
   proto_filename = svn_fs_fs__path_txn_proto_rev(cb->fs, txn_id, pool);
   SVN_ERR(svn_fs_fs__move_into_place(proto_filename, rev_filename,
-                                     old_rev_filename, ffd->flush_to_disk,
-                                     pool));
+                                     old_rev_filename, FALSE, pool));
+  SVN_ERR(svn_fs__batch_fsync_open_file(&proto_file, batch, rev_filename,
+                                        pool));
+  SVN_ERR(svn_fs__batch_fsync_new_path(batch, rev_filename, pool));
 
   /* Now that we've moved the prototype revision file out of the way,
      we can unlock it (since further attempts to write to the file
@@ -3904,7 +4623,11 @@ commit_body(void *baton, apr_pool_t *pool)
   SVN_ERR_ASSERT(! svn_fs_fs__is_packed_revprop(cb->fs, new_rev));
   revprop_filename = svn_fs_fs__path_revprops(cb->fs, new_rev, pool);
   SVN_ERR(write_final_revprop(revprop_filename, old_rev_filename,
-                              cb->txn, ffd->flush_to_disk, pool));
+                              cb->txn, batch, pool));
+
+  /* Make the revision and revprop files as well as any new shard
+     directories persistent, concurrently where possible. */
+  SVN_ERR(svn_fs__batch_fsync_run(batch, pool));
 
   /* Run paranoia checks. */
   if (ffd->verify_before_commit)
@@ -4014,8 +4737,30 @@ svn_fs_fs__commit(svn_revnum_t *new_rev_p,
         }
       else if (err)
         return svn_error_trace(err);
+
+      svn_fs_fs__rep_cache_filter_bump(fs, *new_rev_p);
     }
 
+  /* Keep the optional changed-path index up to date.  This also adds
+     any revisions that previous commits failed to index. */
+  {
+    svn_boolean_t exists;
+
+    SVN_ERR(svn_fs_fs__exists_path_index(&exists, fs, pool));
+    if (exists)
+      {
+        svn_error_t *err = svn_fs_fs__update_path_index(fs, *new_rev_p,
+                                                        NULL, NULL,
+                                                        NULL, NULL, pool);
+        if (svn_error_find_cause(err, SVN_ERR_SQLITE_ROLLBACK_FAILED))
+          return svn_error_trace(
+              svn_error_compose_create(err,
+                                       svn_fs_fs__close_path_index(fs)));
+        else if (err)
+          return svn_error_trace(err);
+      }
+  }
+
   return SVN_NO_ERROR;
 }
 
@@ -20,9 +20,12 @@
  * ====================================================================
  */
 
+#include <apr_thread_proc.h>
+
 #include "svn_sorts.h"
 #include "svn_checksum.h"
 #include "svn_time.h"
+#include "private/svn_atomic.h"
 #include "private/svn_subr_private.h"
 
 #include "verify.h"
@@ -884,10 +887,200 @@ verify_f7_metadata_consistency(svn_fs_t *fs,
   return SVN_NO_ERROR;
 }
 
+#if APR_HAS_THREADS
+/* How often the calling thread checks for cancellation while waiting for
+ * verification threads. */
+#define VERIFY_JOB_POLL_INTERVAL (APR_USEC_PER_SEC / 20)
+
+/* Work item for verify_f7_thread(). */
+typedef struct verify_f7_job_t
+{
+  /* How to get the FS instance to use. */
+  svn_fs_fs__open_fs_func_t open_func;
+  void *open_baton;
+
+  /* Revision range to check.  Never crosses a shard boundary. */
+  svn_revnum_t start;
+  svn_revnum_t end;
+
+  /* Set by the calling thread to make all jobs of a batch stop early.
+   * Shared between those jobs. */
+  volatile svn_atomic_t *cancelled;
+
+  /* Set by the verification thread once it has finished. */
+  volatile svn_atomic_t done;
+
+  /* The thread executing this job. */
+  apr_thread_t *thread;
+
+  /* The outcome of this job. */
+  svn_error_t *err;
+} verify_f7_job_t;
+
+/* Implements svn_cancel_func_t for the verify_f7_job_t in BATON.
+ *
+ * The caller's cancel function may not be thread-safe, so only the calling
+ * thread invokes it.  The verification threads simply poll the shared flag.
+ */
+static svn_error_t *
+verify_f7_job_cancel(void *baton)
+{
+  verify_f7_job_t *job = baton;
+
+  if (svn_atomic_read(job->cancelled))
+    return svn_error_create(SVN_ERR_CANCELLED, NULL, NULL);
+
+  return SVN_NO_ERROR;
+}
+
+/* Thread function running verify_f7_metadata_consistency() for the
+ * verify_f7_job_t in DATA, using a private FS instance and pool.
+ */
+static void * APR_THREAD_FUNC
+verify_f7_thread(apr_thread_t *thread,
+                 void *data)
+{
+  verify_f7_job_t *job = data;
+
+  /* Pools are not thread-safe.  Use a separate root pool. */
+  apr_pool_t *pool
+    = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+  svn_fs_t *fs;
+
+  job->err = job->open_func(&fs, job->open_baton, pool, pool);
+  if (!job->err)
+    job->err = verify_f7_metadata_consistency(fs, job->start, job->end,
+                                              NULL, NULL,
+                                              verify_f7_job_cancel, job,
+                                              pool);
+
+  svn_pool_destroy(pool);
+  svn_atomic_set(&job->done, TRUE);
+  apr_thread_exit(thread, APR_SUCCESS);
+
+  return NULL;
+}
+
+/* Like verify_f7_metadata_consistency() but check up to JOBS shards
+ * at once, each in a separate thread with an FS instance provided by
+ * OPEN_FUNC with OPEN_BATON.  Notifications and errors are reported in
+ * revision order.  FS must be sharded.
+ */
+static svn_error_t *
+verify_f7_metadata_concurrently(svn_fs_t *fs,
+                                svn_revnum_t start,
+                                svn_revnum_t end,
+                                int jobs,
+                                svn_fs_fs__open_fs_func_t open_func,
+                                void *open_baton,
+                                svn_fs_progress_notify_func_t notify_func,
+                                void *notify_baton,
+                                svn_cancel_func_t cancel_func,
+                                void *cancel_baton,
+                                apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_revnum_t shard_size = ffd->max_files_per_dir;
+  svn_revnum_t revision = start;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+
+  while (revision <= end)
+    {
+      verify_f7_job_t *batch;
+      volatile svn_atomic_t cancelled = FALSE;
+      svn_error_t *err = SVN_NO_ERROR;
+      int count, started, i;
+
+      svn_pool_clear(iterpool);
+
+      if (cancel_func)
+        SVN_ERR(cancel_func(cancel_baton));
+
+      /* Split the next part of the range into up to JOBS chunks, one
+       * per shard. */
+      batch = apr_pcalloc(iterpool, jobs * sizeof(*batch));
+      for (count = 0; count < jobs && revision <= end; ++count)
+        {
+          verify_f7_job_t *job = &batch[count];
+
+          job->open_func = open_func;
+          job->open_baton = open_baton;
+          job->cancelled = &cancelled;
+          job->start = revision;
+          job->end = MIN(end, (revision / shard_size + 1) * shard_size - 1);
+
+          revision = job->end + 1;
+        }
+
+      for (started = 0; started < count; ++started)
+        {
+          apr_status_t status = apr_thread_create(&batch[started].thread,
+                                                  NULL, verify_f7_thread,
+                                                  &batch[started], iterpool);
+          if (status)
+            {
+              err = svn_error_wrap_apr(status,
+                                       _("Can't create verification thread"));
+              break;
+            }
+        }
+
+      /* Wait for all jobs.  We must not leave running threads behind.
+       * Only this thread may call CANCEL_FUNC. */
+      for (i = 0; i < started; ++i)
+        {
+          apr_status_t retval;
+          apr_status_t status;
+
+          while (!svn_atomic_read(&batch[i].done))
+            {
+              if (!err && cancel_func)
+                err = cancel_func(cancel_baton);
+              if (err)
+                svn_atomic_set(&cancelled, TRUE);
+
+              apr_sleep(VERIFY_JOB_POLL_INTERVAL);
+            }
+
+          status = apr_thread_join(&retval, batch[i].thread);
+
+          if (status)
+            err = svn_error_compose_create(err,
+                     svn_error_wrap_apr(status,
+                                        _("Can't join verification thread")));
+        }
+
+      /* Report progress and the first failure in revision order. */
+      for (i = 0; i < started; ++i)
+        {
+          svn_revnum_t pack_start
+            = svn_fs_fs__packed_base_rev(fs, batch[i].start);
+
+          if (!err && notify_func && (pack_start % shard_size == 0))
+            notify_func(pack_start, notify_baton, iterpool);
+
+          if (err)
+            svn_error_clear(batch[i].err);
+          else
+            err = batch[i].err;
+        }
+
+      SVN_ERR(err);
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+#endif
+
 svn_error_t *
 svn_fs_fs__verify(svn_fs_t *fs,
                   svn_revnum_t start,
                   svn_revnum_t end,
+                  int jobs,
+                  svn_fs_fs__open_fs_func_t open_func,
+                  void *open_baton,
                   svn_fs_progress_notify_func_t notify_func,
                   void *notify_baton,
                   svn_cancel_func_t cancel_func,
@@ -910,9 +1103,21 @@ svn_fs_fs__verify(svn_fs_t *fs,
   /* log/phys index consistency.  We need to check them first to make
      sure we can access the rev / pack files in format7. */
   if (svn_fs_fs__use_log_addressing(fs))
-    SVN_ERR(verify_f7_metadata_consistency(fs, start, end,
-                                           notify_func, notify_baton,
-                                           cancel_func, cancel_baton, pool));
+    {
+#if APR_HAS_THREADS
+      if (jobs > 1 && open_func && ffd->max_files_per_dir)
+        SVN_ERR(verify_f7_metadata_concurrently(fs, start, end, jobs,
+                                                open_func, open_baton,
+                                                notify_func, notify_baton,
+                                                cancel_func, cancel_baton,
+                                                pool));
+      else
+#endif
+        SVN_ERR(verify_f7_metadata_consistency(fs, start, end,
+                                               notify_func, notify_baton,
+                                               cancel_func, cancel_baton,
+                                               pool));
+    }
 
   /* rep cache consistency */
   if (ffd->format >= SVN_FS_FS__MIN_REP_SHARING_FORMAT)
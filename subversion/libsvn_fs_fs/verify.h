@@ -29,10 +29,20 @@
  * START to END where possible.  Indicate progress via the optional
  * NOTIFY_FUNC callback using NOTIFY_BATON.  The optional CANCEL_FUNC
  * will periodically be called with CANCEL_BATON to allow for preemption.
+ *
+ * If JOBS is larger than 1 and OPEN_FUNC is not NULL, check the indexes
+ * and checksums of up to JOBS shards concurrently, each one in a separate
+ * thread with its own FS instance provided by OPEN_FUNC with OPEN_BATON.
+ * NOTIFY_FUNC will only be called from the calling thread and in
+ * revision order but CANCEL_FUNC will also be called from the workers.
+ *
  * Use POOL for temporary allocations. */
 svn_error_t *svn_fs_fs__verify(svn_fs_t *fs,
                                svn_revnum_t start,
                                svn_revnum_t end,
+                               int jobs,
+                               svn_fs_fs__open_fs_func_t open_func,
+                               void *open_baton,
                                svn_fs_progress_notify_func_t notify_func,
                                void *notify_baton,
                                svn_cancel_func_t cancel_func,
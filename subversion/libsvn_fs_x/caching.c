@@ -257,16 +257,31 @@ dump_global_cache_statistics(void *baton_void)
 
 #endif /* SVN_DEBUG_CACHE_DUMP_STATS */
 
+/* Return the kind of cache that uses the key PREFIX for reporting it to
+ * monitoring, e.g. "fsx:DIR".  Allocate the result in RESULT_POOL.
+ */
+static const char *
+get_metrics_kind(const char *prefix,
+                 apr_pool_t *result_pool)
+{
+  /* The last part of the prefix identifies the type of data. */
+  const char *kind = strrchr(prefix, ':');
+  return apr_pstrcat(result_pool, "fsx:", kind ? kind + 1 : prefix,
+                     SVN_VA_NULL);
+}
+
 /* This function sets / registers the required callbacks for a given
  * not transaction-specific CACHE object in FS, if CACHE is not NULL.
  *
  * All these svn_cache__t instances shall be handled uniformly. Unless
- * ERROR_HANDLER is NULL, register it for the given CACHE in FS.
+ * ERROR_HANDLER is NULL, register it for the given CACHE in FS.  Unless
+ * METRICS_KIND is NULL, report CACHE's statistics under that name.
  */
 static svn_error_t *
 init_callbacks(svn_cache__t *cache,
                svn_fs_t *fs,
                svn_cache__error_handler_t error_handler,
+               const char *metrics_kind,
                apr_pool_t *pool)
 {
 #ifdef SVN_DEBUG_CACHE_DUMP_STATS
@@ -292,6 +307,10 @@ init_callbacks(svn_cache__t *cache,
                                           fs,
                                           pool));
 
+  /* Report access statistics to monitoring, if enabled. */
+  if (metrics_kind)
+    SVN_ERR(svn_cache__register_metrics(cache, metrics_kind, pool));
+
   return SVN_NO_ERROR;
 }
 
@@ -368,7 +387,9 @@ create_cache(svn_cache__t **cache_p,
       SVN_ERR(svn_cache__create_null(cache_p, prefix, result_pool));
     }
 
-  SVN_ERR(init_callbacks(*cache_p, fs, error_handler, result_pool));
+  SVN_ERR(init_callbacks(*cache_p, fs, error_handler,
+                         get_metrics_kind(prefix, result_pool),
+                         result_pool));
 
   return SVN_NO_ERROR;
 }
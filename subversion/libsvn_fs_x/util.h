@@ -25,7 +25,7 @@
 
 #include "svn_fs.h"
 #include "id.h"
-#include "batch_fsync.h"
+#include "private/svn_fs_util.h"
 
 /* Functions for dealing with recoverable errors on mutable files
  *
@@ -454,7 +454,7 @@ svn_error_t *
 svn_fs_x__move_into_place(const char *old_filename,
                           const char *new_filename,
                           const char *perms_reference,
-                          svn_fs_x__batch_fsync_t *batch,
+                          svn_fs__batch_fsync_t *batch,
                           apr_pool_t *scratch_pool);
 
 #endif
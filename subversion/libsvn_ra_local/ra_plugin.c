@@ -155,13 +155,13 @@ cache_init(void *baton, apr_pool_t *pool)
   if (memory_cache_size_str)
     {
       apr_uint64_t memory_cache_size;
-      svn_cache_config_t settings = *svn_cache_config_get();
+      svn_cache_config2_t settings = *svn_cache_config_get2();
 
       SVN_ERR(svn_error_quick_wrap(svn_cstring_atoui64(&memory_cache_size,
                                                        memory_cache_size_str),
                                    _("memory-cache-size invalid")));
       settings.cache_size = 1024 * 1024 * memory_cache_size;
-      svn_cache_config_set(&settings);
+      svn_cache_config_set2(&settings);
     }
 
   return SVN_NO_ERROR;
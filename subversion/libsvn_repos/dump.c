@@ -23,6 +23,8 @@
 
 #include <stdarg.h>
 
+#include <apr_thread_proc.h>
+
 #include "svn_private_config.h"
 #include "svn_pools.h"
 #include "svn_error.h"
@@ -41,6 +43,7 @@
 #include "private/svn_repos_private.h"
 #include "private/svn_mergeinfo_private.h"
 #include "private/svn_fs_private.h"
+#include "private/svn_atomic.h"
 #include "private/svn_sorts_private.h"
 #include "private/svn_utf_private.h"
 #include "private/svn_cache.h"
@@ -2459,12 +2462,436 @@ report_error(svn_revnum_t revision,
     }
 }
 
+#if APR_HAS_THREADS
+/* Number of consecutive revisions verified by a single job in
+   verify_revisions_concurrently(). */
+#define VERIFY_CHUNK_SIZE 16
+
+/* How often the main thread checks for cancellation while waiting for
+   verification threads. */
+#define VERIFY_JOB_POLL_INTERVAL (APR_USEC_PER_SEC / 20)
+
+/* Outcome of verifying a single revision in a worker thread. */
+typedef struct verify_rev_result_t
+{
+  /* Notifications sent while verifying the revision, to be replayed by
+     the main thread.  NULL, if the caller does not want notifications. */
+  apr_array_header_t *notifications;
+
+  /* Copies of the warnings that the worker FS issued while verifying the
+     revision, to be forwarded to the caller's FS by the main thread. */
+  apr_array_header_t *warnings;
+
+  /* The verification error or SVN_NO_ERROR. */
+  svn_error_t *err;
+} verify_rev_result_t;
+
+/* Work item for verify_thread(). */
+typedef struct verify_job_t
+{
+  /* The filesystem to open.  Private copies owned by this job. */
+  const char *fs_path;
+  apr_hash_t *fs_config;
+
+  /* As passed to svn_repos_verify_fs4(). */
+  svn_revnum_t start_rev;
+  svn_boolean_t check_normalization;
+
+  /* Set by the main thread to make all jobs of a batch stop early.
+     Shared between those jobs. */
+  volatile svn_atomic_t *cancelled;
+
+  /* Set by the verification thread once it has finished. */
+  volatile svn_atomic_t finished;
+
+  /* Whether to buffer notifications at all. */
+  svn_boolean_t notify;
+
+  /* Whether to continue after the first verification failure. */
+  svn_boolean_t keep_going;
+
+  /* Verify revisions FIRST to FIRST + COUNT - 1. */
+  svn_revnum_t first;
+  int count;
+
+  /* COUNT results, of which the first DONE are valid. */
+  verify_rev_result_t *results;
+  int done;
+
+  /* Error that prevented the job from verifying anything. */
+  svn_error_t *err;
+
+  /* Copies of the warnings that the worker FS issued outside the
+     verification of any specific revision. */
+  apr_array_header_t *other_warnings;
+
+  /* Where to put new warnings of the worker FS.  Either OTHER_WARNINGS or
+     the WARNINGS of the revision currently being verified. */
+  apr_array_header_t *warnings;
+
+  /* Root pool used exclusively by this job until it has been reported. */
+  apr_pool_t *pool;
+
+  /* The thread executing this job. */
+  apr_thread_t *thread;
+} verify_job_t;
+
+/* Implements svn_repos_notify_func_t.  Append a copy of NOTIFY to the
+   array of notifications in BATON. */
+static void
+buffer_notify_func(void *baton,
+                   const svn_repos_notify_t *notify,
+                   apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *notifications = baton;
+  apr_pool_t *pool = notifications->pool;
+  svn_repos_notify_t *copy = apr_pmemdup(pool, notify, sizeof(*notify));
+
+  copy->warning_str = apr_pstrdup(pool, notify->warning_str);
+  copy->path = apr_pstrdup(pool, notify->path);
+
+  APR_ARRAY_PUSH(notifications, const svn_repos_notify_t *) = copy;
+}
+
+/* Implements svn_fs_warning_callback_t.  Append a copy of ERR to the
+   current list of warnings of the verify_job_t in BATON. */
+static void
+buffer_warning(void *baton,
+               svn_error_t *err)
+{
+  verify_job_t *job = baton;
+
+  APR_ARRAY_PUSH(job->warnings, svn_error_t *) = svn_error_dup(err);
+}
+
+/* Pass all warnings in WARNINGS to the warning callback of FS and
+   clear them.  WARNINGS may be NULL. */
+static void
+forward_warnings(svn_fs_t *fs,
+                 apr_array_header_t *warnings)
+{
+  int i;
+
+  if (!warnings)
+    return;
+
+  for (i = 0; i < warnings->nelts; ++i)
+    {
+      svn_error_t *warning = APR_ARRAY_IDX(warnings, i, svn_error_t *);
+
+      svn_fs__warn(fs, warning);
+      svn_error_clear(warning);
+    }
+
+  apr_array_clear(warnings);
+}
+
+/* Clear all warnings in WARNINGS without reporting them.  WARNINGS may
+   be NULL. */
+static void
+clear_warnings(apr_array_header_t *warnings)
+{
+  int i;
+
+  if (!warnings)
+    return;
+
+  for (i = 0; i < warnings->nelts; ++i)
+    svn_error_clear(APR_ARRAY_IDX(warnings, i, svn_error_t *));
+
+  apr_array_clear(warnings);
+}
+
+/* Implements svn_cancel_func_t for the verify_job_t in BATON.
+
+   The caller's cancel function may not be thread-safe, so only the main
+   thread invokes it.  The verification threads simply poll the shared
+   flag. */
+static svn_error_t *
+verify_job_cancel(void *baton)
+{
+  verify_job_t *job = baton;
+
+  if (svn_atomic_read(job->cancelled))
+    return svn_error_create(SVN_ERR_CANCELLED, NULL, NULL);
+
+  return SVN_NO_ERROR;
+}
+
+/* Thread function verifying the revisions of the verify_job_t in DATA. */
+static void * APR_THREAD_FUNC
+verify_thread(apr_thread_t *thread,
+              void *data)
+{
+  verify_job_t *job = data;
+  apr_pool_t *fs_pool = svn_pool_create(job->pool);
+  apr_pool_t *iterpool = svn_pool_create(fs_pool);
+  svn_fs_t *fs;
+
+  job->err = svn_fs_open2(&fs, job->fs_path, job->fs_config, fs_pool,
+                          iterpool);
+  if (!job->err)
+    {
+      svn_fs_set_warning_func(fs, buffer_warning, job);
+
+      while (job->done < job->count)
+        {
+          verify_rev_result_t *result = &job->results[job->done++];
+
+          svn_pool_clear(iterpool);
+          if (job->notify)
+            result->notifications
+              = apr_array_make(job->pool, 0,
+                               sizeof(const svn_repos_notify_t *));
+
+          result->warnings = apr_array_make(job->pool, 0,
+                                            sizeof(svn_error_t *));
+          job->warnings = result->warnings;
+
+          result->err = verify_one_revision(fs, job->first + job->done - 1,
+                                            job->notify
+                                              ? buffer_notify_func
+                                              : NULL,
+                                            result->notifications,
+                                            job->start_rev,
+                                            job->check_normalization,
+                                            verify_job_cancel, job,
+                                            iterpool);
+
+          /* The main thread will stop at this point anyway. */
+          if (result->err
+              && (!job->keep_going
+                  || result->err->apr_err == SVN_ERR_CANCELLED))
+            break;
+        }
+
+      job->warnings = job->other_warnings;
+    }
+
+  svn_pool_destroy(fs_pool);
+  svn_atomic_set(&job->finished, TRUE);
+  apr_thread_exit(thread, APR_SUCCESS);
+
+  return NULL;
+}
+
+/* Report the outcome of the COUNT jobs in BATCH the same way as
+   svn_repos_verify_fs4() would report a sequential verification, in
+   revision order.  Warnings of the worker FSes get forwarded to FS at the
+   point where FS would have issued them.  Errors handed over to the caller
+   or to VERIFY_CALLBACK are reset in BATCH.  NOTIFY is a #svn_repos_notify_verify_rev_end
+   notification to reuse.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+report_verify_jobs(svn_fs_t *fs,
+                   verify_job_t *batch,
+                   int count,
+                   svn_repos_notify_t *notify,
+                   svn_repos_notify_func_t notify_func,
+                   void *notify_baton,
+                   svn_repos_verify_callback_t verify_callback,
+                   void *verify_baton,
+                   apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  int i, k;
+
+  for (i = 0; i < count; ++i)
+    {
+      verify_job_t *job = &batch[i];
+
+      if (job->err)
+        {
+          svn_error_t *err = job->err;
+          job->err = SVN_NO_ERROR;
+
+          return svn_error_trace(err);
+        }
+
+      for (k = 0; k < job->done; ++k)
+        {
+          verify_rev_result_t *result = &job->results[k];
+          svn_revnum_t rev = job->first + k;
+          svn_error_t *err = result->err;
+
+          svn_pool_clear(iterpool);
+          result->err = SVN_NO_ERROR;
+
+          forward_warnings(fs, result->warnings);
+          if (notify_func && result->notifications)
+            {
+              int n;
+              for (n = 0; n < result->notifications->nelts; ++n)
+                notify_func(notify_baton,
+                            APR_ARRAY_IDX(result->notifications, n,
+                                          const svn_repos_notify_t *),
+                            iterpool);
+            }
+
+          if (err && err->apr_err == SVN_ERR_CANCELLED)
+            {
+              return svn_error_trace(err);
+            }
+          else if (err)
+            {
+              SVN_ERR(report_error(rev, err, verify_callback, verify_baton,
+                                   iterpool));
+            }
+          else if (notify_func)
+            {
+              /* Tell the caller that we're done with this revision. */
+              notify->revision = rev;
+              notify_func(notify_baton, notify, iterpool);
+            }
+        }
+
+      forward_warnings(fs, job->other_warnings);
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Verify revisions START_REV to END_REV of FS like the sequential loop in
+   svn_repos_verify_fs4() does, but with up to JOBS worker threads that
+   each verify a chunk of VERIFY_CHUNK_SIZE revisions using their own FS
+   instance.  All other parameters are as for svn_repos_verify_fs4(). */
+static svn_error_t *
+verify_revisions_concurrently(svn_fs_t *fs,
+                              svn_revnum_t start_rev,
+                              svn_revnum_t end_rev,
+                              svn_boolean_t check_normalization,
+                              int jobs,
+                              svn_repos_notify_func_t notify_func,
+                              void *notify_baton,
+                              svn_repos_verify_callback_t verify_callback,
+                              void *verify_baton,
+                              svn_cancel_func_t cancel_func,
+                              void *cancel_baton,
+                              apr_pool_t *scratch_pool)
+{
+  const char *fs_path = svn_fs_path(fs, scratch_pool);
+  apr_hash_t *fs_config = svn_fs_config(fs, scratch_pool);
+  svn_repos_notify_t *notify
+    = svn_repos_notify_create(svn_repos_notify_verify_rev_end, scratch_pool);
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  svn_revnum_t rev = start_rev;
+
+  while (rev <= end_rev)
+    {
+      verify_job_t *batch;
+      volatile svn_atomic_t cancelled = FALSE;
+      svn_error_t *err = SVN_NO_ERROR;
+      int count, started, i, k;
+
+      svn_pool_clear(iterpool);
+
+      if (cancel_func)
+        SVN_ERR(cancel_func(cancel_baton));
+
+      /* Split the next part of the range into up to JOBS chunks.
+       * Pools are not thread-safe, so each job gets its own root pool. */
+      batch = apr_pcalloc(iterpool, jobs * sizeof(*batch));
+      for (count = 0; count < jobs && rev <= end_rev; ++count)
+        {
+          verify_job_t *job = &batch[count];
+
+          job->pool
+            = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+          job->fs_path = apr_pstrdup(job->pool, fs_path);
+          job->fs_config = fs_config ? apr_hash_copy(job->pool, fs_config)
+                                     : NULL;
+          job->start_rev = start_rev;
+          job->check_normalization = check_normalization;
+          job->cancelled = &cancelled;
+          job->notify = notify_func != NULL;
+          job->keep_going = verify_callback != NULL;
+          job->first = rev;
+          job->count = (int)MIN(VERIFY_CHUNK_SIZE, end_rev - rev + 1);
+          job->results = apr_pcalloc(job->pool,
+                                     job->count * sizeof(*job->results));
+          job->other_warnings = apr_array_make(job->pool, 0,
+                                               sizeof(svn_error_t *));
+          job->warnings = job->other_warnings;
+
+          rev += job->count;
+        }
+
+      for (started = 0; started < count; ++started)
+        {
+          apr_status_t status = apr_thread_create(&batch[started].thread,
+                                                  NULL, verify_thread,
+                                                  &batch[started], iterpool);
+          if (status)
+            {
+              err = svn_error_wrap_apr(status,
+                                       _("Can't create verification thread"));
+              break;
+            }
+        }
+
+      /* Wait for all jobs.  We must not leave running threads behind.
+       * Only this thread may call CANCEL_FUNC.  Tell the workers to stop
+       * upon cancellation or if some thread could not be started. */
+      for (i = 0; i < started; ++i)
+        {
+          apr_status_t retval;
+          apr_status_t status;
+
+          while (!svn_atomic_read(&batch[i].finished))
+            {
+              if (!err && cancel_func)
+                err = cancel_func(cancel_baton);
+              if (err)
+                svn_atomic_set(&cancelled, TRUE);
+
+              apr_sleep(VERIFY_JOB_POLL_INTERVAL);
+            }
+
+          status = apr_thread_join(&retval, batch[i].thread);
+
+          if (status)
+            err = svn_error_compose_create(err,
+                     svn_error_wrap_apr(status,
+                                        _("Can't join verification thread")));
+        }
+
+      if (!err)
+        err = report_verify_jobs(fs, batch, count, notify,
+                                 notify_func, notify_baton,
+                                 verify_callback, verify_baton, iterpool);
+
+      /* Release whatever has not been reported. */
+      for (i = 0; i < count; ++i)
+        {
+          for (k = 0; k < batch[i].done; ++k)
+            {
+              svn_error_clear(batch[i].results[k].err);
+              clear_warnings(batch[i].results[k].warnings);
+            }
+
+          clear_warnings(batch[i].other_warnings);
+
+          svn_error_clear(batch[i].err);
+          svn_pool_destroy(batch[i].pool);
+        }
+
+      SVN_ERR(err);
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+#endif
+
 svn_error_t *
-svn_repos_verify_fs3(svn_repos_t *repos,
+svn_repos_verify_fs4(svn_repos_t *repos,
                      svn_revnum_t start_rev,
                      svn_revnum_t end_rev,
                      svn_boolean_t check_normalization,
                      svn_boolean_t metadata_only,
+                     int jobs,
                      svn_repos_notify_func_t notify_func,
                      void *notify_baton,
                      svn_repos_verify_callback_t verify_callback,
@@ -2508,7 +2935,7 @@ svn_repos_verify_fs3(svn_repos_t *repos,
                              end_rev, youngest);
 
   /* Create a notify object that we can reuse within the loop and a
-     forwarding structure for notifications from inside svn_fs_verify(). */
+     forwarding structure for notifications from inside svn_fs_verify2(). */
   if (notify_func)
     {
       notify = svn_repos_notify_create(svn_repos_notify_verify_rev_end, pool);
@@ -2522,10 +2949,10 @@ svn_repos_verify_fs3(svn_repos_t *repos,
     }
 
   /* Verify global metadata and backend-specific data first. */
-  err = svn_fs_verify(svn_fs_path(fs, pool), svn_fs_config(fs, pool),
-                      start_rev, end_rev,
-                      verify_notify, verify_notify_baton,
-                      cancel_func, cancel_baton, pool);
+  err = svn_fs_verify2(svn_fs_path(fs, pool), svn_fs_config(fs, pool),
+                       start_rev, end_rev, jobs,
+                       verify_notify, verify_notify_baton,
+                       cancel_func, cancel_baton, pool);
 
   if (err && err->apr_err == SVN_ERR_CANCELLED)
     {
@@ -2537,6 +2964,16 @@ svn_repos_verify_fs3(svn_repos_t *repos,
                            verify_baton, iterpool));
     }
 
+#if APR_HAS_THREADS
+  if (!metadata_only && jobs > 1)
+    SVN_ERR(verify_revisions_concurrently(fs, start_rev, end_rev,
+                                          check_normalization, jobs,
+                                          notify_func, notify_baton,
+                                          verify_callback, verify_baton,
+                                          cancel_func, cancel_baton,
+                                          iterpool));
+  else
+#endif
   if (!metadata_only)
     for (rev = start_rev; rev <= end_rev; rev++)
       {
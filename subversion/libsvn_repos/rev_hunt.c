@@ -39,6 +39,7 @@
 #include "repos.h"
 #include "private/svn_fspath.h"
 #include "private/svn_fs_private.h"
+#include "private/svn_fs_fs_private.h"
 #include "private/svn_sorts_private.h"
 
 
@@ -304,6 +305,86 @@ svn_repos_history2(svn_fs_t *fs,
 }
 
 
+/* Set *LOOK_LOWER to TRUE if PATH@REVISION in FS does not exist or is not
+ * the node that existed at START_ROOT / PATH, i.e. if the deletion that
+ * svn_repos_deleted_rev() is looking for happened at or before REVISION.
+ * START is the revision of START_ROOT.  See the matrix in
+ * svn_repos_deleted_rev() for details.  Use POOL for temporaries.
+ */
+static svn_error_t *
+deleted_at_or_before(svn_boolean_t *look_lower,
+                     svn_fs_t *fs,
+                     svn_fs_root_t *start_root,
+                     const char *path,
+                     svn_revnum_t start,
+                     svn_revnum_t revision,
+                     apr_pool_t *pool)
+{
+  svn_fs_root_t *root, *copy_root = NULL;
+  const char *copy_path;
+  svn_node_kind_t kind;
+  svn_fs_node_relation_t node_relation;
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, revision, pool));
+  SVN_ERR(svn_fs_check_path(&kind, root, path, pool));
+  if (kind == svn_node_none)
+    {
+      /* Case D. */
+      *look_lower = TRUE;
+      return SVN_NO_ERROR;
+    }
+
+  SVN_ERR(svn_fs_node_relation(&node_relation, start_root, path,
+                               root, path, pool));
+  if (node_relation != svn_fs_node_unrelated)
+    SVN_ERR(svn_fs_closest_copy(&copy_root, &copy_path, root,
+                                path, pool));
+
+  /* Cases A, B, C vs. E, F. */
+  *look_lower = node_relation == svn_fs_node_unrelated
+             || (copy_root && svn_fs_revision_root_revision(copy_root) > start);
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *REVISIONS to the sorted list of revisions in START to END in which
+ * PATH, one of its parents or one of its sub-paths got changed in FS.
+ * Set it to NULL if FS does not index changed paths.  Allocate the result
+ * in RESULT_POOL and use SCRATCH_POOL for temporaries.
+ */
+static svn_error_t *
+get_changed_revisions(apr_array_header_t **revisions,
+                      svn_fs_t *fs,
+                      const char *path,
+                      svn_revnum_t start,
+                      svn_revnum_t end,
+                      apr_pool_t *result_pool,
+                      apr_pool_t *scratch_pool)
+{
+  svn_fs_fs__ioctl_path_revisions_input_t input;
+  svn_fs_fs__ioctl_path_revisions_output_t *output;
+  svn_error_t *err;
+
+  input.path = path;
+  input.start = start;
+  input.end = end;
+
+  err = svn_fs_ioctl(fs, SVN_FS_FS__IOCTL_PATH_REVISIONS, &input,
+                     (void **)&output, NULL, NULL,
+                     result_pool, scratch_pool);
+  if (err && err->apr_err == SVN_ERR_FS_UNRECOGNIZED_IOCTL_CODE)
+    {
+      svn_error_clear(err);
+      *revisions = NULL;
+      return SVN_NO_ERROR;
+    }
+
+  SVN_ERR(err);
+  *revisions = output->revisions;
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_repos_deleted_rev(svn_fs_t *fs,
                       const char *path,
@@ -317,6 +398,8 @@ svn_repos_deleted_rev(svn_fs_t *fs,
   svn_revnum_t mid_rev;
   svn_node_kind_t kind;
   svn_fs_node_relation_t node_relation;
+  apr_array_header_t *revisions;
+  svn_boolean_t look_lower;
 
   /* Validate the revision range. */
   if (! SVN_IS_VALID_REVNUM(start))
@@ -432,55 +515,67 @@ svn_repos_deleted_rev(svn_fs_t *fs,
      node          |     look LOWER                                     |
                    |                                                    |
      --------------------------------------------------------------------
+
+     The outcome can only change in revisions that touched PATH or one of
+     its parents.  If the filesystem can tell us which revisions those
+     are, restrict the search to them.  END itself looks LOWER, hence so
+     does the youngest of them.
   */
 
-  mid_rev = (start + end) / 2;
   iterpool = svn_pool_create(pool);
+  SVN_ERR(get_changed_revisions(&revisions, fs, path, start + 1, end,
+                                pool, iterpool));
+  if (revisions && revisions->nelts)
+    {
+      int lower = 0;
+      int upper = revisions->nelts - 1;
+
+      while (lower < upper)
+        {
+          int mid = lower + (upper - lower) / 2;
+
+          svn_pool_clear(iterpool);
+          SVN_ERR(deleted_at_or_before(&look_lower, fs, start_root, path,
+                                       start,
+                                       APR_ARRAY_IDX(revisions, mid,
+                                                     svn_revnum_t),
+                                       iterpool));
+          if (look_lower)
+            upper = mid;
+          else
+            lower = mid + 1;
+        }
+
+      *deleted = APR_ARRAY_IDX(revisions, lower, svn_revnum_t);
+      svn_pool_destroy(iterpool);
+      return SVN_NO_ERROR;
+    }
+
+  mid_rev = (start + end) / 2;
 
   while (1)
     {
       svn_pool_clear(iterpool);
 
-      /* Get revision root and node id for mid_rev at that revision. */
-      SVN_ERR(svn_fs_revision_root(&root, fs, mid_rev, iterpool));
-      SVN_ERR(svn_fs_check_path(&kind, root, path, iterpool));
-      if (kind == svn_node_none)
+      SVN_ERR(deleted_at_or_before(&look_lower, fs, start_root, path,
+                                   start, mid_rev, iterpool));
+      if (look_lower)
         {
-          /* Case D: Look lower in the range. */
+          /* Cases A, B, C, D: Look at lower revs. */
           end = mid_rev;
           mid_rev = (start + mid_rev) / 2;
         }
+      else if (end - mid_rev == 1)
+        {
+          /* Found the node path was deleted. */
+          *deleted = end;
+          break;
+        }
       else
         {
-          svn_fs_root_t *copy_root;
-          const char *copy_path;
-          /* Determine the relationship between the start node
-             and the current node. */
-          SVN_ERR(svn_fs_node_relation(&node_relation, start_root, path,
-                                       root, path, iterpool));
-          if (node_relation != svn_fs_node_unrelated)
-            SVN_ERR(svn_fs_closest_copy(&copy_root, &copy_path, root,
-                                        path, iterpool));
-          if (node_relation == svn_fs_node_unrelated ||
-              (copy_root &&
-               (svn_fs_revision_root_revision(copy_root) > start)))
-            {
-              /* Cases A, B, C: Look at lower revs. */
-              end = mid_rev;
-              mid_rev = (start + mid_rev) / 2;
-            }
-          else if (end - mid_rev == 1)
-            {
-              /* Found the node path was deleted. */
-              *deleted = end;
-              break;
-            }
-          else
-            {
-              /* Cases E, F: Look at higher revs. */
-              start = mid_rev;
-              mid_rev = (start + end) / 2;
-            }
+          /* Cases E, F: Look at higher revs. */
+          start = mid_rev;
+          mid_rev = (start + end) / 2;
         }
     }
 
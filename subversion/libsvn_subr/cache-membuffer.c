@@ -24,6 +24,8 @@
 #include <assert.h>
 #include <apr_md5.h>
 #include <apr_thread_rwlock.h>
+#include <apr_global_mutex.h>
+#include <apr_shm.h>
 
 #include "svn_pools.h"
 #include "svn_checksum.h"
@@ -129,6 +131,33 @@
  * to scale well despite that bottleneck, we simply segment the cache into
  * a number of independent caches (segments). Items will be multiplexed based
  * on their hash key.
+ *
+ * Optionally, readers may bypass the segment lock entirely.  In that mode,
+ * the entry groups of every segment are mapped onto STRIPE_COUNT stripes,
+ * each of which has a sequence counter ("seqlock").  A writer makes the
+ * counter odd before it modifies any group of that stripe and makes it
+ * even again when it releases the segment lock.  An optimistic reader
+ * remembers the counter value, looks up and copies the data without any
+ * locking and then checks whether the counter is still the same.  Only
+ * if that validation fails, the reader falls back to the locked path.
+ * As a result, hits on hot entries neither block other readers nor do
+ * they need exclusive access to update hit counts.
+ *
+ * With the TinyLFU policy, each segment also maintains a frequency sketch
+ * (see frequency_sketch_t) of all recently requested keys, including
+ * those that are not in the cache.  L1 then serves as the admission
+ * window and L2 as a segmented LRU: entries that got hit since the last
+ * time the L2 insertion window passed them are "protected" and survive.
+ * All others are on "probation" and will only be replaced by entries
+ * from L1 that have been requested more often.  Otherwise, the incoming
+ * entry gets dropped.  That way, one-time bulk access cannot flush the
+ * frequently used contents of L2.
+ *
+ * Optionally, large serialized items get LZ4-compressed before being
+ * stored (see svn_cache__membuffer_set_compression).  Compression and
+ * decompression happen outside the segment locks except for partial
+ * getters and setters, which need the uncompressed item while holding
+ * the lock.  Partially modified items will be stored uncompressed.
  */
 
 /* APR's read-write lock implementation on Windows is horribly inefficient.
@@ -146,6 +175,72 @@
 #  define USE_SIMPLE_MUTEX 0
 #endif
 
+/* Optimistic reads need proper memory barriers to detect concurrent
+ * modifications reliably.  If we don't know how to get these, readers
+ * will always use the segment lock.  The debug tags stored with each
+ * entry are only verified on the locked code path, so disable optimistic
+ * reads in that configuration as well.
+ */
+#if defined(SVN_DEBUG_CACHE_MEMBUFFER)
+#  define SUPPORT_OPTIMISTIC_READS 0
+#  define MEMORY_BARRIER()
+#elif defined(SVN_HAS_ATOMIC_BUILTINS)
+#  define SUPPORT_OPTIMISTIC_READS 1
+#  define MEMORY_BARRIER() __sync_synchronize()
+#elif defined(_MSC_VER)
+#  define SUPPORT_OPTIMISTIC_READS 1
+#  define MEMORY_BARRIER() MemoryBarrier()
+#else
+#  define SUPPORT_OPTIMISTIC_READS 0
+#  define MEMORY_BARRIER()
+#endif
+
+/* A membuffer cache may be placed in an anonymous shared memory region
+ * to be used by all processes forked after its creation.  This requires
+ * a process-shared lock implementation that works without a lock file,
+ * i.e. whose child initialization is trivial.  The locks belong to the
+ * creating process; see svn_cache__membuffer_child_init() for how the
+ * children must treat them.  Note that all pointers within
+ * the svn_membuffer_t structures stay valid because the shared region is
+ * mapped to the same address in all child processes.
+ */
+#if !APR_HAS_FORK || !APR_HAS_SHARED_MEMORY || USE_SIMPLE_MUTEX
+#  define SUPPORT_SHARED_MEMORY 0
+#elif APR_HAS_PROC_PTHREAD_SERIALIZE
+#  define SUPPORT_SHARED_MEMORY 1
+#  define SHARED_LOCK_MECH APR_LOCK_PROC_PTHREAD
+#elif APR_HAS_SYSVSEM_SERIALIZE
+#  define SUPPORT_SHARED_MEMORY 1
+#  define SHARED_LOCK_MECH APR_LOCK_SYSVSEM
+#else
+#  define SUPPORT_SHARED_MEMORY 0
+#endif
+
+/* Number of stripes, i.e. sequence counters for optimistic readers, per
+ * cache segment.  Entry groups get mapped onto them round-robin.
+ *
+ * Must be a power of 2 and no larger than 64 because we track modified
+ * stripes in a 64 bit mask (see svn_membuffer_t.dirty_stripes).
+ */
+#define STRIPE_COUNT 64
+
+/* Number of lock-free lookup attempts before an optimistic reader falls
+ * back to using the segment lock.
+ */
+#define OPTIMISTIC_READ_ATTEMPTS 2
+
+/* Number of counters in the frequency sketch that get updated per key.
+ */
+#define SKETCH_DEPTH 4
+
+/* Frequency sketch counters saturate at this value.
+ */
+#define SKETCH_MAX_COUNT 15
+
+/* The frequency sketch gets aged after this many updates per counter.
+ */
+#define SKETCH_SAMPLE_FACTOR 10
+
 /* For more efficient copy operations, let's align all data items properly.
  * Since we can't portably align pointers, this is rather the item size
  * granularity which ensures *relative* alignment within the cache - still
@@ -563,7 +658,13 @@ typedef struct entry_t
    * above ensures that there will be no overflows.
    * Only valid for used entries.
    */
-  apr_size_t size;
+  apr_uint32_t size;
+
+  /* If the item data has been compressed, this is the size of the
+   * serialized item before compression.  0 for uncompressed items.
+   * Only valid for used entries.
+   */
+  apr_uint32_t original_size;
 
   /* Number of (read) hits for this entry. Will be reset upon write.
    * Only valid for used entries.
@@ -652,6 +753,46 @@ typedef struct entry_group_t
 
 } entry_group_t;
 
+/* The sequence counter of a stripe of entry groups.  An odd value means
+ * that some writer is currently modifying groups in that stripe.  The
+ * counters are padded to a typical cache line size such that writes to
+ * one stripe don't slow down readers of other stripes.
+ */
+typedef struct stripe_t
+{
+  /* Incremented when a writer starts to modify the stripe and again when
+   * the modifications have been completed. */
+  volatile svn_atomic_t sequence;
+
+  /* padding to avoid false sharing between stripes */
+  char padding[64 - sizeof(svn_atomic_t)];
+
+} stripe_t;
+
+/* A count-min sketch approximating the number of recent requests per key,
+ * used by the TinyLFU policy.  All counters get halved periodically, so
+ * the estimates reflect the recent past only.
+ *
+ * Lookups update the sketch without synchronization, i.e. concurrent
+ * updates may get lost.  That is fine since we need estimates only.
+ */
+typedef struct frequency_sketch_t
+{
+  /* SIZE saturating counters, one per byte.  NULL if the TinyLFU policy
+   * is not being used. */
+  unsigned char *counters;
+
+  /* Number of counters - 1.  SIZE is a power of two. */
+  apr_uint32_t mask;
+
+  /* Number of key requests recorded since the last aging. */
+  apr_uint32_t additions;
+
+  /* Age the sketch once ADDITIONS reached this value. */
+  apr_uint32_t sample_size;
+
+} frequency_sketch_t;
+
 /* Per-cache level header structure.  Instances of this are members of
  * svn_membuffer_t and will use non-overlapping sections of its DATA buffer.
  * All offset values are global / absolute to that whole buffer.
@@ -796,6 +937,34 @@ struct svn_membuffer_t
    */
   apr_uint64_t total_hits;
 
+  /* Total number of entries removed to make room for new data.
+   * Purely statistical information that may be used for profiling only.
+   * Updates are not synchronized and values may be nonsensicle on some
+   * platforms.
+   */
+  apr_uint64_t total_evictions;
+
+  /* Serialized items of at least this size will be compressed before
+   * storing them in the cache.  0, if compression is disabled.
+   */
+  apr_size_t compression_threshold;
+
+  /* Total number of bytes passed to and returned from the compressor.
+   * Purely statistical information that may be used for profiling only.
+   * Updates are not synchronized and values may be nonsensicle on some
+   * platforms.
+   */
+  apr_uint64_t compression_input;
+  apr_uint64_t compression_output;
+
+  /* Total time spent in compression and decompression in microseconds.
+   * Purely statistical information that may be used for profiling only.
+   * Updates are not synchronized and values may be nonsensicle on some
+   * platforms.
+   */
+  apr_uint64_t compression_time;
+  apr_uint64_t decompression_time;
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   /* A lock for intra-process synchronization to the cache, or NULL if
    * the cache's creator doesn't feel the cache needs to be
@@ -813,21 +982,221 @@ struct svn_membuffer_t
   svn_boolean_t allow_blocking_writes;
 #endif
 
+#if SUPPORT_SHARED_MEMORY
+  /* If the segment resides in shared memory, this is the lock that
+   * serializes all access to it across threads and processes.  Readers
+   * and writers alike will acquire it exclusively.  NULL otherwise.
+   */
+  apr_global_mutex_t *shared_lock;
+
+  /* Unmanaged pool holding all SHARED_LOCKs of the cache.  Only the
+   * creating process may destroy it and it does so by cleaning up
+   * OWNER_POOL.  Only set in the first segment.
+   */
+  apr_pool_t *shared_lock_pool;
+
+  /* The pool that the cache has been created in.  Only set in the first
+   * segment.
+   */
+  apr_pool_t *owner_pool;
+#endif
+
   /* A write lock counter, must be either 0 or 1.
    * This one is only used in debug assertions to verify that you used
    * the correct multi-threading settings. */
   svn_atomic_t write_lock_count;
+
+  /* STRIPE_COUNT sequence counters used to validate lock-free reads.
+   * NULL, if optimistic reads have not been enabled for this cache.
+   */
+  stripe_t *stripes;
+
+  /* Bit mask of the stripes whose sequence counters have been made odd
+   * by the current writer.  Only accessed while holding the write lock.
+   */
+  apr_uint64_t dirty_stripes;
+
+  /* Access frequency estimates, used by the TinyLFU policy only.
+   */
+  frequency_sketch_t sketch;
 };
 
 /* Align integer VALUE to the next ITEM_ALIGNMENT boundary.
  */
 #define ALIGN_VALUE(value) (((value) + ITEM_ALIGNMENT-1) & -ITEM_ALIGNMENT)
 
+/* Return the index of the stripe that the entry group GROUP_INDEX
+ * belongs to.
+ */
+#define STRIPE_INDEX(group_index) ((group_index) % STRIPE_COUNT)
+
+/* If optimistic reads are enabled for CACHE, tell them that the entry
+ * groups in the stripe of GROUP_INDEX are about to be modified.  Readers
+ * will not trust that stripe until publish_changes() has been called.
+ *
+ * Note: This function requires the caller to hold the write lock.
+ */
+static APR_INLINE void
+touch_group(svn_membuffer_t *cache, apr_uint32_t group_index)
+{
+  apr_uint64_t bit = APR_UINT64_C(1) << STRIPE_INDEX(group_index);
+  if (cache->stripes && !(cache->dirty_stripes & bit))
+    {
+      cache->dirty_stripes |= bit;
+      cache->stripes[STRIPE_INDEX(group_index)].sequence++;
+
+      /* Readers must see the odd counter before any modification. */
+      MEMORY_BARRIER();
+    }
+}
+
+/* Make all modifications to CACHE done since the first touch_group()
+ * call visible to optimistic readers.
+ *
+ * Note: This function requires the caller to hold the write lock.
+ */
+static void
+publish_changes(svn_membuffer_t *cache)
+{
+  if (cache->dirty_stripes)
+    {
+      apr_uint32_t i;
+
+      /* All modifications must be visible before the even counters. */
+      MEMORY_BARRIER();
+
+      for (i = 0; i < STRIPE_COUNT; ++i)
+        if (cache->dirty_stripes & (APR_UINT64_C(1) << i))
+          cache->stripes[i].sequence++;
+
+      cache->dirty_stripes = 0;
+    }
+}
+
+/* Begin a lock-free read of the entry group GROUP_INDEX in CACHE.
+ * Return the current sequence number of its stripe.  An odd value
+ * indicates that a writer is active and the caller should not try
+ * to read the group without a lock.
+ */
+static APR_INLINE apr_uint32_t
+begin_optimistic_read(svn_membuffer_t *cache, apr_uint32_t group_index)
+{
+  apr_uint32_t sequence = cache->stripes[STRIPE_INDEX(group_index)].sequence;
+
+  /* Don't read any cache contents before the sequence number. */
+  MEMORY_BARRIER();
+  return sequence;
+}
+
+/* Return TRUE, if no writer touched the stripe of entry group GROUP_INDEX
+ * in CACHE since begin_optimistic_read() returned SEQUENCE for it, i.e.
+ * if all data read in the meantime is consistent.
+ */
+static APR_INLINE svn_boolean_t
+validate_optimistic_read(svn_membuffer_t *cache,
+                         apr_uint32_t group_index,
+                         apr_uint32_t sequence)
+{
+  /* All cache contents must have been read before re-checking. */
+  MEMORY_BARRIER();
+  return sequence == cache->stripes[STRIPE_INDEX(group_index)].sequence;
+}
+
+/* Return a well-mixed 64 bit hash value for KEY.
+ */
+static APR_INLINE apr_uint64_t
+sketch_hash(const entry_key_t *key)
+{
+  apr_uint64_t hash = key->fingerprint[0]
+                    ^ (key->fingerprint[1] * APR_UINT64_C(0x9e3779b97f4a7c15));
+  return hash ^ (hash >> 29);
+}
+
+/* Return the index of the I-th counter for HASH in SKETCH.
+ */
+#define SKETCH_INDEX(sketch, hash, i) \
+  (((apr_uint32_t)(hash) + (i) * ((apr_uint32_t)((hash) >> 32) | 1)) \
+   & (sketch)->mask)
+
+/* Record a request for KEY in the frequency sketch of CACHE, if the
+ * TinyLFU policy is being used.
+ *
+ * This may be called without holding any lock.
+ */
+static void
+sketch_record(svn_membuffer_t *cache,
+              const entry_key_t *key)
+{
+  frequency_sketch_t *sketch = &cache->sketch;
+  if (sketch->counters)
+    {
+      apr_uint64_t hash = sketch_hash(key);
+      apr_uint32_t i;
+
+      for (i = 0; i < SKETCH_DEPTH; ++i)
+        {
+          unsigned char *counter
+            = &sketch->counters[SKETCH_INDEX(sketch, hash, i)];
+          if (*counter < SKETCH_MAX_COUNT)
+            ++*counter;
+        }
+
+      sketch->additions++;
+    }
+}
+
+/* Return the estimated number of recent requests for KEY in CACHE.
+ */
+static apr_uint32_t
+sketch_estimate(svn_membuffer_t *cache,
+                const entry_key_t *key)
+{
+  frequency_sketch_t *sketch = &cache->sketch;
+  apr_uint64_t hash = sketch_hash(key);
+  apr_uint32_t result = SKETCH_MAX_COUNT;
+  apr_uint32_t i;
+
+  for (i = 0; i < SKETCH_DEPTH; ++i)
+    result = MIN(result, sketch->counters[SKETCH_INDEX(sketch, hash, i)]);
+
+  return result;
+}
+
+/* If enough requests have been recorded in the frequency sketch of
+ * CACHE, halve all counters to let older requests fade out.
+ *
+ * Note: This function requires the caller to hold the write lock.
+ */
+static void
+sketch_age(svn_membuffer_t *cache)
+{
+  frequency_sketch_t *sketch = &cache->sketch;
+  if (sketch->counters && sketch->additions >= sketch->sample_size)
+    {
+      apr_size_t i;
+      for (i = 0; i <= sketch->mask; ++i)
+        sketch->counters[i] >>= 1;
+
+      sketch->additions /= 2;
+    }
+}
+
 /* If locking is supported for CACHE, acquire a read lock for it.
  */
 static svn_error_t *
 read_lock_cache(svn_membuffer_t *cache)
 {
+#if SUPPORT_SHARED_MEMORY
+  if (cache->shared_lock)
+    {
+      apr_status_t status = apr_global_mutex_lock(cache->shared_lock);
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't lock cache mutex"));
+
+      return SVN_NO_ERROR;
+    }
+#endif
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   return svn_mutex__lock(cache->lock);
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
@@ -851,6 +1220,13 @@ read_lock_cache(svn_membuffer_t *cache)
 static svn_error_t *
 write_lock_cache(svn_membuffer_t *cache, svn_boolean_t *success)
 {
+#if SUPPORT_SHARED_MEMORY
+  /* Shared segments are always locked exclusively, so this is the same
+   * as a read lock. */
+  if (cache->shared_lock)
+    return svn_error_trace(read_lock_cache(cache));
+#endif
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   return svn_mutex__lock(cache->lock);
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
@@ -888,13 +1264,20 @@ write_lock_cache(svn_membuffer_t *cache, svn_boolean_t *success)
 static svn_error_t *
 force_write_lock_cache(svn_membuffer_t *cache)
 {
+#if SUPPORT_SHARED_MEMORY
+  if (cache->shared_lock)
+    return svn_error_trace(read_lock_cache(cache));
+#endif
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   return svn_mutex__lock(cache->lock);
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
-  apr_status_t status = apr_thread_rwlock_wrlock(cache->lock);
-  if (status)
-    return svn_error_wrap_apr(status,
-                              _("Can't write-lock cache mutex"));
+  {
+    apr_status_t status = apr_thread_rwlock_wrlock(cache->lock);
+    if (status)
+      return svn_error_wrap_apr(status,
+                                _("Can't write-lock cache mutex"));
+  }
 
   return SVN_NO_ERROR;
 #else
@@ -908,6 +1291,20 @@ force_write_lock_cache(svn_membuffer_t *cache)
 static svn_error_t *
 unlock_cache(svn_membuffer_t *cache, svn_error_t *err)
 {
+#if SUPPORT_SHARED_MEMORY
+  if (cache->shared_lock)
+    {
+      apr_status_t status = apr_global_mutex_unlock(cache->shared_lock);
+      if (err)
+        return err;
+
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't unlock cache mutex"));
+
+      return SVN_NO_ERROR;
+    }
+#endif
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   return svn_mutex__unlock(cache->lock, err);
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
@@ -927,6 +1324,16 @@ unlock_cache(svn_membuffer_t *cache, svn_error_t *err)
 #endif
 }
 
+/* Publish all modifications that the current writer made to CACHE to
+ * optimistic readers and release the write lock.  Return ERR upon success.
+ */
+static svn_error_t *
+unlock_cache_write(svn_membuffer_t *cache, svn_error_t *err)
+{
+  publish_changes(cache);
+  return unlock_cache(cache, err);
+}
+
 /* If supported, guard the execution of EXPR with a read lock to CACHE.
  * The macro has been modeled after SVN_MUTEX__WITH_LOCK.
  */
@@ -959,7 +1366,7 @@ do {                                                            \
       else                                                      \
         break;                                                  \
     }                                                           \
-  SVN_ERR(unlock_cache(cache, (expr)));                         \
+  SVN_ERR(unlock_cache_write(cache, (expr)));                   \
 } while (0)
 
 /* Returns 0 if the entry group identified by GROUP_INDEX in CACHE has not
@@ -995,6 +1402,8 @@ initialize_group(svn_membuffer_t *cache, apr_uint32_t group_index)
   for (i = first_index; i < last_index; ++i)
     {
       group_header_t *header = &cache->directory[i].header;
+      touch_group(cache, i);
+
       header->used = 0;
       header->chain_length = 1;
       header->next = NO_INDEX;
@@ -1109,6 +1518,25 @@ get_index(svn_membuffer_t *cache, entry_t *entry)
        + (apr_uint32_t)(entry - cache->directory[group_index].entries);
 }
 
+/* If optimistic reads are enabled for CACHE, tell them that the group
+ * chain containing ENTRY is about to be modified.
+ *
+ * Note: This function requires the caller to hold the write lock.
+ */
+static void
+touch_entry(svn_membuffer_t *cache, entry_t *entry)
+{
+  if (cache->stripes)
+    {
+      /* Readers always start at the first group of a chain. */
+      apr_uint32_t group_index = get_index(cache, entry) / GROUP_SIZE;
+      while (cache->directory[group_index].header.previous != NO_INDEX)
+        group_index = cache->directory[group_index].header.previous;
+
+      touch_group(cache, group_index);
+    }
+}
+
 /* Return the cache level of ENTRY in CACHE.
  */
 static cache_level_t *
@@ -1217,6 +1645,9 @@ drop_entry(svn_membuffer_t *cache, entry_t *entry)
 
   cache_level_t *level = get_cache_level(cache, entry);
 
+  /* ENTRY and maybe the last entry in its chain are going to change. */
+  touch_entry(cache, entry);
+
   /* update global cache usage counters
    */
   cache->used_entries--;
@@ -1308,6 +1739,7 @@ insert_entry(svn_membuffer_t *cache, entry_t *entry)
    */
   assert(entry->offset == level->current_data);
   assert(idx == group_index * GROUP_SIZE + group->header.used);
+  touch_entry(cache, entry);
   level->current_data = ALIGN_VALUE(entry->offset + entry->size);
 
   /* update usage counters
@@ -1407,6 +1839,10 @@ find_entry(svn_membuffer_t *cache,
    */
   group = &cache->directory[group_index];
 
+  /* We are going to modify the group chain. */
+  if (find_empty)
+    touch_group(cache, group_index);
+
   /* If the entry group has not been initialized, yet, there is no data.
    */
   if (! is_group_initialized(cache, group_index))
@@ -1539,6 +1975,7 @@ find_entry(svn_membuffer_t *cache,
               let_entry_age(cache, &to_shrink->entries[i]);
 
           drop_entry(cache, entry);
+          cache->total_evictions++;
         }
 
       /* initialize entry for the new key
@@ -1550,6 +1987,68 @@ find_entry(svn_membuffer_t *cache,
   return entry;
 }
 
+/* Lock-free variant of find_entry() with FIND_EMPTY being FALSE.
+ *
+ * Since writers may modify the directory concurrently, all references
+ * are checked to be within bounds before following them.  Still, the
+ * result may be bogus and must be validated by the caller using
+ * validate_optimistic_read().
+ */
+static entry_t *
+find_entry_optimistic(svn_membuffer_t *cache,
+                      apr_uint32_t group_index,
+                      const full_key_t *to_find)
+{
+  entry_group_t *group = &cache->directory[group_index];
+  apr_uint32_t group_limit = cache->group_count + cache->spare_group_count;
+  apr_uint64_t data_size = cache->l1.size + cache->l2.size;
+  apr_size_t key_len = to_find->entry_key.key_len;
+  apr_uint32_t chain_length;
+
+  /* If the entry group has not been initialized, yet, there is no data.
+   */
+  if (! is_group_initialized(cache, group_index))
+    return NULL;
+
+  for (chain_length = 1; ; ++chain_length)
+    {
+      apr_uint32_t i;
+      apr_uint32_t used = MIN(group->header.used, GROUP_SIZE);
+      apr_uint32_t next = group->header.next;
+
+      for (i = 0; i < used; ++i)
+        if (entry_keys_match(&group->entries[i].key, &to_find->entry_key))
+          {
+            entry_t *entry = &group->entries[i];
+            apr_uint64_t offset = entry->offset;
+
+            /* If the full key is fully defined in prefix_id & mangeled
+             * key, we are done. */
+            if (!key_len)
+              return entry;
+
+            /* Compare the full key.  The key length has already been
+             * found to be equal to ours. */
+            if (   offset <= data_size
+                && data_size - offset >= key_len
+                && memcmp(to_find->full_key.data, cache->data + offset,
+                          key_len) == 0)
+              return entry;
+
+            /* Key conflict. */
+            return NULL;
+          }
+
+      /* end of chain (or something bogus)? */
+      if (   next == NO_INDEX
+          || next >= group_limit
+          || chain_length >= MAX_GROUP_CHAIN_LENGTH)
+        return NULL;
+
+      group = &cache->directory[next];
+    }
+}
+
 /* Move a surviving ENTRY from just behind the insertion window to
  * its beginning and move the insertion window up accordingly.
  */
@@ -1559,6 +2058,9 @@ move_entry(svn_membuffer_t *cache, entry_t *entry)
   apr_size_t size = ALIGN_VALUE(entry->size);
   cache_level_t *level = get_cache_level(cache, entry);
 
+  /* ENTRY's data may be moved. */
+  touch_entry(cache, entry);
+
   /* This entry survived this cleansing run. Reset half of its
    * hit count so that its removal gets more likely in the next
    * run unless someone read / hit this entry in the meantime.
@@ -1599,6 +2101,7 @@ promote_entry(svn_membuffer_t *cache, entry_t *entry)
   apr_size_t size = ALIGN_VALUE(entry->size);
   assert(get_cache_level(cache, entry) == &cache->l1);
   assert(idx == cache->l1.next);
+  touch_entry(cache, entry);
 
   /* copy item from the current location in L1 to the start of L2's
    * insertion window */
@@ -1722,6 +2225,27 @@ ensure_data_insertable_l2(svn_membuffer_t *cache,
                */
               keep = FALSE;
             }
+          else if (cache->sketch.counters)
+            {
+              /* TinyLFU.  Entries that got hit since we passed them the
+               * last time are protected.  Their hit counts will be reduced
+               * when being moved, so they will eventually be on probation
+               * again unless they keep getting hits.
+               *
+               * Entries on probation only get replaced by more popular
+               * ones.  If the incoming entry is not, reject it right away
+               * instead of evicting other entries that might be popular.
+               */
+              if (entry->hit_count)
+                keep = TRUE;
+              else if (  sketch_estimate(cache, &entry->key)
+                         * (apr_uint64_t)entry->priority
+                       >= sketch_estimate(cache, &to_fit_in->key)
+                         * (apr_uint64_t)to_fit_in->priority)
+                return FALSE;
+              else
+                keep = FALSE;
+            }
           else
             {
               /* If the existing data is the same prio as the incoming data,
@@ -1756,6 +2280,7 @@ ensure_data_insertable_l2(svn_membuffer_t *cache,
                 drop_hits += entry->hit_count * (apr_uint64_t)entry->priority;
 
               drop_entry(cache, entry);
+              cache->total_evictions++;
             }
         }
     }
@@ -1821,9 +2346,14 @@ ensure_data_insertable_l1(svn_membuffer_t *cache, apr_size_t size)
           if (entry_index == cache->l1.next)
             {
               if (keep)
-                promote_entry(cache, entry);
+                {
+                  promote_entry(cache, entry);
+                }
               else
-                drop_entry(cache, entry);
+                {
+                  drop_entry(cache, entry);
+                  cache->total_evictions++;
+                }
             }
         }
     }
@@ -1832,31 +2362,120 @@ ensure_data_insertable_l1(svn_membuffer_t *cache, apr_size_t size)
    * right answer. */
 }
 
-svn_error_t *
-svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
-                                  apr_size_t total_size,
-                                  apr_size_t directory_size,
-                                  apr_size_t segment_count,
-                                  svn_boolean_t thread_safe,
-                                  svn_boolean_t allow_blocking_writes,
-                                  apr_pool_t *pool)
+/* Memory source for the cache segment structures and buffers.  If SHM is
+ * NULL, allocate from POOL.  Otherwise, hand out consecutive chunks of the
+ * shared memory region starting at NEXT.
+ */
+typedef struct segment_allocator_t
+{
+  /* Pool to allocate from, if SHM is NULL. */
+  apr_pool_t *pool;
+
+#if SUPPORT_SHARED_MEMORY
+  /* Shared memory region to allocate from or NULL. */
+  apr_shm_t *shm;
+#endif
+
+  /* Next unused byte in SHM. */
+  unsigned char *next;
+
+  /* Number of unused bytes in SHM. */
+  apr_size_t remaining;
+} segment_allocator_t;
+
+/* Return a memory block of SIZE bytes from ALLOCATOR.  If CLEAR is set,
+ * the contents will be all zero.  Return NULL if we are OOM.
+ */
+static void *
+segment_alloc(segment_allocator_t *allocator,
+              apr_size_t size,
+              svn_boolean_t clear)
+{
+  void *result;
+
+#if SUPPORT_SHARED_MEMORY
+  if (allocator->shm)
+    {
+      /* Shared memory has been zeroed by the OS upon creation. */
+      size = ALIGN_VALUE(size);
+      if (size > allocator->remaining)
+        return NULL;
+
+      result = allocator->next;
+      allocator->next += size;
+      allocator->remaining -= size;
+
+      return result;
+    }
+#endif
+
+  result = clear ? apr_pcalloc(allocator->pool, size)
+                 : apr_palloc(allocator->pool, size);
+
+  return result;
+}
+
+#if SUPPORT_SHARED_MEMORY
+/* Pool cleanup function destroying the apr_pool_t * BATON that holds the
+ * shared segment locks.  Children of the creating process must never run
+ * this (see svn_cache__membuffer_child_init) because it would destroy the
+ * locks for all other processes as well.
+ */
+static apr_status_t
+destroy_shared_locks(void *baton)
+{
+  apr_pool_destroy(baton);
+  return APR_SUCCESS;
+}
+#endif
+
+/* Implement svn_cache__membuffer_cache_create and
+ * svn_cache__membuffer_cache_create_shared.  If SHARED is set, allocate
+ * all segments in an anonymous shared memory region and protect them with
+ * process-shared locks, independent of THREAD_SAFE and
+ * ALLOW_BLOCKING_WRITES.
+ */
+static svn_error_t *
+membuffer_cache_create(svn_membuffer_t **cache,
+                       apr_size_t total_size,
+                       apr_size_t directory_size,
+                       apr_size_t segment_count,
+                       svn_boolean_t thread_safe,
+                       svn_boolean_t allow_blocking_writes,
+                       svn_boolean_t optimistic_reads,
+                       svn_boolean_t shared,
+                       svn_cache_policy_t policy,
+                       apr_pool_t *pool)
 {
   svn_membuffer_t *c;
   prefix_pool_t *prefix_pool;
+  segment_allocator_t allocator = { 0 };
 
   apr_uint32_t seg;
   apr_uint32_t group_count;
   apr_uint32_t main_group_count;
   apr_uint32_t spare_group_count;
   apr_uint32_t group_init_size;
+  apr_uint32_t sketch_size = 0;
   apr_uint64_t data_size;
   apr_uint64_t max_entry_size;
 
   /* Allocate 1% of the cache capacity to the prefix string pool.
+   *
+   * The prefix pool is process-local, i.e. different processes may assign
+   * different indexes to the same prefix.  So, we can't use it with shared
+   * caches at all and will always store the full keys instead.
    */
-  SVN_ERR(prefix_pool_create(&prefix_pool, total_size / 100, thread_safe,
-                             pool));
-  total_size -= total_size / 100;
+  if (shared)
+    {
+      SVN_ERR(prefix_pool_create(&prefix_pool, 0, thread_safe, pool));
+    }
+  else
+    {
+      SVN_ERR(prefix_pool_create(&prefix_pool, total_size / 100,
+                                 thread_safe, pool));
+      total_size -= total_size / 100;
+    }
 
   /* Limit the total size (only relevant if we can address > 4GB)
    */
@@ -1910,9 +2529,6 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
          && segment_count < MAX_SEGMENT_COUNT)
     segment_count *= 2;
 
-  /* allocate cache as an array of segments / cache objects */
-  c = apr_palloc(pool, segment_count * sizeof(*c));
-
   /* Split total cache size into segments of equal size
    */
   total_size /= segment_count;
@@ -1963,9 +2579,59 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
   assert(spare_group_count > 0 && main_group_count > 0);
 
   group_init_size = 1 + group_count / (8 * GROUP_INIT_GRANULARITY);
-  for (seg = 0; seg < segment_count; ++seg)
+
+  /* The frequency sketch should have at least one counter per entry
+   * the segment can hold.  Its size must be a power of two. */
+  if (policy == svn_cache_policy_tinylfu)
     {
-      /* allocate buffers and initialize cache members
+      sketch_size = 1;
+      while (   sketch_size < (apr_uint64_t)group_count * GROUP_SIZE
+             && sketch_size < 0x40000000)
+        sketch_size *= 2;
+    }
+
+  /* Where shall we allocate our segments from? */
+  allocator.pool = pool;
+  if (shared)
+    {
+#if SUPPORT_SHARED_MEMORY
+      apr_status_t status;
+      apr_uint64_t shm_size
+        = ALIGN_VALUE(segment_count * sizeof(*c))
+        + segment_count
+          * (  ALIGN_VALUE(group_count * sizeof(entry_group_t))
+             + ALIGN_VALUE(group_init_size)
+             + ALIGN_VALUE(STRIPE_COUNT * sizeof(stripe_t))
+             + ALIGN_VALUE(sketch_size)
+             + ALIGN_VALUE(data_size));
+
+      if (shm_size > APR_SIZE_MAX)
+        return svn_error_create(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                                _("Shared cache too large"));
+
+      status = apr_shm_create(&allocator.shm, (apr_size_t)shm_size, NULL,
+                              pool);
+      if (status)
+        return svn_error_wrap_apr(status,
+                                  _("Can't create shared memory cache"));
+
+      allocator.next = apr_shm_baseaddr_get(allocator.shm);
+      allocator.remaining = apr_shm_size_get(allocator.shm);
+#else
+      return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                              _("Shared memory caches are not supported "
+                                "on this platform"));
+#endif
+    }
+
+  /* allocate cache as an array of segments / cache objects */
+  c = segment_alloc(&allocator, segment_count * sizeof(*c), FALSE);
+  if (c == NULL)
+    return svn_error_wrap_apr(APR_ENOMEM, "OOM");
+
+  for (seg = 0; seg < segment_count; ++seg)
+    {
+      /* allocate buffers and initialize cache members
        */
       c[seg].segment_count = (apr_uint32_t)segment_count;
       c[seg].prefix_pool = prefix_pool;
@@ -1978,12 +2644,14 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
       /* Allocate but don't clear / zero the directory because it would add
          significantly to the server start-up time if the caches are large.
          Group initialization will take care of that in stead. */
-      c[seg].directory = apr_palloc(pool,
-                                    group_count * sizeof(entry_group_t));
+      c[seg].directory = segment_alloc(&allocator,
+                                       group_count * sizeof(entry_group_t),
+                                       FALSE);
 
       /* Allocate and initialize directory entries as "not initialized",
          hence "unused" */
-      c[seg].group_initialized = apr_pcalloc(pool, group_init_size);
+      c[seg].group_initialized = segment_alloc(&allocator, group_init_size,
+                                               TRUE);
 
       /* Allocate 1/4th of the data buffer to L1
        */
@@ -2004,7 +2672,9 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
       c[seg].l2.current_data = c[seg].l2.start_offset;
 
       /* This cast is safe because DATA_SIZE <= MAX_SEGMENT_SIZE. */
-      c[seg].data = apr_palloc(pool, (apr_size_t)ALIGN_VALUE(data_size));
+      c[seg].data = segment_alloc(&allocator,
+                                  (apr_size_t)ALIGN_VALUE(data_size),
+                                  FALSE);
       c[seg].data_used = 0;
       c[seg].max_entry_size = max_entry_size;
 
@@ -2012,17 +2682,57 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
       c[seg].total_reads = 0;
       c[seg].total_writes = 0;
       c[seg].total_hits = 0;
+      c[seg].total_evictions = 0;
+
+      c[seg].compression_threshold = 0;
+      c[seg].compression_input = 0;
+      c[seg].compression_output = 0;
+      c[seg].compression_time = 0;
+      c[seg].decompression_time = 0;
 
       /* were allocations successful?
        * If not, initialize a minimal cache structure.
        */
-      if (c[seg].data == NULL || c[seg].directory == NULL)
+      if (   c[seg].data == NULL
+          || c[seg].directory == NULL
+          || c[seg].group_initialized == NULL)
         {
           /* We are OOM. There is no need to proceed with "half a cache".
            */
           return svn_error_wrap_apr(APR_ENOMEM, "OOM");
         }
 
+#if SUPPORT_SHARED_MEMORY
+      /* Forked processes will inherit the lock.  Keep it out of the
+       * managed pool hierarchy such that their apr_terminate() won't
+       * destroy it (see SHARED_LOCK_MECH). */
+      c[seg].shared_lock = NULL;
+      c[seg].shared_lock_pool = NULL;
+      c[seg].owner_pool = NULL;
+      if (shared)
+        {
+          apr_status_t status;
+          if (seg == 0)
+            {
+              apr_pool_create_unmanaged_ex(&c[0].shared_lock_pool, NULL,
+                                           NULL);
+              if (c[0].shared_lock_pool == NULL)
+                return svn_error_wrap_apr(APR_ENOMEM, "OOM");
+
+              c[0].owner_pool = pool;
+              apr_pool_cleanup_register(pool, c[0].shared_lock_pool,
+                                        destroy_shared_locks,
+                                        apr_pool_cleanup_null);
+            }
+
+          status = apr_global_mutex_create(&c[seg].shared_lock, NULL,
+                                           SHARED_LOCK_MECH,
+                                           c[0].shared_lock_pool);
+          if (status)
+            return svn_error_wrap_apr(status, _("Can't create cache mutex"));
+        }
+#endif
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
       /* A lock for intra-process synchronization to the cache, or NULL if
        * the cache's creator doesn't feel the cache needs to be
@@ -2030,9 +2740,9 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
        */
       SVN_ERR(svn_mutex__init(&c[seg].lock, thread_safe, pool));
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
-      /* Same for read-write lock. */
+      /* Same for read-write lock.  Not needed for shared segments. */
       c[seg].lock = NULL;
-      if (thread_safe)
+      if (thread_safe && !shared)
         {
           apr_status_t status =
               apr_thread_rwlock_create(&(c[seg].lock), pool);
@@ -2046,6 +2756,40 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
 #endif
       /* No writers at the moment. */
       c[seg].write_lock_count = 0;
+
+      /* Lock-free reads only make sense if there are locks in the first
+       * place. */
+      c[seg].dirty_stripes = 0;
+      c[seg].stripes = NULL;
+      if (SUPPORT_OPTIMISTIC_READS && (thread_safe || shared)
+          && optimistic_reads)
+        {
+          c[seg].stripes = segment_alloc(&allocator,
+                                         STRIPE_COUNT * sizeof(stripe_t),
+                                         TRUE);
+          if (c[seg].stripes == NULL)
+            return svn_error_wrap_apr(APR_ENOMEM, "OOM");
+        }
+
+      /* Frequency sketch for the TinyLFU policy. */
+      c[seg].sketch.counters = NULL;
+      c[seg].sketch.mask = 0;
+      c[seg].sketch.additions = 0;
+      c[seg].sketch.sample_size = 0;
+      if (sketch_size)
+        {
+          c[seg].sketch.counters = segment_alloc(&allocator, sketch_size,
+                                                 TRUE);
+          if (c[seg].sketch.counters == NULL)
+            return svn_error_wrap_apr(APR_ENOMEM, "OOM");
+
+          c[seg].sketch.mask = sketch_size - 1;
+          c[seg].sketch.sample_size
+            = (apr_uint64_t)sketch_size * SKETCH_SAMPLE_FACTOR
+                > APR_UINT32_MAX / 2
+            ? APR_UINT32_MAX / 2
+            : sketch_size * SKETCH_SAMPLE_FACTOR;
+        }
     }
 
   /* done here
@@ -2054,6 +2798,152 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
+                                  apr_size_t total_size,
+                                  apr_size_t directory_size,
+                                  apr_size_t segment_count,
+                                  svn_boolean_t thread_safe,
+                                  svn_boolean_t allow_blocking_writes,
+                                  svn_boolean_t optimistic_reads,
+                                  svn_cache_policy_t policy,
+                                  apr_pool_t *pool)
+{
+  return svn_error_trace(membuffer_cache_create(cache, total_size,
+                                                directory_size,
+                                                segment_count, thread_safe,
+                                                allow_blocking_writes,
+                                                optimistic_reads, FALSE,
+                                                policy, pool));
+}
+
+svn_error_t *
+svn_cache__membuffer_cache_create_shared(svn_membuffer_t **cache,
+                                         apr_size_t total_size,
+                                         apr_size_t directory_size,
+                                         apr_size_t segment_count,
+                                         svn_boolean_t optimistic_reads,
+                                         svn_cache_policy_t policy,
+                                         apr_pool_t *pool)
+{
+  return svn_error_trace(membuffer_cache_create(cache, total_size,
+                                                directory_size,
+                                                segment_count, TRUE, TRUE,
+                                                optimistic_reads, TRUE,
+                                                policy, pool));
+}
+
+svn_error_t *
+svn_cache__membuffer_child_init(svn_membuffer_t *cache,
+                                apr_pool_t *pool)
+{
+#if SUPPORT_SHARED_MEMORY
+  apr_uint32_t seg;
+
+  if (cache == NULL || cache->shared_lock_pool == NULL)
+    return SVN_NO_ERROR;
+
+  /* The locks are still owned by our parent. */
+  apr_pool_cleanup_kill(cache->owner_pool, cache->shared_lock_pool,
+                        destroy_shared_locks);
+
+  for (seg = 0; seg < cache->segment_count; ++seg)
+    {
+      apr_status_t status
+        = apr_global_mutex_child_init(&cache[seg].shared_lock, NULL, pool);
+      if (status)
+        return svn_error_wrap_apr(status,
+                                  _("Can't re-initialize cache mutex"));
+    }
+#endif
+
+  return SVN_NO_ERROR;
+}
+
+void
+svn_cache__membuffer_set_compression(svn_membuffer_t *cache,
+                                     apr_size_t threshold)
+{
+  apr_uint32_t seg;
+  for (seg = 0; seg < cache->segment_count; ++seg)
+    cache[seg].compression_threshold = threshold;
+}
+
+/* LZ4 cannot compress more than this many bytes at once
+ * (see LZ4_MAX_INPUT_SIZE).
+ */
+#define MAX_COMPRESSIBLE_SIZE 0x7E000000
+
+/* If compression is enabled for CACHE and the serialized item in *BUFFER
+ * of *SIZE bytes is large enough, try to compress it.  If that saves
+ * space, replace *BUFFER and *SIZE with the compressed data and set
+ * *ORIGINAL_SIZE to the previous *SIZE.  Otherwise, leave them unchanged
+ * and set *ORIGINAL_SIZE to 0.  Allocate the result in RESULT_POOL.
+ */
+static svn_error_t *
+compress_item(void **buffer,
+              apr_size_t *size,
+              apr_size_t *original_size,
+              svn_membuffer_t *cache,
+              apr_pool_t *result_pool)
+{
+  svn_stringbuf_t *compressed;
+  apr_time_t start;
+
+  *original_size = 0;
+  if (   *buffer == NULL
+      || cache->compression_threshold == 0
+      || *size < cache->compression_threshold
+      || *size > MAX_COMPRESSIBLE_SIZE)
+    return SVN_NO_ERROR;
+
+  start = apr_time_now();
+  compressed = svn_stringbuf_create_empty(result_pool);
+  SVN_ERR(svn__compress_lz4(*buffer, *size, compressed));
+
+  cache->compression_time += apr_time_now() - start;
+  cache->compression_input += *size;
+
+  /* Incompressible data would only get larger. */
+  if (compressed->len >= *size)
+    {
+      cache->compression_output += *size;
+      return SVN_NO_ERROR;
+    }
+
+  cache->compression_output += compressed->len;
+  *original_size = *size;
+  *buffer = compressed->data;
+  *size = compressed->len;
+
+  return SVN_NO_ERROR;
+}
+
+/* Decompress the DATA_SIZE bytes at DATA that have been stored by CACHE
+ * for an item of ORIGINAL_SIZE bytes.  Return the result in *BUFFER and
+ * *SIZE, allocated in RESULT_POOL.
+ */
+static svn_error_t *
+decompress_item(char **buffer,
+                apr_size_t *size,
+                const void *data,
+                apr_size_t data_size,
+                apr_size_t original_size,
+                svn_membuffer_t *cache,
+                apr_pool_t *result_pool)
+{
+  svn_stringbuf_t *decompressed = svn_stringbuf_create_empty(result_pool);
+  apr_time_t start = apr_time_now();
+
+  SVN_ERR(svn__decompress_lz4(data, data_size, decompressed, original_size));
+  cache->decompression_time += apr_time_now() - start;
+
+  *buffer = decompressed->data;
+  *size = decompressed->len;
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_cache__membuffer_clear(svn_membuffer_t *cache)
 {
@@ -2076,9 +2966,15 @@ svn_cache__membuffer_clear(svn_membuffer_t *cache)
    */
   for (seg = 0; seg < segment_count; ++seg)
     {
+      apr_uint32_t i;
+
       /* Unconditionally acquire the write lock. */
       SVN_ERR(force_write_lock_cache(&cache[seg]));
 
+      /* Optimistic readers must not trust any group, from now on. */
+      for (i = 0; i < STRIPE_COUNT; ++i)
+        touch_group(&cache[seg], i);
+
       /* Mark all groups as "not initialized", which implies "empty". */
       cache[seg].first_spare_group = NO_INDEX;
       cache[seg].max_spare_used = 0;
@@ -2102,7 +2998,7 @@ svn_cache__membuffer_clear(svn_membuffer_t *cache)
       cache[seg].used_entries = 0;
 
       /* Segment may be used again. */
-      SVN_ERR(unlock_cache(&cache[seg], SVN_NO_ERROR));
+      SVN_ERR(unlock_cache_write(&cache[seg], SVN_NO_ERROR));
     }
 
   /* done here */
@@ -2143,12 +3039,13 @@ entry_exists(svn_membuffer_t *cache,
   return SVN_NO_ERROR;
 }
 
-/* Given the SIZE and PRIORITY of a new item, return the cache level
+/* Given the KEY, SIZE and PRIORITY of a new item, return the cache level
    (L1 or L2) in fragment CACHE that this item shall be inserted into.
    If we can't find nor make enough room for the item, return NULL.
  */
 static cache_level_t *
 select_level(svn_membuffer_t *cache,
+             const entry_key_t *key,
              apr_size_t size,
              apr_uint32_t priority)
 {
@@ -2165,6 +3062,7 @@ select_level(svn_membuffer_t *cache,
     {
       /* Large but important items go into L2. */
       entry_t dummy_entry = { { { 0 } } };
+      dummy_entry.key = *key;
       dummy_entry.priority = priority;
       dummy_entry.size = size;
 
@@ -2179,7 +3077,8 @@ select_level(svn_membuffer_t *cache,
 
 /* Try to insert the serialized item given in BUFFER with ITEM_SIZE
  * into the group GROUP_INDEX of CACHE and uniquely identify it by
- * hash value TO_FIND.
+ * hash value TO_FIND.  If BUFFER contains compressed data, ORIGINAL_SIZE
+ * is the item size before compression.  Otherwise, it is 0.
  *
  * However, there is no guarantee that it will actually be put into
  * the cache. If there is already some data associated with TO_FIND,
@@ -2195,6 +3094,7 @@ membuffer_cache_set_internal(svn_membuffer_t *cache,
                              apr_uint32_t group_index,
                              char *buffer,
                              apr_size_t item_size,
+                             apr_size_t original_size,
                              apr_uint32_t priority,
                              DEBUG_CACHE_MEMBUFFER_TAG_ARG
                              apr_pool_t *scratch_pool)
@@ -2209,6 +3109,9 @@ membuffer_cache_set_internal(svn_membuffer_t *cache,
    * membuffer in single-threaded mode. */
   assert(0 == svn_atomic_inc(&cache->write_lock_count));
 
+  /* Let past requests fade out before comparing frequencies. */
+  sketch_age(cache);
+
   /* Quick check make sure arithmetics will work further down the road. */
   size = item_size + to_find->entry_key.key_len;
   if (size < item_size)
@@ -2223,12 +3126,16 @@ membuffer_cache_set_internal(svn_membuffer_t *cache,
    * the old spot, just re-use that space. */
   if (entry && buffer && ALIGN_VALUE(entry->size) >= size)
     {
+      /* We are about to overwrite the entry's contents. */
+      touch_group(cache, group_index);
+
       /* Careful! We need to cast SIZE to the full width of CACHE->DATA_USED
        * lest we run into trouble with 32 bit underflow *not* treated as a
        * negative value.
        */
       cache->data_used += (apr_uint64_t)size - entry->size;
-      entry->size = size;
+      entry->size = (apr_uint32_t)size;
+      entry->original_size = (apr_uint32_t)original_size;
       entry->priority = priority;
 
 #ifdef SVN_DEBUG_CACHE_MEMBUFFER
@@ -2257,7 +3164,9 @@ membuffer_cache_set_internal(svn_membuffer_t *cache,
 
   /* if necessary, enlarge the insertion window.
    */
-  level = buffer ? select_level(cache, size, priority) : NULL;
+  level = buffer
+        ? select_level(cache, &to_find->entry_key, size, priority)
+        : NULL;
   if (level)
     {
       /* Remove old data for this key, if that exists.
@@ -2265,7 +3174,8 @@ membuffer_cache_set_internal(svn_membuffer_t *cache,
        * the serialized item's (future) position within data buffer.
        */
       entry = find_entry(cache, group_index, to_find, TRUE);
-      entry->size = size;
+      entry->size = (apr_uint32_t)size;
+      entry->original_size = (apr_uint32_t)original_size;
       entry->offset = level->current_data;
       entry->priority = priority;
 
@@ -2331,16 +3241,21 @@ membuffer_cache_set(svn_membuffer_t *cache,
   apr_uint32_t group_index;
   void *buffer = NULL;
   apr_size_t size = 0;
+  apr_size_t original_size;
 
   /* find the entry group that will hold the key.
    */
   group_index = get_group_index(&cache, &key->entry_key);
+  sketch_record(cache, &key->entry_key);
 
-  /* Serialize data data.
+  /* Serialize data data and compress it if that has been enabled.
    */
   if (item)
     SVN_ERR(serializer(&buffer, &size, item, scratch_pool));
 
+  SVN_ERR(compress_item(&buffer, &size, &original_size, cache,
+                        scratch_pool));
+
   /* The actual cache data access needs to sync'ed
    */
   WITH_WRITE_LOCK(cache,
@@ -2349,12 +3264,354 @@ membuffer_cache_set(svn_membuffer_t *cache,
                                                group_index,
                                                buffer,
                                                size,
+                                               original_size,
                                                priority,
                                                DEBUG_CACHE_MEMBUFFER_TAG
                                                scratch_pool));
   return SVN_NO_ERROR;
 }
 
+/* Snapshots of a membuffer cache start with this line, followed by
+ * SNAPSHOT_BYTE_ORDER as a native 32 bit integer.  Since snapshots are
+ * only meant to be used by the same machine, all numbers are written in
+ * native byte order and a mismatch simply makes us reject the snapshot.
+ */
+#define SNAPSHOT_MAGIC "SVN-MEMBUFFER-SNAPSHOT 1\n"
+#define SNAPSHOT_BYTE_ORDER 0x01020304
+
+/* Value of snapshot_record_t.prefix_len that marks the end of a snapshot.
+ */
+#define SNAPSHOT_END APR_UINT32_MAX
+
+/* Header of a cache entry within a snapshot.  It is followed by
+ * PREFIX_LEN bytes of shared key prefix (without terminating NUL) and
+ * SIZE bytes of entry data, i.e. the full key and the serialized item.
+ */
+typedef struct snapshot_record_t
+{
+  /* Copy of entry_key_t.fingerprint. */
+  apr_uint64_t fingerprint[2];
+
+  /* Copy of entry_key_t.key_len. */
+  apr_uint64_t key_len;
+
+  /* Copy of entry_t.size. */
+  apr_uint64_t size;
+
+  /* Copy of entry_t.original_size. */
+  apr_uint64_t original_size;
+
+  /* Copy of entry_t.priority. */
+  apr_uint32_t priority;
+
+  /* Length of the shared key prefix, if the entry uses one.  0 otherwise.
+   * SNAPSHOT_END for the final record. */
+  apr_uint32_t prefix_len;
+} snapshot_record_t;
+
+/* Append all entries in the chain of group GROUP_INDEX in CACHE to BUFFER
+ * in snapshot format.
+ *
+ * Note: This function requires the caller to serialize access.
+ */
+static svn_error_t *
+dump_group_chain(svn_stringbuf_t *buffer,
+                 svn_membuffer_t *cache,
+                 apr_uint32_t group_index)
+{
+  entry_group_t *group;
+
+  if (!is_group_initialized(cache, group_index))
+    return SVN_NO_ERROR;
+
+  for (group = &cache->directory[group_index];
+       group;
+       group = group->header.next == NO_INDEX
+             ? NULL
+             : &cache->directory[group->header.next])
+    {
+      apr_uint32_t i;
+      for (i = 0; i < group->header.used; ++i)
+        {
+          entry_t *entry = &group->entries[i];
+          const char *prefix = "";
+          snapshot_record_t record = { { 0 } };
+
+          if (entry->key.prefix_idx != NO_INDEX)
+            prefix = cache->prefix_pool->values[entry->key.prefix_idx];
+
+          record.fingerprint[0] = entry->key.fingerprint[0];
+          record.fingerprint[1] = entry->key.fingerprint[1];
+          record.key_len = entry->key.key_len;
+          record.size = entry->size;
+          record.original_size = entry->original_size;
+          record.priority = entry->priority;
+          record.prefix_len = (apr_uint32_t)strlen(prefix);
+
+          svn_stringbuf_appendbytes(buffer, (const char *)&record,
+                                    sizeof(record));
+          svn_stringbuf_appendbytes(buffer, prefix, record.prefix_len);
+          svn_stringbuf_appendbytes(buffer,
+                                    (const char *)cache->data + entry->offset,
+                                    entry->size);
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Append those snapshot records in BUFFER to KEPT that FILTER called
+ * with FILTER_BATON accepts.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+filter_snapshot_records(svn_stringbuf_t *kept,
+                        const svn_stringbuf_t *buffer,
+                        svn_cache__snapshot_filter_t filter,
+                        void *filter_baton,
+                        apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  apr_size_t offset = 0;
+
+  while (offset < buffer->len)
+    {
+      snapshot_record_t record;
+      const char *data;
+      const char *key_prefix;
+      apr_size_t record_size;
+      svn_boolean_t keep;
+
+      svn_pool_clear(iterpool);
+
+      /* BUFFER has been filled by dump_group_chain, so no need to
+       * validate the records. */
+      memcpy(&record, buffer->data + offset, sizeof(record));
+      record_size = sizeof(record) + record.prefix_len
+                  + (apr_size_t)record.size;
+      data = buffer->data + offset + sizeof(record) + record.prefix_len;
+
+      /* Full keys start with the NUL-terminated cache prefix. */
+      key_prefix = record.prefix_len
+                 ? apr_pstrmemdup(iterpool, buffer->data + offset
+                                            + sizeof(record),
+                                  record.prefix_len)
+                 : data;
+
+      SVN_ERR(filter(&keep, filter_baton, key_prefix, iterpool));
+      if (keep)
+        svn_stringbuf_appendbytes(kept, buffer->data + offset, record_size);
+
+      offset += record_size;
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_cache__membuffer_dump(svn_membuffer_t *cache,
+                          svn_stream_t *stream,
+                          svn_cache__snapshot_filter_t filter,
+                          void *filter_baton,
+                          apr_pool_t *scratch_pool)
+{
+  apr_uint32_t seg;
+  apr_uint32_t byte_order = SNAPSHOT_BYTE_ORDER;
+  snapshot_record_t end = { { 0 } };
+  apr_size_t len;
+  svn_stringbuf_t *buffer = svn_stringbuf_create_empty(scratch_pool);
+  svn_stringbuf_t *kept = svn_stringbuf_create_empty(scratch_pool);
+
+  SVN_ERR(svn_stream_puts(stream, SNAPSHOT_MAGIC));
+  len = sizeof(byte_order);
+  SVN_ERR(svn_stream_write(stream, (const char *)&byte_order, &len));
+
+  /* Copy the cache contents group by group such that we only hold the
+   * segment locks for short periods of time and don't do any I/O while
+   * holding them. */
+  for (seg = 0; seg < cache->segment_count; ++seg)
+    {
+      svn_membuffer_t *segment = &cache[seg];
+      apr_uint32_t group_index;
+
+      for (group_index = 0;
+           group_index < segment->group_count;
+           ++group_index)
+        {
+          svn_stringbuf_t *output = buffer;
+
+          svn_stringbuf_setempty(buffer);
+          WITH_READ_LOCK(segment,
+                         dump_group_chain(buffer, segment, group_index));
+
+          if (filter && buffer->len)
+            {
+              svn_stringbuf_setempty(kept);
+              SVN_ERR(filter_snapshot_records(kept, buffer, filter,
+                                              filter_baton, scratch_pool));
+              output = kept;
+            }
+
+          len = output->len;
+          if (len)
+            SVN_ERR(svn_stream_write(stream, output->data, &len));
+        }
+    }
+
+  end.prefix_len = SNAPSHOT_END;
+  len = sizeof(end);
+  SVN_ERR(svn_stream_write(stream, (const char *)&end, &len));
+
+  return SVN_NO_ERROR;
+}
+
+/* Return an error indicating that the snapshot being read is corrupt.
+ */
+static svn_error_t *
+corrupt_snapshot(void)
+{
+  return svn_error_create(SVN_ERR_CORRUPT_PACKED_DATA, NULL,
+                          _("Corrupt or incompatible cache snapshot"));
+}
+
+/* Read exactly LEN bytes from STREAM into BUFFER.
+ */
+static svn_error_t *
+read_snapshot_data(svn_stream_t *stream,
+                   void *buffer,
+                   apr_size_t len)
+{
+  apr_size_t read = len;
+  SVN_ERR(svn_stream_read_full(stream, buffer, &read));
+  if (read != len)
+    return svn_error_trace(corrupt_snapshot());
+
+  return SVN_NO_ERROR;
+}
+
+/* Store the serialized ITEM of ITEM_SIZE bytes with the given PRIORITY
+ * and ORIGINAL_SIZE (see entry_t) under KEY in CACHE.  Use SCRATCH_POOL
+ * for temporary allocations.
+ */
+static svn_error_t *
+load_snapshot_entry(svn_membuffer_t *cache,
+                    const full_key_t *key,
+                    char *item,
+                    apr_size_t item_size,
+                    apr_size_t original_size,
+                    apr_uint32_t priority,
+                    apr_pool_t *scratch_pool)
+{
+#ifdef SVN_DEBUG_CACHE_MEMBUFFER
+
+  /* We can't reconstruct the debug tags.  So, don't load anything. */
+  return SVN_NO_ERROR;
+
+#else
+
+  apr_uint32_t group_index = get_group_index(&cache, &key->entry_key);
+  WITH_WRITE_LOCK(cache,
+                  membuffer_cache_set_internal(cache,
+                                               key,
+                                               group_index,
+                                               item,
+                                               item_size,
+                                               original_size,
+                                               priority,
+                                               scratch_pool));
+  return SVN_NO_ERROR;
+
+#endif
+}
+
+svn_error_t *
+svn_cache__membuffer_load(svn_membuffer_t *cache,
+                          svn_stream_t *stream,
+                          svn_cache__snapshot_filter_t filter,
+                          void *filter_baton,
+                          apr_pool_t *scratch_pool)
+{
+  char magic[sizeof(SNAPSHOT_MAGIC) - 1];
+  apr_uint32_t byte_order;
+  svn_stringbuf_t *prefix = svn_stringbuf_create_empty(scratch_pool);
+  svn_membuf_t data;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+
+  SVN_ERR(read_snapshot_data(stream, magic, sizeof(magic)));
+  SVN_ERR(read_snapshot_data(stream, &byte_order, sizeof(byte_order)));
+  if (   memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic))
+      || byte_order != SNAPSHOT_BYTE_ORDER)
+    return svn_error_trace(corrupt_snapshot());
+
+  svn_membuf__create(&data, 0, scratch_pool);
+  while (TRUE)
+    {
+      snapshot_record_t record;
+      full_key_t full_key;
+      const char *key_prefix;
+      svn_boolean_t keep = TRUE;
+
+      svn_pool_clear(iterpool);
+
+      SVN_ERR(read_snapshot_data(stream, &record, sizeof(record)));
+      if (record.prefix_len == SNAPSHOT_END)
+        break;
+
+      /* Entries either have a shared prefix or store their full key. */
+      if (   record.key_len > record.size
+          || record.size > MAX_ITEM_SIZE
+          || record.original_size > MAX_ITEM_SIZE
+          || (record.prefix_len == 0) == (record.key_len == 0))
+        return svn_error_trace(corrupt_snapshot());
+
+      svn_stringbuf_ensure(prefix, record.prefix_len);
+      SVN_ERR(read_snapshot_data(stream, prefix->data, record.prefix_len));
+      prefix->data[record.prefix_len] = '\0';
+      prefix->len = record.prefix_len;
+
+      svn_membuf__ensure(&data, (apr_size_t)record.size);
+      SVN_ERR(read_snapshot_data(stream, data.data, (apr_size_t)record.size));
+
+      /* Full keys start with the NUL-terminated cache prefix. */
+      if (record.prefix_len)
+        key_prefix = prefix->data;
+      else if (memchr(data.data, 0, (apr_size_t)record.key_len))
+        key_prefix = data.data;
+      else
+        return svn_error_trace(corrupt_snapshot());
+
+      if (filter)
+        SVN_ERR(filter(&keep, filter_baton, key_prefix, iterpool));
+      if (!keep)
+        continue;
+
+      full_key.entry_key.fingerprint[0] = record.fingerprint[0];
+      full_key.entry_key.fingerprint[1] = record.fingerprint[1];
+      full_key.entry_key.key_len = (apr_size_t)record.key_len;
+      full_key.entry_key.prefix_idx = NO_INDEX;
+      full_key.full_key.data = data.data;
+      full_key.full_key.size = (apr_size_t)record.key_len;
+
+      /* The prefix indexes are specific to each cache instance. */
+      if (record.prefix_len)
+        {
+          SVN_ERR(prefix_pool_get(&full_key.entry_key.prefix_idx,
+                                  cache->prefix_pool, prefix->data));
+          if (full_key.entry_key.prefix_idx == NO_INDEX)
+            continue;
+        }
+
+      SVN_ERR(load_snapshot_entry(cache, &full_key,
+                                  (char *)data.data + record.key_len,
+                                  (apr_size_t)(record.size - record.key_len),
+                                  (apr_size_t)record.original_size,
+                                  record.priority, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
 /* Count a hit in ENTRY within CACHE.
  */
 static void
@@ -2373,8 +3630,9 @@ increment_hit_counters(svn_membuffer_t *cache, entry_t *entry)
 /* Look for the cache entry in group GROUP_INDEX of CACHE, identified
  * by the hash value TO_FIND. If no item has been stored for KEY,
  * *BUFFER will be NULL. Otherwise, return a copy of the serialized
- * data in *BUFFER and return its size in *ITEM_SIZE. Allocations will
- * be done in POOL.
+ * data in *BUFFER and return its size in *ITEM_SIZE.  If that data is
+ * compressed, *ORIGINAL_SIZE will be the uncompressed size and 0
+ * otherwise.  Allocations will be done in POOL.
  *
  * Note: This function requires the caller to serialization access.
  * Don't call it directly, call membuffer_cache_get instead.
@@ -2385,6 +3643,7 @@ membuffer_cache_get_internal(svn_membuffer_t *cache,
                              const full_key_t *to_find,
                              char **buffer,
                              apr_size_t *item_size,
+                             apr_size_t *original_size,
                              DEBUG_CACHE_MEMBUFFER_TAG_ARG
                              apr_pool_t *result_pool)
 {
@@ -2401,6 +3660,7 @@ membuffer_cache_get_internal(svn_membuffer_t *cache,
        */
       *buffer = NULL;
       *item_size = 0;
+      *original_size = 0;
 
       return SVN_NO_ERROR;
     }
@@ -2429,10 +3689,88 @@ membuffer_cache_get_internal(svn_membuffer_t *cache,
    */
   increment_hit_counters(cache, entry);
   *item_size = entry->size - entry->key.key_len;
+  *original_size = entry->original_size;
 
   return SVN_NO_ERROR;
 }
 
+/* Lock-free variant of membuffer_cache_get_internal.  Set *SUCCESS to
+ * TRUE if a consistent state of group GROUP_INDEX in CACHE could be read
+ * and return the results in *BUFFER, *ITEM_SIZE and *ORIGINAL_SIZE.
+ * Otherwise, set
+ * *SUCCESS to FALSE, in which case the caller must retry or take the
+ * segment lock.  Allocations will be done in RESULT_POOL.
+ *
+ * This must only be called if optimistic reads are enabled for CACHE.
+ */
+static void
+membuffer_cache_get_optimistic(svn_membuffer_t *cache,
+                               apr_uint32_t group_index,
+                               const full_key_t *to_find,
+                               char **buffer,
+                               apr_size_t *item_size,
+                               apr_size_t *original_size,
+                               svn_boolean_t *success,
+                               apr_pool_t *result_pool)
+{
+  apr_size_t key_len = to_find->entry_key.key_len;
+  apr_uint64_t offset = 0;
+  apr_size_t size = 0;
+  apr_size_t uncompressed_size = 0;
+  entry_t *entry;
+
+  apr_uint32_t sequence = begin_optimistic_read(cache, group_index);
+  *success = FALSE;
+
+  /* Some writer is modifying this stripe right now. */
+  if (sequence & 1)
+    return;
+
+  entry = find_entry_optimistic(cache, group_index, to_find);
+  if (entry)
+    {
+      offset = entry->offset;
+      size = entry->size;
+      uncompressed_size = entry->original_size;
+    }
+
+  /* Don't trust ENTRY, OFFSET and SIZE before validating them. */
+  if (!validate_optimistic_read(cache, group_index, sequence))
+    return;
+
+  if (entry == NULL)
+    {
+      /* no such entry found.
+       */
+      *buffer = NULL;
+      *item_size = 0;
+      *original_size = 0;
+      *success = TRUE;
+      cache->total_reads++;
+
+      return;
+    }
+
+  /* The data may get overwritten while we copy it.  Such a copy will
+   * simply be discarded below.  Since OFFSET and SIZE are consistent,
+   * we will never access anything outside the data buffer, though. */
+  *buffer = apr_palloc(result_pool, ALIGN_VALUE(size) - key_len);
+  memcpy(*buffer, cache->data + offset + key_len,
+         ALIGN_VALUE(size) - key_len);
+
+  if (!validate_optimistic_read(cache, group_index, sequence))
+    return;
+
+  /* update hit statistics.  Even if ENTRY has been replaced in the
+   * meantime, that is merely a heuristics.
+   */
+  cache->total_reads++;
+  increment_hit_counters(cache, entry);
+  *item_size = size - key_len;
+  *original_size = uncompressed_size;
+  *success = TRUE;
+}
+
 /* Look for the *ITEM identified by KEY. If no item has been stored
  * for KEY, *ITEM will be NULL. Otherwise, the DESERIALIZER is called
  * to re-construct the proper object from the serialized data.
@@ -2449,18 +3787,33 @@ membuffer_cache_get(svn_membuffer_t *cache,
   apr_uint32_t group_index;
   char *buffer;
   apr_size_t size;
+  apr_size_t original_size;
+
+  svn_boolean_t done = FALSE;
+  int attempt;
 
   /* find the entry group that will hold the key.
    */
   group_index = get_group_index(&cache, &key->entry_key);
-  WITH_READ_LOCK(cache,
-                 membuffer_cache_get_internal(cache,
-                                              group_index,
-                                              key,
-                                              &buffer,
-                                              &size,
-                                              DEBUG_CACHE_MEMBUFFER_TAG
-                                              result_pool));
+  sketch_record(cache, &key->entry_key);
+
+  /* Try without locking first, if allowed to.
+   */
+  if (cache->stripes)
+    for (attempt = 0; !done && attempt < OPTIMISTIC_READ_ATTEMPTS; ++attempt)
+      membuffer_cache_get_optimistic(cache, group_index, key, &buffer, &size,
+                                     &original_size, &done, result_pool);
+
+  if (!done)
+    WITH_READ_LOCK(cache,
+                   membuffer_cache_get_internal(cache,
+                                                group_index,
+                                                key,
+                                                &buffer,
+                                                &size,
+                                                &original_size,
+                                                DEBUG_CACHE_MEMBUFFER_TAG
+                                                result_pool));
 
   /* re-construct the original data object from its serialized form.
    */
@@ -2470,6 +3823,10 @@ membuffer_cache_get(svn_membuffer_t *cache,
       return SVN_NO_ERROR;
     }
 
+  if (original_size)
+    SVN_ERR(decompress_item(&buffer, &size, buffer, size, original_size,
+                            cache, result_pool));
+
   return deserializer(item, buffer, size, result_pool);
 }
 
@@ -2502,6 +3859,40 @@ membuffer_cache_has_key_internal(svn_membuffer_t *cache,
   return SVN_NO_ERROR;
 }
 
+/* Lock-free variant of membuffer_cache_has_key_internal.  Set *SUCCESS
+ * to TRUE if a consistent state of group GROUP_INDEX in CACHE could be
+ * read and return the result in *FOUND.  Otherwise, set *SUCCESS to FALSE.
+ *
+ * This must only be called if optimistic reads are enabled for CACHE.
+ */
+static void
+membuffer_cache_has_key_optimistic(svn_membuffer_t *cache,
+                                   apr_uint32_t group_index,
+                                   const full_key_t *to_find,
+                                   svn_boolean_t *found,
+                                   svn_boolean_t *success)
+{
+  entry_t *entry;
+  apr_uint32_t sequence = begin_optimistic_read(cache, group_index);
+  *success = FALSE;
+
+  /* Some writer is modifying this stripe right now. */
+  if (sequence & 1)
+    return;
+
+  entry = find_entry_optimistic(cache, group_index, to_find);
+  if (!validate_optimistic_read(cache, group_index, sequence))
+    return;
+
+  /* See membuffer_cache_has_key_internal for why we count this as a hit.
+   */
+  if (entry)
+    increment_hit_counters(cache, entry);
+
+  *found = entry != NULL;
+  *success = TRUE;
+}
+
 /* Look for an entry identified by KEY.  If no item has been stored
  * for KEY, *FOUND will be set to FALSE and TRUE otherwise.
  */
@@ -2515,13 +3906,24 @@ membuffer_cache_has_key(svn_membuffer_t *cache,
   /* find the entry group that will hold the key.
    */
   apr_uint32_t group_index = get_group_index(&cache, &key->entry_key);
+  svn_boolean_t done = FALSE;
+  int attempt;
+
   cache->total_reads++;
 
-  WITH_READ_LOCK(cache,
-                 membuffer_cache_has_key_internal(cache,
-                                                  group_index,
-                                                  key,
-                                                  found));
+  /* Try without locking first, if allowed to.
+   */
+  if (cache->stripes)
+    for (attempt = 0; !done && attempt < OPTIMISTIC_READ_ATTEMPTS; ++attempt)
+      membuffer_cache_has_key_optimistic(cache, group_index, key, found,
+                                         &done);
+
+  if (!done)
+    WITH_READ_LOCK(cache,
+                   membuffer_cache_has_key_internal(cache,
+                                                    group_index,
+                                                    key,
+                                                    found));
 
   return SVN_NO_ERROR;
 }
@@ -2579,6 +3981,16 @@ membuffer_cache_get_partial_internal(svn_membuffer_t *cache,
 
 #endif
 
+      /* Partial getters expect the uncompressed item. */
+      if (entry->original_size)
+        {
+          char *buffer;
+          SVN_ERR(decompress_item(&buffer, &item_size, item_data, item_size,
+                                  entry->original_size, cache,
+                                  result_pool));
+          item_data = buffer;
+        }
+
       return deserializer(item, item_data, item_size, baton, result_pool);
     }
 }
@@ -2600,6 +4012,7 @@ membuffer_cache_get_partial(svn_membuffer_t *cache,
                             apr_pool_t *result_pool)
 {
   apr_uint32_t group_index = get_group_index(&cache, &key->entry_key);
+  sketch_record(cache, &key->entry_key);
 
   WITH_READ_LOCK(cache,
                  membuffer_cache_get_partial_internal
@@ -2646,6 +4059,9 @@ membuffer_cache_set_partial_internal(svn_membuffer_t *cache,
       void *orig_data = item_data;
       apr_size_t item_size = entry->size - key_len;
 
+      /* FUNC may modify the data in-situ. */
+      touch_group(cache, group_index);
+
       increment_hit_counters(cache, entry);
       cache->total_writes++;
 
@@ -2664,6 +4080,19 @@ membuffer_cache_set_partial_internal(svn_membuffer_t *cache,
 
 #endif
 
+      /* Compressed items can't be modified in-situ.  Modify a decompressed
+       * copy instead, which will then be written back uncompressed below.
+       * Recompressing it would be too expensive while holding the lock.
+       */
+      if (entry->original_size)
+        {
+          char *buffer;
+          SVN_ERR(decompress_item(&buffer, &item_size, item_data, item_size,
+                                  entry->original_size, cache,
+                                  scratch_pool));
+          item_data = buffer;
+        }
+
       /* modify it, preferably in-situ.
        */
       err = func(&item_data, &item_size, baton, scratch_pool);
@@ -2696,7 +4125,8 @@ membuffer_cache_set_partial_internal(svn_membuffer_t *cache,
                   /* Write the new entry.
                    */
                   entry = find_entry(cache, group_index, to_find, TRUE);
-                  entry->size = item_size + key_len;
+                  entry->size = (apr_uint32_t)(item_size + key_len);
+                  entry->original_size = 0;
                   entry->offset = cache->l1.current_data;
 
                   if (key_len)
@@ -3131,6 +4561,12 @@ svn_membuffer_get_segment_info(svn_membuffer_t *segment,
 
   info->used_entries += segment->used_entries;
   info->total_entries += segment->group_count * GROUP_SIZE;
+  info->evictions += segment->total_evictions;
+
+  info->compression_input += segment->compression_input;
+  info->compression_output += segment->compression_output;
+  info->compression_time += segment->compression_time;
+  info->decompression_time += segment->decompression_time;
 
   if (include_histogram)
     for (i = 0; i < segment->group_count; ++i)
@@ -71,6 +71,7 @@ svn_cache__get(void **value_p,
                apr_pool_t *result_pool)
 {
   svn_error_t *err;
+  apr_time_t start = 0;
 
   /* In case any errors happen and are quelched, make sure we start
      out with FOUND set to false. */
@@ -80,6 +81,9 @@ svn_cache__get(void **value_p,
     return SVN_NO_ERROR;
 #endif
 
+  if (cache->latency)
+    start = apr_time_now();
+
   cache->reads++;
   err = handle_error(cache,
                      (cache->vtable->get)(value_p,
@@ -92,6 +96,10 @@ svn_cache__get(void **value_p,
   if (*found)
     cache->hits++;
 
+  if (cache->latency)
+    svn_cache__record_latency(cache->latency, *found,
+                              apr_time_now() - start);
+
   return err;
 }
 
@@ -161,6 +169,7 @@ svn_cache__get_partial(void **value,
                        apr_pool_t *result_pool)
 {
   svn_error_t *err;
+  apr_time_t start = 0;
 
   /* In case any errors happen and are quelched, make sure we start
   out with FOUND set to false. */
@@ -170,6 +179,9 @@ svn_cache__get_partial(void **value,
     return SVN_NO_ERROR;
 #endif
 
+  if (cache->latency)
+    start = apr_time_now();
+
   cache->reads++;
   err = handle_error(cache,
                      (cache->vtable->get_partial)(value,
@@ -184,6 +196,10 @@ svn_cache__get_partial(void **value,
   if (*found)
     cache->hits++;
 
+  if (cache->latency)
+    svn_cache__record_latency(cache->latency, *found,
+                              apr_time_now() - start);
+
   return err;
 }
 
@@ -258,6 +274,7 @@ svn_cache__format_info(const svn_cache__info_t *info,
                  / (double)(info->total_entries ? info->total_entries : 1);
 
   const char *histogram = "";
+  const char *compression = "";
   if (!access_only)
     {
       svn_stringbuf_t *text = svn_stringbuf_create_empty(result_pool);
@@ -275,6 +292,20 @@ svn_cache__format_info(const svn_cache__info_t *info,
                                        text->data, info->histogram[i], i);
 
       histogram = text->data;
+
+      if (info->compression_input)
+        compression
+          = apr_psprintf(result_pool,
+                         "compress: %" APR_UINT64_T_FMT " MB -> %"
+                         APR_UINT64_T_FMT " MB (%5.2f%%),"
+                         " %" APR_UINT64_T_FMT " ms compressing,"
+                         " %" APR_UINT64_T_FMT " ms decompressing\n",
+                         info->compression_input / _1MB,
+                         info->compression_output / _1MB,
+                         (100.0 * (double)info->compression_output)
+                           / (double)info->compression_input,
+                         info->compression_time / 1000,
+                         info->decompression_time / 1000);
     }
 
   return access_only
@@ -300,7 +331,7 @@ svn_cache__format_info(const svn_cache__info_t *info,
                             " of %" APR_UINT64_T_FMT " MB data cache"
                             " / %" APR_UINT64_T_FMT " MB total cache memory\n"
                             "          %" APR_UINT64_T_FMT " entries (%5.2f%%)"
-                            " of %" APR_UINT64_T_FMT " total\n%s",
+                            " of %" APR_UINT64_T_FMT " total\n%s%s",
 
                             info->id,
 
@@ -315,5 +346,6 @@ svn_cache__format_info(const svn_cache__info_t *info,
 
                             info->used_entries, data_entry_rate,
                             info->total_entries,
+                            compression,
                             histogram);
 }
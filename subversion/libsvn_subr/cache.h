@@ -30,6 +30,33 @@
 extern "C" {
 #endif /* __cplusplus */
 
+/* Number of buckets in the lookup latency histograms.  The last one
+ * collects everything above the largest bound in cache_metrics.c.
+ */
+#define SVN_CACHE__LATENCY_BUCKETS 8
+
+/* Lookup latency histograms of a cache instance whose metrics are being
+ * collected (see svn_cache__register_metrics()).
+ */
+typedef struct svn_cache__latency_t {
+  /* Number of getter calls that returned a cached item / returned nothing
+   * per latency bucket. */
+  apr_uint64_t hits[SVN_CACHE__LATENCY_BUCKETS];
+  apr_uint64_t misses[SVN_CACHE__LATENCY_BUCKETS];
+
+  /* Total time spent in these calls in microseconds. */
+  apr_uint64_t hit_time;
+  apr_uint64_t miss_time;
+} svn_cache__latency_t;
+
+/* Count a getter call that took DURATION and did (FOUND) or didn't find
+ * the item in the histograms of LATENCY.  Implemented in cache_metrics.c.
+ */
+void
+svn_cache__record_latency(svn_cache__latency_t *latency,
+                          svn_boolean_t found,
+                          apr_interval_time_t duration);
+
 typedef struct svn_cache__vtable_t {
   /* See svn_cache__get(). */
   svn_error_t *(*get)(void **value,
@@ -109,6 +136,10 @@ struct svn_cache__t {
   /* Cause all getters to act as though the cache contains no data.
      (Currently this never becomes set except in maintainer builds.) */
   svn_boolean_t pretend_empty;
+
+  /* Lookup latency histograms.  NULL unless metrics are being collected
+     for this cache. */
+  svn_cache__latency_t *latency;
 };
 
 
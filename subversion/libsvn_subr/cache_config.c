@@ -31,7 +31,7 @@
 
 /* The cache settings as a process-wide singleton.
  */
-static svn_cache_config_t cache_settings =
+static svn_cache_config2_t cache_settings =
   {
     /* default configuration:
      *
@@ -55,18 +55,37 @@ static svn_cache_config_t cache_settings =
                   * value (< 100) may be more suitable.
                   */
 #if APR_HAS_THREADS
-    FALSE        /* assume multi-threaded operation.
+    FALSE,       /* assume multi-threaded operation.
                   * Because this simply activates proper synchronization
                   * between threads, it is a safe default.
                   */
 #else
-    TRUE         /* single-threaded is the only supported mode of operation */
+    TRUE,        /* single-threaded is the only supported mode of operation */
 #endif
+    svn_cache_policy_default,
+                 /* The traditional policy works well for most workloads and
+                  * does not need extra memory.
+                  */
+    0,           /* no compression.
+                  * Compression makes every access to large items more
+                  * expensive.  Enable it only if the working set does not
+                  * fit into the available memory otherwise.
+                  */
+    TRUE         /* optimistic reads.
+                  * Readers don't contend for the segment locks.  Disable
+                  * this only to rule out the lock-free path when
+                  * diagnosing cache problems.
+                  */
 };
 
+/* Whether the process-global membuffer cache shall be allocated in
+ * shared memory.  See svn_cache__set_global_membuffer_shared().
+ */
+static svn_boolean_t share_global_membuffer = FALSE;
+
 /* Get the current FSFS cache configuration. */
-const svn_cache_config_t *
-svn_cache_config_get(void)
+const svn_cache_config2_t *
+svn_cache_config_get2(void)
 {
   return &cache_settings;
 }
@@ -120,14 +139,38 @@ initialize_cache(void *baton, apr_pool_t *unused_pool)
         return SVN_NO_ERROR;
       apr_allocator_owner_set(allocator, pool);
 
-      err = svn_cache__membuffer_cache_create(
-          &cache,
-          (apr_size_t)cache_size,
-          (apr_size_t)(cache_size / 5),
-          0,
-          ! svn_cache_config_get()->single_threaded,
-          FALSE,
-          pool);
+      err = SVN_NO_ERROR;
+      if (share_global_membuffer)
+        {
+          err = svn_cache__membuffer_cache_create_shared(
+              &cache,
+              (apr_size_t)cache_size,
+              (apr_size_t)(cache_size / 5),
+              0,
+              cache_settings.optimistic_reads,
+              cache_settings.policy,
+              pool);
+
+          /* Fall back to a private cache if sharing is not supported. */
+          if (err && err->apr_err == SVN_ERR_UNSUPPORTED_FEATURE)
+            {
+              svn_error_clear(err);
+              err = SVN_NO_ERROR;
+              share_global_membuffer = FALSE;
+            }
+        }
+
+      if (!share_global_membuffer)
+        err = svn_cache__membuffer_cache_create(
+            &cache,
+            (apr_size_t)cache_size,
+            (apr_size_t)(cache_size / 5),
+            0,
+            ! svn_cache_config_get2()->single_threaded,
+            FALSE,
+            cache_settings.optimistic_reads,
+            cache_settings.policy,
+            pool);
 
       /* Some error occurred. Most likely it's an OOM error but we don't
        * really care. Simply release all cache memory and disable caching
@@ -143,6 +186,9 @@ initialize_cache(void *baton, apr_pool_t *unused_pool)
           return svn_error_trace(err);
         }
 
+      svn_cache__membuffer_set_compression(
+          cache, cache_settings.compression_threshold);
+
       /* done */
       *cache_p = cache;
     }
@@ -174,7 +220,13 @@ svn_cache__get_global_membuffer_cache(void)
 }
 
 void
-svn_cache_config_set(const svn_cache_config_t *settings)
+svn_cache__set_global_membuffer_shared(svn_boolean_t shared)
+{
+  share_global_membuffer = shared;
+}
+
+void
+svn_cache_config_set2(const svn_cache_config2_t *settings)
 {
   cache_settings = *settings;
 }
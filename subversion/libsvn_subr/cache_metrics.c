@@ -0,0 +1,507 @@
+/*
+ * cache_metrics.c: export cache statistics for monitoring systems
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <stddef.h>
+
+#include "svn_hash.h"
+#include "svn_pools.h"
+#include "svn_sorts.h"
+#include "private/svn_atomic.h"
+#include "private/svn_mutex.h"
+#include "private/svn_sorts_private.h"
+#include "private/svn_string_private.h"
+#include "cache.h"
+
+/* Upper bounds of the lookup latency buckets in microseconds.  The last
+ * bucket is unbounded.
+ */
+static const apr_interval_time_t
+latency_bounds[SVN_CACHE__LATENCY_BUCKETS - 1]
+  = { 1, 4, 16, 64, 256, 1024, 4096 };
+
+void
+svn_cache__record_latency(svn_cache__latency_t *latency,
+                          svn_boolean_t found,
+                          apr_interval_time_t duration)
+{
+  int i;
+  for (i = 0; i < SVN_CACHE__LATENCY_BUCKETS - 1; ++i)
+    if (duration <= latency_bounds[i])
+      break;
+
+  /* Like the other cache statistics, these are not synchronized. */
+  if (found)
+    {
+      latency->hits[i]++;
+      latency->hit_time += duration;
+    }
+  else
+    {
+      latency->misses[i]++;
+      latency->miss_time += duration;
+    }
+}
+
+/* Counters to report for each cache kind.
+ */
+typedef struct metrics_t
+{
+  apr_uint64_t gets;
+  apr_uint64_t hits;
+  apr_uint64_t sets;
+  apr_uint64_t failures;
+  svn_cache__latency_t latency;
+} metrics_t;
+
+/* A cache whose metrics get reported.  Registrations form a doubly-linked
+ * list and remove themselves upon cleanup of the cache's pool.
+ */
+typedef struct registration_t
+{
+  /* The cache and the kind it gets reported as. */
+  svn_cache__t *cache;
+  const char *kind;
+
+  /* Neighbors in the list of registrations. */
+  struct registration_t *next;
+  struct registration_t *previous;
+} registration_t;
+
+/* Collect metrics for caches registered from now on? */
+static svn_boolean_t metrics_enabled = FALSE;
+
+/* The registry, initialized upon first registration.  REGISTRY_MUTEX
+ * serializes access to all other members.
+ */
+static volatile svn_atomic_t registry_initialized = 0;
+static svn_mutex__t *registry_mutex = NULL;
+static apr_pool_t *registry_pool = NULL;
+static registration_t *registrations = NULL;
+
+/* Maps cache kinds to the metrics_t accumulated over all caches of that
+ * kind which have already been cleaned up.  Allocated in REGISTRY_POOL.
+ */
+static apr_hash_t *retired = NULL;
+
+/* Implements svn_atomic__err_init_func_t.  Initialize the registry.
+ */
+static svn_error_t *
+initialize_registry(void *baton,
+                    apr_pool_t *scratch_pool)
+{
+  registry_pool = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+  retired = apr_hash_make(registry_pool);
+  SVN_ERR(svn_mutex__init(&registry_mutex, TRUE, registry_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Add the counters of CACHE to TOTAL.
+ */
+static void
+add_metrics(metrics_t *total,
+            const svn_cache__t *cache)
+{
+  int i;
+
+  total->gets += cache->reads;
+  total->hits += cache->hits;
+  total->sets += cache->writes;
+  total->failures += cache->failures;
+
+  for (i = 0; i < SVN_CACHE__LATENCY_BUCKETS; ++i)
+    {
+      total->latency.hits[i] += cache->latency->hits[i];
+      total->latency.misses[i] += cache->latency->misses[i];
+    }
+
+  total->latency.hit_time += cache->latency->hit_time;
+  total->latency.miss_time += cache->latency->miss_time;
+}
+
+/* Return the metrics_t for KIND in HASH, allocating a new one in POOL
+ * if necessary.
+ */
+static metrics_t *
+get_metrics(apr_hash_t *hash,
+            const char *kind,
+            apr_pool_t *pool)
+{
+  metrics_t *metrics = svn_hash_gets(hash, kind);
+  if (metrics == NULL)
+    {
+      metrics = apr_pcalloc(pool, sizeof(*metrics));
+      svn_hash_sets(hash, apr_pstrdup(pool, kind), metrics);
+    }
+
+  return metrics;
+}
+
+/* Move the counters of REGISTRATION to the retired totals and remove it
+ * from the list.
+ *
+ * Note: This function requires the caller to hold REGISTRY_MUTEX.
+ */
+static svn_error_t *
+unregister(registration_t *registration)
+{
+  add_metrics(get_metrics(retired, registration->kind, registry_pool),
+              registration->cache);
+
+  if (registration->previous)
+    registration->previous->next = registration->next;
+  else
+    registrations = registration->next;
+
+  if (registration->next)
+    registration->next->previous = registration->previous;
+
+  return SVN_NO_ERROR;
+}
+
+/* APR pool cleanup handler removing the registration_t given as BATON.
+ */
+static apr_status_t
+unregister_cleanup(void *baton)
+{
+  registration_t *registration = baton;
+  svn_error_t *err = svn_mutex__lock(registry_mutex);
+  if (!err)
+    err = svn_mutex__unlock(registry_mutex, unregister(registration));
+
+  svn_error_clear(err);
+  return APR_SUCCESS;
+}
+
+/* Add REGISTRATION to the list.
+ *
+ * Note: This function requires the caller to hold REGISTRY_MUTEX.
+ */
+static svn_error_t *
+add_registration(registration_t *registration)
+{
+  registration->next = registrations;
+  if (registrations)
+    registrations->previous = registration;
+
+  registrations = registration;
+
+  return SVN_NO_ERROR;
+}
+
+void
+svn_cache__enable_metrics(svn_boolean_t enabled)
+{
+  metrics_enabled = enabled;
+}
+
+svn_error_t *
+svn_cache__register_metrics(svn_cache__t *cache,
+                            const char *kind,
+                            apr_pool_t *pool)
+{
+  registration_t *registration;
+
+  if (!metrics_enabled || cache == NULL || cache->latency)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_atomic__init_once(&registry_initialized, initialize_registry,
+                                NULL, pool));
+
+  registration = apr_pcalloc(pool, sizeof(*registration));
+  registration->cache = cache;
+  registration->kind = apr_pstrdup(pool, kind);
+
+  cache->latency = apr_pcalloc(pool, sizeof(*cache->latency));
+
+  SVN_MUTEX__WITH_LOCK(registry_mutex, add_registration(registration));
+  apr_pool_cleanup_register(pool, registration, unregister_cleanup,
+                            apr_pool_cleanup_null);
+
+  return SVN_NO_ERROR;
+}
+
+/* Sum up the metrics of all caches, current and retired, per cache kind
+ * and return them in *TOTALS.  Allocate the result in RESULT_POOL.
+ *
+ * Note: This function requires the caller to hold REGISTRY_MUTEX.
+ */
+static svn_error_t *
+collect_metrics(apr_hash_t **totals,
+                apr_pool_t *result_pool)
+{
+  apr_hash_index_t *hi;
+  registration_t *registration;
+
+  *totals = apr_hash_make(result_pool);
+  for (hi = apr_hash_first(result_pool, retired); hi; hi = apr_hash_next(hi))
+    {
+      metrics_t *metrics = get_metrics(*totals, apr_hash_this_key(hi),
+                                       result_pool);
+      *metrics = *(const metrics_t *)apr_hash_this_val(hi);
+    }
+
+  for (registration = registrations;
+       registration;
+       registration = registration->next)
+    add_metrics(get_metrics(*totals, registration->kind, result_pool),
+                registration->cache);
+
+  return SVN_NO_ERROR;
+}
+
+/* Return KIND as a label value, escaped as required by the exposition
+ * format.  Allocate the result in RESULT_POOL.
+ */
+static const char *
+escape_label(const char *kind,
+             apr_pool_t *result_pool)
+{
+  svn_stringbuf_t *result = svn_stringbuf_create_empty(result_pool);
+  for (; *kind; ++kind)
+    if (*kind == '\\')
+      svn_stringbuf_appendcstr(result, "\\\\");
+    else if (*kind == '"')
+      svn_stringbuf_appendcstr(result, "\\\"");
+    else if (*kind == '\n')
+      svn_stringbuf_appendcstr(result, "\\n");
+    else
+      svn_stringbuf_appendbyte(result, *kind);
+
+  return result->data;
+}
+
+/* Append the HELP and TYPE lines for metric NAME to OUTPUT.
+ */
+static void
+append_header(svn_stringbuf_t *output,
+              const char *name,
+              const char *type,
+              const char *help)
+{
+  svn_stringbuf_appendcstr(output,
+                           apr_psprintf(output->pool,
+                                        "# HELP %s %s\n# TYPE %s %s\n",
+                                        name, help, name, type));
+}
+
+/* Append a sample for metric NAME with the given LABELS and VALUE
+ * to OUTPUT.
+ */
+static void
+append_sample(svn_stringbuf_t *output,
+              const char *name,
+              const char *labels,
+              apr_uint64_t value)
+{
+  svn_stringbuf_appendcstr(output,
+                           apr_psprintf(output->pool,
+                                        "%s%s %" APR_UINT64_T_FMT "\n",
+                                        name, labels, value));
+}
+
+/* Append the histogram of the lookups that found (HITS) or didn't find
+ * the requested item in LATENCY for the cache with the escaped LABEL to
+ * OUTPUT.
+ */
+static void
+append_histogram(svn_stringbuf_t *output,
+                 const char *label,
+                 const svn_cache__latency_t *latency,
+                 svn_boolean_t hits)
+{
+  const char *result = hits ? "hit" : "miss";
+  const apr_uint64_t *buckets = hits ? latency->hits : latency->misses;
+  apr_uint64_t total_time = hits ? latency->hit_time : latency->miss_time;
+  apr_uint64_t count = 0;
+  int i;
+
+  for (i = 0; i < SVN_CACHE__LATENCY_BUCKETS; ++i)
+    {
+      const char *bound = i < SVN_CACHE__LATENCY_BUCKETS - 1
+                        ? apr_psprintf(output->pool, "%g",
+                                       latency_bounds[i] / 1000000.0)
+                        : "+Inf";
+      count += buckets[i];
+      append_sample(output, "svn_cache_lookup_duration_seconds_bucket",
+                    apr_psprintf(output->pool,
+                                 "{cache=\"%s\",result=\"%s\",le=\"%s\"}",
+                                 label, result, bound),
+                    count);
+    }
+
+  svn_stringbuf_appendcstr(output,
+                           apr_psprintf(output->pool,
+                                        "svn_cache_lookup_duration_seconds_sum"
+                                        "{cache=\"%s\",result=\"%s\"} %.6f\n",
+                                        label, result,
+                                        total_time / 1000000.0));
+  append_sample(output, "svn_cache_lookup_duration_seconds_count",
+                apr_psprintf(output->pool, "{cache=\"%s\",result=\"%s\"}",
+                             label, result),
+                count);
+}
+
+/* Per-cache counters and their descriptions. */
+static const struct
+{
+  const char *name;
+  const char *help;
+  apr_size_t offset;
+} counters[] =
+  {
+    { "svn_cache_gets_total", "Number of cache lookups.",
+      offsetof(metrics_t, gets) },
+    { "svn_cache_hits_total", "Number of cache lookups that found the item.",
+      offsetof(metrics_t, hits) },
+    { "svn_cache_sets_total", "Number of items written to the cache.",
+      offsetof(metrics_t, sets) },
+    { "svn_cache_failures_total", "Number of failed cache operations.",
+      offsetof(metrics_t, failures) }
+  };
+
+/* Append the metrics of the global membuffer cache to OUTPUT, if that
+ * cache exists.
+ */
+static void
+append_membuffer_metrics(svn_stringbuf_t *output)
+{
+  svn_cache__info_t *info;
+
+  if (svn_cache__get_global_membuffer_cache() == NULL)
+    return;
+
+  info = svn_cache__membuffer_get_global_info(output->pool);
+
+  append_header(output, "svn_membuffer_gets_total", "counter",
+                "Number of lookups in the shared cache memory.");
+  append_sample(output, "svn_membuffer_gets_total", "", info->gets);
+  append_header(output, "svn_membuffer_hits_total", "counter",
+                "Number of lookups that found the item.");
+  append_sample(output, "svn_membuffer_hits_total", "", info->hits);
+  append_header(output, "svn_membuffer_sets_total", "counter",
+                "Number of items written to the shared cache memory.");
+  append_sample(output, "svn_membuffer_sets_total", "", info->sets);
+  append_header(output, "svn_membuffer_evictions_total", "counter",
+                "Number of items removed to make room for others.");
+  append_sample(output, "svn_membuffer_evictions_total", "",
+                info->evictions);
+  append_header(output, "svn_membuffer_used_bytes", "gauge",
+                "Size of the data currently cached.");
+  append_sample(output, "svn_membuffer_used_bytes", "", info->used_size);
+  append_header(output, "svn_membuffer_data_bytes", "gauge",
+                "Capacity of the data buffer.");
+  append_sample(output, "svn_membuffer_data_bytes", "", info->data_size);
+  append_header(output, "svn_membuffer_entries", "gauge",
+                "Number of items currently cached.");
+  append_sample(output, "svn_membuffer_entries", "", info->used_entries);
+  append_header(output, "svn_membuffer_max_entries", "gauge",
+                "Maximum number of items in the cache index.");
+  append_sample(output, "svn_membuffer_max_entries", "",
+                info->total_entries);
+
+  if (info->compression_input)
+    {
+      append_header(output, "svn_membuffer_compression_input_bytes_total",
+                    "counter", "Number of bytes passed to the compressor.");
+      append_sample(output, "svn_membuffer_compression_input_bytes_total",
+                    "", info->compression_input);
+      append_header(output, "svn_membuffer_compression_output_bytes_total",
+                    "counter", "Number of bytes returned by the compressor.");
+      append_sample(output, "svn_membuffer_compression_output_bytes_total",
+                    "", info->compression_output);
+      append_header(output, "svn_membuffer_compression_seconds_total",
+                    "counter", "Time spent compressing items.");
+      svn_stringbuf_appendcstr(output,
+                               apr_psprintf(output->pool,
+                                    "svn_membuffer_compression_seconds_total"
+                                    " %.6f\n",
+                                    info->compression_time / 1000000.0));
+      append_header(output, "svn_membuffer_decompression_seconds_total",
+                    "counter", "Time spent decompressing items.");
+      svn_stringbuf_appendcstr(output,
+                               apr_psprintf(output->pool,
+                                    "svn_membuffer_decompression_seconds_total"
+                                    " %.6f\n",
+                                    info->decompression_time / 1000000.0));
+    }
+}
+
+svn_error_t *
+svn_cache__format_metrics(svn_string_t **metrics,
+                          apr_pool_t *result_pool)
+{
+  svn_stringbuf_t *output = svn_stringbuf_create_empty(result_pool);
+  apr_hash_t *totals = NULL;
+
+  if (svn_atomic_read(&registry_initialized))
+    SVN_MUTEX__WITH_LOCK(registry_mutex,
+                         collect_metrics(&totals, result_pool));
+
+  if (totals && apr_hash_count(totals))
+    {
+      apr_array_header_t *sorted
+        = svn_sort__hash(totals, svn_sort_compare_items_lexically,
+                         result_pool);
+      const char **labels = apr_palloc(result_pool,
+                                       sorted->nelts * sizeof(*labels));
+      apr_size_t k;
+      int i;
+
+      for (i = 0; i < sorted->nelts; ++i)
+        labels[i] = escape_label(APR_ARRAY_IDX(sorted, i,
+                                               svn_sort__item_t).key,
+                                 result_pool);
+
+      for (k = 0; k < sizeof(counters) / sizeof(counters[0]); ++k)
+        {
+          append_header(output, counters[k].name, "counter",
+                        counters[k].help);
+          for (i = 0; i < sorted->nelts; ++i)
+            {
+              const char *value
+                = APR_ARRAY_IDX(sorted, i, svn_sort__item_t).value;
+              append_sample(output, counters[k].name,
+                            apr_psprintf(result_pool, "{cache=\"%s\"}",
+                                         labels[i]),
+                            *(const apr_uint64_t *)(value
+                                                    + counters[k].offset));
+            }
+        }
+
+      append_header(output, "svn_cache_lookup_duration_seconds", "histogram",
+                    "Time spent in cache lookups.");
+      for (i = 0; i < sorted->nelts; ++i)
+        {
+          const metrics_t *value
+            = APR_ARRAY_IDX(sorted, i, svn_sort__item_t).value;
+          append_histogram(output, labels[i], &value->latency, TRUE);
+          append_histogram(output, labels[i], &value->latency, FALSE);
+        }
+    }
+
+  append_membuffer_metrics(output);
+
+  *metrics = svn_stringbuf__morph_into_string(output);
+  return SVN_NO_ERROR;
+}
@@ -35,6 +35,7 @@
 
 #include "checksum.h"
 #include "fnv1a.h"
+#include "sha1.h"
 
 #include "private/svn_subr_private.h"
 
@@ -475,8 +476,6 @@ svn_checksum(svn_checksum_t **checksum,
              apr_size_t len,
              apr_pool_t *pool)
 {
-  apr_sha1_ctx_t sha1_ctx;
-
   SVN_ERR(validate_kind(kind));
   *checksum = svn_checksum_create(kind, pool);
 
@@ -487,9 +486,7 @@ svn_checksum(svn_checksum_t **checksum,
         break;
 
       case svn_checksum_sha1:
-        apr_sha1_init(&sha1_ctx);
-        apr_sha1_update(&sha1_ctx, data, (unsigned int)len);
-        apr_sha1_final((unsigned char *)(*checksum)->digest, &sha1_ctx);
+        svn__sha1((unsigned char *)(*checksum)->digest, data, len);
         break;
 
       case svn_checksum_fnv1a_32:
@@ -550,8 +547,7 @@ svn_checksum_ctx_create(svn_checksum_kind_t kind,
         break;
 
       case svn_checksum_sha1:
-        ctx->apr_ctx = apr_palloc(pool, sizeof(apr_sha1_ctx_t));
-        apr_sha1_init(ctx->apr_ctx);
+        ctx->apr_ctx = svn_sha1__context_create(pool);
         break;
 
       case svn_checksum_fnv1a_32:
@@ -580,8 +576,7 @@ svn_checksum_ctx_reset(svn_checksum_ctx_t *ctx)
         break;
 
       case svn_checksum_sha1:
-        memset(ctx->apr_ctx, 0, sizeof(apr_sha1_ctx_t));
-        apr_sha1_init(ctx->apr_ctx);
+        svn_sha1__context_reset(ctx->apr_ctx);
         break;
 
       case svn_checksum_fnv1a_32:
@@ -611,7 +606,7 @@ svn_checksum_update(svn_checksum_ctx_t *ctx,
         break;
 
       case svn_checksum_sha1:
-        apr_sha1_update(ctx->apr_ctx, data, (unsigned int)len);
+        svn_sha1__update(ctx->apr_ctx, data, len);
         break;
 
       case svn_checksum_fnv1a_32:
@@ -644,7 +639,8 @@ svn_checksum_final(svn_checksum_t **checksum,
         break;
 
       case svn_checksum_sha1:
-        apr_sha1_final((unsigned char *)(*checksum)->digest, ctx->apr_ctx);
+        svn_sha1__finalize((unsigned char *)(*checksum)->digest,
+                           ctx->apr_ctx);
         break;
 
       case svn_checksum_fnv1a_32:
@@ -665,6 +661,99 @@ svn_checksum_final(svn_checksum_t **checksum,
   return SVN_NO_ERROR;
 }
 
+/* Feed the data to the digests of a multi-digest context in chunks of
+ * this size, so each chunk is still in L1 cache when the second digest
+ * gets to it.
+ */
+#define MULTI_CHUNK_SIZE 0x2000
+
+struct svn_checksum__multi_ctx_t
+{
+  /* The individual digests.  Either may be NULL if not requested. */
+  svn_checksum_ctx_t *md5_ctx;
+  svn_checksum_ctx_t *sha1_ctx;
+};
+
+svn_checksum__multi_ctx_t *
+svn_checksum__multi_ctx_create(svn_boolean_t md5,
+                               svn_boolean_t sha1,
+                               apr_pool_t *pool)
+{
+  svn_checksum__multi_ctx_t *ctx = apr_pcalloc(pool, sizeof(*ctx));
+
+  if (md5)
+    ctx->md5_ctx = svn_checksum_ctx_create(svn_checksum_md5, pool);
+  if (sha1)
+    ctx->sha1_ctx = svn_checksum_ctx_create(svn_checksum_sha1, pool);
+
+  return ctx;
+}
+
+svn_error_t *
+svn_checksum__multi_ctx_reset(svn_checksum__multi_ctx_t *ctx)
+{
+  if (ctx->md5_ctx)
+    SVN_ERR(svn_checksum_ctx_reset(ctx->md5_ctx));
+  if (ctx->sha1_ctx)
+    SVN_ERR(svn_checksum_ctx_reset(ctx->sha1_ctx));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_checksum__multi_update(svn_checksum__multi_ctx_t *ctx,
+                           const void *data,
+                           apr_size_t len)
+{
+  const char *chunk = data;
+
+  /* Don't bother with the chunking if there is only one digest. */
+  if (!ctx->md5_ctx || !ctx->sha1_ctx)
+    {
+      svn_checksum_ctx_t *single = ctx->md5_ctx ? ctx->md5_ctx
+                                                : ctx->sha1_ctx;
+      return single ? svn_checksum_update(single, data, len) : SVN_NO_ERROR;
+    }
+
+  while (len > 0)
+    {
+      apr_size_t chunk_len = MIN(len, MULTI_CHUNK_SIZE);
+
+      SVN_ERR(svn_checksum_update(ctx->md5_ctx, chunk, chunk_len));
+      SVN_ERR(svn_checksum_update(ctx->sha1_ctx, chunk, chunk_len));
+
+      chunk += chunk_len;
+      len -= chunk_len;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_checksum__multi_final(svn_checksum_t **md5_checksum,
+                          svn_checksum_t **sha1_checksum,
+                          const svn_checksum__multi_ctx_t *ctx,
+                          apr_pool_t *pool)
+{
+  if (md5_checksum)
+    {
+      if (ctx->md5_ctx)
+        SVN_ERR(svn_checksum_final(md5_checksum, ctx->md5_ctx, pool));
+      else
+        *md5_checksum = NULL;
+    }
+
+  if (sha1_checksum)
+    {
+      if (ctx->sha1_ctx)
+        SVN_ERR(svn_checksum_final(sha1_checksum, ctx->sha1_ctx, pool));
+      else
+        *sha1_checksum = NULL;
+    }
+
+  return SVN_NO_ERROR;
+}
+
 apr_size_t
 svn_checksum_size(const svn_checksum_t *checksum)
 {
@@ -854,3 +943,92 @@ svn_checksum__wrap_write_stream_fnv1a_32x4(apr_uint32_t *digest,
 
   return result;
 }
+
+/* Baton used by the multi-digest stream handlers below. */
+typedef struct multi_stream_baton_t
+{
+  /* Stream we are wrapping.  Forward all operations to it. */
+  svn_stream_t *inner_stream;
+
+  /* Build the digests in here. */
+  svn_checksum__multi_ctx_t *context;
+
+  /* Write the final checksums here.  Either may be NULL. */
+  svn_checksum_t **md5_checksum;
+  svn_checksum_t **sha1_checksum;
+
+  /* Allocate the resulting checksums here. */
+  apr_pool_t *pool;
+} multi_stream_baton_t;
+
+/* Implement svn_write_fn_t.
+ * Update the digests and pass data on to inner stream.
+ */
+static svn_error_t *
+multi_write_handler(void *baton,
+                    const char *data,
+                    apr_size_t *len)
+{
+  multi_stream_baton_t *b = baton;
+
+  SVN_ERR(svn_checksum__multi_update(b->context, data, *len));
+  SVN_ERR(svn_stream_write(b->inner_stream, data, len));
+
+  return SVN_NO_ERROR;
+}
+
+/* Implement svn_close_fn_t.
+ * Finalize the digests and close the inner stream.
+ */
+static svn_error_t *
+multi_close_handler(void *baton)
+{
+  multi_stream_baton_t *b = baton;
+
+  SVN_ERR(svn_checksum__multi_final(b->md5_checksum, b->sha1_checksum,
+                                    b->context, b->pool));
+
+  return svn_error_trace(svn_stream_close(b->inner_stream));
+}
+
+/* Implement svn_stream_seek_fn_t.
+ * Only support resetting the stream, which restarts the digests.
+ */
+static svn_error_t *
+multi_seek_handler(void *baton,
+                   const svn_stream_mark_t *mark)
+{
+  multi_stream_baton_t *b = baton;
+
+  if (mark)
+    return svn_error_create(SVN_ERR_STREAM_SEEK_NOT_SUPPORTED, NULL, NULL);
+
+  SVN_ERR(svn_checksum__multi_ctx_reset(b->context));
+  return svn_error_trace(svn_stream_reset(b->inner_stream));
+}
+
+svn_stream_t *
+svn_checksum__wrap_write_stream_multi(svn_checksum_t **md5_checksum,
+                                      svn_checksum_t **sha1_checksum,
+                                      svn_stream_t *inner_stream,
+                                      apr_pool_t *pool)
+{
+  svn_stream_t *outer_stream;
+  multi_stream_baton_t *baton = apr_pcalloc(pool, sizeof(*baton));
+
+  baton->inner_stream = inner_stream;
+  baton->context = svn_checksum__multi_ctx_create(md5_checksum != NULL,
+                                                  sha1_checksum != NULL,
+                                                  pool);
+  baton->md5_checksum = md5_checksum;
+  baton->sha1_checksum = sha1_checksum;
+  baton->pool = pool;
+
+  outer_stream = svn_stream_create(baton, pool);
+  svn_stream_set_write(outer_stream, multi_write_handler);
+  svn_stream_set_close(outer_stream, multi_close_handler);
+  if (svn_stream_supports_reset(inner_stream))
+    svn_stream_set_seek(outer_stream, multi_seek_handler);
+
+  return outer_stream;
+}
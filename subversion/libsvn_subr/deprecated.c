@@ -47,6 +47,7 @@
 #include "svn_xml.h"
 #include "svn_auth.h"
 #include "svn_base64.h"
+#include "svn_cache_config.h"
 
 #include "opt.h"
 #include "auth.h"
@@ -2013,3 +2014,29 @@ svn_cstring_join(const apr_array_header_t *strings,
 {
   return svn_cstring_join2(strings, separator, TRUE, pool);
 }
+
+/*** From cache_config.c ***/
+const svn_cache_config_t *
+svn_cache_config_get(void)
+{
+  static svn_cache_config_t settings;
+  const svn_cache_config2_t *settings2 = svn_cache_config_get2();
+
+  settings.cache_size = settings2->cache_size;
+  settings.file_handle_count = settings2->file_handle_count;
+  settings.single_threaded = settings2->single_threaded;
+
+  return &settings;
+}
+
+void
+svn_cache_config_set(const svn_cache_config_t *settings)
+{
+  svn_cache_config2_t settings2 = *svn_cache_config_get2();
+
+  settings2.cache_size = settings->cache_size;
+  settings2.file_handle_count = settings->file_handle_count;
+  settings2.single_threaded = settings->single_threaded;
+
+  svn_cache_config_set2(&settings2);
+}
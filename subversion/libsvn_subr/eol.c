@@ -29,10 +29,93 @@
 #include "svn_io.h"
 #include "private/svn_eol_private.h"
 #include "private/svn_dep_compat.h"
+#include "private/svn_simd.h"
+
+#ifdef SVN__SSE2
+#include <emmintrin.h>
+#endif
+#ifdef SVN__AVX2
+#include <immintrin.h>
+
+/* Scan the full 32 byte blocks in BUF of LEN bytes for any of C1, C2
+ * and C3.  Return the position of the first match or the start of the
+ * remaining partial block if there is none.
+ */
+SVN__TARGET_AVX2
+static char *
+find_chars_avx2(char *buf, apr_size_t len, char c1, char c2, char c3)
+{
+  const __m256i v1 = _mm256_set1_epi8(c1);
+  const __m256i v2 = _mm256_set1_epi8(c2);
+  const __m256i v3 = _mm256_set1_epi8(c3);
+
+  for (; len >= sizeof(__m256i)
+       ; buf += sizeof(__m256i), len -= sizeof(__m256i))
+    {
+      __m256i chunk = _mm256_loadu_si256((const __m256i *)buf);
+      int mask = _mm256_movemask_epi8(
+                   _mm256_or_si256(
+                     _mm256_or_si256(_mm256_cmpeq_epi8(chunk, v1),
+                                     _mm256_cmpeq_epi8(chunk, v2)),
+                     _mm256_cmpeq_epi8(chunk, v3)));
+      if (mask)
+        return buf + __builtin_ctz(mask);
+    }
+
+  return buf;
+}
+#endif
+
+char *
+svn_eol__find_chars(char *buf, apr_size_t len, char c1, char c2, char c3)
+{
+#ifdef SVN__AVX2
+  if (len >= sizeof(__m256i) && svn_simd__have_avx2())
+    {
+      char *end = buf + len;
+      buf = find_chars_avx2(buf, len, c1, c2, c3);
+      len = end - buf;
+    }
+#endif
+
+#ifdef SVN__SSE2
+  {
+    const __m128i v1 = _mm_set1_epi8(c1);
+    const __m128i v2 = _mm_set1_epi8(c2);
+    const __m128i v3 = _mm_set1_epi8(c3);
+
+    /* Scan 16 bytes at a time.  Any match will be located below. */
+    for (; len >= sizeof(__m128i)
+         ; buf += sizeof(__m128i), len -= sizeof(__m128i))
+      {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)buf);
+        if (_mm_movemask_epi8(
+              _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, v1),
+                                        _mm_cmpeq_epi8(chunk, v2)),
+                           _mm_cmpeq_epi8(chunk, v3))))
+          break;
+      }
+  }
+#endif
+
+  for (; len > 0; ++buf, --len)
+    {
+      if (*buf == c1 || *buf == c2 || *buf == c3)
+        return buf;
+    }
+
+  return NULL;
+}
 
 char *
 svn_eol__find_eol_start(char *buf, apr_size_t len)
 {
+#if defined(SVN__SSE2)
+
+  /* The vector code beats the word-wise scan below. */
+  return svn_eol__find_chars(buf, len, '\r', '\n', '\n');
+
+#else
 #if SVN_UNALIGNED_ACCESS_IS_OK
 
   /* Scan the input one machine word at a time. */
@@ -68,6 +151,7 @@ svn_eol__find_eol_start(char *buf, apr_size_t len)
     }
 
   return NULL;
+#endif
 }
 
 const char *
@@ -51,6 +51,17 @@
 #include <fcntl.h>
 #endif
 
+#if defined(__linux__)
+#include <errno.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#ifndef FICLONE
+/* From <linux/fs.h>; not all C libraries expose it. */
+#define FICLONE _IOW(0x94, 9, int)
+#endif
+#endif
+
 #include "svn_hash.h"
 #include "svn_types.h"
 #include "svn_dirent_uri.h"
@@ -880,6 +891,106 @@ svn_io_temp_dir(const char **dir,
 
 /*** Creating, copying and appending files. ***/
 
+#if defined(__linux__)
+
+/* Maximum number of bytes per copy_file_range() call.  Smaller than the
+ * 2GB limit of the call, so we don't hold up signals for too long. */
+#define COPY_RANGE_CHUNK_SIZE 0x40000000
+
+/* Try to copy the contents of FROM_FILE to TO_FILE without passing the
+ * data through user space.  Both files must be at their start.
+ *
+ * First, try to share the data blocks with a FICLONE reflink, which is
+ * instantaneous on file systems supporting it (btrfs, XFS, ...).  Then,
+ * try copy_file_range(), which lets the kernel copy the data directly
+ * or offload it to the storage.  Set *DONE to TRUE if either succeeded
+ * for the whole file.  Otherwise, reset both files to their initial state,
+ * set *DONE to FALSE and return APR_SUCCESS.
+ */
+static apr_status_t
+copy_contents_in_kernel(svn_boolean_t *done,
+                        apr_file_t *from_file,
+                        apr_file_t *to_file)
+{
+  apr_os_file_t from_fd, to_fd;
+  struct stat from_stat;
+#ifdef __NR_copy_file_range
+  apr_off_t copied = 0;
+#endif
+
+  *done = FALSE;
+  if (apr_os_file_get(&from_fd, from_file)
+      || apr_os_file_get(&to_fd, to_file))
+    return APR_SUCCESS;
+
+  /* Pseudo files, e.g. in /proc, report a size of 0 and copy_file_range
+     would not copy their contents.  Leave those and empty files to the
+     generic code. */
+  if (fstat(from_fd, &from_stat) || !S_ISREG(from_stat.st_mode)
+      || from_stat.st_size == 0)
+    return APR_SUCCESS;
+
+  if (ioctl(to_fd, FICLONE, from_fd) == 0)
+    {
+      *done = TRUE;
+      return APR_SUCCESS;
+    }
+
+#ifdef __NR_copy_file_range
+  while (1)
+    {
+      /* Call the kernel directly: older C libraries lack a wrapper. */
+      long result = syscall(__NR_copy_file_range, from_fd, NULL, to_fd,
+                            NULL, (size_t)COPY_RANGE_CHUNK_SIZE, 0u);
+      if (result > 0)
+        {
+          copied += result;
+        }
+      else if (result == 0 && copied >= from_stat.st_size)
+        {
+          *done = TRUE;
+          return APR_SUCCESS;
+        }
+      else if (result == 0)
+        {
+          /* Some file systems report success without copying anything
+             or stop early.  Start over the usual way.  We bypassed the
+             APR file buffers, so only the OS file offsets need fixing. */
+          if (copied == 0)
+            return APR_SUCCESS;
+
+          if (   lseek(from_fd, 0, SEEK_SET) != 0
+              || ftruncate(to_fd, 0)
+              || lseek(to_fd, 0, SEEK_SET) != 0)
+            return APR_FROM_OS_ERROR(errno);
+
+          return APR_SUCCESS;
+        }
+      else if (errno == EINTR)
+        {
+          continue;
+        }
+      else if (copied == 0
+               && (errno == ENOSYS || errno == EXDEV || errno == EINVAL
+                   || errno == EOPNOTSUPP || errno == EBADF
+                   || errno == EPERM))
+        {
+          /* Not supported for this combination of files.  Nothing has
+             been written yet, so the caller may copy the usual way. */
+          return APR_SUCCESS;
+        }
+      else
+        {
+          return APR_FROM_OS_ERROR(errno);
+        }
+    }
+#else
+  return APR_SUCCESS;
+#endif
+}
+
+#endif /* __linux__ */
+
 /* Transfer the contents of FROM_FILE to TO_FILE, using POOL for temporary
  * allocations.
  *
@@ -894,6 +1005,14 @@ copy_contents(apr_file_t *from_file,
               apr_file_t *to_file,
               apr_pool_t *pool)
 {
+#if defined(__linux__)
+  svn_boolean_t done;
+  apr_status_t status = copy_contents_in_kernel(&done, from_file, to_file);
+
+  if (status || done)
+    return status;
+#endif
+
   /* Copy bytes till the cows come home. */
   while (1)
     {
@@ -4233,6 +4352,21 @@ svn_io_file_aligned_seek(apr_file_t *file,
   return SVN_NO_ERROR;
 }
 
+void
+svn_io__file_prefetch(apr_file_t *file,
+                      apr_off_t offset,
+                      apr_off_t length)
+{
+#if defined(POSIX_FADV_WILLNEED)
+  apr_os_file_t fd;
+
+  /* The kernel queues the reads and returns immediately.  Failures are
+     of no concern to the caller, who will simply read the data later. */
+  if (length > 0 && apr_os_file_get(&fd, file) == APR_SUCCESS)
+    (void)posix_fadvise(fd, offset, length, POSIX_FADV_WILLNEED);
+#endif
+}
+
 
 svn_error_t *
 svn_io_file_write(apr_file_t *file, const void *buf,
@@ -0,0 +1,276 @@
+/*
+ * sha1.c :  SHA-1 digests with hardware acceleration
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <string.h>
+
+#include "private/svn_simd.h"
+#include "sha1.h"
+
+#ifdef SVN__SHA_NI
+#include <immintrin.h>
+#endif
+
+/* SHA-1 block size in bytes. */
+#define BLOCK_SIZE 64
+
+struct svn_sha1__context_t
+{
+  /* If set, use the hardware implementation and the fields below.
+   * Otherwise, use APR_CTX. */
+  svn_boolean_t use_hw;
+
+  /* Fallback implementation. */
+  apr_sha1_ctx_t apr_ctx;
+
+  /* Hash state A to E. */
+  apr_uint32_t state[5];
+
+  /* Input not yet processed because it does not fill a whole block. */
+  unsigned char buffer[BLOCK_SIZE];
+
+  /* Number of bytes fed into this context so far. */
+  apr_uint64_t length;
+};
+
+#ifdef SVN__SHA_NI
+
+/* One group of 4 SHA-1 rounds using the SHA extensions.  M0 is the
+ * message schedule for this group; M1 to M3 get advanced towards being
+ * used in the next 3 groups.  The extra work done in the final groups
+ * only produces values that are never used.
+ */
+#define ROUNDS_4(e_next, e_cur, m0, m1, m2, m3, f) \
+  e_cur = _mm_sha1nexte_epu32(e_cur, m0);          \
+  e_next = abcd;                                   \
+  m1 = _mm_sha1msg2_epu32(m1, m0);                 \
+  abcd = _mm_sha1rnds4_epu32(abcd, e_cur, f);      \
+  m3 = _mm_sha1msg1_epu32(m3, m0);                 \
+  m2 = _mm_xor_si128(m2, m0)
+
+/* Process COUNT blocks of 64 bytes at DATA and update STATE. */
+SVN__TARGET_SHA
+static void
+process_blocks_hw(apr_uint32_t state[5],
+                  const unsigned char *data,
+                  apr_size_t count)
+{
+  const __m128i mask = _mm_set_epi64x(0x0001020304050607ULL,
+                                      0x08090a0b0c0d0e0fULL);
+  __m128i abcd = _mm_shuffle_epi32(
+                   _mm_loadu_si128((const __m128i *)state), 0x1b);
+  __m128i e0 = _mm_set_epi32((int)state[4], 0, 0, 0);
+  __m128i e1;
+
+  for (; count > 0; --count, data += BLOCK_SIZE)
+    {
+      const __m128i abcd_save = abcd;
+      const __m128i e0_save = e0;
+      __m128i msg0, msg1, msg2, msg3;
+
+      /* Rounds 0 to 15 also load the input. */
+      msg0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)data),
+                              mask);
+      e0 = _mm_add_epi32(e0, msg0);
+      e1 = abcd;
+      abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+
+      msg1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 16)),
+                              mask);
+      e1 = _mm_sha1nexte_epu32(e1, msg1);
+      e0 = abcd;
+      abcd = _mm_sha1rnds4_epu32(abcd, e1, 0);
+      msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+
+      msg2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 32)),
+                              mask);
+      e0 = _mm_sha1nexte_epu32(e0, msg2);
+      e1 = abcd;
+      abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+      msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+      msg0 = _mm_xor_si128(msg0, msg2);
+
+      msg3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 48)),
+                              mask);
+      ROUNDS_4(e0, e1, msg3, msg0, msg1, msg2, 0);
+
+      /* Rounds 16 to 79. */
+      ROUNDS_4(e1, e0, msg0, msg1, msg2, msg3, 0);
+      ROUNDS_4(e0, e1, msg1, msg2, msg3, msg0, 1);
+      ROUNDS_4(e1, e0, msg2, msg3, msg0, msg1, 1);
+      ROUNDS_4(e0, e1, msg3, msg0, msg1, msg2, 1);
+      ROUNDS_4(e1, e0, msg0, msg1, msg2, msg3, 1);
+      ROUNDS_4(e0, e1, msg1, msg2, msg3, msg0, 1);
+      ROUNDS_4(e1, e0, msg2, msg3, msg0, msg1, 2);
+      ROUNDS_4(e0, e1, msg3, msg0, msg1, msg2, 2);
+      ROUNDS_4(e1, e0, msg0, msg1, msg2, msg3, 2);
+      ROUNDS_4(e0, e1, msg1, msg2, msg3, msg0, 2);
+      ROUNDS_4(e1, e0, msg2, msg3, msg0, msg1, 2);
+      ROUNDS_4(e0, e1, msg3, msg0, msg1, msg2, 3);
+      ROUNDS_4(e1, e0, msg0, msg1, msg2, msg3, 3);
+      ROUNDS_4(e0, e1, msg1, msg2, msg3, msg0, 3);
+      ROUNDS_4(e1, e0, msg2, msg3, msg0, msg1, 3);
+      ROUNDS_4(e0, e1, msg3, msg0, msg1, msg2, 3);
+
+      e0 = _mm_sha1nexte_epu32(e0, e0_save);
+      abcd = _mm_add_epi32(abcd, abcd_save);
+    }
+
+  _mm_storeu_si128((__m128i *)state, _mm_shuffle_epi32(abcd, 0x1b));
+  state[4] = (apr_uint32_t)_mm_extract_epi32(e0, 3);
+}
+
+#endif /* SVN__SHA_NI */
+
+svn_sha1__context_t *
+svn_sha1__context_create(apr_pool_t *pool)
+{
+  svn_sha1__context_t *context = apr_palloc(pool, sizeof(*context));
+  svn_sha1__context_reset(context);
+
+  return context;
+}
+
+void
+svn_sha1__context_reset(svn_sha1__context_t *context)
+{
+  static const apr_uint32_t initial_state[5]
+    = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0 };
+
+#ifdef SVN__SHA_NI
+  context->use_hw = svn_simd__have_sha();
+#else
+  context->use_hw = FALSE;
+#endif
+
+  if (context->use_hw)
+    memcpy(context->state, initial_state, sizeof(initial_state));
+  else
+    apr_sha1_init(&context->apr_ctx);
+
+  context->length = 0;
+}
+
+void
+svn_sha1__update(svn_sha1__context_t *context,
+                 const void *data,
+                 apr_size_t len)
+{
+#ifdef SVN__SHA_NI
+  const unsigned char *input = data;
+  apr_size_t buffered;
+
+  if (context->use_hw)
+    {
+      buffered = (apr_size_t)(context->length % BLOCK_SIZE);
+      context->length += len;
+
+      /* Complete a partially filled block first. */
+      if (buffered)
+        {
+          apr_size_t to_copy = BLOCK_SIZE - buffered;
+          if (to_copy > len)
+            to_copy = len;
+
+          memcpy(context->buffer + buffered, input, to_copy);
+          input += to_copy;
+          len -= to_copy;
+
+          if (buffered + to_copy < BLOCK_SIZE)
+            return;
+
+          process_blocks_hw(context->state, context->buffer, 1);
+        }
+
+      /* Process whole blocks straight from the input. */
+      process_blocks_hw(context->state, input, len / BLOCK_SIZE);
+      input += len - len % BLOCK_SIZE;
+      len %= BLOCK_SIZE;
+
+      memcpy(context->buffer, input, len);
+      return;
+    }
+#endif
+
+  /* APR takes the length as unsigned int. */
+  while (len > APR_UINT32_MAX)
+    {
+      apr_sha1_update(&context->apr_ctx, data, APR_UINT32_MAX);
+      data = (const char *)data + APR_UINT32_MAX;
+      len -= APR_UINT32_MAX;
+    }
+
+  apr_sha1_update(&context->apr_ctx, data, (unsigned int)len);
+}
+
+void
+svn_sha1__finalize(unsigned char digest[APR_SHA1_DIGESTSIZE],
+                   svn_sha1__context_t *context)
+{
+#ifdef SVN__SHA_NI
+  if (context->use_hw)
+    {
+      apr_uint64_t bits = context->length * 8;
+      apr_size_t buffered = (apr_size_t)(context->length % BLOCK_SIZE);
+      int i;
+
+      /* Pad with 0x80, zeros and the big-endian bit count. */
+      context->buffer[buffered++] = 0x80;
+      if (buffered > BLOCK_SIZE - 8)
+        {
+          memset(context->buffer + buffered, 0, BLOCK_SIZE - buffered);
+          process_blocks_hw(context->state, context->buffer, 1);
+          buffered = 0;
+        }
+
+      memset(context->buffer + buffered, 0, BLOCK_SIZE - 8 - buffered);
+      for (i = 0; i < 8; ++i)
+        context->buffer[BLOCK_SIZE - 1 - i] = (unsigned char)(bits >> (8 * i));
+
+      process_blocks_hw(context->state, context->buffer, 1);
+
+      for (i = 0; i < 5; ++i)
+        {
+          digest[4 * i + 0] = (unsigned char)(context->state[i] >> 24);
+          digest[4 * i + 1] = (unsigned char)(context->state[i] >> 16);
+          digest[4 * i + 2] = (unsigned char)(context->state[i] >> 8);
+          digest[4 * i + 3] = (unsigned char)(context->state[i]);
+        }
+
+      return;
+    }
+#endif
+
+  apr_sha1_final(digest, &context->apr_ctx);
+}
+
+void
+svn__sha1(unsigned char digest[APR_SHA1_DIGESTSIZE],
+          const void *data,
+          apr_size_t len)
+{
+  svn_sha1__context_t context;
+
+  svn_sha1__context_reset(&context);
+  svn_sha1__update(&context, data, len);
+  svn_sha1__finalize(digest, &context);
+}
@@ -0,0 +1,78 @@
+/*
+ * simd.c :  runtime detection of SIMD instruction sets
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include "private/svn_simd.h"
+
+#ifdef SVN__SHA_NI
+#include <cpuid.h>
+#endif
+
+svn_boolean_t
+svn_simd__have_avx2(void)
+{
+#ifdef SVN__AVX2
+  /* 0 = unknown, 1 = no, 2 = yes.  Racing initializations will all
+     arrive at the same value. */
+  static volatile int avx2 = 0;
+
+  if (avx2 == 0)
+    {
+      __builtin_cpu_init();
+      avx2 = __builtin_cpu_supports("avx2") ? 2 : 1;
+    }
+
+  return avx2 == 2;
+#else
+  return FALSE;
+#endif
+}
+
+svn_boolean_t
+svn_simd__have_sha(void)
+{
+#ifdef SVN__SHA_NI
+  /* 0 = unknown, 1 = no, 2 = yes. */
+  static volatile int sha = 0;
+
+  if (sha == 0)
+    {
+      unsigned int eax, ebx, ecx, edx;
+      svn_boolean_t supported = FALSE;
+
+      /* The SHA extensions are flagged in bit 29 of EBX of leaf 7. */
+      __builtin_cpu_init();
+      if (__builtin_cpu_supports("ssse3") && __builtin_cpu_supports("sse4.1")
+          && __get_cpuid_max(0, NULL) >= 7)
+        {
+          __cpuid_count(7, 0, eax, ebx, ecx, edx);
+          supported = (ebx & (1u << 29)) != 0;
+        }
+
+      sha = supported ? 2 : 1;
+    }
+
+  return sha == 2;
+#else
+  return FALSE;
+#endif
+}
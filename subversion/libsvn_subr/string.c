@@ -34,9 +34,17 @@
 #include "svn_ctype.h"
 #include "private/svn_dep_compat.h"
 #include "private/svn_string_private.h"
+#include "private/svn_simd.h"
 
 #include "svn_private_config.h"
 
+#ifdef SVN__SSE2
+#include <emmintrin.h>
+#endif
+#ifdef SVN__AVX2
+#include <immintrin.h>
+#endif
+
 
 
 /* Allocate the space for a memory buffer from POOL.
@@ -1501,6 +1509,54 @@ svn_string__similarity(const svn_string_t *stringa,
     return SVN_STRING__SIM_RANGE_MAX;
 }
 
+#ifdef SVN__AVX2
+
+/* Return the number of matching bytes at the start of A and B that can be
+ * found by comparing full 32 byte blocks, up to MAX_LEN.  The result is
+ * exact if a mismatch was found.
+ */
+SVN__TARGET_AVX2
+static apr_size_t
+match_length_avx2(const char *a, const char *b, apr_size_t max_len)
+{
+  apr_size_t pos;
+
+  for (pos = 0; max_len - pos >= sizeof(__m256i); pos += sizeof(__m256i))
+    {
+      __m256i chunk_a = _mm256_loadu_si256((const __m256i *)(a + pos));
+      __m256i chunk_b = _mm256_loadu_si256((const __m256i *)(b + pos));
+      unsigned mask = ~(unsigned)_mm256_movemask_epi8(
+                                   _mm256_cmpeq_epi8(chunk_a, chunk_b));
+      if (mask)
+        return pos + __builtin_ctz(mask);
+    }
+
+  return pos;
+}
+
+/* Like match_length_avx2 but compare the MAX_LEN bytes before A and B,
+ * i.e. return the length of the common suffix.
+ */
+SVN__TARGET_AVX2
+static apr_size_t
+reverse_match_length_avx2(const char *a, const char *b, apr_size_t max_len)
+{
+  apr_size_t pos;
+
+  for (pos = sizeof(__m256i); pos <= max_len; pos += sizeof(__m256i))
+    {
+      __m256i chunk_a = _mm256_loadu_si256((const __m256i *)(a - pos));
+      __m256i chunk_b = _mm256_loadu_si256((const __m256i *)(b - pos));
+      unsigned mask = ~(unsigned)_mm256_movemask_epi8(
+                                   _mm256_cmpeq_epi8(chunk_a, chunk_b));
+      if (mask)
+        return pos - sizeof(__m256i) + __builtin_clz(mask);
+    }
+
+  return pos - sizeof(__m256i);
+}
+#endif
+
 apr_size_t
 svn_cstring__match_length(const char *a,
                           const char *b,
@@ -1508,6 +1564,24 @@ svn_cstring__match_length(const char *a,
 {
   apr_size_t pos = 0;
 
+#ifdef SVN__AVX2
+  if (max_len >= sizeof(__m256i) && svn_simd__have_avx2())
+    pos = match_length_avx2(a, b, max_len);
+#endif
+
+#ifdef SVN__SSE2
+
+  /* Skip all matching 16 byte blocks.  The remainder gets handled below. */
+  for (; max_len - pos >= sizeof(__m128i); pos += sizeof(__m128i))
+    {
+      __m128i chunk_a = _mm_loadu_si128((const __m128i *)(a + pos));
+      __m128i chunk_b = _mm_loadu_si128((const __m128i *)(b + pos));
+      if (_mm_movemask_epi8(_mm_cmpeq_epi8(chunk_a, chunk_b)) != 0xffff)
+        break;
+    }
+
+#endif
+
 #if SVN_UNALIGNED_ACCESS_IS_OK
 
   /* Chunky processing is so much faster ...
@@ -1536,6 +1610,26 @@ svn_cstring__reverse_match_length(const char *a,
 {
   apr_size_t pos = 0;
 
+#ifdef SVN__AVX2
+  if (max_len >= sizeof(__m256i) && svn_simd__have_avx2())
+    pos = reverse_match_length_avx2(a, b, max_len);
+#endif
+
+#ifdef SVN__SSE2
+
+  /* Skip all matching 16 byte blocks.  The remainder gets handled below. */
+  for (pos += sizeof(__m128i); pos <= max_len; pos += sizeof(__m128i))
+    {
+      __m128i chunk_a = _mm_loadu_si128((const __m128i *)(a - pos));
+      __m128i chunk_b = _mm_loadu_si128((const __m128i *)(b - pos));
+      if (_mm_movemask_epi8(_mm_cmpeq_epi8(chunk_a, chunk_b)) != 0xffff)
+        break;
+    }
+
+  pos -= sizeof(__m128i);
+
+#endif
+
 #if SVN_UNALIGNED_ACCESS_IS_OK
 
   /* Chunky processing is so much faster ...
@@ -1544,7 +1638,7 @@ svn_cstring__reverse_match_length(const char *a,
    * because A and B will probably have different alignment. So, skipping
    * the first few chars until alignment is reached is not an option.
    */
-  for (pos = sizeof(apr_size_t); pos <= max_len; pos += sizeof(apr_size_t))
+  for (pos += sizeof(apr_size_t); pos <= max_len; pos += sizeof(apr_size_t))
     if (*(const apr_size_t*)(a - pos) != *(const apr_size_t*)(b - pos))
       break;
 
@@ -51,6 +51,7 @@
 
 #include "private/svn_string_private.h"
 #include "private/svn_eol_private.h"
+#include "private/svn_simd.h"
 
 /**
  * The textual elements of a detranslated special file.  One of these
@@ -876,6 +877,10 @@ struct translation_baton
      may trigger a translation action, hence are 'interesting' */
   char interesting[256];
 
+  /* The interesting characters for vectorized scanning.  Unused slots
+     repeat one of the other values. */
+  char scan_chars[3];
+
   /* Length of the string EOL_STR points to. */
   apr_size_t eol_str_len;
 
@@ -946,9 +951,57 @@ create_translation_baton(const char *eol_str,
       b->interesting['\n'] = TRUE;
     }
 
+  b->scan_chars[0] = keywords ? '$' : '\r';
+  b->scan_chars[1] = eol_str ? '\r' : '$';
+  b->scan_chars[2] = eol_str ? '\n' : '$';
+
   return b;
 }
 
+/* Return the first character in [P, END) that is interesting according
+ * to baton B, or END if there is none.
+ */
+static const char *
+find_interesting(const struct translation_baton *b,
+                 const char *p,
+                 const char *end)
+{
+#ifdef SVN__SSE2
+
+  /* Let the vector code skip over boring runs 16 or 32 bytes at a time. */
+  const char *found = svn_eol__find_chars((char *)p, end - p,
+                                          b->scan_chars[0],
+                                          b->scan_chars[1],
+                                          b->scan_chars[2]);
+  return found ? found : end;
+
+#else
+
+  const char *interesting = b->interesting;
+
+  /* Check 4 bytes at once to allow for efficient pipelining
+     and to reduce loop condition overhead. */
+  while ((end - p) >= 4)
+    {
+      if (interesting[(unsigned char)p[0]]
+          || interesting[(unsigned char)p[1]]
+          || interesting[(unsigned char)p[2]]
+          || interesting[(unsigned char)p[3]])
+        break;
+
+      p += 4;
+    }
+
+  /* Found an interesting char or EOF in the next 4 bytes.
+     Find its exact position. */
+  while (p < end && !interesting[(unsigned char)*p])
+    ++p;
+
+  return p;
+
+#endif
+}
+
 /* Return TRUE if the EOL starting at BUF matches the eol_str member of B.
  * Be aware of special cases like "\n\r\n" and "\n\n\r". For sequences like
  * "\n$" (an EOL followed by a keyword), the result will be FALSE since it is
@@ -1125,24 +1178,7 @@ translate_chunk(svn_stream_t *dst,
 
               if (b->keywords)
                 {
-                  /* Check 4 bytes at once to allow for efficient pipelining
-                    and to reduce loop condition overhead. */
-                  while ((end - p) >= (len + 4))
-                    {
-                      if (interesting[(unsigned char)p[len]]
-                          || interesting[(unsigned char)p[len+1]]
-                          || interesting[(unsigned char)p[len+2]]
-                          || interesting[(unsigned char)p[len+3]])
-                        break;
-
-                      len += 4;
-                    }
-
-                  /* Found an interesting char or EOF in the next 4 bytes.
-                     Find its exact position. */
-                  while ((p + len) < end
-                         && !interesting[(unsigned char)p[len]])
-                    ++len;
+                  len = find_interesting(b, p + len, end) - p;
                 }
               else
                 {
@@ -56,9 +56,19 @@
  *
  */
 
+#include <string.h>
+
 #include "private/svn_utf_private.h"
 #include "private/svn_eol_private.h"
 #include "private/svn_dep_compat.h"
+#include "private/svn_simd.h"
+
+#ifdef SVN__SSE2
+#include <emmintrin.h>
+#endif
+#ifdef SVN__AVX2
+#include <immintrin.h>
+#endif
 
 /* Lookup table to categorise each octet in the string. */
 static const char octet_category[256] = {
@@ -258,7 +268,16 @@ static const char machine [9][14] = {
 static const char *
 first_non_fsm_start_char(const char *data, apr_size_t max_len)
 {
-#if SVN_UNALIGNED_ACCESS_IS_OK
+#if defined(SVN__SSE2)
+
+  /* Scan the input 16 bytes at a time.  The sign bits of all bytes get
+     collected in MASK, i.e. any non-ASCII char makes it non-zero. */
+  for (; max_len >= sizeof(__m128i)
+       ; data += sizeof(__m128i), max_len -= sizeof(__m128i))
+    if (_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)data)))
+      break;
+
+#elif SVN_UNALIGNED_ACCESS_IS_OK
 
   /* Scan the input one machine word at a time. */
   for (; max_len > sizeof(apr_uintptr_t)
@@ -276,8 +295,215 @@ first_non_fsm_start_char(const char *data, apr_size_t max_len)
   return data;
 }
 
-const char *
-svn_utf__last_valid(const char *data, apr_size_t len)
+#ifdef SVN__AVX2
+
+/* Vectorized validation following the "lookup" algorithm by Keiser and
+ * Lemire, "Validating UTF-8 In Less Than One Instruction Per Byte".
+ *
+ * Every byte gets classified by three 16-entry tables, indexed by the
+ * high nibble of the preceding byte, the low nibble of the preceding
+ * byte and the high nibble of the byte itself.  Each table entry is a
+ * set of error bits; an error is present where all three tables agree.
+ * This covers all invalid 2-byte combinations.  Whether a byte must be
+ * the 3rd or 4th byte of a sequence is determined separately from the
+ * bytes 2 and 3 positions back.
+ */
+
+/* Error classes.  TOO_LARGE_1000 and OVERLONG_4 share a bit because
+ * they never apply to the same byte pair. */
+#define UTF8_TOO_SHORT       0x01
+#define UTF8_TOO_LONG        0x02
+#define UTF8_OVERLONG_3      0x04
+#define UTF8_TOO_LARGE       0x08
+#define UTF8_SURROGATE       0x10
+#define UTF8_OVERLONG_2      0x20
+#define UTF8_TOO_LARGE_1000  0x40
+#define UTF8_OVERLONG_4      0x40
+#define UTF8_TWO_CONTS       0x80
+#define UTF8_CARRY           (UTF8_TOO_SHORT | UTF8_TOO_LONG \
+                              | UTF8_TWO_CONTS)
+
+/* Errors implied by the high nibble of the first byte of a pair. */
+static const unsigned char byte_1_high_table[16] = {
+  /* 0_______ ASCII */
+  UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+  UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+  /* 10______ continuation */
+  UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS,
+  /* 1100____ 2-byte lead */
+  UTF8_TOO_SHORT | UTF8_OVERLONG_2,
+  /* 1101____ 2-byte lead */
+  UTF8_TOO_SHORT,
+  /* 1110____ 3-byte lead */
+  UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE,
+  /* 1111____ 4-byte lead */
+  UTF8_TOO_SHORT | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4
+};
+
+/* Errors implied by the low nibble of the first byte of a pair. */
+static const unsigned char byte_1_low_table[16] = {
+  /* ____0000 */
+  UTF8_CARRY | UTF8_OVERLONG_3 | UTF8_OVERLONG_2 | UTF8_OVERLONG_4,
+  /* ____0001 */
+  UTF8_CARRY | UTF8_OVERLONG_2,
+  /* ____001_ */
+  UTF8_CARRY,
+  UTF8_CARRY,
+  /* ____0100 */
+  UTF8_CARRY | UTF8_TOO_LARGE,
+  /* ____0101 .. ____1100 */
+  UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+  UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+  UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+  UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+  UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+  UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+  UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+  UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+  /* ____1101 */
+  UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_SURROGATE,
+  /* ____111_ */
+  UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+  UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000
+};
+
+/* Errors implied by the high nibble of the second byte of a pair. */
+static const unsigned char byte_2_high_table[16] = {
+  /* 0_______ ASCII */
+  UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+  UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+  /* 1000____ */
+  UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3
+  | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4,
+  /* 1001____ */
+  UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3
+  | UTF8_TOO_LARGE,
+  /* 101_____ */
+  UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE
+  | UTF8_TOO_LARGE,
+  UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE
+  | UTF8_TOO_LARGE,
+  /* 11______ lead */
+  UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT
+};
+
+/* A block ending in any byte above these limits ends in an incomplete
+ * multi-byte sequence. */
+static const unsigned char incomplete_limit[32] = {
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xef, 0xdf, 0xbf
+};
+
+/* Return INPUT shifted by N bytes towards higher addresses, with the
+ * top N bytes of PREV shifted in. */
+#define AVX2_PREV(input, prev, n) \
+  _mm256_alignr_epi8((input), \
+                     _mm256_permute2x128_si256((prev), (input), 0x21), \
+                     16 - (n))
+
+/* Validate LEN bytes starting at DATA in blocks of 32 bytes.  Return
+ * NULL if all of it is valid UTF-8.  Otherwise, return the start of the
+ * first block in which an error was detected.  All data before that
+ * block is valid except for a possibly incomplete sequence at its end.
+ */
+SVN__TARGET_AVX2
+static const char *
+avx2_first_invalid_block(const char *data, apr_size_t len)
+{
+  const __m256i nibble_mask = _mm256_set1_epi8(0x0f);
+  const __m256i byte_1_high
+    = _mm256_broadcastsi128_si256(_mm_loadu_si128(
+        (const __m128i *)byte_1_high_table));
+  const __m256i byte_1_low
+    = _mm256_broadcastsi128_si256(_mm_loadu_si128(
+        (const __m128i *)byte_1_low_table));
+  const __m256i byte_2_high
+    = _mm256_broadcastsi128_si256(_mm_loadu_si128(
+        (const __m128i *)byte_2_high_table));
+  const __m256i limit
+    = _mm256_loadu_si256((const __m256i *)incomplete_limit);
+  __m256i prev = _mm256_setzero_si256();
+  __m256i prev_incomplete = _mm256_setzero_si256();
+  const char *end = data + len;
+  const char *block;
+
+  for (block = data; ; block += sizeof(__m256i))
+    {
+      apr_size_t remaining = end - block;
+      __m256i input;
+      __m256i error;
+
+      if (remaining >= sizeof(__m256i))
+        {
+          input = _mm256_loadu_si256((const __m256i *)block);
+        }
+      else
+        {
+          /* Pad the last block with NULs.  They are valid by themselves
+             and will flag any sequence left incomplete before them. */
+          char tail[sizeof(__m256i)] = { 0 };
+          memcpy(tail, block, remaining);
+          input = _mm256_loadu_si256((const __m256i *)tail);
+        }
+
+      if (_mm256_movemask_epi8(input) == 0)
+        {
+          /* Pure ASCII.  Only a sequence left open by PREV may fail. */
+          error = prev_incomplete;
+          prev_incomplete = _mm256_setzero_si256();
+        }
+      else
+        {
+          __m256i prev1 = AVX2_PREV(input, prev, 1);
+          __m256i prev2 = AVX2_PREV(input, prev, 2);
+          __m256i prev3 = AVX2_PREV(input, prev, 3);
+          __m256i special, must_be_cont;
+
+          special = _mm256_and_si256(
+            _mm256_and_si256(
+              _mm256_shuffle_epi8(byte_1_high,
+                _mm256_and_si256(_mm256_srli_epi16(prev1, 4),
+                                 nibble_mask)),
+              _mm256_shuffle_epi8(byte_1_low,
+                _mm256_and_si256(prev1, nibble_mask))),
+            _mm256_shuffle_epi8(byte_2_high,
+              _mm256_and_si256(_mm256_srli_epi16(input, 4),
+                               nibble_mask)));
+
+          /* Bytes 2 back from a 3-byte lead or 3 back from a 4-byte
+             lead must be continuations.  That is exactly where the
+             TWO_CONTS bit is expected to be set. */
+          must_be_cont = _mm256_and_si256(
+            _mm256_or_si256(
+              _mm256_subs_epu8(prev2, _mm256_set1_epi8(0xe0 - 0x80)),
+              _mm256_subs_epu8(prev3, _mm256_set1_epi8(0xf0 - 0x80))),
+            _mm256_set1_epi8((char)0x80));
+
+          error = _mm256_xor_si256(must_be_cont, special);
+          prev_incomplete = _mm256_subs_epu8(input, limit);
+        }
+
+      if (!_mm256_testz_si256(error, error))
+        return block;
+
+      if (remaining < sizeof(__m256i))
+        return NULL;
+
+      prev = input;
+    }
+}
+
+/* Below that many bytes, the setup overhead of the vector code is not
+ * worth it. */
+#define AVX2_MIN_LEN 64
+
+#endif /* SVN__AVX2 */
+
+/* Byte-at-a-time implementation of svn_utf__last_valid. */
+static const char *
+fsm_last_valid(const char *data, apr_size_t len)
 {
   const char *start = first_non_fsm_start_char(data, len);
   const char *end = data + len;
@@ -291,10 +517,39 @@ svn_utf__last_valid(const char *data, apr_size_t len)
       state = machine[state][category];
       if (state == FSM_START)
         start = data;
+      else if (state == FSM_ERROR)
+        break;
     }
   return start;
 }
 
+const char *
+svn_utf__last_valid(const char *data, apr_size_t len)
+{
+#ifdef SVN__AVX2
+  if (len >= AVX2_MIN_LEN && svn_simd__have_avx2())
+    {
+      const char *block = avx2_first_invalid_block(data, len);
+      const char *start;
+
+      if (block == NULL)
+        return data + len;
+
+      /* Everything before BLOCK is valid, apart from a sequence of at
+         most 3 bytes that may be incomplete.  Any sequence starting more
+         than 3 bytes before BLOCK is complete and valid, so restart the
+         scalar scan at the first char boundary from there. */
+      start = block - data > 3 ? block - 3 : data;
+      while (start < block && ((unsigned char)*start & 0xc0) == 0x80)
+        ++start;
+
+      return fsm_last_valid(start, data + len - start);
+    }
+#endif
+
+  return fsm_last_valid(data, len);
+}
+
 svn_boolean_t
 svn_utf__cstring_is_valid(const char *data)
 {
@@ -313,9 +568,14 @@ svn_utf__is_valid(const char *data, apr_size_t len)
   if (!data)
     return FALSE;
 
+#ifdef SVN__AVX2
+  if (len >= AVX2_MIN_LEN && svn_simd__have_avx2())
+    return avx2_first_invalid_block(data, len) == NULL;
+#endif
+
   data = first_non_fsm_start_char(data, len);
 
-  while (data < end)
+  while (data < end && state != FSM_ERROR)
     {
       unsigned char octet = *data++;
       int category = octet_category[octet];
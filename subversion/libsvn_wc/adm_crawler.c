@@ -39,6 +39,7 @@
 #include "svn_dirent_uri.h"
 #include "svn_path.h"
 
+#include "private/svn_delta_private.h"
 #include "private/svn_wc_private.h"
 
 #include "wc.h"
@@ -1045,8 +1046,10 @@ open_txdelta_stream(svn_txdelta_stream_t **txdelta_stream_p,
       SVN_ERR(svn_stream_reset(b->local_stream));
     }
 
-  svn_txdelta2(txdelta_stream_p, b->base_stream, b->local_stream,
-               FALSE, result_pool);
+  /* Large files are sent in many windows; compute and compress them in
+   * parallel. */
+  svn_txdelta__pipelined(txdelta_stream_p, b->base_stream, b->local_stream,
+                         FALSE, result_pool);
   b->need_reset = TRUE;
   return SVN_NO_ERROR;
 }
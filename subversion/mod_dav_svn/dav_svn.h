@@ -533,6 +533,9 @@ int dav_svn__method_post(request_rec *r);
 /* Request handler to GET Subversion internal status (FSFS cache). */
 int dav_svn__status(request_rec *r);
 
+/* Request handler to GET cache metrics in Prometheus text format. */
+int dav_svn__metrics(request_rec *r);
+
 /*** repos.c ***/
 
 /* generate an ETag for RESOURCE and return it, allocated in POOL. */
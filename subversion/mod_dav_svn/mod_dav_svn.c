@@ -42,6 +42,7 @@
 #include "svn_dso.h"
 #include "mod_dav_svn.h"
 
+#include "private/svn_cache.h"
 #include "private/svn_fspath.h"
 #include "private/svn_subr_private.h"
 
@@ -614,7 +615,7 @@ SVNBlockRead_cmd(cmd_parms *cmd, void *config, int arg)
 static const char *
 SVNInMemoryCacheSize_cmd(cmd_parms *cmd, void *config, const char *arg1)
 {
-  svn_cache_config_t settings = *svn_cache_config_get();
+  svn_cache_config2_t settings = *svn_cache_config_get2();
 
   apr_uint64_t value = 0;
   svn_error_t *err = svn_cstring_atoui64(&value, arg1);
@@ -626,7 +627,15 @@ SVNInMemoryCacheSize_cmd(cmd_parms *cmd, void *config, const char *arg1)
 
   settings.cache_size = value * 0x400;
 
-  svn_cache_config_set(&settings);
+  svn_cache_config_set2(&settings);
+
+  return NULL;
+}
+
+static const char *
+SVNCacheMetrics_cmd(cmd_parms *cmd, void *config, int arg)
+{
+  svn_cache__enable_metrics(arg);
 
   return NULL;
 }
@@ -1396,6 +1405,12 @@ static const command_rec cmds[] =
                 "in-memory object cache (default value is 16384; 0 switches "
                 "to dynamically sized caches)."),
   /* per server */
+  AP_INIT_FLAG("SVNCacheMetrics", SVNCacheMetrics_cmd, NULL,
+               RSRC_CONF,
+               "collects access statistics and lookup latencies of "
+               "Subversion's caches to be served by the svn-metrics "
+               "handler (default is Off)."),
+  /* per server */
   AP_INIT_TAKE1("SVNCompressionLevel", SVNCompressionLevel_cmd, NULL,
                 RSRC_CONF,
                 "specifies the compression level used before sending file "
@@ -1452,6 +1467,9 @@ register_hooks(apr_pool_t *pconf)
   /* Handler to GET Subversion's FSFS cache stats, a bit like mod_status. */
   ap_hook_handler(dav_svn__status, NULL, NULL, APR_HOOK_MIDDLE);
 
+  /* Handler to GET the cache stats in a format suitable for monitoring. */
+  ap_hook_handler(dav_svn__metrics, NULL, NULL, APR_HOOK_MIDDLE);
+
   /* live property handling */
   dav_hook_gather_propsets(dav_svn__gather_propsets, NULL, NULL,
                            APR_HOOK_MIDDLE);
@@ -117,3 +117,36 @@ int dav_svn__status(request_rec *r)
 
   return 0;
 }
+
+/* Like the svn-status handler but for monitoring systems:
+
+     SVNCacheMetrics On
+
+     <Location /svn-metrics>
+       SetHandler svn-metrics
+     </Location>
+
+  Per-cache statistics will only be available if SVNCacheMetrics has
+  been enabled.  As with svn-status, the values are those of the process
+  handling the request.
+*/
+int dav_svn__metrics(request_rec *r)
+{
+  svn_string_t *metrics;
+  svn_error_t *err;
+
+  if (r->method_number != M_GET || strcmp(r->handler, "svn-metrics"))
+    return DECLINED;
+
+  err = svn_cache__format_metrics(&metrics, r->pool);
+  if (err)
+    {
+      svn_error_clear(err);
+      return HTTP_INTERNAL_SERVER_ERROR;
+    }
+
+  ap_set_content_type(r, "text/plain; version=0.0.4");
+  ap_rwrite(metrics->data, (int)metrics->len, r);
+
+  return 0;
+}
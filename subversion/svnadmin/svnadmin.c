@@ -97,6 +97,7 @@ check_lib_versions(void)
 /** Subcommands. **/
 
 static svn_opt_subcommand_t
+  subcommand_build_path_index,
   subcommand_build_repcache,
   subcommand_crashtest,
   subcommand_create,
@@ -159,7 +160,8 @@ enum svnadmin__cmdline_options_t
     svnadmin__normalize_props,
     svnadmin__exclude,
     svnadmin__include,
-    svnadmin__glob
+    svnadmin__glob,
+    svnadmin__jobs
   };
 
 /* Option codes and descriptions.
@@ -298,6 +300,13 @@ static const apr_getopt_option_t options_table[] =
         "                             Character '/' is not treated specially, so\n"
         "                             pattern /*/foo matches paths /a/foo and /a/b/foo.") },
 
+    {"jobs", svnadmin__jobs, 1,
+     N_("use up to ARG concurrent jobs.  For 'pack',\n"
+        "                             each job packs a separate shard and\n"
+        "                             needs its own pack buffer.  For\n"
+        "                             'hotcopy', each job copies a separate\n"
+        "                             shard (FSFS only).")},
+
     {NULL}
   };
 
@@ -307,6 +316,16 @@ static const apr_getopt_option_t options_table[] =
  */
 static const svn_opt_subcommand_desc3_t cmd_table[] =
 {
+  {"build-path-index", subcommand_build_path_index, {0}, {N_(
+    "usage: svnadmin build-path-index REPOS_PATH\n"
+    "\n"), N_(
+    "Create the changed-path index for the repository at REPOS_PATH,\n"
+    "if it does not exist yet, and add all revisions it does not cover.\n"
+    "Once created, the index is kept up to date by every commit and speeds\n"
+    "up searching for the revision in which a path got deleted.\n"
+   )},
+   {'q', 'M'} },
+
   {"build-repcache", subcommand_build_repcache, {0}, {N_(
     "usage: svnadmin build-repcache REPOS_PATH [-r LOWER[:UPPER]]\n"
     "\n"), N_(
@@ -429,7 +448,7 @@ static const svn_opt_subcommand_desc3_t cmd_table[] =
     "If --incremental is passed, data which already exists at the destination\n"
     "is not copied again.  Incremental mode is implemented for FSFS repositories.\n"
    )},
-   {svnadmin__clean_logs, svnadmin__incremental, 'q'} },
+   {svnadmin__clean_logs, svnadmin__incremental, 'q', svnadmin__jobs} },
 
   {"info", subcommand_info, {0}, {N_(
     "usage: svnadmin info REPOS_PATH\n"
@@ -520,7 +539,7 @@ static const svn_opt_subcommand_desc3_t cmd_table[] =
     "Possibly compact the repository into a more efficient storage model.\n"
     "This may not apply to all repositories, in which case, exit.\n"
    )},
-   {'q', 'M'} },
+   {'q', 'M', svnadmin__jobs} },
 
   {"recover", subcommand_recover, {0}, {N_(
     "usage: svnadmin recover REPOS_PATH\n"
@@ -630,7 +649,8 @@ static const svn_opt_subcommand_desc3_t cmd_table[] =
     "Verify the data stored in the repository.\n"
    )},
    {'t', 'r', 'q', svnadmin__keep_going, 'M',
-    svnadmin__check_normalization, svnadmin__metadata_only} },
+    svnadmin__check_normalization, svnadmin__metadata_only,
+    svnadmin__jobs} },
 
   { NULL, NULL, {0}, {NULL}, {0} }
 };
@@ -673,22 +693,26 @@ struct svnadmin_opt_state
   apr_array_header_t *exclude;                      /* --exclude */
   apr_array_header_t *include;                      /* --include */
   svn_boolean_t glob;                               /* --pattern */
+  int jobs;                                         /* --jobs */
 
   const char *config_dir;    /* Overriding Configuration Directory */
 };
 
 
 /* Helper to open a repository and set a warning func (so we don't
- * SEGFAULT when libsvn_fs's default handler gets run).  */
+ * SEGFAULT when libsvn_fs's default handler gets run).  Set BULK_LOAD
+ * if we are going to commit many revisions, e.g. from a dump file, and
+ * nobody else is expected to commit at the same time.  */
 static svn_error_t *
-open_repos(svn_repos_t **repos,
-           const char *path,
-           struct svnadmin_opt_state *opt_state,
-           apr_pool_t *pool)
+open_repos_for(svn_repos_t **repos,
+               const char *path,
+               struct svnadmin_opt_state *opt_state,
+               svn_boolean_t bulk_load,
+               apr_pool_t *pool)
 {
   /* Enable the "block-read" feature (where it applies)? */
   svn_boolean_t use_block_read
-    = svn_cache_config_get()->cache_size > BLOCK_READ_CACHE_THRESHOLD;
+    = svn_cache_config_get2()->cache_size > BLOCK_READ_CACHE_THRESHOLD;
 
   /* construct FS configuration parameters: enable caches for r/o data */
   apr_hash_t *fs_config = apr_hash_make(pool);
@@ -703,12 +727,28 @@ open_repos(svn_repos_t **repos,
   svn_hash_sets(fs_config, SVN_FS_CONFIG_NO_FLUSH_TO_DISK,
                            opt_state->no_flush_to_disk ? "1" : "0");
 
+  /* Building the rep-cache filter means reading the whole rep-cache.
+     That only pays off for the many rep-sharing lookups of a load. */
+  if (bulk_load)
+    svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_REP_CACHE_FILTER, "1");
+
   /* now, open the requested repository */
   SVN_ERR(svn_repos_open3(repos, path, fs_config, pool, pool));
   svn_fs_set_warning_func(svn_repos_fs(*repos), warning_func, NULL);
   return SVN_NO_ERROR;
 }
 
+/* Like open_repos_for() but for anything but loads.  */
+static svn_error_t *
+open_repos(svn_repos_t **repos,
+           const char *path,
+           struct svnadmin_opt_state *opt_state,
+           apr_pool_t *pool)
+{
+  return svn_error_trace(open_repos_for(repos, path, opt_state, FALSE,
+                                        pool));
+}
+
 
 /* Set *REVNUM to the revision specified by REVISION (or to
    SVN_INVALID_REVNUM if that has the type 'unspecified'),
@@ -1015,7 +1055,7 @@ struct repos_verify_callback_baton
 };
 
 /* Implementation of svn_repos_verify_callback_t to handle errors coming
-   from svn_repos_verify_fs3(). */
+   from svn_repos_verify_fs4(). */
 static svn_error_t *
 repos_verify_callback(void *baton,
                       svn_revnum_t revision,
@@ -1058,7 +1098,7 @@ repos_verify_callback(void *baton,
 
 /* Implementation of svn_repos_notify_func_t to wrap the output to a
    response stream for svn_repos_dump_fs2(), svn_repos_verify_fs(),
-   svn_repos_hotcopy3() and others. */
+   svn_repos_hotcopy4() and others. */
 static void
 repos_notify_handler(void *baton,
                      const svn_repos_notify_t *notify,
@@ -1719,7 +1759,8 @@ subcommand_load(apr_getopt_t *os, void *baton, apr_pool_t *pool)
      support a limited set of revision kinds: number and unspecified. */
   SVN_ERR(get_load_range(&lower, &upper, opt_state));
 
-  SVN_ERR(open_repos(&repos, opt_state->repository_path, opt_state, pool));
+  SVN_ERR(open_repos_for(&repos, opt_state->repository_path, opt_state,
+                         TRUE, pool));
 
   /* Open the file or STDIN, depending on whether -F was specified. */
   if (opt_state->file)
@@ -2206,7 +2247,8 @@ subcommand_pack(apr_getopt_t *os, void *baton, apr_pool_t *pool)
     feedback_stream = recode_stream_create(stdout, pool);
 
   return svn_error_trace(
-    svn_repos_fs_pack2(repos, !opt_state->quiet ? repos_notify_handler : NULL,
+    svn_repos_fs_pack3(repos, opt_state->jobs,
+                       !opt_state->quiet ? repos_notify_handler : NULL,
                        feedback_stream, check_cancel, NULL, pool));
 }
 
@@ -2272,9 +2314,10 @@ subcommand_verify(apr_getopt_t *os, void *baton, apr_pool_t *pool)
     apr_array_make(pool, 0, sizeof(struct verification_error *));
   verify_baton.result_pool = pool;
 
-  SVN_ERR(svn_repos_verify_fs3(repos, lower, upper,
+  SVN_ERR(svn_repos_verify_fs4(repos, lower, upper,
                                opt_state->check_normalization,
                                opt_state->metadata_only,
+                               opt_state->jobs,
                                !opt_state->quiet
                                  ? repos_notify_handler : NULL,
                                feedback_stream,
@@ -2372,8 +2415,9 @@ subcommand_hotcopy(apr_getopt_t *os, void *baton, apr_pool_t *pool)
   if (! opt_state->quiet)
     feedback_stream = recode_stream_create(stdout, pool);
 
-  return svn_repos_hotcopy3(opt_state->repository_path, new_repos_path,
+  return svn_repos_hotcopy4(opt_state->repository_path, new_repos_path,
                             opt_state->clean_logs, opt_state->incremental,
+                            opt_state->jobs,
                             !opt_state->quiet ? repos_notify_handler : NULL,
                             feedback_stream, check_cancel, NULL, pool);
 }
@@ -3035,6 +3079,38 @@ subcommand_build_repcache(apr_getopt_t *os, void *baton, apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* This implements `svn_opt_subcommand_t'. */
+static svn_error_t *
+subcommand_build_path_index(apr_getopt_t *os, void *baton, apr_pool_t *pool)
+{
+  struct svnadmin_opt_state *opt_state = baton;
+  svn_fs_fs__ioctl_build_path_index_input_t input = {0};
+  svn_repos_t *repos;
+  svn_fs_t *fs;
+  svn_error_t *err;
+
+  /* Expect no more arguments. */
+  SVN_ERR(parse_args(NULL, os, 0, 0, pool));
+
+  SVN_ERR(open_repos(&repos, opt_state->repository_path, opt_state, pool));
+  fs = svn_repos_fs(repos);
+
+  if (! opt_state->quiet)
+    input.progress_func = build_rep_cache_progress_func;
+
+  err = svn_fs_ioctl(fs, SVN_FS_FS__IOCTL_BUILD_PATH_INDEX,
+                     &input, NULL,
+                     check_cancel, NULL, pool, pool);
+  if (err && err->apr_err == SVN_ERR_FS_UNRECOGNIZED_IOCTL_CODE)
+    return svn_error_quick_wrapf(err,
+                                 _("Building the changed-path index is not "
+                                   "implemented for the filesystem type "
+                                   "found in '%s'"),
+                                 svn_fs_path(fs, pool));
+
+  return svn_error_trace(err);
+}
+
 
 /** Main. **/
 
@@ -3075,7 +3151,8 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   /* Initialize opt_state. */
   opt_state.start_revision.kind = svn_opt_revision_unspecified;
   opt_state.end_revision.kind = svn_opt_revision_unspecified;
-  opt_state.memory_cache_size = svn_cache_config_get()->cache_size;
+  opt_state.memory_cache_size = svn_cache_config_get2()->cache_size;
+  opt_state.jobs = 1;
 
   /* Parse options. */
   SVN_ERR(svn_cmdline__getopt_init(&os, argc, argv, pool));
@@ -3273,6 +3350,13 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
       case svnadmin__normalize_props:
         opt_state.normalize_props = TRUE;
         break;
+      case svnadmin__jobs:
+        SVN_ERR(svn_cstring_atoi(&opt_state.jobs, opt_arg));
+        if (opt_state.jobs < 1)
+          return svn_error_createf(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                                   _("Invalid number of jobs '%s'"),
+                                   opt_arg);
+        break;
       case svnadmin__exclude:
         SVN_ERR(svn_utf_cstring_to_utf8(&utf8_opt_arg, opt_arg, pool));
 
@@ -3414,12 +3498,13 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   /* Configure FSFS caches for maximum efficiency with svnadmin.
    * Also, apply the respective command line parameters, if given. */
   {
-    svn_cache_config_t settings = *svn_cache_config_get();
+    svn_cache_config2_t settings = *svn_cache_config_get2();
 
     settings.cache_size = opt_state.memory_cache_size;
-    settings.single_threaded = TRUE;
+    /* Concurrent pack jobs share the caches. */
+    settings.single_threaded = opt_state.jobs <= 1;
 
-    svn_cache_config_set(&settings);
+    svn_cache_config_set2(&settings);
   }
 
   /* Run the subcommand. */
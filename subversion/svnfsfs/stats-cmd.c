@@ -369,6 +369,31 @@ print_histograms_by_extension(svn_fs_fs__stats_t *stats,
     }
 }
 
+/* Print the content chunking summary in STATS.
+ * Use POOL for allocations.
+ */
+static void
+print_chunking_stats(svn_fs_fs__chunking_stats_t *stats,
+                     apr_pool_t *pool)
+{
+  /* Ratio of plaintext referenced to plaintext stored. */
+  double ratio = stats->chunk_expanded_size
+               ? stats->expanded_size / (double)stats->chunk_expanded_size
+               : 1.0;
+
+  printf(_("%20s bytes in %12s chunked representations\n"
+           "%20s bytes in %12s distinct chunks (%s references)\n"
+           "%20s bytes on disk for distinct chunks\n"
+           "                         with %12.3f deduplication ratio\n"),
+         svn__ui64toa_sep(stats->expanded_size, ',', pool),
+         svn__ui64toa_sep(stats->rep_count, ',', pool),
+         svn__ui64toa_sep(stats->chunk_expanded_size, ',', pool),
+         svn__ui64toa_sep(stats->chunk_count, ',', pool),
+         svn__ui64toa_sep(stats->chunk_refs, ',', pool),
+         svn__ui64toa_sep(stats->chunk_size, ',', pool),
+         ratio);
+}
+
 /* Print the contents of STATS to the console.
  * Use POOL for allocations.
  */
@@ -449,6 +474,8 @@ print_stats(svn_fs_fs__stats_t *stats,
   print_rep_stats(&stats->dir_prop_rep_stats, pool);
   printf("\nFile property representation statistics:\n");
   print_rep_stats(&stats->file_prop_rep_stats, pool);
+  printf("\nContent chunking statistics:\n");
+  print_chunking_stats(&stats->chunking_stats, pool);
 
   printf("\nLargest representations:\n");
   print_largest_reps(stats->largest_changes, pool);
@@ -258,7 +258,7 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   /* Initialize opt_state. */
   opt_state.start_revision.kind = svn_opt_revision_unspecified;
   opt_state.end_revision.kind = svn_opt_revision_unspecified;
-  opt_state.memory_cache_size = svn_cache_config_get()->cache_size;
+  opt_state.memory_cache_size = svn_cache_config_get2()->cache_size;
 
   /* Parse options. */
   SVN_ERR(svn_cmdline__getopt_init(&os, argc, argv, pool));
@@ -446,12 +446,12 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   /* Configure FSFS caches for maximum efficiency with svnfsfs.
    * Also, apply the respective command line parameters, if given. */
   {
-    svn_cache_config_t settings = *svn_cache_config_get();
+    svn_cache_config2_t settings = *svn_cache_config_get2();
 
     settings.cache_size = opt_state.memory_cache_size;
     settings.single_threaded = TRUE;
 
-    svn_cache_config_set(&settings);
+    svn_cache_config_set2(&settings);
   }
 
   /* Run the subcommand. */
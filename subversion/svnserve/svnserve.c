@@ -55,6 +55,7 @@
 #include "private/svn_dep_compat.h"
 #include "private/svn_cmdline_private.h"
 #include "private/svn_atomic.h"
+#include "private/svn_cache.h"
 #include "private/svn_mutex.h"
 #include "private/svn_subr_private.h"
 
@@ -164,6 +165,16 @@ enum run_mode {
  */
 #define MAX_REQUEST_SIZE 16
 
+/* With --metrics-file, update that file about once per this many
+ * microseconds, even if there are no connections coming in.
+ */
+#define METRICS_INTERVAL apr_time_from_sec(10)
+
+/* If we need to react to shutdown requests, wait at most this many
+ * microseconds for new connections before checking for such requests.
+ */
+#define SHUTDOWN_POLL_INTERVAL apr_time_from_sec(1)
+
 #ifdef WIN32
 static apr_os_sock_t winservice_svnserve_accept_socket = INVALID_SOCKET;
 
@@ -222,6 +233,11 @@ void winservice_notify_stop(void)
 #define SVNSERVE_OPT_MAX_REQUEST     274
 #define SVNSERVE_OPT_MAX_RESPONSE    275
 #define SVNSERVE_OPT_CACHE_NODEPROPS 276
+#define SVNSERVE_OPT_CACHE_SNAPSHOT  277
+#define SVNSERVE_OPT_CACHE_POLICY    278
+#define SVNSERVE_OPT_CACHE_COMPRESS  279
+#define SVNSERVE_OPT_METRICS_FILE    280
+#define SVNSERVE_OPT_CACHE_OPTIMISTIC 281
 
 /* Text macro because we can't use #ifdef sections inside a N_("...")
    macro expansion. */
@@ -296,6 +312,8 @@ static const apr_getopt_option_t svnserve__options[] =
         "                             "
         "0 switches to dynamically sized caches.\n"
         "                             "
+        "In fork mode, all connections share this cache.\n"
+        "                             "
         "[used for FSFS and FSX repositories only]")},
     {"cache-txdeltas", SVNSERVE_OPT_CACHE_TXDELTAS, 1,
      N_("enable or disable caching of deltas between older\n"
@@ -325,6 +343,48 @@ static const apr_getopt_option_t svnserve__options[] =
         "Default is yes.\n"
         "                             "
         "[used for FSFS repositories only]")},
+    {"cache-snapshot", SVNSERVE_OPT_CACHE_SNAPSHOT, 1,
+     N_("load the in-memory cache contents from file ARG\n"
+        "                             "
+        "upon startup and write them back to it upon\n"
+        "                             "
+        "SIGTERM or SIGINT.\n"
+        "                             "
+        "[mode: daemon]")},
+    {"cache-policy", SVNSERVE_OPT_CACHE_POLICY, 1,
+     N_("select the replacement policy of the in-memory\n"
+        "                             "
+        "cache.  ARG is 'default' or 'tinylfu'.  The latter\n"
+        "                             "
+        "keeps one-time scans from evicting frequently\n"
+        "                             "
+        "used data.\n"
+        "                             "
+        "Default is 'default'.")},
+    {"cache-compress", SVNSERVE_OPT_CACHE_COMPRESS, 1,
+     N_("compress in-memory cache entries of ARG kBytes\n"
+        "                             "
+        "or more.  This allows for more data to be cached\n"
+        "                             "
+        "at the expense of CPU time.\n"
+        "                             "
+        "Default is 0 (no compression).")},
+    {"cache-optimistic-reads", SVNSERVE_OPT_CACHE_OPTIMISTIC, 1,
+     N_("enable or disable lock-free reads from the\n"
+        "                             "
+        "in-memory cache.  If disabled, readers always\n"
+        "                             "
+        "lock the cache segment they access.\n"
+        "                             "
+        "Default is yes.")},
+    {"metrics-file", SVNSERVE_OPT_METRICS_FILE, 1,
+     N_("periodically write cache statistics in Prometheus\n"
+        "                             "
+        "text format to file ARG.  In fork mode, only the\n"
+        "                             "
+        "totals of the shared in-memory cache get reported.\n"
+        "                             "
+        "[mode: daemon]")},
     {"client-speed", SVNSERVE_OPT_CLIENT_SPEED, 1,
      N_("Optimize network handling based on the assumption\n"
         "                             "
@@ -492,6 +552,348 @@ static void sigchld_handler(int signo)
 }
 #endif
 
+/* Set by shutdown_handler() to tell the accept() loop to terminate. */
+static volatile sig_atomic_t shutdown_requested = FALSE;
+
+/* Signal handler to use instead of the default action for SIGTERM and
+ * SIGINT if we need to do some work before exiting. */
+static void shutdown_handler(int signo)
+{
+  /* The accept() loop will notice within SHUTDOWN_POLL_INTERVAL, even if
+   * the signal did not interrupt accept() itself. */
+  shutdown_requested = TRUE;
+}
+
+/* svnserve cache snapshots start with this line, followed by one
+ * "<youngest revision> <repository key>" line for every repository with
+ * entries in the snapshot, an empty line and the membuffer snapshot.
+ * See cache_snapshot_repo_key() for the repository keys.
+ */
+#define CACHE_SNAPSHOT_MAGIC "SVNSERVE-CACHE-SNAPSHOT 1"
+
+/* Baton type used by the cache snapshot filters. */
+typedef struct cache_snapshot_baton_t
+{
+  /* Maps repository keys to the svn_revnum_t * youngest revision of that
+   * repository when the snapshot has been written. */
+  apr_hash_t *youngest;
+
+  /* Maps repository keys to the svn_boolean_t * verdict of the filter
+   * for all entries of that repository. */
+  apr_hash_t *verdicts;
+} cache_snapshot_baton_t;
+
+/* Set *KEY and *KEY_LEN to the repository key part in cache key PREFIX.
+ * Set *KEY to NULL if PREFIX does not belong to a FSFS or FSX repository.
+ *
+ * Their cache key prefixes follow the pattern
+ * "ns:<namespace>:<backend>:<uuid>/<fs path>:..." with all colons in the
+ * variable parts being escaped as "%_".  The repository key is the
+ * "<uuid>/<fs path>" part.
+ */
+static void
+cache_snapshot_repo_key(const char **key,
+                        apr_size_t *key_len,
+                        const char *prefix)
+{
+  const char *repo_start, *uuid_end, *repo_end;
+
+  *key = NULL;
+
+  repo_start = strstr(prefix, ":fsfs:");
+  if (repo_start)
+    repo_start += strlen(":fsfs:");
+  else if ((repo_start = strstr(prefix, ":fsx:")))
+    repo_start += strlen(":fsx:");
+  else
+    return;
+
+  uuid_end = strchr(repo_start, '/');
+  repo_end = uuid_end ? strchr(uuid_end, ':') : NULL;
+  if (!repo_end || memchr(repo_start, '\n', repo_end - repo_start))
+    return;
+
+  *key = repo_start;
+  *key_len = repo_end - repo_start;
+}
+
+/* Set *YOUNGEST to the youngest revision of the repository identified by
+ * repository KEY (see cache_snapshot_repo_key()).  Set it to
+ * SVN_INVALID_REVNUM if that repository does not exist anymore or has a
+ * different UUID.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+cache_snapshot_youngest(svn_revnum_t *youngest,
+                        const char *key,
+                        apr_pool_t *scratch_pool)
+{
+  const char *uuid_end = strchr(key, '/');
+  const char *escaped_path;
+  const char *uuid;
+  svn_stringbuf_t *path;
+  svn_fs_t *fs;
+  svn_error_t *err;
+
+  *youngest = SVN_INVALID_REVNUM;
+
+  /* Un-escape the repository path. */
+  uuid = apr_pstrmemdup(scratch_pool, key, uuid_end - key);
+  path = svn_stringbuf_create_empty(scratch_pool);
+  for (escaped_path = uuid_end + 1; *escaped_path; ++escaped_path)
+    {
+      if (*escaped_path == '%' && escaped_path[1])
+        {
+          ++escaped_path;
+          svn_stringbuf_appendbyte(path,
+                                   *escaped_path == '_' ? ':' : '%');
+        }
+      else
+        {
+          svn_stringbuf_appendbyte(path, *escaped_path);
+        }
+    }
+
+  /* Does that repository still exist?  Is it the same? */
+  err = svn_fs_open2(&fs, path->data, NULL, scratch_pool, scratch_pool);
+  if (err)
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+
+  SVN_ERR(svn_fs_get_uuid(fs, &escaped_path, scratch_pool));
+  if (strcmp(uuid, escaped_path) == 0)
+    SVN_ERR(svn_fs_youngest_rev(youngest, fs, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_cache__snapshot_filter_t.  BATON is a
+ * cache_snapshot_baton_t.
+ *
+ * Accept only entries of FSFS and FSX repositories that still exist with
+ * the same UUID in the same location.  When writing the snapshot, record
+ * their youngest revisions in BATON->YOUNGEST.  When loading it, also
+ * reject all entries of repositories whose youngest revision differs from
+ * the one recorded in BATON->YOUNGEST.  The latter happens e.g. after
+ * restoring a repository from a backup.
+ */
+static svn_error_t *
+cache_snapshot_filter(svn_boolean_t *keep,
+                      void *baton,
+                      svn_boolean_t loading,
+                      const char *prefix,
+                      apr_pool_t *scratch_pool)
+{
+  cache_snapshot_baton_t *b = baton;
+  apr_pool_t *result_pool = apr_hash_pool_get(b->verdicts);
+  const char *key;
+  apr_size_t key_len;
+  svn_boolean_t *verdict;
+  svn_revnum_t *recorded;
+  svn_revnum_t youngest;
+
+  *keep = FALSE;
+
+  cache_snapshot_repo_key(&key, &key_len, prefix);
+  if (!key)
+    return SVN_NO_ERROR;
+
+  /* Have we checked that repository already? */
+  verdict = apr_hash_get(b->verdicts, key, key_len);
+  if (verdict)
+    {
+      *keep = *verdict;
+      return SVN_NO_ERROR;
+    }
+
+  key = apr_pstrmemdup(result_pool, key, key_len);
+  verdict = apr_pcalloc(result_pool, sizeof(*verdict));
+  apr_hash_set(b->verdicts, key, key_len, verdict);
+
+  recorded = apr_hash_get(b->youngest, key, key_len);
+  if (loading && !recorded)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(cache_snapshot_youngest(&youngest, key, scratch_pool));
+  if (!SVN_IS_VALID_REVNUM(youngest))
+    return SVN_NO_ERROR;
+
+  if (loading)
+    {
+      *verdict = *recorded == youngest;
+    }
+  else
+    {
+      recorded = apr_palloc(result_pool, sizeof(*recorded));
+      *recorded = youngest;
+      apr_hash_set(b->youngest, key, key_len, recorded);
+      *verdict = TRUE;
+    }
+
+  *keep = *verdict;
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_cache__snapshot_filter_t for loading snapshots. */
+static svn_error_t *
+load_snapshot_filter(svn_boolean_t *keep,
+                     void *baton,
+                     const char *prefix,
+                     apr_pool_t *scratch_pool)
+{
+  return svn_error_trace(cache_snapshot_filter(keep, baton, TRUE, prefix,
+                                               scratch_pool));
+}
+
+/* Implements svn_cache__snapshot_filter_t for writing snapshots. */
+static svn_error_t *
+save_snapshot_filter(svn_boolean_t *keep,
+                     void *baton,
+                     const char *prefix,
+                     apr_pool_t *scratch_pool)
+{
+  return svn_error_trace(cache_snapshot_filter(keep, baton, FALSE, prefix,
+                                               scratch_pool));
+}
+
+/* Return an error indicating that the cache snapshot file PATH is
+ * invalid.  Use POOL for allocations.
+ */
+static svn_error_t *
+invalid_cache_snapshot(const char *path,
+                       apr_pool_t *pool)
+{
+  return svn_error_createf(SVN_ERR_CORRUPT_PACKED_DATA, NULL,
+                           _("Invalid cache snapshot '%s'"),
+                           svn_dirent_local_style(path, pool));
+}
+
+/* Load the snapshot in file PATH into the global membuffer cache, if
+ * that file exists.  Use POOL for temporary allocations.
+ */
+static svn_error_t *
+load_cache_snapshot(const char *path,
+                    apr_pool_t *pool)
+{
+  svn_membuffer_t *membuffer = svn_cache__get_global_membuffer_cache();
+  cache_snapshot_baton_t baton;
+  svn_stream_t *stream;
+  svn_stringbuf_t *line;
+  svn_boolean_t eof;
+  svn_error_t *err;
+
+  if (!membuffer)
+    return SVN_NO_ERROR;
+
+  err = svn_stream_open_readonly(&stream, path, pool, pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  SVN_ERR(svn_stream_readline(stream, &line, "\n", &eof, pool));
+  if (eof || strcmp(line->data, CACHE_SNAPSHOT_MAGIC))
+    return svn_error_trace(invalid_cache_snapshot(path, pool));
+
+  /* Read the repository list. */
+  baton.youngest = apr_hash_make(pool);
+  baton.verdicts = apr_hash_make(pool);
+  while (TRUE)
+    {
+      svn_revnum_t *youngest = apr_palloc(pool, sizeof(*youngest));
+      const char *key;
+
+      SVN_ERR(svn_stream_readline(stream, &line, "\n", &eof, pool));
+      if (eof)
+        return svn_error_trace(invalid_cache_snapshot(path, pool));
+      if (line->len == 0)
+        break;
+
+      err = svn_revnum_parse(youngest, line->data, &key);
+      if (err || *key != ' ')
+        {
+          svn_error_clear(err);
+          return svn_error_trace(invalid_cache_snapshot(path, pool));
+        }
+
+      ++key;
+      apr_hash_set(baton.youngest, key, line->data + line->len - key,
+                   youngest);
+    }
+
+  SVN_ERR(svn_cache__membuffer_load(membuffer, stream,
+                                    load_snapshot_filter, &baton, pool));
+
+  return svn_error_trace(svn_stream_close(stream));
+}
+
+/* Write a snapshot of the global membuffer cache to the file at PATH,
+ * replacing it atomically.  Use POOL for temporary allocations.
+ */
+static svn_error_t *
+save_cache_snapshot(const char *path,
+                    apr_pool_t *pool)
+{
+  svn_membuffer_t *membuffer = svn_cache__get_global_membuffer_cache();
+  const char *dir = svn_dirent_dirname(path, pool);
+  cache_snapshot_baton_t baton;
+  apr_hash_index_t *hi;
+  svn_stream_t *stream, *entries;
+  const char *temp_path, *entries_path;
+
+  if (!membuffer)
+    return SVN_NO_ERROR;
+
+  /* We only know which repositories to list in the header after having
+   * written all entries. */
+  baton.youngest = apr_hash_make(pool);
+  baton.verdicts = apr_hash_make(pool);
+  SVN_ERR(svn_stream_open_unique(&entries, &entries_path, dir,
+                                 svn_io_file_del_none, pool, pool));
+  SVN_ERR(svn_cache__membuffer_dump(membuffer, entries,
+                                    save_snapshot_filter, &baton, pool));
+  SVN_ERR(svn_stream_close(entries));
+
+  SVN_ERR(svn_stream_open_unique(&stream, &temp_path, dir,
+                                 svn_io_file_del_none, pool, pool));
+  SVN_ERR(svn_stream_printf(stream, pool, "%s\n", CACHE_SNAPSHOT_MAGIC));
+  for (hi = apr_hash_first(pool, baton.youngest); hi; hi = apr_hash_next(hi))
+    {
+      const char *key = apr_hash_this_key(hi);
+      svn_revnum_t *youngest = apr_hash_this_val(hi);
+
+      SVN_ERR(svn_stream_printf(stream, pool, "%ld %s\n", *youngest, key));
+    }
+  SVN_ERR(svn_stream_puts(stream, "\n"));
+
+  SVN_ERR(svn_stream_open_readonly(&entries, entries_path, pool, pool));
+  SVN_ERR(svn_stream_copy3(entries, stream, NULL, NULL, pool));
+  SVN_ERR(svn_io_remove_file2(entries_path, FALSE, pool));
+
+  return svn_error_trace(svn_io_file_rename2(temp_path, path, FALSE, pool));
+}
+
+/* Replace the contents of the file at PATH with the current cache metrics.
+ * Use POOL for temporary allocations.
+ */
+static svn_error_t *
+write_metrics(const char *path,
+              apr_pool_t *pool)
+{
+  apr_pool_t *scratch_pool = svn_pool_create(pool);
+  svn_string_t *metrics;
+
+  SVN_ERR(svn_cache__format_metrics(&metrics, scratch_pool));
+  SVN_ERR(svn_io_write_atomic2(path, metrics->data, metrics->len, NULL,
+                               FALSE, scratch_pool));
+
+  svn_pool_destroy(scratch_pool);
+  return SVN_NO_ERROR;
+}
+
 /* Redirect stdout to stderr.  ARG is the pool.
  *
  * In tunnel or inetd mode, we don't want hook scripts corrupting the
@@ -547,6 +949,10 @@ accept_connection(connection_t **connection,
 
       status = apr_socket_accept(&(*connection)->usock, sock,
                                  connection_pool);
+
+      /* The connection must not inherit our polling timeout. */
+      if (status == APR_SUCCESS)
+        status = apr_socket_timeout_set((*connection)->usock, -1);
       if (handling_mode == connection_mode_fork)
         {
           apr_proc_t proc;
@@ -557,13 +963,20 @@ accept_connection(connection_t **connection,
             ;
         }
     }
-  while (APR_STATUS_IS_EINTR(status)
+  while ((APR_STATUS_IS_EINTR(status) && !shutdown_requested)
     || APR_STATUS_IS_ECONNABORTED(status)
     || APR_STATUS_IS_ECONNRESET(status));
 
-  return status
-       ? svn_error_wrap_apr(status, _("Can't accept client connection"))
-       : SVN_NO_ERROR;
+  /* Timeouts are part of the normal operation and the caller will
+   * simply try again. */
+  if (status)
+    {
+      svn_pool_destroy(connection_pool);
+      *connection = NULL;
+      return svn_error_wrap_apr(status, _("Can't accept client connection"));
+    }
+
+  return SVN_NO_ERROR;
 }
 
 /* Add a reference to CONNECTION, i.e. keep it and it's pool valid unless
@@ -739,6 +1152,12 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   const char *config_filename = NULL;
   const char *pid_filename = NULL;
   const char *log_filename = NULL;
+  const char *cache_snapshot = NULL;
+  svn_cache_policy_t cache_policy = svn_cache_policy_default;
+  apr_size_t cache_compression_threshold = 0;
+  svn_boolean_t cache_optimistic_reads = TRUE;
+  const char *metrics_file = NULL;
+  apr_time_t metrics_written = 0;
   svn_node_kind_t kind;
   apr_size_t min_thread_count = THREADPOOL_MIN_SIZE;
   apr_size_t max_thread_count = THREADPOOL_MAX_SIZE;
@@ -925,6 +1344,44 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
           cache_nodeprops = svn_tristate__from_word(arg) == svn_tristate_true;
           break;
 
+        case SVNSERVE_OPT_CACHE_SNAPSHOT:
+          SVN_ERR(svn_utf_cstring_to_utf8(&cache_snapshot, arg, pool));
+          cache_snapshot = svn_dirent_internal_style(cache_snapshot, pool);
+          SVN_ERR(svn_dirent_get_absolute(&cache_snapshot, cache_snapshot,
+                                          pool));
+          break;
+
+        case SVNSERVE_OPT_METRICS_FILE:
+          SVN_ERR(svn_utf_cstring_to_utf8(&metrics_file, arg, pool));
+          metrics_file = svn_dirent_internal_style(metrics_file, pool);
+          SVN_ERR(svn_dirent_get_absolute(&metrics_file, metrics_file,
+                                          pool));
+          break;
+
+        case SVNSERVE_OPT_CACHE_POLICY:
+          if (strcmp(arg, "default") == 0)
+            cache_policy = svn_cache_policy_default;
+          else if (strcmp(arg, "tinylfu") == 0)
+            cache_policy = svn_cache_policy_tinylfu;
+          else
+            return svn_error_createf(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                                     _("Invalid cache policy '%s'"), arg);
+          break;
+
+        case SVNSERVE_OPT_CACHE_COMPRESS:
+          {
+            apr_uint64_t sz_val;
+            SVN_ERR(svn_cstring_atoui64(&sz_val, arg));
+
+            cache_compression_threshold = (apr_size_t)(0x400 * sz_val);
+          }
+          break;
+
+        case SVNSERVE_OPT_CACHE_OPTIMISTIC:
+          cache_optimistic_reads
+            = svn_tristate__from_word(arg) == svn_tristate_true;
+          break;
+
         case SVNSERVE_OPT_BLOCK_READ:
           use_block_read = svn_tristate__from_word(arg) == svn_tristate_true;
           break;
@@ -1274,11 +1731,14 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
    * keep the per-process caches smaller than the default.
    * Also, apply the respective command line parameters, if given. */
   {
-    svn_cache_config_t settings = *svn_cache_config_get();
+    svn_cache_config2_t settings = *svn_cache_config_get2();
 
     if (params.memory_cache_size != -1)
       settings.cache_size = params.memory_cache_size;
 
+    settings.policy = cache_policy;
+    settings.compression_threshold = cache_compression_threshold;
+    settings.optimistic_reads = cache_optimistic_reads;
     settings.single_threaded = TRUE;
     if (handling_mode == connection_mode_thread)
       {
@@ -1294,9 +1754,48 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
 #endif
       }
 
-    svn_cache_config_set(&settings);
+    svn_cache_config_set2(&settings);
+    svn_cache__enable_metrics(metrics_file != NULL);
+
+#if APR_HAS_FORK
+    /* Let all connection processes share a single cache.  It must be
+     * created before forking the first child to be inherited by all. */
+    if (handling_mode == connection_mode_fork
+        && run_mode != run_mode_listen_once)
+      {
+        svn_cache__set_global_membuffer_shared(TRUE);
+        svn_cache__get_global_membuffer_cache();
+      }
+#endif
   }
 
+  /* Warm up the cache with the contents we had before the last restart
+   * and save them again when being asked to terminate. */
+  if (cache_snapshot && run_mode != run_mode_listen_once)
+    {
+      err = load_cache_snapshot(cache_snapshot, pool);
+      if (err)
+        {
+          logger__log_error(params.logger, err, NULL, NULL);
+          svn_error_clear(err);
+        }
+
+      apr_signal(SIGTERM, shutdown_handler);
+      apr_signal(SIGINT, shutdown_handler);
+
+      /* Don't rely on signals interrupting accept(). */
+      status = apr_socket_timeout_set(sock, SHUTDOWN_POLL_INTERVAL);
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't set socket timeout"));
+    }
+  else if (metrics_file && run_mode != run_mode_listen_once)
+    {
+      /* Wake up to refresh the metrics while idle. */
+      status = apr_socket_timeout_set(sock, METRICS_INTERVAL);
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't set socket timeout"));
+    }
+
 #if APR_HAS_THREADS
   SVN_ERR(svn_root_pools__create(&connection_pools));
 
@@ -1333,8 +1832,31 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   while (1)
     {
       connection_t *connection = NULL;
-      SVN_ERR(accept_connection(&connection, sock, &params, handling_mode,
-                                pool));
+      err = accept_connection(&connection, sock, &params, handling_mode,
+                              pool);
+      if (metrics_file && apr_time_now() - metrics_written >= METRICS_INTERVAL)
+        {
+          /* Failing to report must not take the server down. */
+          svn_error_t *metrics_err = write_metrics(metrics_file, pool);
+          if (metrics_err)
+            {
+              logger__log_error(params.logger, metrics_err, NULL, NULL);
+              svn_error_clear(metrics_err);
+            }
+
+          metrics_written = apr_time_now();
+        }
+      if (shutdown_requested)
+        {
+          svn_error_clear(err);
+          return svn_error_trace(save_cache_snapshot(cache_snapshot, pool));
+        }
+      if (err && APR_STATUS_IS_TIMEUP(err->apr_err))
+        {
+          svn_error_clear(err);
+          continue;
+        }
+      SVN_ERR(err);
       if (run_mode == run_mode_listen_once)
         {
           err = serve_socket(connection, connection->pool);
@@ -1352,6 +1874,25 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
               /* the child wouldn't listen to the main server's socket */
               apr_socket_close(sock);
 
+              /* the shared cache locks belong to the parent process */
+              err = svn_cache__membuffer_child_init(
+                      svn_cache__get_global_membuffer_cache(),
+                      connection->pool);
+              if (err)
+                {
+                  logger__log_error(params.logger, err, NULL, NULL);
+                  svn_error_clear(err);
+                  close_connection(connection);
+                  return SVN_NO_ERROR;
+                }
+
+              /* nor save the cache contents upon termination */
+              if (cache_snapshot)
+                {
+                  apr_signal(SIGTERM, SIG_DFL);
+                  apr_signal(SIGINT, SIG_DFL);
+                }
+
               /* serve_socket() logs any error it returns, so ignore it. */
               svn_error_clear(serve_socket(connection, connection->pool));
               close_connection(connection);
@@ -152,6 +152,7 @@ def test_stats(sbox):
                       'File representation statistics:',
                       'Directory property representation statistics:',
                       'File property representation statistics:',
+                      'Content chunking statistics:',
                       'Largest representations:',
                       'Extensions by number of representations:',
                       'Extensions by size of changed files:',
@@ -193,6 +194,11 @@ def test_stats(sbox):
                            '.*\d+ bytes with rep-sharing off',
                            '.*\d+ shared references',
                            '.*\d+ average delta chain length'],
+    'Content chunking .*' :
+                          ['.*\d+ bytes in .*\d+ chunked representations',
+                           '.*\d+ bytes in .*\d+ distinct chunks \(\d+ references\)',
+                           '.*\d+ bytes on disk for distinct chunks',
+                           '.*\d+ deduplication ratio'],
     'Largest.*:'        : ['.*\d+ r\d+ */\S*'],
     'Extensions by number .*:' :
                           ['.*\d+ \( ?\d+%\) representations'],
@@ -37,6 +37,7 @@
 #include "svn_pools.h"
 #include "svn_error.h"
 
+#include "private/svn_delta_private.h"
 #include "../../libsvn_delta/delta.h"
 #include "delta-window-test.h"
 
@@ -605,6 +606,291 @@ random_txdelta_to_svndiff_stream_test(apr_pool_t *pool)
   return err;
 }
 
+/* Return the svndiff data that turns SOURCE into TARGET, using the svndiff
+   VERSION and compression LEVEL.  Select the delta implementation by METHOD:
+   0 is the classic txdelta stream, 1 is the pipelined stream with parallel
+   encoding, 2 the pipelined stream with sequential encoding and 3 the
+   pipelined target push stream.  Use POOL for all allocations. */
+static svn_error_t *
+get_svndiff(svn_stringbuf_t **svndiff,
+            apr_file_t *source,
+            apr_file_t *target,
+            int method,
+            int version,
+            int level,
+            apr_pool_t *pool)
+{
+  svn_stream_t *source_stream;
+  svn_stream_t *target_stream;
+  svn_stream_t *output;
+  svn_txdelta_stream_t *txstream;
+
+  rewind_file(source);
+  rewind_file(target);
+  source_stream = svn_stream_from_aprfile2(source, TRUE, pool);
+  target_stream = svn_stream_from_aprfile2(target, TRUE, pool);
+
+  *svndiff = svn_stringbuf_create_empty(pool);
+  output = svn_stream_from_stringbuf(*svndiff, pool);
+
+  if (method == 0 || method == 1)
+    {
+      if (method == 0)
+        svn_txdelta2(&txstream, source_stream, target_stream, FALSE, pool);
+      else
+        svn_txdelta__pipelined(&txstream, source_stream, target_stream,
+                               FALSE, pool);
+
+      SVN_ERR(svn_stream_copy3(svn_txdelta_to_svndiff_stream(txstream,
+                                                             version, level,
+                                                             pool),
+                               output, NULL, NULL, pool));
+    }
+  else if (method == 2)
+    {
+      svn_txdelta_window_handler_t handler;
+      void *handler_baton;
+      svn_txdelta_window_t *window;
+
+      svn_txdelta__pipelined(&txstream, source_stream, target_stream,
+                             FALSE, pool);
+      svn_txdelta_to_svndiff3(&handler, &handler_baton, output, version,
+                              level, pool);
+      do
+        {
+          SVN_ERR(svn_txdelta_next_window(&window, txstream, pool));
+          SVN_ERR(handler(window, handler_baton));
+        }
+      while (window);
+    }
+  else
+    {
+      svn_stream_t *push_stream;
+
+      SVN_ERR(svn_txdelta__target_push_pipelined(&push_stream, output,
+                                                 version, level,
+                                                 source_stream, pool));
+      SVN_ERR(svn_stream_copy3(target_stream, push_stream, NULL, NULL,
+                               pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* (Note: *LAST_SEED is an output parameter.) */
+static svn_error_t *
+do_random_pipelined_test(apr_pool_t *pool,
+                         apr_uint32_t *last_seed)
+{
+  apr_uint32_t seed;
+  apr_uint32_t maxlen;
+  apr_size_t bytes_range;
+  int i;
+  int iterations;
+  int dump_files;
+  int print_windows;
+  const char *random_bytes;
+  apr_pool_t *iterpool;
+
+  /* Initialize parameters and print out the seed in case we dump core
+     or something. */
+  init_params(&seed, &maxlen, &iterations, &dump_files, &print_windows,
+              &random_bytes, &bytes_range, pool);
+
+  /* Make sure that we get plenty of windows per file. */
+  maxlen *= 16;
+  iterations = iterations / 6 + 1;
+
+  iterpool = svn_pool_create(pool);
+  for (i = 0; i < iterations; i++)
+    {
+      apr_uint32_t subseed_base;
+      apr_file_t *source;
+      apr_file_t *target;
+      apr_file_t *new_target;
+      svn_stringbuf_t *expected;
+      svn_txdelta_window_handler_t handler;
+      void *handler_baton;
+      svn_stream_t *push_stream;
+      int method;
+
+      svn_pool_clear(iterpool);
+
+      /* Generate source and target for the delta and its application. */
+      *last_seed = seed;
+      subseed_base = svn_test_rand(&seed);
+      source = generate_random_file(maxlen, subseed_base, &seed,
+                                    random_bytes, bytes_range,
+                                    dump_files, iterpool);
+      target = generate_random_file(maxlen, subseed_base, &seed,
+                                    random_bytes, bytes_range,
+                                    dump_files, iterpool);
+
+      /* All pipelined variants must produce the same svndiff data as the
+         classic sequential implementation. */
+      SVN_ERR(get_svndiff(&expected, source, target, 0, i % 3, i % 10,
+                          iterpool));
+      for (method = 1; method <= 3; ++method)
+        {
+          svn_stringbuf_t *svndiff;
+          SVN_ERR(get_svndiff(&svndiff, source, target, method, i % 3,
+                              i % 10, iterpool));
+          SVN_TEST_ASSERT(svn_stringbuf_compare(expected, svndiff));
+        }
+
+      /* Make sure that data actually describes TARGET. */
+      new_target = open_tempfile(NULL, iterpool);
+      rewind_file(source);
+      svn_txdelta_apply(svn_stream_from_aprfile2(source, TRUE, iterpool),
+                        svn_stream_from_aprfile2(new_target, TRUE, iterpool),
+                        NULL, NULL, iterpool, &handler, &handler_baton);
+      push_stream = svn_txdelta_parse_svndiff(handler, handler_baton, TRUE,
+                                              iterpool);
+      SVN_ERR(svn_stream_write(push_stream, expected->data, &expected->len));
+      SVN_ERR(svn_stream_close(push_stream));
+
+      SVN_ERR(compare_files(target, new_target, dump_files));
+
+      apr_file_close(source);
+      apr_file_close(target);
+      apr_file_close(new_target);
+    }
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_test_driver_t. */
+static svn_error_t *
+random_pipelined_test(apr_pool_t *pool)
+{
+  apr_uint32_t seed;
+  svn_error_t *err = do_random_pipelined_test(pool, &seed);
+  if (err)
+    fprintf(stderr, "SEED: %lu\n", (unsigned long)seed);
+  return err;
+}
+
+/* Baton type for count_insertion_windows(). */
+typedef struct insertion_windows_baton_t
+{
+  /* Number of windows that use no source data but still have a non-empty
+     source view. */
+  int count;
+} insertion_windows_baton_t;
+
+/* Implements svn_txdelta_window_handler_t.
+   Count the no-source-op windows with a source view in BATON. */
+static svn_error_t *
+count_insertion_windows(svn_txdelta_window_t *window,
+                        void *baton)
+{
+  insertion_windows_baton_t *b = baton;
+
+  if (window && !window->src_ops && window->sview_len)
+    b->count++;
+
+  return SVN_NO_ERROR;
+}
+
+/* Return LEN bytes of random data generated from *SEED, allocated in
+   POOL. */
+static const char *
+random_data(apr_size_t len,
+            apr_uint32_t *seed,
+            apr_pool_t *pool)
+{
+  char *data = apr_palloc(pool, len);
+  apr_size_t i;
+
+  for (i = 0; i < len; ++i)
+    data[i] = (char)svn_test_rand(seed);
+
+  return data;
+}
+
+/* Make sure that the pipelined svndiff encoders keep the source view of a
+   window that could not use any of its source data.  Appliers read the
+   source data sequentially, so dropping that view would shift the source
+   data of all following windows. */
+static svn_error_t *
+pipelined_no_match_window_test(apr_pool_t *pool)
+{
+  apr_uint32_t seed = 1234;
+  const apr_size_t len = SVN_DELTA_WINDOW_SIZE;
+  const char *first = random_data(len, &seed, pool);
+  const char *second = random_data(len, &seed, pool);
+  const char *third = random_data(len, &seed, pool);
+  const char *unrelated = random_data(len, &seed, pool);
+  apr_file_t *source = open_tempfile(NULL, pool);
+  apr_file_t *target = open_tempfile(NULL, pool);
+  apr_file_t *new_target;
+  svn_stringbuf_t *expected;
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+  svn_stream_t *push_stream;
+  insertion_windows_baton_t baton = { 0 };
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int method;
+  int version;
+
+  /* Three windows of source data.  The first and last target windows are
+     unchanged but the one in the middle has nothing in common with the
+     source, i.e. it will be a plain insertion window. */
+  SVN_ERR(svn_io_file_write_full(source, first, len, NULL, pool));
+  SVN_ERR(svn_io_file_write_full(source, second, len, NULL, pool));
+  SVN_ERR(svn_io_file_write_full(source, third, len, NULL, pool));
+
+  SVN_ERR(svn_io_file_write_full(target, first, len, NULL, pool));
+  SVN_ERR(svn_io_file_write_full(target, unrelated, len, NULL, pool));
+  SVN_ERR(svn_io_file_write_full(target, third, len, NULL, pool));
+
+  for (version = 0; version <= 2; ++version)
+    {
+      svn_pool_clear(iterpool);
+
+      SVN_ERR(get_svndiff(&expected, source, target, 0, version, 0,
+                          iterpool));
+      for (method = 1; method <= 3; ++method)
+        {
+          svn_stringbuf_t *svndiff;
+          SVN_ERR(get_svndiff(&svndiff, source, target, method, version, 0,
+                              iterpool));
+          SVN_TEST_ASSERT(svn_stringbuf_compare(expected, svndiff));
+        }
+
+      /* The middle window must still cover its part of the source. */
+      baton.count = 0;
+      push_stream = svn_txdelta_parse_svndiff(count_insertion_windows,
+                                              &baton, TRUE, iterpool);
+      SVN_ERR(svn_stream_write(push_stream, expected->data,
+                               &expected->len));
+      SVN_ERR(svn_stream_close(push_stream));
+      SVN_TEST_INT_ASSERT(baton.count, 1);
+
+      /* Make sure that data actually describes TARGET. */
+      new_target = open_tempfile(NULL, iterpool);
+      rewind_file(source);
+      svn_txdelta_apply(svn_stream_from_aprfile2(source, TRUE, iterpool),
+                        svn_stream_from_aprfile2(new_target, TRUE, iterpool),
+                        NULL, NULL, iterpool, &handler, &handler_baton);
+      push_stream = svn_txdelta_parse_svndiff(handler, handler_baton, TRUE,
+                                              iterpool);
+      SVN_ERR(svn_stream_write(push_stream, expected->data,
+                               &expected->len));
+      SVN_ERR(svn_stream_close(push_stream));
+
+      SVN_ERR(compare_files(target, new_target, FALSE));
+      apr_file_close(new_target);
+    }
+
+  svn_pool_destroy(iterpool);
+  apr_file_close(source);
+  apr_file_close(target);
+
+  return SVN_NO_ERROR;
+}
+
 /* Change to 1 to enable the unit test for the delta combiner's range index: */
 #if 0
 #include "range-index-test.h"
@@ -625,6 +911,10 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "random combine delta test"),
     SVN_TEST_PASS2(random_txdelta_to_svndiff_stream_test,
                    "random txdelta to svndiff stream test"),
+    SVN_TEST_PASS2(random_pipelined_test,
+                   "random pipelined delta test"),
+    SVN_TEST_PASS2(pipelined_no_match_window_test,
+                   "pipelined delta of a window without matches"),
 #ifdef SVN_RANGE_INDEX_TEST_H
     SVN_TEST_PASS2(random_range_index_test,
                    "random range index test"),
@@ -22,15 +22,21 @@
  */
 
 #include <apr_pools.h>
+#include <apr_strings.h>
 
 #include "../svn_test.h"
 
 #include "svn_types.h"
 #include "svn_error.h"
 #include "svn_delta.h"
+#include "svn_pools.h"
+#include "svn_sorts.h"
 
+#include "private/svn_delta_private.h"
 #include "private/svn_subr_private.h"
 
+#include "../../libsvn_delta/delta.h"
+
 static svn_error_t *
 stream_window_test(apr_pool_t *pool)
 {
@@ -96,6 +102,260 @@ stream_window_test(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* Baton for count_new_data(). */
+typedef struct count_baton_t
+{
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+  apr_size_t new_data_len;
+} count_baton_t;
+
+/* Implements svn_txdelta_window_handler_t.  Sum up the new data in the
+ * windows and forward them to the handler in BATON. */
+static svn_error_t *
+count_new_data(svn_txdelta_window_t *window, void *baton)
+{
+  count_baton_t *cb = baton;
+
+  if (window && window->new_data)
+    cb->new_data_len += window->new_data->len;
+
+  return cb->handler(window, cb->handler_baton);
+}
+
+/* Push TARGET through a delta against SOURCE created by the large-window
+ * matcher if LARGE_WINDOW is set and by svn_txdelta_target_push otherwise.
+ * Apply the result to SOURCE and compare that to TARGET.  Return the
+ * amount of new data in the delta. */
+static svn_error_t *
+push_and_apply(apr_size_t *new_data_len,
+               svn_boolean_t large_window,
+               const svn_string_t *source,
+               const svn_string_t *target,
+               apr_pool_t *pool)
+{
+  svn_stringbuf_t *result = svn_stringbuf_create_empty(pool);
+  count_baton_t cb = { 0 };
+  svn_stream_t *stream;
+  apr_size_t len = target->len;
+
+  svn_txdelta_apply(svn_stream_from_string(source, pool),
+                    svn_stream_from_stringbuf(result, pool),
+                    NULL, NULL, pool, &cb.handler, &cb.handler_baton);
+
+  if (large_window)
+    SVN_ERR(svn_txdelta__target_push_large(&stream, count_new_data, &cb,
+                                           svn_stream_from_string(source,
+                                                                  pool),
+                                           svn_stream_from_string(source,
+                                                                  pool),
+                                           pool));
+  else
+    stream = svn_txdelta_target_push(count_new_data, &cb,
+                                     svn_stream_from_string(source, pool),
+                                     pool);
+
+  SVN_ERR(svn_stream_write(stream, target->data, &len));
+  SVN_ERR(svn_stream_close(stream));
+
+  SVN_TEST_ASSERT(result->len == target->len);
+  SVN_TEST_ASSERT(memcmp(result->data, target->data, target->len) == 0);
+
+  *new_data_len = cb.new_data_len;
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+large_window_test(apr_pool_t *pool)
+{
+  enum { SOURCE_LEN = 4000000, INSERTED = 37000 };
+
+  char *source = apr_palloc(pool, SOURCE_LEN);
+  svn_stringbuf_t *target;
+  svn_string_t source_str, target_str;
+  apr_size_t normal_len, large_window_len;
+  apr_uint32_t seed = 42;
+  int i;
+
+  /* Random source data that xdelta can't compress on its own. */
+  for (i = 0; i < SOURCE_LEN; ++i)
+    source[i] = (char)svn_test_rand(&seed);
+
+  source_str.data = source;
+  source_str.len = SOURCE_LEN;
+
+  /* Insert some data at the start and move 1MB from the middle to the
+   * end.  The latter causes some source data to be skipped. */
+  target = svn_stringbuf_create_ensure(SOURCE_LEN + INSERTED, pool);
+  for (i = 0; i < INSERTED; ++i)
+    svn_stringbuf_appendbyte(target, (char)svn_test_rand(&seed));
+  svn_stringbuf_appendbytes(target, source, 1000000);
+  svn_stringbuf_appendbytes(target, source + 2000000, 2000000);
+  svn_stringbuf_appendbytes(target, source + 1000000, 1000000);
+
+  target_str.data = target->data;
+  target_str.len = target->len;
+
+  SVN_ERR(push_and_apply(&normal_len, FALSE, &source_str, &target_str,
+                         pool));
+  SVN_ERR(push_and_apply(&large_window_len, TRUE, &source_str, &target_str,
+                         pool));
+
+  /* Apart from the inserted data, we may lose up to one window at each
+   * discontinuity.  The moved block itself can't be matched as source
+   * views may not slide backwards. */
+  SVN_TEST_ASSERT(large_window_len
+                  < INSERTED + 1000000 + 3 * SVN_DELTA_WINDOW_SIZE);
+  SVN_TEST_ASSERT(large_window_len * 2 < normal_len);
+
+  return SVN_NO_ERROR;
+}
+
+/* Deltify TARGET against SOURCE window by window, with the same alignment
+ * as svn_txdelta_target_push().  Verify each window and print the xdelta
+ * throughput for DESCRIPTION. */
+static svn_error_t *
+measure_xdelta(const char *description,
+               const svn_stringbuf_t *source,
+               const svn_stringbuf_t *target,
+               apr_pool_t *pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  char *buf = apr_palloc(pool, 2 * SVN_DELTA_WINDOW_SIZE);
+  char *result = apr_palloc(pool, SVN_DELTA_WINDOW_SIZE);
+  apr_size_t new_data_len = 0;
+  apr_time_t duration = 0;
+  apr_size_t pos;
+
+  for (pos = 0; pos < target->len; pos += SVN_DELTA_WINDOW_SIZE)
+    {
+      apr_size_t source_len = 0;
+      apr_size_t target_len = MIN(SVN_DELTA_WINDOW_SIZE, target->len - pos);
+      apr_size_t len = SVN_DELTA_WINDOW_SIZE;
+      svn_txdelta_window_t *window;
+      apr_time_t start;
+
+      svn_pool_clear(iterpool);
+
+      if (pos < source->len)
+        source_len = MIN(SVN_DELTA_WINDOW_SIZE, source->len - pos);
+
+      memcpy(buf, source->data + pos, source_len);
+      memcpy(buf + source_len, target->data + pos, target_len);
+
+      start = apr_time_now();
+      window = svn_txdelta__compute_window(buf, source_len, target_len, pos,
+                                           iterpool);
+      duration += apr_time_now() - start;
+
+      new_data_len += window->new_data->len;
+      svn_txdelta_apply_instructions(window, buf, result, &len);
+      SVN_TEST_ASSERT(len == target_len);
+      SVN_TEST_ASSERT(memcmp(result, target->data + pos, len) == 0);
+    }
+
+  /* Bytes per microsecond are MB/s. */
+  printf("%s: %.1f MB/s, %" APR_SIZE_T_FMT " bytes of new data\n",
+         description, (double)target->len / MAX(duration, 1),
+         new_data_len);
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+xdelta_throughput_test(apr_pool_t *pool)
+{
+  enum { DATA_LEN = 8000000 };
+
+  svn_stringbuf_t *source = svn_stringbuf_create_ensure(DATA_LEN, pool);
+  svn_stringbuf_t *target = svn_stringbuf_create_ensure(DATA_LEN, pool);
+  apr_uint32_t seed = 42;
+  apr_size_t pos;
+  int i;
+
+  /* Source code like text with small edits every few kB. */
+  for (i = 0; source->len < DATA_LEN; ++i)
+    {
+      char line[80];
+      apr_uint32_t arg = svn_test_rand(&seed) % 1000;
+
+      apr_snprintf(line, sizeof(line), "  value_%d = compute(%u, \"%x\");\n",
+                   i, arg, svn_test_rand(&seed));
+      svn_stringbuf_appendcstr(source, line);
+    }
+
+  for (pos = 0; pos < source->len; )
+    {
+      apr_size_t len = MIN(source->len - pos,
+                           1000 + svn_test_rand(&seed) % 4000);
+      svn_stringbuf_appendbytes(target, source->data + pos, len);
+      pos += len;
+
+      switch (svn_test_rand(&seed) % 3)
+        {
+          case 0:  svn_stringbuf_appendcstr(target, "/* new */");
+                   break;
+          case 1:  pos += 7;
+                   break;
+          default: svn_stringbuf_appendcstr(target, "replaced");
+                   pos += 8;
+                   break;
+        }
+    }
+
+  SVN_ERR(measure_xdelta("source edits", source, target, pool));
+
+  /* Random binary data with some insertions that shift the contents
+   * within the windows. */
+  svn_stringbuf_setempty(source);
+  svn_stringbuf_setempty(target);
+  for (i = 0; i < DATA_LEN; ++i)
+    svn_stringbuf_appendbyte(source, (char)svn_test_rand(&seed));
+
+  for (pos = 0; pos < source->len; pos += 65536)
+    {
+      for (i = 0; i < 100; ++i)
+        svn_stringbuf_appendbyte(target, (char)svn_test_rand(&seed));
+      svn_stringbuf_appendbytes(target, source->data + pos,
+                                MIN(65536, source->len - pos));
+    }
+
+  SVN_ERR(measure_xdelta("random binary", source, target, pool));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+adler32_test(apr_pool_t *pool)
+{
+  enum { BLOCK_SIZE = 64, DATA_LEN = 0x10000 };
+
+  char *data = apr_palloc(pool, DATA_LEN + BLOCK_SIZE);
+  apr_uint32_t seed = 42;
+  int i;
+
+  /* Blocks of equal bytes, including those that overflow the 16 bit
+   * half of the checksum. */
+  for (i = 0; i < 256; ++i)
+    {
+      memset(data, i, BLOCK_SIZE);
+      SVN_TEST_ASSERT(svn_txdelta__adler32(data, FALSE)
+                      == svn_txdelta__adler32(data, TRUE));
+    }
+
+  /* Random data at all alignments. */
+  for (i = 0; i < DATA_LEN + BLOCK_SIZE; ++i)
+    data[i] = (char)svn_test_rand(&seed);
+
+  for (i = 0; i < DATA_LEN; ++i)
+    SVN_TEST_ASSERT(svn_txdelta__adler32(data + i, FALSE)
+                    == svn_txdelta__adler32(data + i, TRUE));
+
+  return SVN_NO_ERROR;
+}
+
 
 
 /* The test table.  */
@@ -107,6 +367,12 @@ static struct svn_test_descriptor_t test_funcs[] =
     SVN_TEST_NULL,
     SVN_TEST_PASS2(stream_window_test,
                    "txdelta stream and windows test"),
+    SVN_TEST_PASS2(large_window_test,
+                   "large-window delta for shifted data"),
+    SVN_TEST_SKIP2(xdelta_throughput_test, TRUE,
+                   "optional xdelta throughput benchmark"),
+    SVN_TEST_PASS2(adler32_test,
+                   "vectorized adler32 matches the portable code"),
     SVN_TEST_NULL
   };
 
@@ -5702,8 +5702,8 @@ upgrade_while_committing(const svn_test_opts_t *opts,
   SVN_ERR(test_commit_txn(&head_rev, txn1, NULL, pool));
 
   /* Verify filesystem content. */
-  SVN_ERR(svn_fs_verify(fs_path, NULL, 0, SVN_INVALID_REVNUM, NULL, NULL,
-                        NULL, NULL, pool));
+  SVN_ERR(svn_fs_verify2(fs_path, NULL, 0, SVN_INVALID_REVNUM, 1, NULL, NULL,
+                         NULL, NULL, pool));
 
   return SVN_NO_ERROR;
 }
@@ -7182,8 +7182,8 @@ commit_with_locked_rep_cache(const svn_test_opts_t *opts,
    * svn_fs_t keeping an unusable db connection (and associated file
    * locks) within it.
    */
-  SVN_ERR(svn_fs_verify(fs_path, NULL, 0, SVN_INVALID_REVNUM, NULL, NULL,
-                        NULL, NULL, pool));
+  SVN_ERR(svn_fs_verify2(fs_path, NULL, 0, SVN_INVALID_REVNUM, 1, NULL, NULL,
+                         NULL, NULL, pool));
 
   return SVN_NO_ERROR;
 }
@@ -7469,6 +7469,58 @@ test_unrecognized_ioctl(const svn_test_opts_t *opts,
   return SVN_NO_ERROR;
 }
 
+/* Measure the wall clock time it takes to commit small revisions with
+ * flushing to disk enabled.  Every commit adds a file to a new directory,
+ * i.e. the batch fsync has to handle the rev file, the revprops file as
+ * well as any new shard folders.  Compare FSFS and FSX by running this
+ * with --fs-type. */
+static svn_error_t *
+commit_latency_benchmark(const svn_test_opts_t *opts,
+                         apr_pool_t *pool)
+{
+  enum { COMMIT_COUNT = 200 };
+
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  svn_revnum_t rev = 0;
+  apr_hash_t *fs_config = apr_hash_make(pool);
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  apr_time_t start;
+  apr_interval_time_t duration;
+  int i;
+
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_NO_FLUSH_TO_DISK, "0");
+  SVN_ERR(svn_test__create_fs2(&fs, "test-commit-latency-benchmark", opts,
+                               fs_config, pool));
+
+  start = apr_time_now();
+  for (i = 0; i < COMMIT_COUNT; ++i)
+    {
+      const char *dir_name;
+      const char *file_name;
+
+      svn_pool_clear(iterpool);
+      dir_name = apr_psprintf(iterpool, "/dir-%d", i);
+      file_name = svn_fspath__join(dir_name, "file", iterpool);
+
+      SVN_ERR(svn_fs_begin_txn2(&txn, fs, rev, 0, iterpool));
+      SVN_ERR(svn_fs_txn_root(&txn_root, txn, iterpool));
+      SVN_ERR(svn_fs_make_dir(txn_root, dir_name, iterpool));
+      SVN_ERR(svn_fs_make_file(txn_root, file_name, iterpool));
+      SVN_ERR(svn_test__set_file_contents(txn_root, file_name, file_name,
+                                          iterpool));
+      SVN_ERR(test_commit_txn(&rev, txn, NULL, iterpool));
+    }
+  duration = apr_time_now() - start;
+
+  printf("%s: %d commits, %.3f ms per commit\n", opts->fs_type,
+         COMMIT_COUNT, (double)duration / COMMIT_COUNT / 1000.0);
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
 /* ------------------------------------------------------------------------ */
 
 /* The test table.  */
@@ -7617,6 +7669,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "svn_fs_closest_copy after replacing file with dir"),
     SVN_TEST_OPTS_PASS(test_unrecognized_ioctl,
                        "test svn_fs_ioctl with unrecognized code"),
+    SVN_TEST_OPTS_SKIP(commit_latency_benchmark, TRUE,
+                       "optional commit latency benchmark"),
     SVN_TEST_NULL
   };
 
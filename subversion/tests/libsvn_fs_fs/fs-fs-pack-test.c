@@ -26,8 +26,10 @@
 
 #include "../svn_test.h"
 #include "../../libsvn_fs/fs-loader.h"
+#include "../../libsvn_fs_fs/cached_data.h"
 #include "../../libsvn_fs_fs/fs.h"
 #include "../../libsvn_fs_fs/fs_fs.h"
+#include "../../libsvn_fs_fs/index.h"
 #include "../../libsvn_fs_fs/low_level.h"
 #include "../../libsvn_fs_fs/pack.h"
 #include "../../libsvn_fs_fs/util.h"
@@ -191,7 +193,58 @@ create_packed_filesystem(const char *dir,
   /* Now pack the FS */
   pnb.expected_shard = 0;
   pnb.expected_action = svn_fs_pack_notify_start;
-  return svn_fs_pack(dir, pack_notify, &pnb, NULL, NULL, pool);
+  return svn_fs_pack2(dir, 1, pack_notify, &pnb, NULL, NULL, pool);
+}
+
+/* Open the filesystem at DIR with caches that are not shared with any
+   other FS instance and return it in *FS.  This makes sure that all data
+   will actually be read from the repository files.  Add the options in
+   FS_CONFIG, which may be NULL.  Use POOL for allocations.  */
+static svn_error_t *
+open_with_fresh_caches(svn_fs_t **fs,
+                       const char *dir,
+                       apr_hash_t *fs_config,
+                       apr_pool_t *pool)
+{
+  if (fs_config == NULL)
+    fs_config = apr_hash_make(pool);
+
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                svn_uuid_generate(pool));
+  return svn_error_trace(svn_fs_open2(fs, dir, fs_config, pool, pool));
+}
+
+/* Verify that "iota" in FS has the contents that create_non_packed_
+   filesystem() gave it in each of the revisions 1 to MAX_REV.
+   Use POOL for temporary allocations.  */
+static svn_error_t *
+verify_iota_contents(svn_fs_t *fs,
+                     svn_revnum_t max_rev,
+                     apr_pool_t *pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_revnum_t i;
+
+  for (i = 1; i <= max_rev; i++)
+    {
+      svn_fs_root_t *rev_root;
+      svn_stream_t *rstream;
+      svn_stringbuf_t *rstring;
+      const char *expected;
+
+      svn_pool_clear(iterpool);
+
+      SVN_ERR(svn_fs_revision_root(&rev_root, fs, i, iterpool));
+      SVN_ERR(svn_fs_file_contents(&rstream, rev_root, "iota", iterpool));
+      SVN_ERR(svn_test__stream_to_string(&rstring, rstream, iterpool));
+
+      expected = i == 1 ? "This is the file 'iota'.\n"
+                        : get_rev_contents(i, iterpool);
+      SVN_TEST_STRING_ASSERT(rstring->data, expected);
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
 }
 
 /* Create a packed FSFS filesystem for revprop tests at REPO_NAME with
@@ -226,7 +279,7 @@ prepare_revprop_repo(svn_fs_t **fs,
   svn_pool_destroy(subpool);
 
   /* Pack the repository. */
-  SVN_ERR(svn_fs_pack(repo_name, NULL, NULL, NULL, NULL, pool));
+  SVN_ERR(svn_fs_pack2(repo_name, 1, NULL, NULL, NULL, NULL, pool));
 
   return SVN_NO_ERROR;
 }
@@ -663,7 +716,7 @@ recover_fully_packed(const svn_test_opts_t *opts,
   SVN_ERR(svn_fs_commit_txn(&conflict, &after_rev, txn, subpool));
   SVN_TEST_ASSERT(SVN_IS_VALID_REVNUM(after_rev));
   svn_pool_destroy(subpool);
-  SVN_ERR(svn_fs_pack(REPO_NAME, NULL, NULL, NULL, NULL, pool));
+  SVN_ERR(svn_fs_pack2(REPO_NAME, 1, NULL, NULL, NULL, NULL, pool));
   SVN_ERR(svn_fs_recover(REPO_NAME, NULL, NULL, pool));
 
   /* Now, delete the youngest revprop file, and recover again.  This
@@ -1002,7 +1055,7 @@ upgrade_txns_to_log_addressing(const svn_test_opts_t *opts,
   /* Pack repo to verify that old and new shard get packed according to
      their respective addressing mode */
 
-  SVN_ERR(svn_fs_pack(repo_name, NULL, NULL, NULL, NULL, pool));
+  SVN_ERR(svn_fs_pack2(repo_name, 1, NULL, NULL, NULL, NULL, pool));
 
   /* verify that our changes got in */
 
@@ -1029,9 +1082,9 @@ upgrade_txns_to_log_addressing(const svn_test_opts_t *opts,
 
   /* verify that the indexes are consistent, we calculated the correct
      low-level checksums etc. */
-  SVN_ERR(svn_fs_verify(repo_name, NULL,
-                        SVN_INVALID_REVNUM, SVN_INVALID_REVNUM,
-                        NULL, NULL, NULL, NULL, pool));
+  SVN_ERR(svn_fs_verify2(repo_name, NULL,
+                         SVN_INVALID_REVNUM, SVN_INVALID_REVNUM, 1,
+                         NULL, NULL, NULL, NULL, pool));
   for (; rev >= 0; --rev)
     {
       svn_pool_clear(iterpool);
@@ -1414,6 +1467,23 @@ count_substring(svn_stringbuf_t *string,
   return count;
 }
 
+/* Return the offset of the first occurrence of NEEDLE in STRING at or
+ * after START, or STRING->LEN if there is none. */
+static apr_size_t
+find_substring(svn_stringbuf_t *string,
+               const char *needle,
+               apr_size_t start)
+{
+  apr_size_t len = strlen(needle);
+  apr_size_t pos;
+
+  for (pos = start; pos + len <= string->len; ++pos)
+    if (memcmp(string->data + pos, needle, len) == 0)
+      return pos;
+
+  return string->len;
+}
+
 static svn_error_t *
 count_representations(int *count,
                       svn_fs_t *fs,
@@ -1796,12 +1866,12 @@ pack_with_limited_memory(const svn_test_opts_t *opts,
 
       /* Pack it with a narrow memory budget. */
       SVN_ERR(svn_fs_open2(&fs, dir, NULL, iterpool, iterpool));
-      SVN_ERR(svn_fs_fs__pack(fs, max_mem, NULL, NULL, NULL, NULL,
-                              iterpool));
+      SVN_ERR(svn_fs_fs__pack(fs, max_mem, 1, NULL, NULL, NULL, NULL, NULL,
+                              NULL, iterpool));
 
       /* To be sure: Verify that we didn't break the repo. */
-      SVN_ERR(svn_fs_verify(dir, NULL, 0, MAX_REV, NULL, NULL, NULL, NULL,
-                            iterpool));
+      SVN_ERR(svn_fs_verify2(dir, NULL, 0, MAX_REV, 1, NULL, NULL, NULL, NULL,
+                             iterpool));
     }
 
   svn_pool_destroy(iterpool);
@@ -1888,6 +1958,1297 @@ large_delta_against_plain(const svn_test_opts_t *opts,
 
 #undef REPO_NAME
 
+/* ------------------------------------------------------------------------ */
+#define REPO_NAME "test-repo-read-packed-fs-mmap"
+#define SHARD_SIZE 5
+#define MAX_REV 11
+static svn_error_t *
+read_packed_fs_mmap(const svn_test_opts_t *opts,
+                    apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_revnum_t rev;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  SVN_ERR(create_packed_filesystem(REPO_NAME, opts, MAX_REV, SHARD_SIZE, pool));
+
+  SVN_ERR(open_with_fresh_caches(&fs, REPO_NAME, NULL, pool));
+  ffd = fs->fsap_data;
+  ffd->use_mmap = TRUE;
+
+  SVN_ERR(verify_iota_contents(fs, MAX_REV, pool));
+
+#if APR_HAS_MMAP
+  /* Both, pack files and the remaining non-packed rev files must actually
+   * be mapped into memory. */
+  for (rev = 1; rev <= MAX_REV; rev += SHARD_SIZE)
+    {
+      svn_fs_fs__revision_file_t *rev_file;
+
+      SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&rev_file, fs, rev, pool,
+                                               pool));
+      SVN_TEST_ASSERT(rev_file->is_packed == (rev < MAX_REV - 1));
+      SVN_TEST_ASSERT(rev_file->mmap != NULL);
+      SVN_ERR(svn_fs_fs__close_revision_file(rev_file));
+    }
+#endif
+
+  /* Without the option, files get read through the usual file API. */
+  ffd->use_mmap = FALSE;
+  for (rev = 1; rev <= MAX_REV; rev += SHARD_SIZE)
+    {
+      svn_fs_fs__revision_file_t *rev_file;
+
+      SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&rev_file, fs, rev, pool,
+                                               pool));
+      SVN_TEST_ASSERT(rev_file->mmap == NULL);
+      SVN_ERR(svn_fs_fs__close_revision_file(rev_file));
+    }
+
+  return SVN_NO_ERROR;
+}
+#undef REPO_NAME
+#undef SHARD_SIZE
+#undef MAX_REV
+
+/* ------------------------------------------------------------------------ */
+#define REPO_NAME "test-repo-read-packed-fs-prefetch"
+#define SHARD_SIZE 5
+#define MAX_REV 11
+static svn_error_t *
+read_packed_fs_prefetch(const svn_test_opts_t *opts,
+                        apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  apr_hash_t *fs_config;
+  svn_fs_fs__revision_file_t *rev_file;
+  apr_array_header_t *entries;
+  apr_off_t block_start;
+  apr_off_t window;
+  int ranges = 0;
+  int i;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+  if (opts->server_minor_version && (opts->server_minor_version < 9))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "pre-1.9 SVN doesn't have block-read");
+
+  SVN_ERR(create_packed_filesystem(REPO_NAME, opts, MAX_REV, SHARD_SIZE,
+                                   pool));
+
+  /* Use block-read with tiny blocks, so that the first shard spans many
+   * blocks and prefetch windows. */
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_BLOCK_READ, "1");
+  SVN_ERR(open_with_fresh_caches(&fs, REPO_NAME, fs_config, pool));
+  ffd = fs->fsap_data;
+  ffd->block_size = 0x400;
+  ffd->prefetch_blocks = 2;
+  window = ffd->prefetch_blocks * ffd->block_size;
+
+  SVN_ERR(verify_iota_contents(fs, MAX_REV, pool));
+
+  /* The hinted ranges must consist of whole items taken from the P2L
+   * index, starting with the first used item behind the current block. */
+  SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&rev_file, fs, 1, pool, pool));
+  SVN_ERR(svn_fs_fs__auto_read_footer(rev_file));
+  SVN_ERR(svn_fs_fs__p2l_index_lookup(&entries, fs, rev_file, 1, 0,
+                                      rev_file->l2p_offset, pool, pool));
+
+  for (block_start = 0;
+       block_start < rev_file->l2p_offset;
+       block_start += ffd->block_size)
+    {
+      apr_off_t window_start = block_start + ffd->block_size;
+      apr_off_t start, end;
+      svn_boolean_t start_found = FALSE;
+      svn_boolean_t end_found = FALSE;
+
+      SVN_ERR(svn_fs_fs__get_prefetch_range(&start, &end, fs, rev_file, 1,
+                                            block_start, pool));
+      SVN_TEST_ASSERT(start <= end);
+      if (start == end)
+        continue;
+
+      ++ranges;
+      SVN_TEST_ASSERT(start >= window_start);
+      SVN_TEST_ASSERT(end <= window_start + window);
+      SVN_TEST_ASSERT(end <= rev_file->l2p_offset);
+
+      for (i = 0; i < entries->nelts; ++i)
+        {
+          svn_fs_fs__p2l_entry_t *entry
+            = &APR_ARRAY_IDX(entries, i, svn_fs_fs__p2l_entry_t);
+
+          if (entry->type == SVN_FS_FS__ITEM_TYPE_UNUSED)
+            continue;
+
+          /* No used item between the window start and the range. */
+          SVN_TEST_ASSERT(   entry->offset < window_start
+                          || entry->offset >= start);
+
+          if (entry->offset == start)
+            start_found = TRUE;
+          if (entry->offset + entry->size == end)
+            end_found = TRUE;
+        }
+
+      SVN_TEST_ASSERT(start_found && end_found);
+    }
+
+  SVN_TEST_ASSERT(ranges > 0);
+
+  /* Continuing a prefetched range only extends it while a backward seek
+   * starts a new one. */
+  SVN_ERR(svn_fs_fs__rev_file_prefetch(rev_file, 0x800, 0x400));
+  SVN_ERR(svn_fs_fs__rev_file_prefetch(rev_file, 0xa00, 0x400));
+  SVN_TEST_ASSERT(rev_file->prefetched_start == 0x800);
+  SVN_TEST_ASSERT(rev_file->prefetched_end == 0xe00);
+
+  SVN_ERR(svn_fs_fs__rev_file_prefetch(rev_file, 0, 0x400));
+  SVN_TEST_ASSERT(rev_file->prefetched_start == 0);
+  SVN_TEST_ASSERT(rev_file->prefetched_end == 0x400);
+
+  SVN_ERR(svn_fs_fs__close_revision_file(rev_file));
+
+  return SVN_NO_ERROR;
+}
+#undef REPO_NAME
+#undef SHARD_SIZE
+#undef MAX_REV
+
+/* ------------------------------------------------------------------------ */
+#define REPO_NAME "test-repo-pack-concurrently"
+#define SHARD_SIZE 3
+#define MAX_REV 23
+/* Baton for pack_cancel_notify() and pack_cancel(). */
+struct pack_cancel_baton
+{
+  /* Forwarded to pack_notify(). */
+  struct pack_notify_baton pnb;
+
+#if APR_HAS_THREADS
+  /* The thread that called svn_fs_pack2(). */
+  apr_os_thread_t thread;
+#endif
+
+  /* Set CANCEL once the first shard has been packed. */
+  svn_boolean_t cancel_after_first_shard;
+
+  /* Make pack_cancel() cancel the operation. */
+  svn_boolean_t cancel;
+};
+
+/* Implements svn_fs_pack_notify_t, forwarding to pack_notify(). */
+static svn_error_t *
+pack_cancel_notify(void *baton,
+                   apr_int64_t shard,
+                   svn_fs_pack_notify_action_t action,
+                   apr_pool_t *pool)
+{
+  struct pack_cancel_baton *pcb = baton;
+
+  SVN_ERR(pack_notify(&pcb->pnb, shard, action, pool));
+  if (action == svn_fs_pack_notify_end && pcb->cancel_after_first_shard)
+    pcb->cancel = TRUE;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_cancel_func_t.  The pack threads must not call it. */
+static svn_error_t *
+pack_cancel(void *baton)
+{
+  struct pack_cancel_baton *pcb = baton;
+
+#if APR_HAS_THREADS
+  SVN_TEST_ASSERT(apr_os_thread_equal(apr_os_thread_current(), pcb->thread));
+#endif
+
+  if (pcb->cancel)
+    return svn_error_create(SVN_ERR_CANCELLED, NULL, NULL);
+
+  return SVN_NO_ERROR;
+}
+
+/* Initialize PCB for a pack run in the current thread. */
+static void
+init_pack_cancel_baton(struct pack_cancel_baton *pcb,
+                       svn_boolean_t cancel_after_first_shard)
+{
+  pcb->pnb.expected_shard = 0;
+  pcb->pnb.expected_action = svn_fs_pack_notify_start;
+#if APR_HAS_THREADS
+  pcb->thread = apr_os_thread_current();
+#endif
+  pcb->cancel_after_first_shard = cancel_after_first_shard;
+  pcb->cancel = FALSE;
+}
+
+/* Verify that in the repository at DIR exactly the first PACKED_SHARDS
+ * of its SHARD_COUNT rev shards have been packed.  Use POOL for
+ * allocations. */
+static svn_error_t *
+verify_packed_shards(const char *dir,
+                     apr_int64_t packed_shards,
+                     apr_int64_t shard_count,
+                     apr_pool_t *pool)
+{
+  apr_int64_t shard;
+
+  for (shard = 0; shard < shard_count; ++shard)
+    {
+      svn_node_kind_t kind;
+      const char *path
+        = svn_dirent_join_many(pool, dir, "revs",
+                               apr_psprintf(pool, "%" APR_INT64_T_FMT,
+                                            shard),
+                               SVN_VA_NULL);
+
+      SVN_ERR(svn_io_check_path(path, &kind, pool));
+      SVN_TEST_ASSERT(kind == (shard < packed_shards ? svn_node_none
+                                                     : svn_node_dir));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+#define REPO_NAME "test-repo-pack-concurrently"
+#define SHARD_SIZE 3
+#define MAX_REV 23
+static svn_error_t *
+pack_concurrently(const svn_test_opts_t *opts,
+                  apr_pool_t *pool)
+{
+  struct pack_cancel_baton pcb;
+  svn_fs_t *fs;
+
+  SVN_ERR(create_non_packed_filesystem(REPO_NAME, opts, MAX_REV, SHARD_SIZE,
+                                       pool));
+
+  /* Use more jobs than there are shards in the last batch.
+   * PACK_NOTIFY verifies that shards get reported in order and
+   * PACK_CANCEL that it only gets called from this thread. */
+  init_pack_cancel_baton(&pcb, FALSE);
+  SVN_ERR(svn_fs_pack2(REPO_NAME, 3, pack_cancel_notify, &pcb,
+                       pack_cancel, &pcb, pool));
+  SVN_TEST_ASSERT(pcb.pnb.expected_shard == (MAX_REV + 1) / SHARD_SIZE);
+
+  /* All shards must have been packed. */
+  SVN_ERR(verify_packed_shards(REPO_NAME, (MAX_REV + 1) / SHARD_SIZE,
+                               (MAX_REV + 1) / SHARD_SIZE, pool));
+
+  /* And the contents must be intact. */
+  SVN_ERR(open_with_fresh_caches(&fs, REPO_NAME, NULL, pool));
+  SVN_ERR(verify_iota_contents(fs, MAX_REV, pool));
+
+  return SVN_NO_ERROR;
+}
+#undef REPO_NAME
+#undef SHARD_SIZE
+#undef MAX_REV
+
+/* ------------------------------------------------------------------------ */
+#define REPO_NAME "test-repo-pack-concurrently-cancel"
+#define SHARD_SIZE 3
+#define MAX_REV 23
+static svn_error_t *
+pack_concurrently_cancel(const svn_test_opts_t *opts,
+                         apr_pool_t *pool)
+{
+  struct pack_cancel_baton pcb;
+  svn_fs_t *fs;
+  svn_error_t *err;
+  svn_revnum_t min_unpacked_rev;
+  apr_int64_t packed_shards;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  SVN_ERR(create_non_packed_filesystem(REPO_NAME, opts, MAX_REV, SHARD_SIZE,
+                                       pool));
+
+  /* Cancel as soon as the first shard has been reported. */
+  init_pack_cancel_baton(&pcb, TRUE);
+  err = svn_fs_pack2(REPO_NAME, 3, pack_cancel_notify, &pcb,
+                     pack_cancel, &pcb, pool);
+  SVN_TEST_ASSERT_ERROR(err, SVN_ERR_CANCELLED);
+
+  /* The packed shards must form a prefix and match the reported ones. */
+  SVN_ERR(open_with_fresh_caches(&fs, REPO_NAME, NULL, pool));
+  SVN_ERR(svn_fs_fs__read_min_unpacked_rev(&min_unpacked_rev, fs, pool));
+  SVN_TEST_ASSERT(min_unpacked_rev % SHARD_SIZE == 0);
+
+  packed_shards = min_unpacked_rev / SHARD_SIZE;
+  SVN_TEST_ASSERT(packed_shards >= 1);
+  SVN_TEST_ASSERT(packed_shards < (MAX_REV + 1) / SHARD_SIZE);
+  SVN_TEST_ASSERT(packed_shards == pcb.pnb.expected_shard);
+  SVN_ERR(verify_packed_shards(REPO_NAME, packed_shards,
+                               (MAX_REV + 1) / SHARD_SIZE, pool));
+  SVN_ERR(verify_iota_contents(fs, MAX_REV, pool));
+
+  /* Packing can simply be resumed. */
+  init_pack_cancel_baton(&pcb, FALSE);
+  pcb.pnb.expected_shard = packed_shards;
+  SVN_ERR(svn_fs_pack2(REPO_NAME, 3, pack_cancel_notify, &pcb,
+                       pack_cancel, &pcb, pool));
+  SVN_ERR(verify_packed_shards(REPO_NAME, (MAX_REV + 1) / SHARD_SIZE,
+                               (MAX_REV + 1) / SHARD_SIZE, pool));
+
+  SVN_ERR(open_with_fresh_caches(&fs, REPO_NAME, NULL, pool));
+  SVN_ERR(verify_iota_contents(fs, MAX_REV, pool));
+
+  return SVN_NO_ERROR;
+}
+#undef REPO_NAME
+#undef SHARD_SIZE
+#undef MAX_REV
+
+/* ------------------------------------------------------------------------ */
+#define REPO_NAME "test-repo-hotcopy-concurrently"
+#define SHARD_SIZE 3
+#define MAX_REV 25
+static svn_error_t *
+hotcopy_concurrently(const svn_test_opts_t *opts,
+                     apr_pool_t *pool)
+{
+  const char *dst_name = REPO_NAME "-copy";
+  apr_finfo_t pack_info[(MAX_REV + 1) / SHARD_SIZE];
+  svn_fs_t *fs;
+  svn_revnum_t youngest;
+  int pass;
+  int shard;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  /* Leaves the last two revisions non-packed. */
+  SVN_ERR(create_packed_filesystem(REPO_NAME, opts, MAX_REV, SHARD_SIZE,
+                                   pool));
+  SVN_ERR(svn_io_remove_dir2(dst_name, TRUE, NULL, NULL, pool));
+  svn_test_add_dir_cleanup(dst_name);
+
+  /* A full copy followed by an incremental one that finds nothing new. */
+  for (pass = 0; pass < 2; ++pass)
+    {
+      SVN_ERR(svn_fs_hotcopy4(REPO_NAME, dst_name, FALSE, pass > 0, 3,
+                              NULL, NULL, NULL, NULL, pool));
+
+      SVN_ERR(open_with_fresh_caches(&fs, dst_name, NULL, pool));
+      SVN_ERR(svn_fs_youngest_rev(&youngest, fs, pool));
+      SVN_TEST_ASSERT(youngest == MAX_REV);
+      SVN_ERR(verify_iota_contents(fs, MAX_REV, pool));
+
+      SVN_ERR(svn_fs_verify2(dst_name, NULL, 0, SVN_INVALID_REVNUM, 1,
+                             NULL, NULL, NULL, NULL, pool));
+
+      /* The incremental run must have skipped the unchanged pack files
+       * instead of copying them again. */
+      for (shard = 0; shard < (MAX_REV + 1) / SHARD_SIZE; ++shard)
+        {
+          apr_finfo_t finfo;
+          const char *path
+            = svn_dirent_join_many(pool, dst_name, "revs",
+                                   apr_psprintf(pool, "%d.pack", shard),
+                                   "pack", SVN_VA_NULL);
+
+          SVN_ERR(svn_io_stat(&finfo, path, APR_FINFO_INODE | APR_FINFO_MTIME,
+                              pool));
+          if (pass == 0)
+            {
+              pack_info[shard] = finfo;
+            }
+          else
+            {
+              SVN_TEST_ASSERT(finfo.inode == pack_info[shard].inode);
+              SVN_TEST_ASSERT(finfo.mtime == pack_info[shard].mtime);
+            }
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+#undef REPO_NAME
+#undef SHARD_SIZE
+#undef MAX_REV
+
+/* ------------------------------------------------------------------------ */
+#define REPO_NAME "test-repo-large-directory-blocks"
+#define DIR_SIZE 5000
+
+/* Set *BLOCKS to the block index of directory PATH in revision REV of FS,
+ * or NULL if it has not been stored in blocks. */
+static svn_error_t *
+get_dir_blocks(apr_array_header_t **blocks,
+               svn_fs_t *fs,
+               svn_revnum_t rev,
+               const char *path,
+               apr_pool_t *pool)
+{
+  svn_fs_root_t *root;
+  const svn_fs_id_t *id;
+  node_revision_t *noderev;
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev, pool));
+  SVN_ERR(svn_fs_node_id(&id, root, path, pool));
+  SVN_ERR(svn_fs_fs__get_node_revision(&noderev, fs, id, pool, pool));
+  SVN_ERR(svn_fs_fs__get_dir_block_index(blocks, fs, noderev, pool, pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Return TRUE if the blocks LHS and RHS refer to the same rep. */
+static svn_boolean_t
+same_dir_block(const svn_fs_fs__dir_block_t *lhs,
+               const svn_fs_fs__dir_block_t *rhs)
+{
+  return strcmp(lhs->first_name, rhs->first_name) == 0
+      && lhs->rep.revision == rhs->rep.revision
+      && lhs->rep.item_index == rhs->rep.item_index;
+}
+
+static svn_error_t *
+large_directory_blocks(const svn_test_opts_t *opts,
+                       apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  apr_hash_t *fs_config;
+  apr_hash_t *entries;
+  apr_array_header_t *blocks[4];
+  svn_stringbuf_t *rev_contents;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+  ffd = fs->fsap_data;
+  if (ffd->format < SVN_FS_FS__MIN_BLOCKED_DIRS_FORMAT)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  /* r1: Directory with only the even-numbered entries. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_make_dir(root, "dir", pool));
+  for (i = 0; i < DIR_SIZE; ++i)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_make_file(root,
+                               apr_psprintf(iterpool, "dir/f%05d", 2 * i),
+                               iterpool));
+    }
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+  SVN_TEST_ASSERT(rev == 1);
+
+  /* r2: Add an entry at the front. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_make_file(root, "dir/f00001", pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* r3: Remove the last entry. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_delete(root,
+                        apr_psprintf(pool, "dir/f%05d", 2 * DIR_SIZE - 2),
+                        pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* Only the large directory got stored in blocks. */
+  SVN_ERR(svn_stringbuf_from_file2(&rev_contents,
+                                   svn_fs_fs__path_rev_absolute(fs, 1, pool),
+                                   pool));
+  SVN_TEST_INT_ASSERT(count_substring(rev_contents, "BLOCKED"), 1);
+  SVN_ERR(get_dir_blocks(&blocks[0], fs, 1, "/", pool));
+  SVN_TEST_ASSERT(blocks[0] == NULL);
+
+  for (i = 1; i <= 3; ++i)
+    {
+      SVN_ERR(get_dir_blocks(&blocks[i], fs, i, "dir", pool));
+      SVN_TEST_ASSERT(blocks[i] != NULL);
+      SVN_TEST_INT_ASSERT(blocks[i]->nelts, 4);
+    }
+
+  /* Each single-entry change rewrote only the block containing it. */
+  SVN_TEST_ASSERT(APR_ARRAY_IDX(blocks[2], 0,
+                                svn_fs_fs__dir_block_t).rep.revision == 2);
+  for (i = 1; i < 4; ++i)
+    SVN_TEST_ASSERT(same_dir_block(
+                      &APR_ARRAY_IDX(blocks[1], i, svn_fs_fs__dir_block_t),
+                      &APR_ARRAY_IDX(blocks[2], i, svn_fs_fs__dir_block_t)));
+
+  SVN_TEST_ASSERT(APR_ARRAY_IDX(blocks[3], 3,
+                                svn_fs_fs__dir_block_t).rep.revision == 3);
+  for (i = 0; i < 3; ++i)
+    SVN_TEST_ASSERT(same_dir_block(
+                      &APR_ARRAY_IDX(blocks[2], i, svn_fs_fs__dir_block_t),
+                      &APR_ARRAY_IDX(blocks[3], i, svn_fs_fs__dir_block_t)));
+
+  /* Read the directory from disk, using a new FS instance with disjoint
+   * caches.  Look up single entries first, then list the whole thing. */
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                           svn_uuid_generate(pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev, pool));
+  for (i = -1; i <= 2 * DIR_SIZE; ++i)
+    {
+      svn_node_kind_t kind;
+      const char *path;
+
+      svn_pool_clear(iterpool);
+      path = i < 0 ? "dir/a"
+           : i == 2 * DIR_SIZE ? "dir/g"
+           : apr_psprintf(iterpool, "dir/f%05d", i);
+
+      SVN_ERR(svn_fs_check_path(&kind, root, path, iterpool));
+      if (   (i >= 0 && i < 2 * DIR_SIZE - 2 && i % 2 == 0)
+          || i == 1)
+        SVN_TEST_ASSERT(kind == svn_node_file);
+      else
+        SVN_TEST_ASSERT(kind == svn_node_none);
+    }
+
+  SVN_ERR(svn_fs_dir_entries(&entries, root, "dir", pool));
+  SVN_TEST_INT_ASSERT(apr_hash_count(entries), DIR_SIZE);
+  SVN_TEST_ASSERT(svn_hash_gets(entries, "f00001"));
+  SVN_TEST_ASSERT(!svn_hash_gets(entries,
+                                 apr_psprintf(pool, "f%05d",
+                                              2 * DIR_SIZE - 2)));
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+#undef REPO_NAME
+#undef DIR_SIZE
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-large-directory-benchmark"
+#define DIR_SIZE 1000000
+#define COMMIT_COUNT 10
+#define LOOKUP_COUNT 1000
+
+static svn_error_t *
+large_directory_benchmark(const svn_test_opts_t *opts,
+                          apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  apr_hash_t *fs_config;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  apr_uint32_t seed = 1234;
+  apr_time_t start;
+  apr_interval_time_t duration;
+  apr_off_t rev_size = 0;
+  int i;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_make_dir(root, "dir", pool));
+  for (i = 0; i < DIR_SIZE; ++i)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_make_file(root,
+                               apr_psprintf(iterpool, "dir/f%07d", 2 * i),
+                               iterpool));
+    }
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* Add single entries. */
+  start = apr_time_now();
+  for (i = 0; i < COMMIT_COUNT; ++i)
+    {
+      apr_finfo_t finfo;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, iterpool));
+      SVN_ERR(svn_fs_txn_root(&root, txn, iterpool));
+      SVN_ERR(svn_fs_make_file(root,
+                               apr_psprintf(iterpool, "dir/f%07d",
+                                 2 * (svn_test_rand(&seed) % DIR_SIZE) + 1),
+                               iterpool));
+      SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, iterpool));
+
+      SVN_ERR(svn_io_stat(&finfo, svn_fs_fs__path_rev_absolute(fs, rev,
+                                                               iterpool),
+                          APR_FINFO_SIZE, iterpool));
+      rev_size += finfo.size;
+    }
+  duration = apr_time_now() - start;
+
+  printf("%d entries: %.3f ms and %" APR_OFF_T_FMT " bytes per commit\n",
+         DIR_SIZE, (double)duration / COMMIT_COUNT / 1000.0,
+         rev_size / COMMIT_COUNT);
+
+  /* Random lookups with cold caches. */
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                           svn_uuid_generate(pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev, pool));
+
+  start = apr_time_now();
+  for (i = 0; i < LOOKUP_COUNT; ++i)
+    {
+      svn_node_kind_t kind;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_check_path(&kind, root,
+                                apr_psprintf(iterpool, "dir/f%07d",
+                                  2 * (svn_test_rand(&seed) % DIR_SIZE)),
+                                iterpool));
+      SVN_TEST_ASSERT(kind == svn_node_file);
+    }
+  duration = apr_time_now() - start;
+
+  printf("%d entries: %.3f ms per lookup\n",
+         DIR_SIZE, (double)duration / LOOKUP_COUNT / 1000.0);
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+#undef REPO_NAME
+#undef DIR_SIZE
+#undef COMMIT_COUNT
+#undef LOOKUP_COUNT
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-large-window-deltas"
+
+/* Return LEN random letters, using and updating SEED. */
+static svn_stringbuf_t *
+random_letters(apr_size_t len,
+               apr_uint32_t *seed,
+               apr_pool_t *pool)
+{
+  svn_stringbuf_t *result = svn_stringbuf_create_ensure(len, pool);
+  apr_size_t i;
+
+  for (i = 0; i < len; ++i)
+    result->data[i] = (char)('a' + svn_test_rand(seed) % 26);
+
+  result->data[len] = 0;
+  result->len = len;
+
+  return result;
+}
+
+static svn_error_t *
+large_window_deltas(const svn_test_opts_t *opts,
+                    apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  svn_stringbuf_t *contents[3];
+  svn_stringbuf_t *rev_contents;
+  apr_hash_t *fs_config;
+  apr_uint32_t seed = 1234;
+  int i;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+  ffd = fs->fsap_data;
+  if (ffd->format < SVN_FS_FS__MIN_LARGE_WINDOW_FORMAT)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  /* 1MB of incompressible text, then insert 37kB at the front and cut
+   * 250kB from the middle.  Normal deltification could only match about
+   * a third of the data. */
+  contents[0] = random_letters(1000000, &seed, pool);
+  contents[1] = random_letters(37000, &seed, pool);
+  svn_stringbuf_appendbytes(contents[1], contents[0]->data, 400000);
+  svn_stringbuf_appendbytes(contents[1], contents[0]->data + 650000,
+                            350000);
+
+  /* Finally, a small change for a normal delta on top of that. */
+  contents[2] = svn_stringbuf_dup(contents[1], pool);
+  contents[2]->data[500000] = 'X';
+
+  /* Revision 1: the original file. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_make_file(root, "foo", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "foo", contents[0]->data, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* Revision 2: the modified file, using the large-window matcher. */
+  ffd->large_window_threshold = 0x400;
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(root, "foo", contents[1]->data, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* Revision 3: the small change, using normal deltification. */
+  ffd->large_window_threshold = 0;
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(root, "foo", contents[2]->data, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* Only r2 contains a large-window delta and it is small. */
+  SVN_ERR(svn_stringbuf_from_file2(&rev_contents,
+                                   svn_fs_fs__path_rev_absolute(fs, 2, pool),
+                                   pool));
+  SVN_TEST_INT_ASSERT(count_substring(rev_contents, "LWDELTA"), 1);
+  SVN_TEST_ASSERT(rev_contents->len < 200000);
+
+  SVN_ERR(svn_stringbuf_from_file2(&rev_contents,
+                                   svn_fs_fs__path_rev_absolute(fs, 3, pool),
+                                   pool));
+  SVN_TEST_INT_ASSERT(count_substring(rev_contents, "LWDELTA"), 0);
+
+  /* Reconstructing all versions must work.  To make sure we actually read
+   * from disk, use a new FS instance with disjoint caches. */
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                           svn_uuid_generate(pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+
+  for (i = 0; i < 3; ++i)
+    {
+      svn_stringbuf_t *str;
+
+      SVN_ERR(svn_fs_revision_root(&root, fs, i + 1, pool));
+      SVN_ERR(svn_test__get_file_contents(root, "foo", &str, pool));
+      SVN_TEST_ASSERT(svn_stringbuf_compare(str, contents[i]));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-large-window-format"
+
+static svn_error_t *
+large_window_format(const svn_test_opts_t *opts,
+                    apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_test_opts_t old_opts = *opts;
+  const char *config_path;
+  const char *config = "[" CONFIG_SECTION_DELTIFICATION "]\n"
+                       CONFIG_OPTION_LARGE_WINDOW_THRESHOLD " = 1\n";
+  int i;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  /* A 1.14-compatible repository must not use the large-window matcher,
+   * while the current format may. */
+  old_opts.server_minor_version = 14;
+  for (i = 0; i < 2; ++i)
+    {
+      SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, i ? opts : &old_opts,
+                                  pool));
+      config_path = svn_dirent_join(fs->path, PATH_CONFIG, pool);
+      SVN_ERR(svn_io_remove_file2(config_path, FALSE, pool));
+      SVN_ERR(svn_io_file_create(config_path, config, pool));
+
+      SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+      ffd = fs->fsap_data;
+      if (ffd->format >= SVN_FS_FS__MIN_LARGE_WINDOW_FORMAT)
+        SVN_TEST_ASSERT(ffd->large_window_threshold == 0x400);
+      else
+        SVN_TEST_ASSERT(ffd->large_window_threshold == 0);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-partial-window-cache"
+#define REVISIONS 8
+
+/* Return the delta chain statistics of FS in *STATS and reset them. */
+static svn_error_t *
+get_chain_stats(svn_fs_fs__chain_stats_t *stats,
+                svn_fs_t *fs,
+                apr_pool_t *pool)
+{
+  svn_fs_fs__ioctl_get_chain_stats_input_t input = { 0 };
+  svn_fs_fs__ioctl_get_chain_stats_output_t *output;
+
+  input.reset = TRUE;
+  SVN_ERR(svn_fs_ioctl(fs, SVN_FS_FS__IOCTL_GET_CHAIN_STATS, &input,
+                       (void **)&output, NULL, NULL, pool, pool));
+  *stats = output->stats;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+partial_window_cache(const svn_test_opts_t *opts,
+                     apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev = 0;
+  svn_stringbuf_t *contents[REVISIONS];
+  svn_stringbuf_t *str;
+  svn_fs_fs__chain_stats_t stats;
+  apr_hash_t *fs_config;
+  const char *config_path;
+  const char *config = "[" CONFIG_SECTION_CACHES "]\n"
+                       CONFIG_OPTION_PARTIAL_WINDOW_INTERVAL " = 0\n";
+  apr_uint32_t seed = 4321;
+  int i;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+  ffd = fs->fsap_data;
+  if (ffd->format < SVN_FS_FS__MIN_DELTIFICATION_FORMAT)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  /* A file of several delta windows with small changes in each revision,
+   * i.e. a linear delta chain where every window depends on its base. */
+  for (i = 0; i < REVISIONS; ++i)
+    {
+      if (i == 0)
+        {
+          contents[i] = random_letters(350000, &seed, pool);
+        }
+      else
+        {
+          int k;
+
+          contents[i] = svn_stringbuf_dup(contents[i - 1], pool);
+          for (k = 0; k < 4; ++k)
+            contents[i]->data[k * 90000 + i * 1000] = 'X';
+        }
+
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, pool));
+      SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+      if (i == 0)
+        SVN_ERR(svn_fs_make_file(root, "foo", pool));
+      SVN_ERR(svn_test__set_file_contents(root, "foo", contents[i]->data,
+                                          pool));
+      SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+    }
+
+  /* Use a new FS instance with disjoint caches and cache the partially
+   * composed windows of every delta. */
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                           svn_uuid_generate(pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+  ffd = fs->fsap_data;
+  ffd->partial_window_interval = 1;
+
+  /* Reading the next-to-last revision walks the whole chain. */
+  SVN_ERR(get_chain_stats(&stats, fs, pool));
+  SVN_ERR(svn_fs_revision_root(&root, fs, REVISIONS - 1, pool));
+  SVN_ERR(svn_test__get_file_contents(root, "foo", &str, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(str, contents[REVISIONS - 2]));
+
+  /* The file has 4 windows.  Directories may add to the counters. */
+  SVN_ERR(get_chain_stats(&stats, fs, pool));
+  SVN_TEST_ASSERT(stats.windows >= 4);
+  SVN_TEST_ASSERT(stats.links_walked >= 4 * (REVISIONS - 1));
+  SVN_TEST_ASSERT(stats.links_saved == 0);
+
+  /* Its successor only needs to apply its own delta. */
+  SVN_ERR(svn_fs_revision_root(&root, fs, REVISIONS, pool));
+  SVN_ERR(svn_test__get_file_contents(root, "foo", &str, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(str, contents[REVISIONS - 1]));
+
+  SVN_ERR(get_chain_stats(&stats, fs, pool));
+  if (ffd->partial_window_cache)
+    {
+      SVN_TEST_ASSERT(stats.partial_hits >= 4);
+      SVN_TEST_ASSERT(stats.chain_lengths[1] >= 4);
+      SVN_TEST_ASSERT(stats.links_saved >= 4 * (REVISIONS - 1));
+    }
+
+  /* Starting from the middle of the chain must work as well. */
+  for (i = REVISIONS; i > 0; --i)
+    {
+      SVN_ERR(svn_fs_revision_root(&root, fs, i, pool));
+      SVN_ERR(svn_test__get_file_contents(root, "foo", &str, pool));
+      SVN_TEST_ASSERT(svn_stringbuf_compare(str, contents[i - 1]));
+    }
+
+  /* By default, only every 4th delta counted from the chain's base gets
+   * cached.  The successor then starts from the 4th delta and has to
+   * apply the remaining 4 deltas on top of it. */
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                           svn_uuid_generate(pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+  ffd = fs->fsap_data;
+  SVN_TEST_ASSERT(ffd->partial_window_interval == 4);
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, REVISIONS - 1, pool));
+  SVN_ERR(svn_test__get_file_contents(root, "foo", &str, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(str, contents[REVISIONS - 2]));
+
+  SVN_ERR(get_chain_stats(&stats, fs, pool));
+  SVN_ERR(svn_fs_revision_root(&root, fs, REVISIONS, pool));
+  SVN_ERR(svn_test__get_file_contents(root, "foo", &str, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(str, contents[REVISIONS - 1]));
+
+  SVN_ERR(get_chain_stats(&stats, fs, pool));
+  if (ffd->partial_window_cache)
+    {
+      SVN_TEST_ASSERT(stats.partial_hits >= 4);
+      SVN_TEST_ASSERT(stats.chain_lengths[4] >= 4);
+      SVN_TEST_ASSERT(stats.links_saved >= 4 * (REVISIONS - 4));
+    }
+
+  /* 0 disables the cache. */
+  config_path = svn_dirent_join(fs->path, PATH_CONFIG, pool);
+  SVN_ERR(svn_io_remove_file2(config_path, FALSE, pool));
+  SVN_ERR(svn_io_file_create(config_path, config, pool));
+
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+  ffd = fs->fsap_data;
+  SVN_TEST_ASSERT(ffd->partial_window_cache == NULL);
+
+  for (i = REVISIONS; i > 0; --i)
+    {
+      SVN_ERR(svn_fs_revision_root(&root, fs, i, pool));
+      SVN_ERR(svn_test__get_file_contents(root, "foo", &str, pool));
+      SVN_TEST_ASSERT(svn_stringbuf_compare(str, contents[i - 1]));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef REVISIONS
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-content-chunking"
+#define SHARD_SIZE 2
+
+static svn_error_t *
+content_chunking(const svn_test_opts_t *opts,
+                 apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  svn_stringbuf_t *contents[5];
+  svn_stringbuf_t *rev_contents[2];
+  svn_stringbuf_t *pack_contents;
+  apr_size_t first, second;
+  svn_stringbuf_t *str;
+  svn_fs_fs__ioctl_get_stats_input_t input = { 0 };
+  svn_fs_fs__ioctl_get_stats_output_t *output;
+  svn_fs_fs__chunking_stats_t *stats;
+  apr_hash_t *fs_config;
+  apr_uint32_t seed = 5678;
+  int i;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_SHARD_SIZE,
+                apr_itoa(pool, SHARD_SIZE));
+  SVN_ERR(svn_test__create_fs2(&fs, REPO_NAME, opts, fs_config, pool));
+  ffd = fs->fsap_data;
+  if (   ffd->format < SVN_FS_FS__MIN_CONTENT_CHUNKING_FORMAT
+      || !ffd->use_log_addressing
+      || !ffd->rep_sharing_allowed)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  ffd->content_chunking_threshold = 0x10000;
+
+  /* 1MB of incompressible text, then insert 1000 bytes in the middle and
+   * finally change a single byte elsewhere. */
+  contents[0] = random_letters(1000000, &seed, pool);
+  contents[1] = svn_stringbuf_dup(contents[0], pool);
+  str = random_letters(1000, &seed, pool);
+  svn_stringbuf_insert(contents[1], 500000, str->data, str->len);
+  contents[2] = svn_stringbuf_dup(contents[1], pool);
+  contents[2]->data[200000] = 'X';
+
+  /* Revision 1: the original file. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_make_file(root, "foo", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "foo", contents[0]->data, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* Revision 2: the insertion plus a copy of the original contents. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(root, "foo", contents[1]->data, pool));
+  SVN_ERR(svn_fs_make_file(root, "bar", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "bar", contents[0]->data, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* Revision 3: the single byte change. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(root, "foo", contents[2]->data, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* Only the chunks around the changes got stored again. */
+  for (i = 0; i < 2; ++i)
+    SVN_ERR(svn_stringbuf_from_file2(&rev_contents[i],
+                                     svn_fs_fs__path_rev_absolute(fs, i + 1,
+                                                                  pool),
+                                     pool));
+  SVN_TEST_INT_ASSERT(count_substring(rev_contents[0], "CHUNKED"), 1);
+  SVN_TEST_INT_ASSERT(count_substring(rev_contents[1], "CHUNKED"), 1);
+  SVN_TEST_ASSERT(rev_contents[1]->len < rev_contents[0]->len / 2);
+
+  /* Chunks must survive packing. */
+  SVN_ERR(svn_fs_pack2(REPO_NAME, 1, NULL, NULL, NULL, NULL, pool));
+  SVN_ERR(svn_fs_verify2(REPO_NAME, NULL, 0, rev, 1, NULL, NULL, NULL, NULL,
+                         pool));
+
+  /* Reconstructing all versions must work.  To make sure we actually read
+   * from disk, use a new FS instance with disjoint caches. */
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                           svn_uuid_generate(pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+
+  for (i = 0; i < 3; ++i)
+    {
+      SVN_ERR(svn_fs_revision_root(&root, fs, i + 1, pool));
+      SVN_ERR(svn_test__get_file_contents(root, "foo", &str, pool));
+      SVN_TEST_ASSERT(svn_stringbuf_compare(str, contents[i]));
+    }
+
+  SVN_ERR(svn_test__get_file_contents(root, "bar", &str, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(str, contents[0]));
+
+  /* "bar" shares the rep of r1 as a whole. */
+  SVN_ERR(svn_fs_ioctl(fs, SVN_FS_FS__IOCTL_GET_STATS, &input,
+                       (void **)&output, NULL, NULL, pool, pool));
+  stats = &output->stats->chunking_stats;
+  SVN_TEST_ASSERT(stats->rep_count == 3);
+  SVN_TEST_ASSERT(stats->expanded_size == 3002000);
+  SVN_TEST_ASSERT(stats->chunk_refs > stats->chunk_count);
+  SVN_TEST_ASSERT(stats->chunk_expanded_size < 1500000);
+
+  /* Revision 4: a chunked rep that gets replaced within its txn. */
+  ffd = fs->fsap_data;
+  ffd->content_chunking_threshold = 0x10000;
+  contents[3] = random_letters(300000, &seed, pool);
+  contents[4] = random_letters(300000, &seed, pool);
+
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_make_file(root, "baz", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "baz", contents[3]->data, pool));
+  SVN_ERR(svn_test__set_file_contents(root, "baz", contents[4]->data, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* Revision 5: share the chunks of the replaced rep. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_make_file(root, "qux", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "qux", contents[3]->data, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* The replaced CHUNKED rep gets dropped but its chunks must be kept.
+   * The other chunks directly follow their CHUNKED reps. */
+  SVN_ERR(svn_fs_pack2(REPO_NAME, 1, NULL, NULL, NULL, NULL, pool));
+  SVN_ERR(svn_stringbuf_from_file2(&pack_contents,
+                                   svn_fs_fs__path_rev_packed(fs, rev,
+                                                              PATH_PACKED,
+                                                              pool),
+                                   pool));
+  SVN_TEST_INT_ASSERT(count_substring(pack_contents, "CHUNKED\n"), 2);
+
+  first = find_substring(pack_contents, "CHUNKED\n", 0);
+  second = find_substring(pack_contents, "CHUNKED\n", first + 1);
+  SVN_TEST_ASSERT(find_substring(pack_contents, "DELTA\n", first) < second);
+  SVN_TEST_ASSERT(find_substring(pack_contents, "DELTA\n", second)
+                  < pack_contents->len);
+
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                           svn_uuid_generate(pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev, pool));
+  SVN_ERR(svn_test__get_file_contents(root, "baz", &str, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(str, contents[4]));
+  SVN_ERR(svn_test__get_file_contents(root, "qux", &str, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(str, contents[3]));
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef SHARD_SIZE
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-content-chunking-abort"
+#define SHARD_SIZE 2
+
+static svn_error_t *
+content_chunking_abort(const svn_test_opts_t *opts,
+                       apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  svn_stringbuf_t *contents[2];
+  svn_stringbuf_t *str;
+  svn_stream_t *stream;
+  apr_pool_t *subpool;
+  apr_size_t len;
+  apr_hash_t *fs_config;
+  apr_uint32_t seed = 2468;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_SHARD_SIZE,
+                apr_itoa(pool, SHARD_SIZE));
+  SVN_ERR(svn_test__create_fs2(&fs, REPO_NAME, opts, fs_config, pool));
+  ffd = fs->fsap_data;
+  if (   ffd->format < SVN_FS_FS__MIN_CONTENT_CHUNKING_FORMAT
+      || !ffd->use_log_addressing
+      || !ffd->rep_sharing_allowed)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  ffd->content_chunking_threshold = 0x10000;
+  contents[0] = random_letters(300000, &seed, pool);
+  contents[1] = random_letters(300000, &seed, pool);
+
+  /* Revision 1: abort writing a chunked rep after all but its last chunk
+   * got written.  Then store other contents in the same txn. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_make_file(root, "foo", pool));
+
+  subpool = svn_pool_create(pool);
+  SVN_ERR(svn_fs_apply_text(&stream, root, "foo", NULL, subpool));
+  len = contents[0]->len;
+  SVN_ERR(svn_stream_write(stream, contents[0]->data, &len));
+  svn_pool_destroy(subpool);
+
+  SVN_ERR(svn_test__set_file_contents(root, "foo", contents[1]->data, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* The orphaned chunks are still in the rev file but nothing refers to
+   * them.  Complete the shard and pack it. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_make_dir(root, "dir", pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  SVN_ERR(svn_fs_pack2(REPO_NAME, 1, NULL, NULL, NULL, NULL, pool));
+
+  /* Revision 3: store the aborted contents.  This must not share any of
+   * the chunks that packing dropped. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_make_file(root, "bar", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "bar", contents[0]->data, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  SVN_ERR(svn_fs_verify2(REPO_NAME, NULL, 0, rev, 1, NULL, NULL, NULL, NULL,
+                         pool));
+
+  /* Read from disk using a new FS instance with disjoint caches. */
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                           svn_uuid_generate(pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev, pool));
+  SVN_ERR(svn_test__get_file_contents(root, "foo", &str, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(str, contents[1]));
+  SVN_ERR(svn_test__get_file_contents(root, "bar", &str, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(str, contents[0]));
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef SHARD_SIZE
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-content-chunking-format"
+
+static svn_error_t *
+content_chunking_format(const svn_test_opts_t *opts,
+                        apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_test_opts_t old_opts = *opts;
+  const char *config_path;
+  const char *config = "[" CONFIG_SECTION_REP_SHARING "]\n"
+                       CONFIG_OPTION_CONTENT_CHUNKING_THRESHOLD " = 1\n";
+  int i;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  /* A 1.14-compatible repository must not store "CHUNKED" reps, while
+   * the current format may. */
+  old_opts.server_minor_version = 14;
+  for (i = 0; i < 2; ++i)
+    {
+      SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, i ? opts : &old_opts,
+                                  pool));
+      config_path = svn_dirent_join(fs->path, PATH_CONFIG, pool);
+      SVN_ERR(svn_io_remove_file2(config_path, FALSE, pool));
+      SVN_ERR(svn_io_file_create(config_path, config, pool));
+
+      SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+      ffd = fs->fsap_data;
+      if (   ffd->format >= SVN_FS_FS__MIN_CONTENT_CHUNKING_FORMAT
+          && ffd->use_log_addressing)
+        SVN_TEST_ASSERT(ffd->content_chunking_threshold == 0x400);
+      else
+        SVN_TEST_ASSERT(ffd->content_chunking_threshold == 0);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
 
 
 /* The test table.  */
@@ -1943,6 +3304,32 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "pack with limited memory for metadata"),
     SVN_TEST_OPTS_PASS(large_delta_against_plain,
                        "large deltas against PLAIN, issue #4658"),
+    SVN_TEST_OPTS_PASS(read_packed_fs_mmap,
+                       "read from a packed FSFS filesystem using mmap"),
+    SVN_TEST_OPTS_PASS(read_packed_fs_prefetch,
+                       "read from a packed FSFS filesystem with prefetch"),
+    SVN_TEST_OPTS_PASS(pack_concurrently,
+                       "pack multiple FSFS shards concurrently"),
+    SVN_TEST_OPTS_PASS(pack_concurrently_cancel,
+                       "cancel packing FSFS shards concurrently"),
+    SVN_TEST_OPTS_PASS(hotcopy_concurrently,
+                       "hotcopy FSFS shards concurrently"),
+    SVN_TEST_OPTS_PASS(large_directory_blocks,
+                       "store very large directories in blocks"),
+    SVN_TEST_OPTS_SKIP(large_directory_benchmark, TRUE,
+                       "optional benchmark for 1M entry directories"),
+    SVN_TEST_OPTS_PASS(large_window_deltas,
+                       "large-window deltas for big, shifted files"),
+    SVN_TEST_OPTS_PASS(large_window_format,
+                       "large-window deltas require format 9"),
+    SVN_TEST_OPTS_PASS(partial_window_cache,
+                       "reuse partially composed delta windows"),
+    SVN_TEST_OPTS_PASS(content_chunking,
+                       "share identical chunks of large files"),
+    SVN_TEST_OPTS_PASS(content_chunking_abort,
+                       "don't share chunks of aborted writes"),
+    SVN_TEST_OPTS_PASS(content_chunking_format,
+                       "content chunking requires format 9"),
     SVN_TEST_NULL
   };
 
@@ -34,7 +34,9 @@
 #include "private/svn_fs_fs_private.h"
 #include "private/svn_subr_private.h"
 
+#include "../../libsvn_fs_fs/cached_data.h"
 #include "../../libsvn_fs_fs/index.h"
+#include "../../libsvn_fs_fs/path-index.h"
 #include "../../libsvn_fs_fs/rep-cache.h"
 #include "../../libsvn_fs/fs-loader.h"
 
@@ -424,8 +426,8 @@ load_index(const svn_test_opts_t *opts, apr_pool_t *pool)
   SVN_ERR(svn_fs_ioctl(svn_repos_fs(repos), SVN_FS_FS__IOCTL_LOAD_INDEX,
                        &load_input, NULL, NULL, NULL, pool, pool));
 
-  SVN_TEST_ASSERT_ERROR(svn_repos_verify_fs3(repos, rev, rev, FALSE, FALSE,
-                                             NULL, NULL, NULL, NULL, NULL,
+  SVN_TEST_ASSERT_ERROR(svn_repos_verify_fs4(repos, rev, rev, FALSE, FALSE,
+                                             1, NULL, NULL, NULL, NULL, NULL,
                                              NULL, pool),
                         SVN_ERR_FS_INDEX_CORRUPTION);
 
@@ -434,7 +436,7 @@ load_index(const svn_test_opts_t *opts, apr_pool_t *pool)
   load_input.entries = entries;
   SVN_ERR(svn_fs_ioctl(svn_repos_fs(repos), SVN_FS_FS__IOCTL_LOAD_INDEX,
                        &load_input, NULL, NULL, NULL, pool, pool));
-  SVN_ERR(svn_repos_verify_fs3(repos, rev, rev, FALSE, FALSE, NULL, NULL,
+  SVN_ERR(svn_repos_verify_fs4(repos, rev, rev, FALSE, FALSE, 1, NULL, NULL,
                                NULL, NULL, NULL, NULL, pool));
 
   return SVN_NO_ERROR;
@@ -493,12 +495,334 @@ build_rep_cache(const svn_test_opts_t *opts, apr_pool_t *pool)
   SVN_ERR(svn_fs_fs__exists_rep_cache(&exists, fs, pool));
   SVN_TEST_ASSERT(exists);
 
-  SVN_ERR(svn_fs_verify(fs_path, NULL, 0, SVN_INVALID_REVNUM,
-                        NULL, NULL, NULL, NULL, pool));
+  SVN_ERR(svn_fs_verify2(fs_path, NULL, 0, SVN_INVALID_REVNUM, 1,
+                         NULL, NULL, NULL, NULL, pool));
 
   return SVN_NO_ERROR;
 }
 
+/* ------------------------------------------------------------------------ */
+
+/* Verify that the changed-path index in FS lists exactly the EXPECTED
+ * revisions, terminated by SVN_INVALID_REVNUM, for PATH in START to END.
+ * Use POOL for allocations. */
+static svn_error_t *
+check_path_revisions(svn_fs_t *fs,
+                     const char *path,
+                     svn_revnum_t start,
+                     svn_revnum_t end,
+                     const svn_revnum_t *expected,
+                     apr_pool_t *pool)
+{
+  svn_fs_fs__ioctl_path_revisions_input_t input;
+  svn_fs_fs__ioctl_path_revisions_output_t *output;
+  int i;
+
+  input.path = path;
+  input.start = start;
+  input.end = end;
+  SVN_ERR(svn_fs_ioctl(fs, SVN_FS_FS__IOCTL_PATH_REVISIONS,
+                       &input, (void **)&output, NULL, NULL, pool, pool));
+  SVN_TEST_ASSERT(output->revisions);
+
+  for (i = 0; SVN_IS_VALID_REVNUM(expected[i]); ++i)
+    {
+      SVN_TEST_ASSERT(i < output->revisions->nelts);
+      SVN_TEST_INT_ASSERT(APR_ARRAY_IDX(output->revisions, i, svn_revnum_t),
+                          expected[i]);
+    }
+
+  SVN_TEST_INT_ASSERT(output->revisions->nelts, i);
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+build_path_index(const svn_test_opts_t *opts, apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  svn_revnum_t rev;
+  svn_boolean_t exists;
+  svn_fs_fs__ioctl_path_revisions_input_t query = {0};
+  svn_fs_fs__ioctl_path_revisions_output_t *output;
+  svn_fs_fs__ioctl_build_path_index_input_t input = {0};
+  const svn_revnum_t e_revs[] = { 1, 3, SVN_INVALID_REVNUM };
+  const svn_revnum_t d_revs[] = { 1, 2, SVN_INVALID_REVNUM };
+  const svn_revnum_t iota_revs[] = { 1, 4, SVN_INVALID_REVNUM };
+  const svn_revnum_t root_revs[] = { 1, 2, 3, 4, SVN_INVALID_REVNUM };
+
+  /* Bail (with success) on known-untestable scenarios */
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this will test FSFS repositories only");
+
+  SVN_ERR(svn_test__create_fs2(&fs, "test-repo-build-path-index", opts,
+                               NULL, pool));
+
+  /* r1: Add the Greek tree. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+  SVN_TEST_ASSERT(SVN_IS_VALID_REVNUM(rev));
+
+  /* r2: Modify a file in A/D. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "A/D/G/pi",
+                                      "new pi\n", pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* r3: Delete A/B/E. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_fs_delete(txn_root, "A/B/E", pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* Without an index, there is no result. */
+  SVN_ERR(svn_fs_fs__exists_path_index(&exists, fs, pool));
+  SVN_TEST_ASSERT(!exists);
+
+  query.path = "/A";
+  query.start = 1;
+  query.end = rev;
+  SVN_ERR(svn_fs_ioctl(fs, SVN_FS_FS__IOCTL_PATH_REVISIONS,
+                       &query, (void **)&output, NULL, NULL, pool, pool));
+  SVN_TEST_ASSERT(output->revisions == NULL);
+
+  /* Build the index and check it. */
+  SVN_ERR(svn_fs_ioctl(fs, SVN_FS_FS__IOCTL_BUILD_PATH_INDEX,
+                       &input, NULL, NULL, NULL, pool, pool));
+  SVN_ERR(svn_fs_fs__exists_path_index(&exists, fs, pool));
+  SVN_TEST_ASSERT(exists);
+
+  SVN_ERR(check_path_revisions(fs, "/A/B/E", 1, rev, e_revs, pool));
+  SVN_ERR(check_path_revisions(fs, "/A/B/E/alpha", 1, rev, e_revs, pool));
+  SVN_ERR(check_path_revisions(fs, "/A/D", 1, rev, d_revs, pool));
+  SVN_ERR(check_path_revisions(fs, "/A/D", 2, rev, d_revs + 1, pool));
+
+  /* r4: Modify iota.  The commit must update the index. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "iota", "new iota\n",
+                                      pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  SVN_ERR(check_path_revisions(fs, "/iota", 1, rev, iota_revs, pool));
+  SVN_ERR(check_path_revisions(fs, "/A/D", 1, rev, d_revs, pool));
+  SVN_ERR(check_path_revisions(fs, "/", 1, rev, root_revs, pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-rep-cache-filter"
+
+/* Commit COUNT files with unique contents in REVISION to FS, based on
+ * the youngest revision.  Use POOL for allocations. */
+static svn_error_t *
+add_unique_files(svn_fs_t *fs,
+                 svn_revnum_t revision,
+                 int count,
+                 apr_pool_t *pool)
+{
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  svn_revnum_t rev;
+  int i;
+
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, revision - 1, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  for (i = 0; i < count; ++i)
+    {
+      const char *path = apr_psprintf(pool, "file-%ld-%d", revision, i);
+      SVN_ERR(svn_fs_make_file(txn_root, path, pool));
+      SVN_ERR(svn_test__set_file_contents(txn_root, path,
+                                          apr_psprintf(pool,
+                                                       "content %ld %d\n",
+                                                       revision, i),
+                                          pool));
+    }
+
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+  SVN_TEST_INT_ASSERT(rev, revision);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+rep_cache_filter(const svn_test_opts_t *opts, apr_pool_t *pool)
+{
+  svn_fs_t *fs, *other_fs;
+  fs_fs_data_t *ffd;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root, *root;
+  svn_revnum_t rev;
+  const svn_fs_id_t *id;
+  node_revision_t *noderev;
+  apr_hash_t *fs_config = apr_hash_make(pool);
+
+  /* Bail (with success) on known-untestable scenarios */
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this will test FSFS repositories only");
+
+  if (opts->server_minor_version && (opts->server_minor_version < 6))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "pre-1.6 SVN doesn't support FSFS rep-sharing");
+
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_REP_CACHE_FILTER, "1");
+  SVN_ERR(svn_test__create_fs2(&fs, REPO_NAME, opts, fs_config, pool));
+  ffd = fs->fsap_data;
+  SVN_TEST_ASSERT(ffd->rep_cache_filter_enabled);
+
+  /* r1 .. r3: Unique contents only.  None of them needs to consult the
+     rep-cache database. */
+  SVN_ERR(add_unique_files(fs, 1, 20, pool));
+  SVN_ERR(add_unique_files(fs, 2, 20, pool));
+  SVN_ERR(add_unique_files(fs, 3, 20, pool));
+
+  SVN_TEST_ASSERT(ffd->rep_cache_filter);
+  SVN_TEST_INT_ASSERT(ffd->rep_cache_filter->revision, 3);
+  SVN_TEST_INT_ASSERT(ffd->rep_cache_filter->lookups, 60);
+  SVN_TEST_INT_ASSERT(ffd->rep_cache_filter->negatives, 60);
+
+  /* r4: Duplicate content must still be found and shared. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 3, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_fs_make_file(txn_root, "dup", pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "dup", "content 2 7\n",
+                                      pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  SVN_TEST_INT_ASSERT(ffd->rep_cache_filter->lookups, 61);
+  SVN_TEST_INT_ASSERT(ffd->rep_cache_filter->negatives, 60);
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev, pool));
+  SVN_ERR(svn_fs_node_id(&id, root, "dup", pool));
+  SVN_ERR(svn_fs_fs__get_node_revision(&noderev, fs, id, pool, pool));
+  SVN_TEST_INT_ASSERT(noderev->data_rep->revision, 2);
+
+  /* r5: Committed through another FS instance.  The filter does not
+     know about the new reps, so the next lookup must stop using it. */
+  SVN_ERR(svn_fs_open2(&other_fs, REPO_NAME, NULL, pool, pool));
+  SVN_ERR(add_unique_files(other_fs, 5, 1, pool));
+
+  SVN_ERR(svn_fs_youngest_rev(&rev, fs, pool));
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_fs_make_file(txn_root, "dup2", pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "dup2", "content 5 0\n",
+                                      pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  SVN_TEST_ASSERT(ffd->rep_cache_filter == NULL);
+  SVN_TEST_ASSERT(!ffd->rep_cache_filter_enabled);
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev, pool));
+  SVN_ERR(svn_fs_node_id(&id, root, "dup2", pool));
+  SVN_ERR(svn_fs_fs__get_node_revision(&noderev, fs, id, pool, pool));
+  SVN_TEST_INT_ASSERT(noderev->data_rep->revision, 5);
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-rep-cache-filter-skip"
+#define LOOKUP_COUNT 1000
+
+static svn_error_t *
+rep_cache_filter_skip(const svn_test_opts_t *opts, apr_pool_t *pool)
+{
+  svn_fs_t *fs, *other_fs;
+  fs_fs_data_t *ffd;
+  apr_hash_t *fs_config = apr_hash_make(pool);
+  svn_checksum_t **checksums;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  representation_t *rep;
+  apr_uint64_t entries;
+  int i;
+
+  /* Bail (with success) on known-untestable scenarios */
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this will test FSFS repositories only");
+
+  if (opts->server_minor_version && (opts->server_minor_version < 6))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "pre-1.6 SVN doesn't support FSFS rep-sharing");
+
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_REP_CACHE_FILTER, "1");
+  SVN_ERR(svn_test__create_fs2(&fs, REPO_NAME, opts, fs_config, pool));
+  ffd = fs->fsap_data;
+
+  /* r1 makes FS build its filter. */
+  SVN_ERR(add_unique_files(fs, 1, 20, pool));
+  SVN_TEST_ASSERT(ffd->rep_cache_filter);
+  SVN_TEST_INT_ASSERT(ffd->rep_cache_filter->lookups, 20);
+
+  /* Add rep-cache entries behind FS' back without adding a revision.
+     FS' filter does not know about them but will still be considered
+     up-to-date. */
+  SVN_ERR(svn_fs_open2(&other_fs, REPO_NAME, NULL, pool, pool));
+  checksums = apr_pcalloc(pool, LOOKUP_COUNT * sizeof(*checksums));
+  for (i = 0; i < LOOKUP_COUNT; ++i)
+    {
+      const char *data = apr_psprintf(pool, "not in r1 %d", i);
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_checksum(&checksums[i], svn_checksum_sha1, data,
+                           strlen(data), pool));
+
+      rep = apr_pcalloc(iterpool, sizeof(*rep));
+      memcpy(rep->sha1_digest, checksums[i]->digest,
+             sizeof(rep->sha1_digest));
+      rep->has_sha1 = TRUE;
+      rep->revision = 1;
+      rep->item_index = 1;
+      rep->size = strlen(data);
+      rep->expanded_size = strlen(data);
+      SVN_ERR(svn_fs_fs__set_rep_reference(other_fs, rep, iterpool));
+    }
+
+  /* The database has all of them but FS must not even look. */
+  for (i = 0; i < LOOKUP_COUNT; ++i)
+    {
+      svn_pool_clear(iterpool);
+
+      SVN_ERR(svn_fs_fs__get_rep_reference(&rep, other_fs, checksums[i],
+                                           iterpool));
+      SVN_TEST_ASSERT(rep);
+
+      SVN_ERR(svn_fs_fs__get_rep_reference(&rep, fs, checksums[i],
+                                           iterpool));
+      SVN_TEST_ASSERT(rep == NULL);
+    }
+
+  SVN_TEST_ASSERT(ffd->rep_cache_filter_enabled);
+  SVN_TEST_INT_ASSERT(ffd->rep_cache_filter->lookups, 20 + LOOKUP_COUNT);
+  SVN_TEST_INT_ASSERT(ffd->rep_cache_filter->negatives, 20 + LOOKUP_COUNT);
+
+  /* Adding the same rep again must not fill the filter. */
+  SVN_ERR(svn_fs_fs__get_rep_reference(&rep, other_fs, checksums[0], pool));
+  entries = ffd->rep_cache_filter->entries;
+  SVN_ERR(svn_fs_fs__set_rep_reference(fs, rep, pool));
+  SVN_ERR(svn_fs_fs__set_rep_reference(fs, rep, pool));
+  SVN_TEST_INT_ASSERT(ffd->rep_cache_filter->entries, entries + 1);
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+#undef LOOKUP_COUNT
+#undef REPO_NAME
+
 
 
 /* The test table.  */
@@ -516,6 +840,12 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "load the P2L index"),
     SVN_TEST_OPTS_PASS(build_rep_cache,
                        "build the representation cache"),
+    SVN_TEST_OPTS_PASS(build_path_index,
+                       "build and maintain the changed-path index"),
+    SVN_TEST_OPTS_PASS(rep_cache_filter,
+                       "filter rep-cache lookups"),
+    SVN_TEST_OPTS_PASS(rep_cache_filter_skip,
+                       "rep-cache filter skips database lookups"),
     SVN_TEST_NULL
   };
 
@@ -4468,6 +4468,300 @@ test_list(const svn_test_opts_t *opts,
   return SVN_NO_ERROR;
 }
 
+/* Baton for verify_notify(). */
+typedef struct verify_notify_baton_t
+{
+  /* Next revision expected to be reported as verified. */
+  svn_revnum_t expected_rev;
+
+  /* Whether we received the final notification. */
+  svn_boolean_t done;
+} verify_notify_baton_t;
+
+/* Implements svn_repos_notify_func_t.  Check that revisions get reported
+   in order. */
+static void
+verify_notify(void *baton,
+              const svn_repos_notify_t *notify,
+              apr_pool_t *scratch_pool)
+{
+  verify_notify_baton_t *vnb = baton;
+
+  if (notify->action == svn_repos_notify_verify_rev_end)
+    {
+      if (notify->revision == vnb->expected_rev)
+        vnb->expected_rev++;
+      else
+        vnb->expected_rev = SVN_INVALID_REVNUM;
+    }
+  else if (notify->action == svn_repos_notify_verify_end)
+    {
+      vnb->done = TRUE;
+    }
+}
+
+/* Create a repository called NAME with OPTS, containing the greek tree
+   in r1 and enough further revisions for several rounds of verification
+   jobs.  Return it in *REPOS and its youngest revision in *YOUNGEST_REV.
+   Use POOL for allocations. */
+static svn_error_t *
+create_verify_repos(svn_repos_t **repos,
+                    svn_revnum_t *youngest_rev,
+                    const char *name,
+                    const svn_test_opts_t *opts,
+                    apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i;
+
+  SVN_ERR(svn_test__create_repos(repos, name, opts, pool));
+  fs = svn_repos_fs(*repos);
+
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, *repos, youngest_rev, txn, pool));
+
+  for (i = 0; i < 50; ++i)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, *youngest_rev, iterpool));
+      SVN_ERR(svn_fs_txn_root(&txn_root, txn, iterpool));
+      SVN_ERR(svn_test__set_file_contents(txn_root, "iota",
+                                          apr_psprintf(iterpool,
+                                                       "iota %d\n", i),
+                                          iterpool));
+      SVN_ERR(svn_repos_fs_commit_txn(NULL, *repos, youngest_rev, txn,
+                                      iterpool));
+    }
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_verify_concurrently(const svn_test_opts_t *opts,
+                         apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_revnum_t youngest_rev;
+  verify_notify_baton_t vnb;
+
+  SVN_ERR(create_verify_repos(&repos, &youngest_rev,
+                              "test-repo-verify-concurrently", opts, pool));
+
+  /* All revisions must be verified and reported in order. */
+  vnb.expected_rev = 0;
+  vnb.done = FALSE;
+  SVN_ERR(svn_repos_verify_fs4(repos, SVN_INVALID_REVNUM, SVN_INVALID_REVNUM,
+                               FALSE, FALSE, 3, verify_notify, &vnb,
+                               NULL, NULL, NULL, NULL, pool));
+  SVN_TEST_ASSERT(vnb.expected_rev == youngest_rev + 1);
+  SVN_TEST_ASSERT(vnb.done);
+
+  /* Same for a sub-range. */
+  vnb.expected_rev = 5;
+  vnb.done = FALSE;
+  SVN_ERR(svn_repos_verify_fs4(repos, 5, 40, FALSE, FALSE, 4,
+                               verify_notify, &vnb, NULL, NULL, NULL, NULL,
+                               pool));
+  SVN_TEST_ASSERT(vnb.expected_rev == 41);
+  SVN_TEST_ASSERT(vnb.done);
+
+  return SVN_NO_ERROR;
+}
+
+/* A revision reported by svn_repos_verify_fs4(). */
+typedef struct verify_event_t
+{
+  /* The revision, SVN_INVALID_REVNUM for repository metadata. */
+  svn_revnum_t revision;
+
+  /* The error code reported for it, 0 if it has been verified. */
+  apr_status_t apr_err;
+} verify_event_t;
+
+/* Implements svn_repos_notify_func_t.  Append successfully verified
+   revisions to the verify_event_t array in BATON. */
+static void
+record_verify_notify(void *baton,
+                     const svn_repos_notify_t *notify,
+                     apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *events = baton;
+
+  if (notify->action == svn_repos_notify_verify_rev_end)
+    {
+      verify_event_t *event = apr_array_push(events);
+      event->revision = notify->revision;
+      event->apr_err = 0;
+    }
+}
+
+/* Implements svn_repos_verify_callback_t.  Append failed revisions to the
+   verify_event_t array in BATON and keep going. */
+static svn_error_t *
+record_verify_error(void *baton,
+                    svn_revnum_t revision,
+                    svn_error_t *verify_err,
+                    apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *events = baton;
+  verify_event_t *event = apr_array_push(events);
+
+  event->revision = revision;
+  event->apr_err = verify_err->apr_err;
+
+  return SVN_NO_ERROR;
+}
+
+/* Verify the repository at PATH with JOBS and record the outcome in
+   *EVENTS.  If KEEP_GOING is not set, return the error that stopped the
+   verification in *ERR.  Allocate the results in POOL. */
+static svn_error_t *
+record_verification(apr_array_header_t **events,
+                    svn_error_t **err,
+                    const char *path,
+                    int jobs,
+                    svn_boolean_t keep_going,
+                    apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  apr_hash_t *fs_config = apr_hash_make(pool);
+
+  /* Don't let cached data hide the corruption. */
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                svn_uuid_generate(pool));
+  SVN_ERR(svn_repos_open3(&repos, path, fs_config, pool, pool));
+
+  *events = apr_array_make(pool, 0, sizeof(verify_event_t));
+  *err = svn_repos_verify_fs4(repos, SVN_INVALID_REVNUM, SVN_INVALID_REVNUM,
+                              FALSE, FALSE, jobs,
+                              record_verify_notify, *events,
+                              keep_going ? record_verify_error : NULL,
+                              *events, NULL, NULL, pool);
+
+  if (keep_going)
+    SVN_ERR(*err);
+
+  return SVN_NO_ERROR;
+}
+
+/* Return TRUE if the verify_event_t arrays LHS and RHS are equal. */
+static svn_boolean_t
+verify_events_equal(const apr_array_header_t *lhs,
+                    const apr_array_header_t *rhs)
+{
+  int i;
+
+  if (lhs->nelts != rhs->nelts)
+    return FALSE;
+
+  for (i = 0; i < lhs->nelts; ++i)
+    {
+      const verify_event_t *l = &APR_ARRAY_IDX(lhs, i, verify_event_t);
+      const verify_event_t *r = &APR_ARRAY_IDX(rhs, i, verify_event_t);
+
+      if (l->revision != r->revision || l->apr_err != r->apr_err)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+#define CORRUPT_REV 17
+static svn_error_t *
+test_verify_concurrently_corrupted(const svn_test_opts_t *opts,
+                                   apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_revnum_t youngest_rev;
+  apr_array_header_t *expected, *actual;
+  svn_error_t *expected_err, *actual_err;
+  apr_file_t *file;
+  const char *repos_path;
+  const char *path;
+  const char junk[] = "inserting junk to corrupt the rev";
+  svn_revnum_t last_rev = SVN_INVALID_REVNUM;
+  svn_boolean_t found = FALSE;
+  int i;
+
+  /* We need to know the rev file layout to corrupt it. */
+  if (strcmp(opts->fs_type, SVN_FS_TYPE_FSFS) != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this will test FSFS repositories only");
+  if (opts->server_minor_version && opts->server_minor_version < 6)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "pre-1.6 SVN doesn't use sharded rev files");
+
+  SVN_ERR(create_verify_repos(&repos, &youngest_rev,
+                              "test-repo-verify-concurrently-corrupted",
+                              opts, pool));
+  repos_path = svn_repos_path(repos, pool);
+
+  path = svn_dirent_join_many(pool, svn_fs_path(svn_repos_fs(repos), pool),
+                              "revs", "0",
+                              apr_psprintf(pool, "%d", CORRUPT_REV),
+                              SVN_VA_NULL);
+  SVN_ERR(svn_io_set_file_read_write(path, FALSE, pool));
+  SVN_ERR(svn_io_file_open(&file, path, APR_WRITE, APR_OS_DEFAULT, pool));
+  SVN_ERR(svn_io_file_write_full(file, junk, sizeof(junk) - 1, NULL, pool));
+  SVN_ERR(svn_io_file_close(file, pool));
+
+  /* With --keep-going, parallel verification must report the very same
+   * revisions and errors in the very same order as the sequential one. */
+  SVN_ERR(record_verification(&expected, &expected_err, repos_path, 1,
+                              TRUE, pool));
+  SVN_ERR(record_verification(&actual, &actual_err, repos_path, 3,
+                              TRUE, pool));
+  SVN_TEST_ASSERT(verify_events_equal(expected, actual));
+
+  /* Every revision gets reported once, in order, and the corrupted one
+   * has failed. */
+  for (i = 0; i < actual->nelts; ++i)
+    {
+      verify_event_t *event = &APR_ARRAY_IDX(actual, i, verify_event_t);
+      if (!SVN_IS_VALID_REVNUM(event->revision))
+        {
+          /* Metadata errors come first. */
+          SVN_TEST_ASSERT(last_rev == SVN_INVALID_REVNUM);
+          continue;
+        }
+
+      SVN_TEST_ASSERT(event->revision
+                      == (SVN_IS_VALID_REVNUM(last_rev) ? last_rev + 1 : 0));
+      last_rev = event->revision;
+
+      if (event->revision == CORRUPT_REV)
+        {
+          SVN_TEST_ASSERT(event->apr_err != 0);
+          found = TRUE;
+        }
+    }
+
+  SVN_TEST_ASSERT(found);
+  SVN_TEST_ASSERT(last_rev == youngest_rev);
+
+  /* Without --keep-going, both stop at the first error. */
+  SVN_ERR(record_verification(&expected, &expected_err, repos_path, 1,
+                              FALSE, pool));
+  SVN_ERR(record_verification(&actual, &actual_err, repos_path, 3,
+                              FALSE, pool));
+  SVN_TEST_ASSERT(expected_err && actual_err);
+  SVN_TEST_ASSERT(expected_err->apr_err == actual_err->apr_err);
+  SVN_TEST_ASSERT(verify_events_equal(expected, actual));
+  SVN_TEST_ASSERT(actual->nelts <= CORRUPT_REV);
+
+  svn_error_clear(expected_err);
+  svn_error_clear(actual_err);
+
+  return SVN_NO_ERROR;
+}
+#undef CORRUPT_REV
+
 /* The test table.  */
 
 static int max_threads = 4;
@@ -4539,6 +4833,10 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "optional authz wildcard performance test"),
     SVN_TEST_OPTS_PASS(test_list,
                        "test svn_repos_list"),
+    SVN_TEST_OPTS_PASS(test_verify_concurrently,
+                       "test svn_repos_verify_fs4 with multiple jobs"),
+    SVN_TEST_OPTS_PASS(test_verify_concurrently_corrupted,
+                       "test svn_repos_verify_fs4 jobs with a corrupt rev"),
     SVN_TEST_NULL
   };
 
@@ -26,6 +26,11 @@
 #include <apr_general.h>
 #include <apr_lib.h>
 #include <apr_time.h>
+#include <apr_thread_proc.h>
+
+#if APR_HAS_FORK
+#include <unistd.h>   /* for _exit() */
+#endif
 
 #include "svn_pools.h"
 
@@ -210,7 +215,8 @@ test_membuffer_cache_basic(apr_pool_t *pool)
   svn_membuffer_t *membuffer;
 
   SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 10*1024, 1, 0,
-                                            TRUE, TRUE, pool));
+                                            TRUE, TRUE, FALSE,
+                                            svn_cache_policy_default, pool));
 
   /* Create a cache with just one entry. */
   SVN_ERR(svn_cache__create_membuffer_cache(&cache,
@@ -268,7 +274,8 @@ test_membuffer_serializer_error_handling(apr_pool_t *pool)
   void *val;
 
   SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 10*1024, 1, 0,
-                                            TRUE, TRUE, pool));
+                                            TRUE, TRUE, FALSE,
+                                            svn_cache_policy_default, pool));
 
   /* Create a cache with just one entry. */
   SVN_ERR(svn_cache__create_membuffer_cache(&cache,
@@ -300,7 +307,8 @@ test_membuffer_serializer_error_handling(apr_pool_t *pool)
 
   /* Create a new cache. */
   SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 10*1024, 1, 0,
-                                            TRUE, TRUE, pool));
+                                            TRUE, TRUE, FALSE,
+                                            svn_cache_policy_default, pool));
   SVN_ERR(svn_cache__create_membuffer_cache(&cache,
                                             membuffer,
                                             serialize_revnum,
@@ -387,7 +395,8 @@ test_membuffer_cache_clearing(apr_pool_t *pool)
 
   /* Create a simple cache for strings, keyed by strings. */
   SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 10*1024, 1, 0,
-                                            TRUE, TRUE, pool));
+                                            TRUE, TRUE, FALSE,
+                                            svn_cache_policy_default, pool));
   SVN_ERR(svn_cache__create_membuffer_cache(&cache,
                                             membuffer,
                                             serialize_revnum,
@@ -505,7 +514,8 @@ test_membuffer_unaligned_string_keys(apr_pool_t *pool)
   const char *unaligned_prefix = apr_pstrdup(pool, "_cache:") + 1;
 
   SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 10*1024, 1, 0,
-                                            TRUE, TRUE, pool));
+                                            TRUE, TRUE, FALSE,
+                                            svn_cache_policy_default, pool));
 
   /* Create a cache with just one entry. */
   SVN_ERR(svn_cache__create_membuffer_cache(
@@ -555,7 +565,8 @@ test_membuffer_unaligned_fixed_keys(apr_pool_t *pool)
   const char *unaligned_prefix = apr_pstrdup(pool, "_cache:") + 1;
 
   SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 10*1024, 1, 0,
-                                            TRUE, TRUE, pool));
+                                            TRUE, TRUE, FALSE,
+                                            svn_cache_policy_default, pool));
 
   /* Create a cache with just one entry. */
   SVN_ERR(svn_cache__create_membuffer_cache(
@@ -590,6 +601,984 @@ test_membuffer_unaligned_fixed_keys(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+static svn_error_t *
+test_membuffer_cache_optimistic_basic(apr_pool_t *pool)
+{
+  svn_cache__t *cache;
+  svn_membuffer_t *membuffer;
+
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 10*1024, 1, 0,
+                                            TRUE, TRUE, TRUE,
+                                            svn_cache_policy_default, pool));
+
+  SVN_ERR(svn_cache__create_membuffer_cache(&cache,
+                                            membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            APR_HASH_KEY_STRING,
+                                            "cache:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            TRUE,
+                                            FALSE,
+                                            pool, pool));
+
+  return basic_cache_test(cache, FALSE, pool);
+}
+
+static svn_error_t *
+test_membuffer_cache_shared(apr_pool_t *pool)
+{
+  svn_cache__t *cache;
+  svn_membuffer_t *membuffer;
+  svn_error_t *err;
+
+  err = svn_cache__membuffer_cache_create_shared(&membuffer, 10*1024, 1, 0,
+                                                 TRUE,
+                                                 svn_cache_policy_default,
+                                                 pool);
+  if (err && err->apr_err == SVN_ERR_UNSUPPORTED_FEATURE)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, err,
+                            "shared memory caches not supported");
+  SVN_ERR(err);
+
+  SVN_ERR(svn_cache__create_membuffer_cache(&cache,
+                                            membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            APR_HASH_KEY_STRING,
+                                            "cache:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE,
+                                            FALSE,
+                                            pool, pool));
+
+  SVN_ERR(basic_cache_test(cache, FALSE, pool));
+
+#if APR_HAS_FORK
+  {
+    svn_revnum_t twenty = 20;
+    svn_revnum_t *answer;
+    svn_boolean_t found;
+    apr_proc_t proc;
+    apr_status_t status;
+    int exitcode;
+    apr_exit_why_e exitwhy;
+
+    /* Let a child process add an entry and check that we can see it. */
+    status = apr_proc_fork(&proc, pool);
+    if (status == APR_INCHILD)
+      {
+        err = svn_cache__membuffer_child_init(membuffer, pool);
+        if (!err)
+          err = svn_cache__set(cache, "forked", &twenty, pool);
+        svn_error_clear(err);
+        _exit(err ? 1 : 0);
+      }
+    else if (status != APR_INPARENT)
+      return svn_error_wrap_apr(status, "apr_proc_fork");
+
+    status = apr_proc_wait(&proc, &exitcode, &exitwhy, APR_WAIT);
+    if (status != APR_CHILD_DONE)
+      return svn_error_wrap_apr(status, "apr_proc_wait");
+    if (!APR_PROC_CHECK_EXIT(exitwhy) || exitcode != 0)
+      return svn_error_create(SVN_ERR_TEST_FAILED, NULL,
+                              "child process failed to write to cache");
+
+    SVN_ERR(svn_cache__get((void **) &answer, &found, cache, "forked",
+                           pool));
+    if (! found)
+      return svn_error_create(SVN_ERR_TEST_FAILED, NULL,
+                              "entry written by child process not found");
+    if (*answer != 20)
+      return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                               "expected 20 but found '%ld'", *answer);
+  }
+#endif
+
+  return SVN_NO_ERROR;
+}
+
+#if APR_HAS_FORK
+/* Number of child processes in test_membuffer_cache_shared_children. */
+#define SHARED_CACHE_CHILDREN 4
+
+/* In a child process forked after creating MEMBUFFER in CACHE_POOL, write
+ * the value CHILD_NO to key CHILD_NO of CACHE many times, then clean up
+ * CACHE_POOL as the process' exit would.  Return the exit code. */
+static int
+shared_cache_child(svn_membuffer_t *membuffer,
+                   svn_cache__t *cache,
+                   apr_pool_t *cache_pool,
+                   svn_revnum_t child_no)
+{
+  svn_error_t *err;
+  apr_pool_t *pool = svn_pool_create(NULL);
+  int i;
+
+  err = svn_cache__membuffer_child_init(membuffer, pool);
+  for (i = 0; !err && i < 100; ++i)
+    err = svn_cache__set(cache, &child_no, &child_no, pool);
+
+  /* Must not affect the locks in the other processes. */
+  svn_pool_destroy(cache_pool);
+
+  svn_error_clear(err);
+  return err ? 1 : 0;
+}
+#endif
+
+static svn_error_t *
+test_membuffer_cache_shared_children(apr_pool_t *pool)
+{
+#if APR_HAS_FORK
+  svn_cache__t *cache;
+  svn_membuffer_t *membuffer;
+  svn_error_t *err;
+  apr_pool_t *cache_pool = svn_pool_create(pool);
+  apr_proc_t procs[SHARED_CACHE_CHILDREN];
+  svn_boolean_t found;
+  svn_revnum_t i;
+
+  err = svn_cache__membuffer_cache_create_shared(&membuffer, 10*1024, 1, 0,
+                                                 TRUE,
+                                                 svn_cache_policy_default,
+                                                 cache_pool);
+  if (err && err->apr_err == SVN_ERR_UNSUPPORTED_FEATURE)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, err,
+                            "shared memory caches not supported");
+  SVN_ERR(err);
+
+  SVN_ERR(svn_cache__create_membuffer_cache(&cache,
+                                            membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            sizeof(i),
+                                            "cache:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE,
+                                            FALSE,
+                                            cache_pool, pool));
+
+  /* Let several children contend for the segment lock concurrently and
+   * then terminate, one after the other. */
+  for (i = 0; i < SHARED_CACHE_CHILDREN; ++i)
+    {
+      apr_status_t status = apr_proc_fork(&procs[i], pool);
+      if (status == APR_INCHILD)
+        _exit(shared_cache_child(membuffer, cache, cache_pool, i));
+      else if (status != APR_INPARENT)
+        return svn_error_wrap_apr(status, "apr_proc_fork");
+    }
+
+  for (i = 0; i < SHARED_CACHE_CHILDREN; ++i)
+    {
+      int exitcode;
+      apr_exit_why_e exitwhy;
+      apr_status_t status = apr_proc_wait(&procs[i], &exitcode, &exitwhy,
+                                          APR_WAIT);
+      if (status != APR_CHILD_DONE)
+        return svn_error_wrap_apr(status, "apr_proc_wait");
+      if (!APR_PROC_CHECK_EXIT(exitwhy) || exitcode != 0)
+        return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                                 "child process %ld failed", i);
+    }
+
+  /* The locks must still be usable in the parent. */
+  for (i = 0; i < SHARED_CACHE_CHILDREN; ++i)
+    {
+      svn_revnum_t *answer;
+
+      SVN_ERR(svn_cache__get((void **) &answer, &found, cache, &i, pool));
+      if (! found)
+        return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                                 "entry of child process %ld not found", i);
+      SVN_TEST_ASSERT(*answer == i);
+    }
+
+  SVN_ERR(svn_cache__set(cache, &i, &i, pool));
+  SVN_ERR(svn_cache__has_key(&found, cache, &i, pool));
+  SVN_TEST_ASSERT(found);
+#endif
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_cache__snapshot_filter_t.  Reject all entries whose
+ * prefix is the C string given as BATON. */
+static svn_error_t *
+snapshot_filter(svn_boolean_t *keep,
+                void *baton,
+                const char *prefix,
+                apr_pool_t *scratch_pool)
+{
+  *keep = strcmp(prefix, baton) != 0;
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_membuffer_cache_snapshot(apr_pool_t *pool)
+{
+  svn_membuffer_t *membuffer;
+  svn_cache__t *string_keys, *fixed_keys, *skipped;
+  svn_stringbuf_t *snapshot = svn_stringbuf_create_empty(pool);
+  svn_stringbuf_t *filtered = svn_stringbuf_create_empty(pool);
+  svn_revnum_t value;
+  svn_revnum_t *answer;
+  svn_boolean_t found;
+  apr_uint64_t key;
+
+  /* Create a membuffer and front-ends for string keys, fixed-size keys
+   * (using the prefix pool) and a third one that we filter out. */
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 10*1024, 1, 0,
+                                            TRUE, TRUE, FALSE,
+                                            svn_cache_policy_default, pool));
+  SVN_ERR(svn_cache__create_membuffer_cache(&string_keys, membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            APR_HASH_KEY_STRING, "string:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE, FALSE, pool, pool));
+  SVN_ERR(svn_cache__create_membuffer_cache(&fixed_keys, membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            sizeof(key), "fixed:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE, FALSE, pool, pool));
+  SVN_ERR(svn_cache__create_membuffer_cache(&skipped, membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            APR_HASH_KEY_STRING, "skipped:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE, FALSE, pool, pool));
+
+  value = 10;
+  SVN_ERR(svn_cache__set(string_keys, "ten", &value, pool));
+  key = 11;
+  value = 11;
+  SVN_ERR(svn_cache__set(fixed_keys, &key, &value, pool));
+  value = 12;
+  SVN_ERR(svn_cache__set(skipped, "twelve", &value, pool));
+
+  SVN_ERR(svn_cache__membuffer_dump(membuffer,
+                                    svn_stream_from_stringbuf(snapshot, pool),
+                                    NULL, NULL, pool));
+  SVN_ERR(svn_cache__membuffer_dump(membuffer,
+                                    svn_stream_from_stringbuf(filtered, pool),
+                                    snapshot_filter, "string:", pool));
+
+  /* Load the snapshot into a fresh cache. */
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 10*1024, 1, 0,
+                                            TRUE, TRUE, FALSE,
+                                            svn_cache_policy_default, pool));
+  SVN_ERR(svn_cache__membuffer_load(membuffer,
+                                    svn_stream_from_stringbuf(snapshot, pool),
+                                    snapshot_filter, "skipped:", pool));
+
+  SVN_ERR(svn_cache__create_membuffer_cache(&string_keys, membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            APR_HASH_KEY_STRING, "string:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE, FALSE, pool, pool));
+  SVN_ERR(svn_cache__create_membuffer_cache(&fixed_keys, membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            sizeof(key), "fixed:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE, FALSE, pool, pool));
+  SVN_ERR(svn_cache__create_membuffer_cache(&skipped, membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            APR_HASH_KEY_STRING, "skipped:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE, FALSE, pool, pool));
+
+#ifndef SVN_DEBUG_CACHE_MEMBUFFER
+  SVN_ERR(svn_cache__get((void **) &answer, &found, string_keys, "ten",
+                         pool));
+  if (! found || *answer != 10)
+    return svn_error_create(SVN_ERR_TEST_FAILED, NULL,
+                            "string key not restored from snapshot");
+
+  SVN_ERR(svn_cache__get((void **) &answer, &found, fixed_keys, &key, pool));
+  if (! found || *answer != 11)
+    return svn_error_create(SVN_ERR_TEST_FAILED, NULL,
+                            "fixed-size key not restored from snapshot");
+#endif
+
+  SVN_ERR(svn_cache__get((void **) &answer, &found, skipped, "twelve",
+                         pool));
+  if (found)
+    return svn_error_create(SVN_ERR_TEST_FAILED, NULL,
+                            "filtered entry restored from snapshot");
+
+  /* Entries may be filtered when writing the snapshot as well. */
+  SVN_ERR(svn_cache__membuffer_clear(membuffer));
+  SVN_ERR(svn_cache__membuffer_load(membuffer,
+                                    svn_stream_from_stringbuf(filtered, pool),
+                                    NULL, NULL, pool));
+
+  SVN_ERR(svn_cache__get((void **) &answer, &found, string_keys, "ten",
+                         pool));
+  if (found)
+    return svn_error_create(SVN_ERR_TEST_FAILED, NULL,
+                            "entry filtered from snapshot restored");
+
+#ifndef SVN_DEBUG_CACHE_MEMBUFFER
+  SVN_ERR(svn_cache__get((void **) &answer, &found, skipped, "twelve",
+                         pool));
+  if (! found || *answer != 12)
+    return svn_error_create(SVN_ERR_TEST_FAILED, NULL,
+                            "entry not restored from filtered snapshot");
+#endif
+
+  /* Truncated snapshots must be detected. */
+  svn_stringbuf_chop(snapshot, 1);
+  SVN_TEST_ASSERT_ERROR(svn_cache__membuffer_load(
+                            membuffer,
+                            svn_stream_from_stringbuf(snapshot, pool),
+                            NULL, NULL, pool),
+                        SVN_ERR_CORRUPT_PACKED_DATA);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_cache__partial_getter_func_t.
+ * Return the size of the serialized item in *OUT. */
+static svn_error_t *
+get_item_size(void **out,
+              const void *data,
+              apr_size_t data_len,
+              void *baton,
+              apr_pool_t *result_pool)
+{
+  apr_size_t *size = apr_palloc(result_pool, sizeof(*size));
+  *size = data_len;
+  *out = size;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_cache__partial_setter_func_t.
+ * Replace the first character of the serialized svn_stringbuf_t item. */
+static svn_error_t *
+capitalize_item(void **data,
+                apr_size_t *data_len,
+                void *baton,
+                apr_pool_t *result_pool)
+{
+  char *text = *data;
+  text[0] = 'X';
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_membuffer_cache_compression(apr_pool_t *pool)
+{
+  svn_membuffer_t *membuffer;
+  svn_cache__t *cache;
+  svn_stringbuf_t *big = svn_stringbuf_create_empty(pool);
+  svn_stringbuf_t *small = svn_stringbuf_create("small value", pool);
+  svn_stringbuf_t *answer;
+  apr_size_t *size;
+  svn_boolean_t found;
+  svn_cache__info_t info;
+
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 1024 * 1024, 1, 1,
+                                            TRUE, TRUE, FALSE,
+                                            svn_cache_policy_default, pool));
+  svn_cache__membuffer_set_compression(membuffer, 256);
+
+  /* Use the default svn_stringbuf_t serialization, which includes the
+   * terminating NUL. */
+  SVN_ERR(svn_cache__create_membuffer_cache(&cache, membuffer, NULL, NULL,
+                                            APR_HASH_KEY_STRING, "cache:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE, FALSE, pool, pool));
+
+  while (big->len < 4096)
+    svn_stringbuf_appendcstr(big, "highly compressible ");
+
+  SVN_ERR(svn_cache__set(cache, "big", big, pool));
+  SVN_ERR(svn_cache__set(cache, "small", small, pool));
+
+  /* Both must round-trip, compressed or not. */
+  SVN_ERR(svn_cache__get((void **) &answer, &found, cache, "big", pool));
+  SVN_TEST_ASSERT(found);
+  SVN_TEST_STRING_ASSERT(answer->data, big->data);
+
+  SVN_ERR(svn_cache__get((void **) &answer, &found, cache, "small", pool));
+  SVN_TEST_ASSERT(found);
+  SVN_TEST_STRING_ASSERT(answer->data, small->data);
+
+  /* Partial getters see the uncompressed item. */
+  SVN_ERR(svn_cache__get_partial((void **) &size, &found, cache, "big",
+                                 get_item_size, NULL, pool));
+  SVN_TEST_ASSERT(found);
+  SVN_TEST_ASSERT(*size == big->len + 1);
+
+  /* Partial setters as well. */
+  SVN_ERR(svn_cache__set_partial(cache, "big", capitalize_item, NULL, pool));
+  SVN_ERR(svn_cache__get((void **) &answer, &found, cache, "big", pool));
+  SVN_TEST_ASSERT(found);
+  SVN_TEST_ASSERT(answer->len == big->len);
+  SVN_TEST_ASSERT(answer->data[0] == 'X');
+  SVN_TEST_STRING_ASSERT(answer->data + 1, big->data + 1);
+
+  /* Only the large item got compressed. */
+  SVN_ERR(svn_cache__get_info(cache, &info, FALSE, pool));
+  SVN_TEST_ASSERT(info.compression_input == big->len + 1);
+  SVN_TEST_ASSERT(info.compression_output < info.compression_input);
+
+  return SVN_NO_ERROR;
+}
+
+/* Return an error if TEXT does not contain LINE as a complete line. */
+static svn_error_t *
+assert_has_line(const char *text,
+                const char *line,
+                apr_pool_t *pool)
+{
+  const char *found = strstr(text, apr_pstrcat(pool, line, "\n",
+                                               SVN_VA_NULL));
+  if (!found || (found != text && found[-1] != '\n'))
+    return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                             "metrics line '%s' not found", line);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_cache_metrics(apr_pool_t *pool)
+{
+  apr_pool_t *cache_pool = svn_pool_create(pool);
+  svn_cache__t *cache, *other;
+  svn_revnum_t value = 1;
+  svn_revnum_t *answer;
+  svn_boolean_t found;
+  svn_string_t *metrics;
+
+  svn_cache__enable_metrics(TRUE);
+  SVN_ERR(svn_cache__create_inprocess(&cache, serialize_revnum,
+                                      deserialize_revnum,
+                                      APR_HASH_KEY_STRING, 1, 1, TRUE,
+                                      "prefix:1:metrics", cache_pool));
+  SVN_ERR(svn_cache__register_metrics(cache, "metrics", cache_pool));
+
+  /* Caches of the same kind get reported as one, whatever their keys. */
+  SVN_ERR(svn_cache__create_inprocess(&other, serialize_revnum,
+                                      deserialize_revnum,
+                                      APR_HASH_KEY_STRING, 1, 1, TRUE,
+                                      "prefix:2:metrics", cache_pool));
+  SVN_ERR(svn_cache__register_metrics(other, "metrics", cache_pool));
+  svn_cache__enable_metrics(FALSE);
+
+  SVN_ERR(svn_cache__set(cache, "one", &value, pool));
+  SVN_ERR(svn_cache__get((void **) &answer, &found, cache, "one", pool));
+  SVN_ERR(svn_cache__get((void **) &answer, &found, other, "two", pool));
+
+  SVN_ERR(svn_cache__format_metrics(&metrics, pool));
+  SVN_ERR(assert_has_line(metrics->data,
+                          "svn_cache_gets_total{cache=\"metrics\"} 2",
+                          pool));
+  SVN_TEST_ASSERT(strstr(metrics->data, "prefix:") == NULL);
+  SVN_ERR(assert_has_line(metrics->data,
+                          "svn_cache_hits_total{cache=\"metrics\"} 1",
+                          pool));
+  SVN_ERR(assert_has_line(metrics->data,
+                          "svn_cache_sets_total{cache=\"metrics\"} 1",
+                          pool));
+  SVN_ERR(assert_has_line(metrics->data,
+                          "svn_cache_lookup_duration_seconds_count"
+                          "{cache=\"metrics\",result=\"miss\"} 1",
+                          pool));
+  SVN_ERR(assert_has_line(metrics->data,
+                          "svn_cache_lookup_duration_seconds_bucket"
+                          "{cache=\"metrics\",result=\"hit\",le=\"+Inf\"} 1",
+                          pool));
+
+  /* Counters must not go backwards when the cache goes away. */
+  svn_pool_destroy(cache_pool);
+  SVN_ERR(svn_cache__format_metrics(&metrics, pool));
+  SVN_ERR(assert_has_line(metrics->data,
+                          "svn_cache_gets_total{cache=\"metrics\"} 2",
+                          pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Size of the values in the trace replay test.
+ */
+#define TRACE_VALUE_SIZE 1024
+
+/* Number of keys in the frequently accessed part of the trace.
+ */
+#define TRACE_HOT_KEYS 2000
+
+/* Every TRACE_SCAN_INTERVAL requests, the trace contains a sequential
+ * scan over TRACE_SCAN_LENGTH keys that are never requested again.
+ */
+#define TRACE_SCAN_INTERVAL 10000
+#define TRACE_SCAN_LENGTH 3000
+
+/* Total number of requests in the trace.
+ */
+#define TRACE_LENGTH 100000
+
+/* Serializer / deserializer for blocks of TRACE_VALUE_SIZE bytes. */
+static svn_error_t *
+serialize_block(void **data,
+                apr_size_t *data_len,
+                void *in,
+                apr_pool_t *pool)
+{
+  *data = apr_pmemdup(pool, in, TRACE_VALUE_SIZE);
+  *data_len = TRACE_VALUE_SIZE;
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+deserialize_block(void **out,
+                  void *data,
+                  apr_size_t data_len,
+                  apr_pool_t *pool)
+{
+  *out = data;
+  return SVN_NO_ERROR;
+}
+
+/* Return the I-th key in our synthetic request trace, using and updating
+ * the random number generator state in *SEED.  The trace mimics a server
+ * workload: a skewed distribution over a hot set that is larger than the
+ * cache, interrupted by one-time scans, e.g. from exports or checkouts
+ * of old revisions.
+ */
+static apr_uint64_t
+trace_key(apr_uint32_t *seed,
+          apr_uint32_t i)
+{
+  apr_uint32_t scan_pos = i % TRACE_SCAN_INTERVAL;
+  double x;
+
+  if (scan_pos < TRACE_SCAN_LENGTH)
+    return TRACE_HOT_KEYS + (apr_uint64_t)i;
+
+  x = svn_test_rand(seed) / 4294967296.0;
+  return (apr_uint64_t)(TRACE_HOT_KEYS * x * x * x);
+}
+
+/* Replay the synthetic request trace against a membuffer cache using
+ * POLICY.  Every miss is followed by a write, as our back-ends do.
+ * Return the number of hits in *HITS.
+ */
+static svn_error_t *
+replay_trace(apr_uint32_t *hits,
+             svn_cache_policy_t policy,
+             apr_pool_t *pool)
+{
+  svn_membuffer_t *membuffer;
+  svn_cache__t *cache;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  char *block = apr_pcalloc(pool, TRACE_VALUE_SIZE);
+  apr_uint32_t seed = 0;
+  apr_uint32_t i;
+
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 1024 * 1024,
+                                            64 * 1024, 1, FALSE, FALSE,
+                                            FALSE, policy, pool));
+  SVN_ERR(svn_cache__create_membuffer_cache(&cache, membuffer,
+                                            serialize_block,
+                                            deserialize_block,
+                                            sizeof(apr_uint64_t), "trace",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE, FALSE, pool, pool));
+
+  *hits = 0;
+  for (i = 0; i < TRACE_LENGTH; ++i)
+    {
+      apr_uint64_t key = trace_key(&seed, i);
+      void *value;
+      svn_boolean_t found;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_cache__get(&value, &found, cache, &key, iterpool));
+      if (found)
+        ++*hits;
+      else
+        SVN_ERR(svn_cache__set(cache, &key, block, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_membuffer_cache_policy_trace(const svn_test_opts_t *opts,
+                                  apr_pool_t *pool)
+{
+  apr_uint32_t default_hits, tinylfu_hits;
+
+  /* Compare the hit rates of the eviction policies.  Use -v to see the
+   * numbers. */
+  SVN_ERR(replay_trace(&default_hits, svn_cache_policy_default, pool));
+  SVN_ERR(replay_trace(&tinylfu_hits, svn_cache_policy_tinylfu, pool));
+
+  if (opts->verbose)
+    printf("hit rates: default %.1f%%, tinylfu %.1f%%\n",
+           100.0 * default_hits / TRACE_LENGTH,
+           100.0 * tinylfu_hits / TRACE_LENGTH);
+
+  /* The scans must not flush the hot set with TinyLFU. */
+#ifndef SVN_DEBUG_CACHE_MEMBUFFER
+  SVN_TEST_ASSERT(tinylfu_hits > default_hits);
+#endif
+  SVN_TEST_ASSERT(tinylfu_hits <= TRACE_LENGTH);
+
+  return SVN_NO_ERROR;
+}
+
+/* Request COUNT keys starting at *NEXT_KEY from CACHE once each and add
+ * them upon the inevitable miss.  Advance *NEXT_KEY accordingly.
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+request_once(svn_cache__t *cache,
+             apr_uint64_t *next_key,
+             int count,
+             apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  char *block = apr_pcalloc(scratch_pool, TRACE_VALUE_SIZE);
+  int i;
+
+  for (i = 0; i < count; ++i, ++*next_key)
+    {
+      void *value;
+      svn_boolean_t found;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_cache__get(&value, &found, cache, next_key, iterpool));
+      SVN_TEST_ASSERT(!found);
+      SVN_ERR(svn_cache__set(cache, next_key, block, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_membuffer_cache_tinylfu_admission(apr_pool_t *pool)
+{
+  svn_membuffer_t *membuffer;
+  svn_cache__t *cache;
+  svn_cache__info_t info;
+  char *block = apr_pcalloc(pool, TRACE_VALUE_SIZE);
+  apr_uint64_t popular = 0;
+  apr_uint64_t next_key = 1;
+  void *value;
+  svn_boolean_t found;
+  int i;
+
+  /* Room for about 750 blocks and plenty of directory entries, such
+   * that all evictions are policy decisions. */
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 1024 * 1024,
+                                            256 * 1024, 1, FALSE, FALSE,
+                                            FALSE, svn_cache_policy_tinylfu,
+                                            pool));
+  SVN_ERR(svn_cache__create_membuffer_cache(&cache, membuffer,
+                                            serialize_block,
+                                            deserialize_block,
+                                            sizeof(apr_uint64_t), "admit",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE, FALSE, pool, pool));
+
+  /* Fill L1 and L2 with keys that are never requested again. */
+  SVN_ERR(request_once(cache, &next_key, 1000, pool));
+
+  /* A key that has been requested often but is not cached yet. */
+  for (i = 0; i < 10; ++i)
+    {
+      SVN_ERR(svn_cache__get(&value, &found, cache, &popular, pool));
+      SVN_TEST_ASSERT(!found);
+    }
+
+  SVN_ERR(svn_cache__set(cache, &popular, block, pool));
+
+  /* Push it out of L1 with more one-time keys.  It must be admitted to L2
+   * in favour of the older one-time keys and the newer ones must not
+   * replace it. */
+  SVN_ERR(request_once(cache, &next_key, 1000, pool));
+
+  SVN_ERR(svn_cache__get_info(cache, &info, FALSE, pool));
+  SVN_TEST_ASSERT(info.evictions > 0);
+
+#ifndef SVN_DEBUG_CACHE_MEMBUFFER
+  SVN_ERR(svn_cache__get(&value, &found, cache, &popular, pool));
+  SVN_TEST_ASSERT(found);
+#endif
+
+  return SVN_NO_ERROR;
+}
+
+#if APR_HAS_THREADS
+
+/* Number of distinct keys accessed by the contention tests. */
+#define CONTENTION_KEY_COUNT 1000
+
+/* Upper limit of the number of threads in the contention tests. */
+#define CONTENTION_MAX_THREADS 16
+
+/* Per-thread data of the contention tests. */
+typedef struct contention_baton_t
+{
+  /* Thread-local front-end to the shared membuffer. */
+  svn_cache__t *cache;
+
+  /* Thread-local scratch pool. */
+  apr_pool_t *pool;
+
+  /* Used to vary the access pattern between threads. */
+  int thread_no;
+
+  /* Number of cache accesses to make. */
+  int iterations;
+
+  /* Number of hits seen by this thread. */
+  int hits;
+
+  /* Error returned by the cache, if any. */
+  svn_error_t *err;
+} contention_baton_t;
+
+/* Access BATON->CACHE, mostly reading with occasional writes.  Make sure
+ * any value we get back is the one we expect for the respective key. */
+static svn_error_t *
+contention_worker(contention_baton_t *baton)
+{
+  int i;
+  apr_pool_t *iterpool = svn_pool_create(baton->pool);
+
+  for (i = 0; i < baton->iterations; ++i)
+    {
+      apr_uint64_t key = (i * 7 + baton->thread_no) % CONTENTION_KEY_COUNT;
+      svn_revnum_t value = (svn_revnum_t)key;
+      svn_revnum_t *answer;
+      svn_boolean_t found;
+
+      if ((i % 64) == 0)
+        svn_pool_clear(iterpool);
+
+      /* Re-write every 64th entry with the same value.  That causes
+       * write contention without making the expected results ambiguous. */
+      if ((i % 64) == baton->thread_no)
+        {
+          SVN_ERR(svn_cache__set(baton->cache, &key, &value, iterpool));
+          continue;
+        }
+
+      SVN_ERR(svn_cache__get((void **) &answer, &found, baton->cache, &key,
+                             iterpool));
+      if (found)
+        {
+          if (*answer != value)
+            return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                                     "expected %ld but found %ld",
+                                     value, *answer);
+          baton->hits++;
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+static void *
+APR_THREAD_FUNC contention_thread(apr_thread_t *tid, void *data)
+{
+  contention_baton_t *baton = data;
+
+  baton->err = contention_worker(baton);
+  apr_thread_exit(tid, APR_SUCCESS);
+
+  return NULL;
+}
+
+/* Wait for the first COUNT of THREADS to finish.  Return the first error
+ * that we encounter but join all threads in any case. */
+static svn_error_t *
+join_contention_threads(apr_thread_t **threads,
+                        int count)
+{
+  svn_error_t *err = SVN_NO_ERROR;
+  int i;
+
+  for (i = 0; i < count; ++i)
+    {
+      apr_status_t retval, status;
+
+      status = apr_thread_join(&retval, threads[i]);
+      if (status && !err)
+        err = svn_error_wrap_apr(status, "Can't join thread");
+    }
+
+  return err;
+}
+
+/* Create a fresh single-segment membuffer with OPTIMISTIC_READS as given
+ * and populate it with CONTENTION_KEY_COUNT entries.  Initialize BATONS
+ * with per-thread cache front-ends to it.  Use POOL for allocations. */
+static svn_error_t *
+init_contention_test(contention_baton_t batons[CONTENTION_MAX_THREADS],
+                     svn_boolean_t optimistic_reads,
+                     apr_pool_t *pool)
+{
+  svn_membuffer_t *membuffer;
+  apr_uint64_t key;
+  int i;
+
+  /* A single segment maximizes lock contention. */
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 1024 * 1024,
+                                            64 * 1024, 1, TRUE, FALSE,
+                                            optimistic_reads,
+                                            svn_cache_policy_default, pool));
+
+  for (i = 0; i < CONTENTION_MAX_THREADS; ++i)
+    {
+      batons[i].pool = svn_pool_create(pool);
+      batons[i].thread_no = i;
+      SVN_ERR(svn_cache__create_membuffer_cache(
+                &batons[i].cache, membuffer, serialize_revnum,
+                deserialize_revnum, sizeof(key), "contention:",
+                SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY, FALSE, FALSE,
+                batons[i].pool, pool));
+    }
+
+  for (key = 0; key < CONTENTION_KEY_COUNT; ++key)
+    {
+      svn_revnum_t value = (svn_revnum_t)key;
+      SVN_ERR(svn_cache__set(batons[0].cache, &key, &value, pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Run the first THREAD_COUNT of BATONS concurrently with ITERATIONS
+ * cache accesses each.  Return the total number of hits in *HITS.
+ * Use POOL for allocations. */
+static svn_error_t *
+run_contention_threads(int *hits,
+                       contention_baton_t batons[CONTENTION_MAX_THREADS],
+                       int thread_count,
+                       int iterations,
+                       apr_pool_t *pool)
+{
+  apr_thread_t *threads[CONTENTION_MAX_THREADS];
+  svn_error_t *err = SVN_NO_ERROR;
+  int i;
+
+  for (i = 0; i < thread_count; ++i)
+    {
+      apr_status_t status;
+
+      batons[i].iterations = iterations;
+      batons[i].hits = 0;
+      batons[i].err = SVN_NO_ERROR;
+      status = apr_thread_create(&threads[i], NULL, contention_thread,
+                                 &batons[i], pool);
+      if (status)
+        {
+          /* Don't leave the threads started so far running on BATONS. */
+          err = svn_error_wrap_apr(status, "Can't create thread");
+          thread_count = i;
+          break;
+        }
+    }
+
+  err = svn_error_compose_create(err,
+                                 join_contention_threads(threads,
+                                                         thread_count));
+
+  *hits = 0;
+  for (i = 0; i < thread_count; ++i)
+    {
+      err = svn_error_compose_create(err, batons[i].err);
+      *hits += batons[i].hits;
+    }
+
+  return svn_error_trace(err);
+}
+
+/* Run the contention benchmark on a fresh single-segment membuffer with
+ * 1 to CONTENTION_MAX_THREADS threads and OPTIMISTIC_READS as given and
+ * report the throughput for each thread count. */
+static svn_error_t *
+run_contention_benchmark(svn_boolean_t optimistic_reads,
+                         apr_pool_t *pool)
+{
+  /* Number of cache accesses per thread. */
+  enum { iterations = 100000 };
+
+  contention_baton_t batons[CONTENTION_MAX_THREADS];
+  int thread_count;
+
+  SVN_ERR(init_contention_test(batons, optimistic_reads, pool));
+
+  for (thread_count = 1;
+       thread_count <= CONTENTION_MAX_THREADS;
+       thread_count *= 2)
+    {
+      apr_time_t start = apr_time_now();
+      apr_time_t duration;
+      int hits;
+
+      SVN_ERR(run_contention_threads(&hits, batons, thread_count,
+                                     iterations, pool));
+
+      duration = apr_time_now() - start;
+      printf("%s reads, %2d threads: %10.0f accesses/s, %d hits\n",
+             optimistic_reads ? "optimistic" : "locked    ",
+             thread_count,
+             (double)thread_count * iterations
+               * APR_USEC_PER_SEC / (duration ? duration : 1),
+             hits);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+#endif
+
+static svn_error_t *
+test_membuffer_cache_concurrent_reads(apr_pool_t *pool)
+{
+#if APR_HAS_THREADS
+  contention_baton_t batons[CONTENTION_MAX_THREADS];
+  int hits;
+
+  /* Readers must never see a torn or foreign value while other threads
+   * keep re-writing the same entries. */
+  SVN_ERR(init_contention_test(batons, TRUE, pool));
+  SVN_ERR(run_contention_threads(&hits, batons, 4, 10000, pool));
+  SVN_TEST_ASSERT(hits > 0);
+#endif
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_membuffer_cache_contention(apr_pool_t *pool)
+{
+#if APR_HAS_THREADS
+  /* Compare the scaling of cache lookups with and without optimistic
+   * reads. */
+  SVN_ERR(run_contention_benchmark(FALSE, pool));
+  SVN_ERR(run_contention_benchmark(TRUE, pool));
+#endif
+
+  return SVN_NO_ERROR;
+}
+
 
 /* The test table.  */
 
@@ -616,6 +1605,28 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "test membuffer cache with unaligned string keys"),
     SVN_TEST_PASS2(test_membuffer_unaligned_fixed_keys,
                    "test membuffer cache with unaligned fixed keys"),
+    SVN_TEST_PASS2(test_membuffer_cache_optimistic_basic,
+                   "basic membuffer svn_cache test, optimistic reads"),
+    SVN_TEST_PASS2(test_membuffer_cache_shared,
+                   "membuffer svn_cache in shared memory"),
+    SVN_TEST_SKIP2(test_membuffer_cache_shared_children,
+                   ! APR_HAS_FORK,
+                   "shared membuffer locks survive child processes"),
+    SVN_TEST_PASS2(test_membuffer_cache_snapshot,
+                   "dump and load membuffer cache snapshots"),
+    SVN_TEST_OPTS_PASS(test_membuffer_cache_policy_trace,
+                       "membuffer hit rates per eviction policy"),
+    SVN_TEST_PASS2(test_membuffer_cache_tinylfu_admission,
+                   "TinyLFU admits popular keys into membuffer L2"),
+    SVN_TEST_PASS2(test_membuffer_cache_compression,
+                   "membuffer svn_cache with compressed entries"),
+    SVN_TEST_PASS2(test_cache_metrics,
+                   "export svn_cache metrics"),
+    SVN_TEST_SKIP2(test_membuffer_cache_concurrent_reads,
+                   ! APR_HAS_THREADS,
+                   "concurrent optimistic membuffer reads"),
+    SVN_TEST_SKIP2(test_membuffer_cache_contention, TRUE,
+                   "optional membuffer lookup scaling benchmark"),
     SVN_TEST_NULL
   };
 
@@ -28,6 +28,8 @@
 #include "svn_error.h"
 #include "svn_io.h"
 
+#include "private/svn_subr_private.h"
+
 #include "../svn_test.h"
 
 /* Verify that DIGEST of checksum type KIND can be parsed and
@@ -364,6 +366,127 @@ test_checksummed_stream_reset(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* Feed LEN bytes from DATA into CTX in pieces of varying size. */
+static svn_error_t *
+update_in_pieces(svn_checksum_ctx_t *ctx,
+                 const char *data,
+                 apr_size_t len)
+{
+  apr_size_t piece = 1;
+
+  while (len > 0)
+    {
+      apr_size_t to_feed = piece < len ? piece : len;
+
+      SVN_ERR(svn_checksum_update(ctx, data, to_feed));
+      data += to_feed;
+      len -= to_feed;
+      piece = piece * 3 % 97 + 1;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_sha1_vectors(apr_pool_t *pool)
+{
+  /* Test vectors from FIPS 180-2, plus block boundary cases. */
+  static const struct
+    {
+      const char *data;
+      apr_size_t repeat;
+      const char *digest;
+    } tests[] =
+    {
+      { "", 1, "da39a3ee5e6b4b0d3255bfef95601890afd80709" },
+      { "abc", 1, "a9993e364706816aba3e25717850c26c9cd0d89d" },
+      { "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 1,
+        "84983e441c3bd26ebaae4aa1f95129e5e54670f1" },
+      { "a", 1000000, "34aa973cd4c4daa4f61eeb2bdbad27316534016f" },
+      { "0123456789abcdef", 4, "ce4303f6b22257d9c9cf314ef1dee4707c6e1c13" },
+      { NULL }
+    };
+  int i;
+
+  for (i = 0; tests[i].data; ++i)
+    {
+      svn_stringbuf_t *data = svn_stringbuf_create_empty(pool);
+      svn_checksum_ctx_t *ctx;
+      svn_checksum_t *checksum;
+      apr_size_t k;
+
+      for (k = 0; k < tests[i].repeat; ++k)
+        svn_stringbuf_appendcstr(data, tests[i].data);
+
+      /* One-shot */
+      SVN_ERR(svn_checksum(&checksum, svn_checksum_sha1, data->data,
+                           data->len, pool));
+      SVN_TEST_STRING_ASSERT(svn_checksum_to_cstring(checksum, pool),
+                             tests[i].digest);
+
+      /* Incremental */
+      ctx = svn_checksum_ctx_create(svn_checksum_sha1, pool);
+      SVN_ERR(update_in_pieces(ctx, data->data, data->len));
+      SVN_ERR(svn_checksum_final(&checksum, ctx, pool));
+      SVN_TEST_STRING_ASSERT(svn_checksum_to_cstring(checksum, pool),
+                             tests[i].digest);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_multi_checksum(apr_pool_t *pool)
+{
+  enum { DATA_SIZE = 100000 };
+  char *data = apr_palloc(pool, DATA_SIZE);
+  svn_checksum__multi_ctx_t *ctx;
+  svn_checksum_t *expected_md5, *expected_sha1;
+  svn_checksum_t *md5, *sha1;
+  svn_stringbuf_t *target = svn_stringbuf_create_empty(pool);
+  svn_stream_t *stream;
+  apr_size_t i, len;
+
+  for (i = 0; i < DATA_SIZE; ++i)
+    data[i] = (char)(i * 131 + i / 256);
+
+  SVN_ERR(svn_checksum(&expected_md5, svn_checksum_md5, data, DATA_SIZE,
+                       pool));
+  SVN_ERR(svn_checksum(&expected_sha1, svn_checksum_sha1, data, DATA_SIZE,
+                       pool));
+
+  /* Both digests, fed in two uneven parts. */
+  ctx = svn_checksum__multi_ctx_create(TRUE, TRUE, pool);
+  SVN_ERR(svn_checksum__multi_update(ctx, data, 12345));
+  SVN_ERR(svn_checksum__multi_update(ctx, data + 12345, DATA_SIZE - 12345));
+  SVN_ERR(svn_checksum__multi_final(&md5, &sha1, ctx, pool));
+  SVN_TEST_ASSERT(svn_checksum_match(md5, expected_md5));
+  SVN_TEST_ASSERT(svn_checksum_match(sha1, expected_sha1));
+
+  /* Only MD5. */
+  ctx = svn_checksum__multi_ctx_create(TRUE, FALSE, pool);
+  SVN_ERR(svn_checksum__multi_update(ctx, data, DATA_SIZE));
+  SVN_ERR(svn_checksum__multi_final(&md5, &sha1, ctx, pool));
+  SVN_TEST_ASSERT(svn_checksum_match(md5, expected_md5));
+  SVN_TEST_ASSERT(sha1 == NULL);
+
+  /* Through the stream wrapper, with a reset after some garbage. */
+  stream = svn_checksum__wrap_write_stream_multi(
+             &md5, &sha1, svn_stream_from_stringbuf(target, pool), pool);
+  len = 1000;
+  SVN_ERR(svn_stream_write(stream, data + 1, &len));
+  SVN_ERR(svn_stream_reset(stream));
+  len = DATA_SIZE;
+  SVN_ERR(svn_stream_write(stream, data, &len));
+  SVN_ERR(svn_stream_close(stream));
+
+  SVN_TEST_ASSERT(svn_checksum_match(md5, expected_md5));
+  SVN_TEST_ASSERT(svn_checksum_match(sha1, expected_sha1));
+  SVN_TEST_ASSERT(target->len == DATA_SIZE);
+
+  return SVN_NO_ERROR;
+}
+
 /* An array of all test functions */
 
 static int max_threads = 1;
@@ -389,6 +512,10 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "read from checksummed stream"),
     SVN_TEST_PASS2(test_checksummed_stream_reset,
                    "reset checksummed stream"),
+    SVN_TEST_PASS2(test_sha1_vectors,
+                   "test SHA-1 against known digests"),
+    SVN_TEST_PASS2(test_multi_checksum,
+                   "test single-pass MD5 and SHA-1 calculation"),
     SVN_TEST_NULL
   };
 
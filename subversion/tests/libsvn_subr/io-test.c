@@ -1461,6 +1461,126 @@ test_rmtree_all_readonly(apr_pool_t *pool)
 }
 
 
+/* Create the file PATH with SIZE bytes of not easily compressible data. */
+static svn_error_t *
+create_large_file(const char *path,
+                  apr_size_t size,
+                  apr_pool_t *pool)
+{
+  enum { CHUNK_SIZE = 1024 * 1024 };
+  char *chunk = apr_palloc(pool, CHUNK_SIZE);
+  apr_uint32_t seed = 4711;
+  apr_file_t *file;
+  apr_size_t i;
+
+  SVN_ERR(svn_io_file_open(&file, path,
+                           APR_WRITE | APR_CREATE | APR_TRUNCATE,
+                           APR_OS_DEFAULT, pool));
+  while (size > 0)
+    {
+      apr_size_t to_write = size < CHUNK_SIZE ? size : CHUNK_SIZE;
+
+      for (i = 0; i < to_write; ++i)
+        chunk[i] = (char)svn_test_rand(&seed);
+
+      SVN_ERR(svn_io_file_write_full(file, chunk, to_write, NULL, pool));
+      size -= to_write;
+    }
+
+  return svn_error_trace(svn_io_file_close(file, pool));
+}
+
+/* Copy SRC to DST with svn_io_copy_file and make sure that DST ends up
+   with the same contents as SRC has when being read as a stream. */
+static svn_error_t *
+copy_and_compare(const char *src,
+                 const char *dst,
+                 apr_pool_t *pool)
+{
+  svn_stringbuf_t *expected, *actual;
+
+  SVN_ERR(svn_io_copy_file(src, dst, FALSE, pool));
+  SVN_ERR(svn_stringbuf_from_file2(&expected, src, pool));
+  SVN_ERR(svn_stringbuf_from_file2(&actual, dst, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(expected, actual));
+
+  return svn_error_trace(svn_io_remove_file2(dst, FALSE, pool));
+}
+
+/* Copy files of various sizes with svn_io_copy_file, which may use the
+   kernel's copy offloading. */
+static svn_error_t *
+test_copy_file(apr_pool_t *pool)
+{
+  static const apr_size_t sizes[] = { 0, 1, 65536 + 17,
+                                      4 * 1024 * 1024 + 3 };
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  const char *tmp_dir;
+  const char *src, *dst;
+  int i;
+
+  SVN_ERR(svn_test_make_sandbox_dir(&tmp_dir, "test_copy_file", pool));
+  src = svn_dirent_join(tmp_dir, "src", pool);
+  dst = svn_dirent_join(tmp_dir, "dst", pool);
+
+  for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(create_large_file(src, sizes[i], iterpool));
+      SVN_ERR(copy_and_compare(src, dst, iterpool));
+    }
+
+#if defined(__linux__)
+  /* Pseudo files report a size of 0 while having contents.  The kernel
+     copy would produce an empty file, so this must take the fallback. */
+  {
+    svn_node_kind_t kind;
+    SVN_ERR(svn_io_check_path("/proc/self/cmdline", &kind, pool));
+    if (kind == svn_node_file)
+      SVN_ERR(copy_and_compare("/proc/self/cmdline", dst, pool));
+  }
+#endif
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+/* Compare the speed of svn_io_copy_file with a copy through user-space
+   buffers for a large file. */
+static svn_error_t *
+test_copy_file_performance(apr_pool_t *pool)
+{
+  const apr_size_t size = 64 * 1024 * 1024;
+  const char *tmp_dir;
+  const char *src, *dst, *streamed;
+  svn_stream_t *from, *to;
+  apr_time_t start, copy_time, stream_time;
+
+  SVN_ERR(svn_test_make_sandbox_dir(&tmp_dir, "test_copy_file_performance",
+                                    pool));
+  src = svn_dirent_join(tmp_dir, "src", pool);
+  dst = svn_dirent_join(tmp_dir, "dst", pool);
+  streamed = svn_dirent_join(tmp_dir, "streamed", pool);
+  SVN_ERR(create_large_file(src, size, pool));
+
+  start = apr_time_now();
+  SVN_ERR(svn_io_copy_file(src, dst, TRUE, pool));
+  copy_time = apr_time_now() - start;
+
+  start = apr_time_now();
+  SVN_ERR(svn_stream_open_readonly(&from, src, pool, pool));
+  SVN_ERR(svn_stream_open_writable(&to, streamed, pool, pool));
+  SVN_ERR(svn_stream_copy3(from, to, NULL, NULL, pool));
+  stream_time = apr_time_now() - start;
+
+  printf("%" APR_SIZE_T_FMT " bytes: svn_io_copy_file %"
+         APR_TIME_T_FMT " usec, buffered copy %" APR_TIME_T_FMT
+         " usec\n", size, copy_time, stream_time);
+
+  return SVN_NO_ERROR;
+}
+
+
 /* The test table.  */
 
 static int max_threads = 3;
@@ -1516,6 +1636,10 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "test svn_io_remove_dir2() with read-only directory"),
     SVN_TEST_PASS2(test_rmtree_all_readonly,
                    "test svn_io_remove_dir2() with read-only tree"),
+    SVN_TEST_PASS2(test_copy_file,
+                   "test svn_io_copy_file()"),
+    SVN_TEST_SKIP2(test_copy_file_performance, TRUE,
+                   "optional svn_io_copy_file() performance test"),
     SVN_TEST_NULL
   };
 
@@ -849,6 +849,18 @@ test_string_matching(apr_pool_t *pool)
       {"x_234567890abcdef", "x1234567890abcdef", 1, 15},
       {"1234567890abcdefx", "1234567890abcdex", 15, 1},
 
+      /* long strings to exercise the vectorized code */
+      {"0123456789abcdefghijklmnopqrstuvwxyzABCDEF_",
+       "0123456789abcdefghijklmnopqrstuvwxyzABCDEFG", 42, 0},
+      {"_123456789abcdefghijklmnopqrstuvwxyzABCDEF",
+       "0123456789abcdefghijklmnopqrstuvwxyzABCDEF", 0, 41},
+      {"0123456789abcdefghij_lmnopqrstuvwxyzABCDEF",
+       "0123456789abcdefghijklmnopqrstuvwxyzABCDEF", 20, 21},
+      {"0123456789abcdefghijklmnopqrstuvwxyzABCDEF"
+       "0123456789abcdefghijklmnopqrstuvwxyzABCDEF",
+       "0123456789abcdefghijklmnopqrstuvwxyzABCDEF"
+       "0123456789abcdefghijklmnopqrstuvwxyzABCDEF", 84, 84},
+
       /* list terminator */
       {NULL}
     };
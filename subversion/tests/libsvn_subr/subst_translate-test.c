@@ -31,6 +31,7 @@
 #include "svn_string.h"
 #include "svn_subst.h"
 #include "svn_hash.h"
+#include "svn_pools.h"
 
 #define ARRAY_LEN(ary) ((sizeof (ary)) / (sizeof ((ary)[0])))
 
@@ -500,6 +501,114 @@ test_svn_subst_long_keywords(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* Translate SOURCE with EOL_STR and KEYWORDS through
+   svn_subst_stream_translated() ROUNDS times, verify that the result
+   equals EXPECTED and return the throughput in MB/s in *THROUGHPUT. */
+static svn_error_t *
+translate_throughput(double *throughput,
+                     const svn_stringbuf_t *source,
+                     const svn_stringbuf_t *expected,
+                     const char *eol_str,
+                     apr_hash_t *keywords,
+                     int rounds,
+                     apr_pool_t *pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  apr_time_t start = apr_time_now();
+  apr_time_t duration;
+  int i;
+
+  for (i = 0; i < rounds; ++i)
+    {
+      svn_string_t src_string;
+      svn_stringbuf_t *result;
+      svn_stream_t *dst;
+
+      svn_pool_clear(iterpool);
+      src_string.data = source->data;
+      src_string.len = source->len;
+
+      result = svn_stringbuf_create_ensure(expected->len, iterpool);
+      dst = svn_subst_stream_translated(
+              svn_stream_from_stringbuf(result, iterpool),
+              eol_str, FALSE, keywords, TRUE, iterpool);
+      SVN_ERR(svn_stream_copy3(svn_stream_from_string(&src_string,
+                                                      iterpool),
+                               dst, NULL, NULL, iterpool));
+
+      SVN_TEST_ASSERT(svn_stringbuf_compare(result, expected));
+    }
+
+  duration = apr_time_now() - start;
+  if (duration == 0)
+    duration = 1;
+  *throughput = (double)rounds * source->len / duration;
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+/* Benchmark EOL and keyword translation of mostly boring text, as it is
+   done for checkouts and exports. */
+static svn_error_t *
+test_translate_throughput(const svn_test_opts_t *opts,
+                          apr_pool_t *pool)
+{
+  enum { LINES = 20000, ROUNDS = 10 };
+  svn_stringbuf_t *source = svn_stringbuf_create_empty(pool);
+  svn_stringbuf_t *crlf = svn_stringbuf_create_empty(pool);
+  svn_stringbuf_t *expanded = svn_stringbuf_create_empty(pool);
+  svn_stringbuf_t *both = svn_stringbuf_create_empty(pool);
+  apr_hash_t *keywords = apr_hash_make(pool);
+  double eol_speed, keywords_speed, both_speed;
+  int i;
+
+  svn_hash_sets(keywords, "Rev", svn_string_create("42", pool));
+
+  for (i = 0; i < LINES; ++i)
+    {
+      const char *text;
+
+      /* Every 100th line has a keyword, a few more a lone '$'. */
+      if (i % 100 == 0)
+        text = "  /* Revision of this file: $Rev$ */";
+      else if (i % 50 == 0)
+        text = "  price = \"$100\";";
+      else
+        text = apr_psprintf(pool, "  result[%d] = compute_value(input, "
+                            "%d, flags & MASK);", i, i * 7);
+
+      svn_stringbuf_appendcstr(source, text);
+      svn_stringbuf_appendbyte(source, '\n');
+
+      svn_stringbuf_appendcstr(crlf, text);
+      svn_stringbuf_appendcstr(crlf, "\r\n");
+
+      if (i % 100 == 0)
+        text = "  /* Revision of this file: $Rev: 42 $ */";
+
+      svn_stringbuf_appendcstr(expanded, text);
+      svn_stringbuf_appendbyte(expanded, '\n');
+
+      svn_stringbuf_appendcstr(both, text);
+      svn_stringbuf_appendcstr(both, "\r\n");
+    }
+
+  SVN_ERR(translate_throughput(&eol_speed, source, crlf, "\r\n", NULL,
+                               ROUNDS, pool));
+  SVN_ERR(translate_throughput(&keywords_speed, source, expanded, NULL,
+                               keywords, ROUNDS, pool));
+  SVN_ERR(translate_throughput(&both_speed, source, both, "\r\n",
+                               keywords, ROUNDS, pool));
+
+  if (opts->verbose)
+    printf("translation: eol %.0f MB/s, keywords %.0f MB/s, "
+           "eol+keywords %.0f MB/s\n",
+           eol_speed, keywords_speed, both_speed);
+
+  return SVN_NO_ERROR;
+}
+
 static int max_threads = 1;
 
 static struct svn_test_descriptor_t test_funcs[] =
@@ -519,6 +628,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "test truncated keywords (issue 4349)"),
     SVN_TEST_PASS2(test_svn_subst_long_keywords,
                    "test long keywords (issue 4350)"),
+    SVN_TEST_OPTS_PASS(test_translate_throughput,
+                       "benchmark eol and keyword translation"),
     SVN_TEST_NULL
   };
 
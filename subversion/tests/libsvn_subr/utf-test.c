@@ -998,6 +998,115 @@ test_utf_xfrm(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* Fill BUF of LEN bytes with valid UTF-8 text.  If MIXED is FALSE, use
+   ASCII only.  Otherwise, mix in 2, 3 and 4 byte sequences. */
+static void
+fill_utf8_text(char *buf, apr_size_t len, svn_boolean_t mixed)
+{
+  static const char * const chars[] = {
+    "Subversion ", "\xc3\xa4", "\xe2\x82\xac", "\xf0\x9f\x98\x80",
+    "\xe6\x97\xa5\xe6\x9c\xac", "log\n", "\xd0\xaf"
+  };
+  apr_size_t pos = 0;
+  int i = 0;
+
+  while (pos < len)
+    {
+      const char *piece = mixed ? chars[i++ % 7] : chars[0];
+      apr_size_t piece_len = strlen(piece);
+
+      /* Pad with ASCII rather than splitting a sequence. */
+      if (pos + piece_len > len)
+        {
+          piece = " ";
+          piece_len = 1;
+        }
+
+      memcpy(buf + pos, piece, piece_len);
+      pos += piece_len;
+    }
+}
+
+/* Validate the LEN bytes in BUF repeatedly and return the throughput in
+   MB/s.  Verify that all validations return EXPECTED_LAST. */
+static svn_error_t *
+validation_throughput(double *throughput,
+                      const char *buf,
+                      apr_size_t len,
+                      const char *expected_last)
+{
+  enum { ROUNDS = 50 };
+  apr_time_t start = apr_time_now();
+  apr_time_t duration;
+  int i;
+
+  for (i = 0; i < ROUNDS; ++i)
+    {
+      SVN_TEST_ASSERT(svn_utf__is_valid(buf, len)
+                      == (expected_last == buf + len));
+      SVN_TEST_ASSERT(svn_utf__last_valid(buf, len) == expected_last);
+    }
+
+  duration = apr_time_now() - start;
+  if (duration == 0)
+    duration = 1;
+  *throughput = 2.0 * ROUNDS * len / duration;
+
+  return SVN_NO_ERROR;
+}
+
+/* Measure validation throughput for ASCII, mixed and invalid input and
+   check that the results agree with the reference implementation at all
+   lengths and alignments near block boundaries. */
+static svn_error_t *
+utf_validate_throughput(const svn_test_opts_t *opts,
+                        apr_pool_t *pool)
+{
+  enum { BUFFER_SIZE = 1024 * 1024 };
+  char *buf = apr_palloc(pool, BUFFER_SIZE + 1);
+  const char *invalid_at;
+  double ascii_speed, mixed_speed, invalid_speed;
+  apr_size_t offset, len;
+
+  /* Cross-check around the vector block sizes, including sequences
+     that get cut off or straddle a block boundary. */
+  fill_utf8_text(buf, 512, TRUE);
+  for (offset = 0; offset < 32; ++offset)
+    for (len = 0; len + offset <= 512; ++len)
+      {
+        const char *data = buf + offset;
+        const char *last = svn_utf__last_valid2(data, len);
+
+        if (svn_utf__last_valid(data, len) != last
+            || svn_utf__is_valid(data, len) != (last == data + len))
+          return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                                   "mismatch at offset %d, length %d",
+                                   (int)offset, (int)len);
+      }
+
+  fill_utf8_text(buf, BUFFER_SIZE, FALSE);
+  SVN_ERR(validation_throughput(&ascii_speed, buf, BUFFER_SIZE,
+                                buf + BUFFER_SIZE));
+
+  fill_utf8_text(buf, BUFFER_SIZE, TRUE);
+  SVN_ERR(validation_throughput(&mixed_speed, buf, BUFFER_SIZE,
+                                buf + BUFFER_SIZE));
+
+  /* An overlong '/' near the end of otherwise valid input. */
+  memcpy(buf + BUFFER_SIZE - 1000, "\xc0\xaf", 2);
+  invalid_at = svn_utf__last_valid2(buf, BUFFER_SIZE);
+  SVN_TEST_ASSERT(invalid_at < buf + BUFFER_SIZE);
+  SVN_ERR(validation_throughput(&invalid_speed, buf, BUFFER_SIZE,
+                                invalid_at));
+
+  if (opts->verbose)
+    printf("UTF-8 validation: ascii %.0f MB/s, mixed %.0f MB/s, "
+           "invalid %.0f MB/s\n",
+           ascii_speed, mixed_speed, invalid_speed);
+
+  return SVN_NO_ERROR;
+}
+
 
 /* The test table.  */
 
@@ -1028,6 +1137,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "test svn_utf__normalize"),
     SVN_TEST_PASS2(test_utf_xfrm,
                    "test svn_utf__xfrm"),
+    SVN_TEST_OPTS_PASS(utf_validate_throughput,
+                       "benchmark UTF-8 validation throughput"),
     SVN_TEST_NULL
   };
 